@@ -0,0 +1,999 @@
+// This file is part of the Anti-Lag 2.0 SDK.
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "ffx_antilag2_input.h"
+#include "ffx_antilag2_limiter.h"
+#include "ffx_antilag2_loader.h"
+#include "ffx_antilag2_pacing.h"
+#include "ffx_antilag2_registry.h"
+#include "ffx_antilag2_software.h"
+#include "ffx_antilag2_telemetry.h"
+#include "ffx_antilag2_trace.h"
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+// The front end and the null and software backends also build on platforms without the Windows headers.
+#ifndef _WIN32
+#ifndef _HRESULT_DEFINED
+#define _HRESULT_DEFINED
+typedef std::int32_t HRESULT;
+#endif
+#ifndef S_OK
+#define S_OK            ((HRESULT)0L)
+#endif
+#ifndef S_FALSE
+#define S_FALSE         ((HRESULT)1L)
+#endif
+#ifndef E_NOINTERFACE
+#define E_NOINTERFACE   ((HRESULT)0x80004002L)
+#endif
+#ifndef E_INVALIDARG
+#define E_INVALIDARG    ((HRESULT)0x80070057L)
+#endif
+#ifndef E_PENDING
+#define E_PENDING       ((HRESULT)0x8000000AL)
+#endif
+#endif
+
+namespace AMD {
+namespace AntiLag2 {
+
+    // Result of looking for the driver: the interface to initialize the backend with, or why there is none.
+    struct DriverProbeResult
+    {
+        HRESULT     hr;
+        void*       pInterface;     // Only set when hr is S_OK
+    };
+
+    enum class RecordedCallType : std::uint8_t
+    {
+        Initialize = 1,
+        DeInitialize,
+        Update,                     // Update without settings
+        UpdateWithState,            // Update( enable, maxFPS )
+        SetState,
+        MarkEndOfFrameRendering,
+        SetFrameGenFrameType,
+        PaceFrameGenPresent,
+        BeginUpdate,                // BeginUpdate without settings
+        BeginUpdateWithState,       // BeginUpdate( enable, maxFPS )
+        EndUpdate,
+        SetLatencyMarker,           // The marker goes in maxFPS
+        SetSplitDelay,
+    };
+
+    // One call into a Context, as captured by CallRecorder.
+    struct RecordedCall
+    {
+        Timestamp           entry;          // GetTimestamp() when the call was made
+        Timestamp           duration;       // Time spent in the call, including the latency-reducing delay
+        std::uint64_t       frameIndex;     // Frame the call applies to. For Update, the index it assigned
+        unsigned int        maxFPS;         // UpdateWithState, BeginUpdateWithState and SetState only, the LatencyMarker for SetLatencyMarker
+        std::int32_t        result;         // The returned HRESULT, for DeInitialize the returned reference count
+        RecordedCallType    type;
+        bool                flag;           // enable, or whether the frame is interpolated
+    };
+
+    // Receives every call into a Context, see SetRecorder. CallRecorder in ffx_antilag2_record.h writes them to a log.
+    class CallSink
+    {
+    public:
+        // May be called from any thread.
+        virtual void Record( const RecordedCall& call ) = 0;
+
+    protected:
+        ~CallSink() {}
+    };
+
+    // Receives the state of every frame of a Context, see SetSharedTelemetry. SharedTelemetryWriter in ffx_antilag2_shared.h
+    // publishes it to other processes.
+    class FrameSink
+    {
+    public:
+        // Called by the thread calling Update.
+        virtual void PublishFrame( std::uint64_t frameIndex, Timestamp updateEntry, Timestamp delay, bool enabled, unsigned int maxFPS ) = 0;
+
+        // May be called from any thread.
+        virtual void PublishFrameType( std::uint64_t frameIndex, bool interpolated ) = 0;
+
+    protected:
+        ~FrameSink() {}
+    };
+
+    // Makes the blocking InsertDelay call of a backend on behalf of BeginUpdate, so that the game thread can work during the delay.
+    // DelayThread in ffx_antilag2_async.h makes it on a thread of its own.
+    class DelayExecutor
+    {
+    public:
+        typedef HRESULT ( *Function )( void* argument );
+
+        // Calls function( argument ). The call started before must have been waited for.
+        virtual void Start( Function function, void* argument ) = 0;
+
+        // Whether the call started last has returned. May be called from any thread.
+        virtual bool IsDone() const = 0;
+
+        // Waits for the call started last and returns its result.
+        virtual HRESULT Wait() = 0;
+
+    protected:
+        ~DelayExecutor() {}
+    };
+
+    // Anti-Lag 2.0 front end, shared by all APIs. The backend is chosen at compile time:
+    //
+    //   AntiLag2DX11::Context      - DX11 driver or software implementation (ffx_antilag2_dx11.h)
+    //   AntiLag2DX12::Context      - DX12 driver or software implementation (ffx_antilag2_dx12.h)
+    //   AntiLag2::SoftwareContext  - software implementation without any driver interface, on any platform
+    //   AntiLag2::NullContext      - does nothing; every call compiles down to returning a constant
+    //
+    // A game that presents to several swapchains takes one context per swapchain from a ContextRegistry (ffx_antilag2_registry.h).
+    //
+    // A backend provides the following, with kActive set to false only when the backend does nothing at all:
+    //
+    //   static const bool kActive;
+    //   HRESULT      Initialize( ... );
+    //   bool         IsInitialized() const;
+    //   unsigned int DeInitialize();
+    //   HRESULT      SetState( bool enabled, unsigned int maxFPS );
+    //   HRESULT      InsertDelay();
+    //   HRESULT      BeginDelay( Timestamp* deadline );  // S_FALSE when the delay can only be inserted by blocking in InsertDelay
+    //   HRESULT      EndDelay();                         // Waits for the deadline BeginDelay returned
+    //   HRESULT      SignalInputSample( std::uint64_t frameIndex );
+    //   HRESULT      MarkEndOfFrame( std::uint64_t frameIndex );
+    //   HRESULT      SetFrameType( bool interpolated, std::uint64_t frameIndex );
+    //   HRESULT      InsertSplitDelay( std::uint64_t frameIndex );     // S_FALSE when the whole delay was inserted by InsertDelay
+    //
+    // The clock, SystemClock unless another one is given, provides the following. The simulator in tools/src/PipelineSim.h runs the
+    // front end on virtual time with one.
+    //
+    //   Timestamp    Now() const;
+    //   void         WaitUntil( Timestamp deadline );  // Only called by the presentation thread
+    //
+    // The DX11 and DX12 contexts keep the three members of earlier versions of the SDK and allocate the front end in Initialize.
+    // The async initialization and the delay thread of BeginUpdate are opt-in, see ffx_antilag2_async.h.
+    //
+    // Threading: Initialize and DeInitialize must not overlap with any other call on the same context.
+    // In between, Update is called from one thread at a time (the input thread) and is the only function that passes settings
+    // to the backend. SetState may be called from any thread: it stores the enable flag and maxFPS as one packed word with release
+    // semantics, and Update reads it with acquire semantics, so the two values are always seen together and the last writer wins.
+    // The frame index is published by Update with release semantics and read with acquire semantics by GetFrameIndex.
+    // MarkEndOfFrameRendering and SetFrameGenFrameType may be called from the render and presentation threads.
+    // SetLatencyMarker may be called from any thread, but the split delay is only inserted on the thread calling Update.
+    // BeginUpdate and EndUpdate take the place of Update on the same thread; IsUpdateReady and GetUpdateDeadline may be called from any thread.
+    // PaceFrameGenPresent must always be called from the same presentation thread.
+    // MarkFrameComplete may be called from any thread, but from one thread at a time and in frame order.
+    // SetDelayExecutor must not overlap with BeginUpdate or EndUpdate.
+    // SetRecorder may be called from any thread; a call that is in flight when the recorder is removed may still be recorded.
+    // The same goes for SetSharedTelemetry and a frame that is being published.
+    template<class Backend, class Clock = SystemClock>
+    class Context
+    {
+    public:
+        // Forwards to the backend's Initialize. Fails with E_INVALIDARG if the context is already initialized.
+        template<class... Args>
+        HRESULT Initialize( Args&&... args );
+        bool IsInitialized() const                      { return m_backend.IsInitialized(); }
+
+        // Returns the reference count of the backend's driver interface. It should be 0.
+        unsigned int DeInitialize();
+
+        // Returns a deinitialized context to the state it was declared in: no settings, frame index 0, no telemetry, no refresh
+        // rate, no delay executor, no recorder and no shared telemetry. Must not overlap with any other call.
+        void Reset();
+
+        // Call just before the input is polled. Applies the settings, inserts the latency-reducing delay and starts a new frame.
+        // A maxFPS of kMaxFPSAdaptive lets the AdaptiveLimiter pick the limit, which is passed to the backend like any other.
+        // Fractional limits and limits below the refresh rate are made by MakeMaxFPS and MakeMaxFPSBelowRefresh.
+        HRESULT Update( bool enable, unsigned int maxFPS );
+        HRESULT Update();
+
+        // Update in two halves, so that work which does not depend on the input can run during the delay. BeginUpdate applies the
+        // settings and starts the delay without waiting for it. Once the work is done, or the deadline has come, EndUpdate waits for
+        // whatever is left of the delay and starts the frame; sample the input right after it. A backend that can only delay by
+        // blocking does so on the DelayExecutor, and then there is no deadline to plan for: the delay is over when IsUpdateReady
+        // says so. Without an executor BeginUpdate blocks for the whole delay, which leaves nothing to overlap.
+        HRESULT BeginUpdate( bool enable, unsigned int maxFPS );
+        HRESULT BeginUpdate();
+        HRESULT EndUpdate();
+        bool IsUpdateReady() const;
+
+        // When the delay started by BeginUpdate ends, 0 when the backend does not know or no delay is pending.
+        Timestamp GetUpdateDeadline() const             { return m_pendingDeadline.load( std::memory_order_acquire ); }
+
+        // Publishes settings for the next Update, from any thread.
+        HRESULT SetState( bool enable, unsigned int maxFPS );
+
+        // Index Update assigned to the frame whose input was sampled last. Indices start at 1.
+        std::uint64_t GetFrameIndex() const             { return m_frameIndex.load( std::memory_order_acquire ); }
+
+        // Without a frame index the frame whose input was sampled last is assumed.
+        HRESULT MarkEndOfFrameRendering();
+        HRESULT MarkEndOfFrameRendering( std::uint64_t frameIndex );
+        HRESULT SetFrameGenFrameType( bool interpolated );
+        HRESULT SetFrameGenFrameType( bool interpolated, std::uint64_t frameIndex );
+
+        // Reports a point in the frame, see LatencyMarker. The times between the markers are the per-stage latencies of
+        // GetLatencyStats. RenderSubmitEnd also does what MarkEndOfFrameRendering does, so call one or the other.
+        // Without a frame index the frame whose input was sampled last is assumed, so SimulationStart goes after Update.
+        HRESULT SetLatencyMarker( LatencyMarker marker );
+        HRESULT SetLatencyMarker( LatencyMarker marker, std::uint64_t frameIndex );
+
+        // Splits the delay between Update and the RenderSubmitStart marker, which must then be set for every frame on the
+        // thread calling Update. The backend decides how much of the delay goes where; one that cannot split it, like the
+        // driver, keeps all of it in Update. May be called from any thread, it takes effect with the next marker.
+        HRESULT SetSplitDelay( bool enable );
+        bool IsSplitDelayEnabled() const                { return m_splitDelay.load( std::memory_order_relaxed ); }
+
+        // Call on the presentation thread instead of SetFrameGenFrameType, just before each Present of a frame generation pair.
+        // Waits until the frame is due according to the FrameGenPacer, then signals the frame type. The wait must not hold up
+        // the rendering of the next frame, or it becomes part of the cadence it paces.
+        HRESULT PaceFrameGenPresent( bool interpolated );
+        HRESULT PaceFrameGenPresent( bool interpolated, std::uint64_t frameIndex );
+
+        // Refresh rate of a variable refresh rate display, which caps the adaptive limit and is what MakeMaxFPSBelowRefresh limits
+        // are relative to, and the bottom of its range, around which no limit is placed. May be called from any thread.
+        HRESULT SetRefreshRate( double refreshHz, double minRefreshHz = 0.0 );
+
+        // Limit the adaptive limiter currently passes to the backend, 0 while it is measuring or not in use.
+        unsigned int GetAdaptiveMaxFPS() const          { return m_adaptive.load( std::memory_order_relaxed ) ? m_limiter.GetTarget() : 0; }
+
+        // Call with the time the GPU finished a frame, from a fence or a timestamp query translated to GetTimestamp() time, or the
+        // time the frame was presented if that is all the engine knows. Without a time the frame is taken to have ended now.
+        HRESULT MarkFrameComplete( std::uint64_t frameIndex );
+        HRESULT MarkFrameComplete( std::uint64_t frameIndex, Timestamp time );
+
+        // Latency in GPU frames of the frames reported to MarkFrameComplete, see FrameLatencyEstimator.
+        // S_FALSE means that not enough frames were reported yet.
+        HRESULT GetLatencyInFrames( float* frames ) const;
+
+        // See FrameTelemetry. S_FALSE means that nothing was recorded yet.
+        HRESULT GetLatencyStats( TelemetryInterval interval, LatencyStats* stats ) const;
+        HRESULT GetFrameRecord( unsigned int framesAgo, FrameRecord* record ) const;
+
+        // Makes BeginUpdate leave a blocking delay to the executor from now on, nullptr blocks in BeginUpdate. The executor must
+        // outlive the context or be removed first.
+        void SetDelayExecutor( DelayExecutor* executor ) { m_delayExecutor = executor; }
+
+        // Passes every call to the recorder from now on, nullptr stops. The recorder must outlive the context or be removed first.
+        void SetRecorder( CallSink* recorder )          { m_recorder.store( recorder, std::memory_order_release ); }
+
+        // Publishes every frame to the writer, such as a SharedTelemetryWriter, from now on, nullptr stops. The writer must
+        // outlive the context or be removed first.
+        void SetSharedTelemetry( FrameSink* writer )    { m_sharedTelemetry.store( writer, std::memory_order_release ); }
+
+        Backend&        GetBackend()                    { return m_backend; }
+        const Backend&  GetBackend() const              { return m_backend; }
+        Clock&          GetClock()                      { return m_clock; }
+        const AdaptiveLimiter& GetLimiter() const       { return m_limiter; }
+
+    private:
+        static const unsigned int kEnabledBit = 0x80000000u;
+
+        // Runs call and hands it to the recorder, if there is one.
+        template<class Call>
+        HRESULT Recorded( RecordedCallType type, bool flag, unsigned int maxFPS, std::uint64_t frameIndex, Call call );
+
+        // What EndUpdate has to wait for.
+        enum class PendingDelay : unsigned char
+        {
+            None,
+            Deadline,       // The backend's EndDelay
+            Thread,         // The backend's InsertDelay on m_delayExecutor
+            Inserted,       // Nothing, BeginUpdate made the backend's InsertDelay itself
+        };
+
+        void      StoreState( bool enable, unsigned int maxFPS );
+        Timestamp ApplyState();
+        void      StartFrame( Timestamp updateEntry, Timestamp delay );
+        HRESULT   UpdateFrame();
+        HRESULT   BeginFrame();
+        HRESULT   EndFrame();
+        HRESULT SignalEndOfFrame( std::uint64_t frameIndex );
+        HRESULT SignalFrameType( bool interpolated, std::uint64_t frameIndex );
+        HRESULT SignalLatencyMarker( LatencyMarker marker, std::uint64_t frameIndex );
+
+        Backend                     m_backend;
+        std::atomic<unsigned int>   m_requestedState{ 0 };   // Packed settings published by SetState or Update
+        std::atomic<bool>           m_splitDelay{ false };
+        unsigned int                m_appliedState = 0;      // Packed settings last passed to the backend, only accessed by Update
+        std::atomic<bool>           m_adaptive{ false };     // Whether the requested maxFPS is kMaxFPSAdaptive, only written by Update
+        Timestamp                   m_lastUpdateEntry = 0;   // Only accessed by Update
+        AdaptiveLimiter             m_limiter;
+        std::atomic<std::uint64_t>  m_frameIndex{ 0 };
+        FrameTelemetry              m_telemetry;
+        FrameLatencyEstimator       m_latencyEstimator;      // Only written by MarkFrameComplete
+        FrameGenPacer               m_pacer;                 // Only accessed by the presentation thread
+        Clock                       m_clock;                 // WaitUntil is only called by the presentation thread
+        std::atomic<CallSink*>      m_recorder{ nullptr };
+        std::atomic<FrameSink*>     m_sharedTelemetry{ nullptr };
+        std::atomic<PendingDelay>   m_pendingDelay{ PendingDelay::None };   // Only written by BeginUpdate and EndUpdate
+        std::atomic<Timestamp>      m_pendingDeadline{ 0 };
+        Timestamp                   m_pendingEntry = 0;      // Time BeginUpdate was called
+        HRESULT                     m_pendingResult = S_OK;  // What the backend's InsertDelay returned, for PendingDelay::Inserted
+        DelayExecutor*              m_delayExecutor = nullptr;
+    };
+
+    // Backend that does nothing, for builds and platforms without Anti-Lag 2.0.
+    class NullBackend
+    {
+    public:
+        static const bool kActive = false;
+
+        HRESULT         Initialize()                            { return S_OK; }
+        bool            IsInitialized() const                   { return true; }
+        unsigned int    DeInitialize()                          { return 0; }
+        HRESULT         SetState( bool, unsigned int )          { return S_OK; }
+        HRESULT         InsertDelay()                           { return S_FALSE; }
+        HRESULT         BeginDelay( Timestamp* )                { return S_FALSE; }
+        HRESULT         EndDelay()                              { return S_FALSE; }
+        HRESULT         SignalInputSample( std::uint64_t )      { return S_OK; }
+        HRESULT         MarkEndOfFrame( std::uint64_t )         { return S_OK; }
+        HRESULT         SetFrameType( bool, std::uint64_t )     { return S_OK; }
+        HRESULT         InsertSplitDelay( std::uint64_t )       { return S_FALSE; }
+    };
+
+    // Backend running the software implementation directly, without going through a driver interface.
+    class SoftwareBackend
+    {
+    public:
+        static const bool kActive = true;
+
+        HRESULT         Initialize();
+        bool            IsInitialized() const                   { return m_initialized; }
+        unsigned int    DeInitialize();
+        HRESULT         SetState( bool enabled, unsigned int maxFPS );
+        HRESULT         InsertDelay();
+        HRESULT         BeginDelay( Timestamp* deadline );
+        HRESULT         EndDelay();
+        HRESULT         SignalInputSample( std::uint64_t frameIndex );
+        HRESULT         MarkEndOfFrame( std::uint64_t frameIndex );
+        HRESULT         SetFrameType( bool, std::uint64_t )     { return S_OK; }
+        HRESULT         InsertSplitDelay( std::uint64_t frameIndex );
+
+        const SoftwareLatencyModel& GetModel() const            { return m_model; }
+
+    private:
+        bool                    m_initialized = false;
+        bool                    m_delaying = false;     // Between BeginDelay and EndDelay with the model enabled
+        bool                    m_split = false;        // The last frame had a split delay, so this one starts with the early half
+        bool                    m_early = false;        // BeginDelay started the early half, InsertSplitDelay inserts the rest
+        Timestamp               m_deadline = 0;
+        SoftwareLatencyModel    m_model;
+        PreciseWait             m_wait;
+    };
+
+    typedef Context<NullBackend>        NullContext;
+    typedef Context<SoftwareBackend>    SoftwareContext;
+
+    // Deinitializes a context and returns it to the state it was declared in, for ContextRegistry. Returns what DeInitialize
+    // returned. The DX11 and DX12 headers have one for their contexts.
+    template<class Backend, class Clock>
+    unsigned int ResetContext( Context<Backend, Clock>& context );
+
+    //
+    // Private implementation details below.
+    //
+
+    template<class Backend, class Clock>
+    template<class... Args>
+    inline HRESULT Context<Backend, Clock>::Initialize( Args&&... args )
+    {
+        if ( Backend::kActive && m_backend.IsInitialized() )
+        {
+            return E_INVALIDARG;
+        }
+        m_appliedState = 0;
+        m_lastUpdateEntry = 0;
+        m_adaptive.store( false, std::memory_order_relaxed );
+        m_pacer.Reset();
+        m_latencyEstimator.Reset();
+        return Recorded( RecordedCallType::Initialize, false, 0, 0, [&]() { return m_backend.Initialize( std::forward<Args>( args )... ); } );
+    }
+
+    template<class Backend, class Clock>
+    inline unsigned int Context<Backend, Clock>::DeInitialize()
+    {
+        if ( m_pendingDelay.load( std::memory_order_relaxed ) == PendingDelay::Thread )
+        {
+            m_delayExecutor->Wait();
+        }
+        m_pendingDelay.store( PendingDelay::None, std::memory_order_relaxed );
+        m_pendingDeadline.store( 0, std::memory_order_relaxed );
+        m_appliedState = 0;
+        m_lastUpdateEntry = 0;
+        m_adaptive.store( false, std::memory_order_relaxed );
+        unsigned int refCount = 0;
+        Recorded( RecordedCallType::DeInitialize, false, 0, 0, [&]()
+        {
+            refCount = m_backend.IsInitialized() ? m_backend.DeInitialize() : 0;
+            return (HRESULT)refCount;
+        } );
+        return refCount;
+    }
+
+    template<class Backend, class Clock>
+    inline void Context<Backend, Clock>::Reset()
+    {
+        m_requestedState.store( 0, std::memory_order_relaxed );
+        m_splitDelay.store( false, std::memory_order_relaxed );
+        m_appliedState = 0;
+        m_adaptive.store( false, std::memory_order_relaxed );
+        m_lastUpdateEntry = 0;
+        m_limiter.Reset();
+        m_limiter.SetRefreshRate( 0.0 );
+        m_frameIndex.store( 0, std::memory_order_release );
+        m_telemetry.Reset();
+        m_latencyEstimator.Reset();
+        m_pacer.Reset();
+        m_recorder.store( nullptr, std::memory_order_release );
+        m_sharedTelemetry.store( nullptr, std::memory_order_release );
+        m_delayExecutor = nullptr;
+    }
+
+    template<class Backend, class Clock>
+    inline unsigned int ResetContext( Context<Backend, Clock>& context )
+    {
+        const unsigned int refCount = context.DeInitialize();
+        context.Reset();
+        return refCount;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::SetState( bool enable, unsigned int maxFPS )
+    {
+        return Recorded( RecordedCallType::SetState, enable, maxFPS, 0, [&]()
+        {
+            StoreState( enable, maxFPS );
+            return S_OK;
+        } );
+    }
+
+    template<class Backend, class Clock>
+    inline void Context<Backend, Clock>::StoreState( bool enable, unsigned int maxFPS )
+    {
+        if ( Backend::kActive )
+        {
+            m_requestedState.store( ( enable ? kEnabledBit : 0u ) | ( maxFPS & ~kEnabledBit ), std::memory_order_release );
+        }
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::SetRefreshRate( double refreshHz, double minRefreshHz )
+    {
+        if ( Backend::kActive )
+        {
+            m_limiter.SetRefreshRate( refreshHz, minRefreshHz );
+        }
+        return S_OK;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::Update( bool enable, unsigned int maxFPS )
+    {
+        return Recorded( RecordedCallType::UpdateWithState, enable, maxFPS, 0, [&]()
+        {
+            StoreState( enable, maxFPS );
+            return UpdateFrame();
+        } );
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::Update()
+    {
+        return Recorded( RecordedCallType::Update, false, 0, 0, [&]() { return UpdateFrame(); } );
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::BeginUpdate( bool enable, unsigned int maxFPS )
+    {
+        return Recorded( RecordedCallType::BeginUpdateWithState, enable, maxFPS, 0, [&]()
+        {
+            StoreState( enable, maxFPS );
+            return BeginFrame();
+        } );
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::BeginUpdate()
+    {
+        return Recorded( RecordedCallType::BeginUpdate, false, 0, 0, [&]() { return BeginFrame(); } );
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::EndUpdate()
+    {
+        return Recorded( RecordedCallType::EndUpdate, false, 0, 0, [&]() { return EndFrame(); } );
+    }
+
+    template<class Backend, class Clock>
+    inline bool Context<Backend, Clock>::IsUpdateReady() const
+    {
+        switch ( m_pendingDelay.load( std::memory_order_acquire ) )
+        {
+            case PendingDelay::Deadline:    return m_clock.Now() >= m_pendingDeadline.load( std::memory_order_acquire );
+            case PendingDelay::Thread:      return m_delayExecutor->IsDone();
+            default:                        return true;
+        }
+    }
+
+    template<class Backend, class Clock>
+    inline Timestamp Context<Backend, Clock>::ApplyState()
+    {
+        const Timestamp updateEntry = m_clock.Now();
+
+        // Let the adaptive limiter pick maxFPS when asked to. It starts over every time it is switched on.
+        unsigned int state = m_requestedState.load( std::memory_order_acquire );
+        const bool adaptive = ( state & ~kEnabledBit ) == kMaxFPSAdaptive;
+        if ( adaptive != m_adaptive.load( std::memory_order_relaxed ) )
+        {
+            m_limiter.Reset();
+            m_adaptive.store( adaptive, std::memory_order_relaxed );
+        }
+        else if ( adaptive && m_lastUpdateEntry )
+        {
+            m_limiter.OnFrame( updateEntry - m_lastUpdateEntry );
+        }
+        if ( adaptive )
+        {
+            state = ( state & kEnabledBit ) | m_limiter.GetTarget();
+        }
+        else if ( state & ~kEnabledBit )
+        {
+            // Limits relative to the refresh rate follow it, so they are resolved every frame.
+            state = ( state & kEnabledBit ) | m_limiter.Resolve( state & ~kEnabledBit );
+        }
+        m_lastUpdateEntry = updateEntry;
+
+        // Update the Anti-Lag 2.0 internal state only when necessary:
+        if ( m_appliedState != state )
+        {
+            m_appliedState = state;
+            m_backend.SetState( ( state & kEnabledBit ) != 0, state & ~kEnabledBit );
+        }
+        return updateEntry;
+    }
+
+    template<class Backend, class Clock>
+    inline void Context<Backend, Clock>::StartFrame( Timestamp updateEntry, Timestamp delay )
+    {
+        // The input is sampled next, which is where the frame gets its index.
+        const std::uint64_t frameIndex = m_frameIndex.load( std::memory_order_relaxed ) + 1;
+        m_telemetry.RecordUpdate( frameIndex, updateEntry, delay );
+        if ( FrameSink* shared = m_sharedTelemetry.load( std::memory_order_acquire ) )
+        {
+            shared->PublishFrame( frameIndex, updateEntry, delay, ( m_appliedState & kEnabledBit ) != 0, GetWholeMaxFPS( m_appliedState & ~kEnabledBit ) );
+        }
+        m_frameIndex.store( frameIndex, std::memory_order_release );
+        m_backend.SignalInputSample( frameIndex );
+        FFX_ANTILAG2_TRACE_END( "AntiLag2::Update", frameIndex );
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::UpdateFrame()
+    {
+        if ( !Backend::kActive )
+        {
+            return S_OK;
+        }
+
+        // This function needs to be called once per frame, before the user input
+        // is sampled - or optionally also when the UI settings are modified.
+        if ( !m_backend.IsInitialized() )
+        {
+            return E_NOINTERFACE;
+        }
+        if ( m_pendingDelay.load( std::memory_order_relaxed ) != PendingDelay::None )
+        {
+            return E_INVALIDARG;
+        }
+
+        FFX_ANTILAG2_TRACE_BEGIN( "AntiLag2::Update" );
+        const Timestamp updateEntry = ApplyState();
+
+        // Insert the latency-reducing delay.
+        // (if the state has not been set to 'enabled' this call will have no effect)
+        FFX_ANTILAG2_TRACE_BEGIN( "AntiLag2::Delay" );
+        const Timestamp delayStart = m_clock.Now();
+        const HRESULT hr = m_backend.InsertDelay();
+        const Timestamp delay = m_clock.Now() - delayStart;
+        FFX_ANTILAG2_TRACE_END( "AntiLag2::Delay", 0 );
+
+        StartFrame( updateEntry, delay );
+        return hr == S_OK || hr == S_FALSE ? S_OK : hr;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::BeginFrame()
+    {
+        if ( !Backend::kActive )
+        {
+            return S_OK;
+        }
+        if ( !m_backend.IsInitialized() )
+        {
+            return E_NOINTERFACE;
+        }
+        if ( m_pendingDelay.load( std::memory_order_relaxed ) != PendingDelay::None )
+        {
+            return E_INVALIDARG;
+        }
+
+        // The Update trace event spans the whole delay, including the work done during it.
+        FFX_ANTILAG2_TRACE_BEGIN( "AntiLag2::Update" );
+        m_pendingEntry = ApplyState();
+        Timestamp deadline = 0;
+        if ( m_backend.BeginDelay( &deadline ) == S_OK )
+        {
+            m_pendingDeadline.store( deadline, std::memory_order_release );
+            m_pendingDelay.store( PendingDelay::Deadline, std::memory_order_release );
+        }
+        else if ( m_delayExecutor )
+        {
+            m_pendingDeadline.store( 0, std::memory_order_release );
+            m_delayExecutor->Start( []( void* context ) { return static_cast<Context*>( context )->m_backend.InsertDelay(); }, this );
+            m_pendingDelay.store( PendingDelay::Thread, std::memory_order_release );
+        }
+        else
+        {
+            m_pendingDeadline.store( 0, std::memory_order_release );
+            m_pendingResult = m_backend.InsertDelay();
+            m_pendingDelay.store( PendingDelay::Inserted, std::memory_order_release );
+        }
+        return S_OK;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::EndFrame()
+    {
+        if ( !Backend::kActive )
+        {
+            return S_OK;
+        }
+        if ( !m_backend.IsInitialized() )
+        {
+            return E_NOINTERFACE;
+        }
+
+        HRESULT hr = S_OK;
+        switch ( m_pendingDelay.load( std::memory_order_relaxed ) )
+        {
+            case PendingDelay::Deadline:    hr = m_backend.EndDelay();      break;
+            case PendingDelay::Thread:      hr = m_delayExecutor->Wait();   break;
+            case PendingDelay::Inserted:    hr = m_pendingResult;           break;
+            default:                        return E_INVALIDARG;
+        }
+        m_pendingDelay.store( PendingDelay::None, std::memory_order_release );
+        m_pendingDeadline.store( 0, std::memory_order_release );
+
+        StartFrame( m_pendingEntry, m_clock.Now() - m_pendingEntry );
+        return hr == S_OK || hr == S_FALSE ? S_OK : hr;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::MarkEndOfFrameRendering()
+    {
+        return Backend::kActive ? MarkEndOfFrameRendering( GetFrameIndex() ) : S_OK;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::MarkEndOfFrameRendering( std::uint64_t frameIndex )
+    {
+        return Recorded( RecordedCallType::MarkEndOfFrameRendering, false, 0, frameIndex, [&]() { return SignalEndOfFrame( frameIndex ); } );
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::SignalEndOfFrame( std::uint64_t frameIndex )
+    {
+        if ( !Backend::kActive )
+        {
+            return S_OK;
+        }
+        FFX_ANTILAG2_TRACE_INSTANT( "AntiLag2::MarkEndOfFrameRendering", frameIndex );
+        m_telemetry.RecordEndOfFrame( frameIndex, m_clock.Now() );
+        return m_backend.IsInitialized() ? m_backend.MarkEndOfFrame( frameIndex ) : E_NOINTERFACE;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::SetFrameGenFrameType( bool interpolated )
+    {
+        return Backend::kActive ? SetFrameGenFrameType( interpolated, GetFrameIndex() ) : S_OK;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::SetFrameGenFrameType( bool interpolated, std::uint64_t frameIndex )
+    {
+        return Recorded( RecordedCallType::SetFrameGenFrameType, interpolated, 0, frameIndex, [&]() { return SignalFrameType( interpolated, frameIndex ); } );
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::SignalFrameType( bool interpolated, std::uint64_t frameIndex )
+    {
+        if ( !Backend::kActive )
+        {
+            return S_OK;
+        }
+        FFX_ANTILAG2_TRACE_INSTANT( interpolated ? "AntiLag2::SetFrameGenFrameType(interpolated)" : "AntiLag2::SetFrameGenFrameType(rendered)", frameIndex );
+        m_telemetry.RecordFrameType( frameIndex, interpolated );
+        if ( FrameSink* shared = m_sharedTelemetry.load( std::memory_order_acquire ) )
+        {
+            shared->PublishFrameType( frameIndex, interpolated );
+        }
+        return m_backend.IsInitialized() ? m_backend.SetFrameType( interpolated, frameIndex ) : E_NOINTERFACE;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::SetLatencyMarker( LatencyMarker marker )
+    {
+        return Backend::kActive ? SetLatencyMarker( marker, GetFrameIndex() ) : S_OK;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::SetLatencyMarker( LatencyMarker marker, std::uint64_t frameIndex )
+    {
+        return Recorded( RecordedCallType::SetLatencyMarker, false, (unsigned int)marker, frameIndex, [&]() { return SignalLatencyMarker( marker, frameIndex ); } );
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::SignalLatencyMarker( LatencyMarker marker, std::uint64_t frameIndex )
+    {
+        if ( !Backend::kActive )
+        {
+            return S_OK;
+        }
+        if ( (unsigned int)marker >= kLatencyMarkerCount )
+        {
+            return E_INVALIDARG;
+        }
+        if ( !m_backend.IsInitialized() )
+        {
+            return E_NOINTERFACE;
+        }
+
+        // Only the frame Update started last can still be delayed, a render thread reporting an older one is not.
+        HRESULT hr = S_OK;
+        if ( marker == LatencyMarker::RenderSubmitStart && m_splitDelay.load( std::memory_order_relaxed ) &&
+             frameIndex == m_frameIndex.load( std::memory_order_relaxed ) )
+        {
+            FFX_ANTILAG2_TRACE_BEGIN( "AntiLag2::SplitDelay" );
+            const Timestamp delayStart = m_clock.Now();
+            hr = m_backend.InsertSplitDelay( frameIndex );
+            m_telemetry.RecordSplitDelay( frameIndex, m_clock.Now() - delayStart );
+            FFX_ANTILAG2_TRACE_END( "AntiLag2::SplitDelay", frameIndex );
+        }
+        if ( marker == LatencyMarker::RenderSubmitEnd )
+        {
+            m_telemetry.RecordMarker( frameIndex, marker, m_clock.Now() );
+            return SignalEndOfFrame( frameIndex );
+        }
+        FFX_ANTILAG2_TRACE_INSTANT( GetLatencyMarkerName( marker ), frameIndex );
+        m_telemetry.RecordMarker( frameIndex, marker, m_clock.Now() );
+        return hr == S_OK || hr == S_FALSE ? S_OK : hr;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::SetSplitDelay( bool enable )
+    {
+        return Recorded( RecordedCallType::SetSplitDelay, enable, 0, 0, [&]()
+        {
+            if ( Backend::kActive )
+            {
+                m_splitDelay.store( enable, std::memory_order_relaxed );
+            }
+            return S_OK;
+        } );
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::PaceFrameGenPresent( bool interpolated )
+    {
+        return Backend::kActive ? PaceFrameGenPresent( interpolated, GetFrameIndex() ) : S_OK;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::PaceFrameGenPresent( bool interpolated, std::uint64_t frameIndex )
+    {
+        if ( !Backend::kActive )
+        {
+            return S_OK;
+        }
+        return Recorded( RecordedCallType::PaceFrameGenPresent, interpolated, 0, frameIndex, [&]()
+        {
+            FFX_ANTILAG2_TRACE_BEGIN( "AntiLag2::PaceFrameGenPresent" );
+            const Timestamp ready = m_clock.Now();
+            m_clock.WaitUntil( interpolated ? m_pacer.ScheduleInterpolated( ready ) : m_pacer.ScheduleReal( ready ) );
+            FFX_ANTILAG2_TRACE_END( "AntiLag2::PaceFrameGenPresent", frameIndex );
+            return SignalFrameType( interpolated, frameIndex );
+        } );
+    }
+
+    template<class Backend, class Clock>
+    template<class Call>
+    inline HRESULT Context<Backend, Clock>::Recorded( RecordedCallType type, bool flag, unsigned int maxFPS, std::uint64_t frameIndex, Call call )
+    {
+        CallSink* recorder = Backend::kActive ? m_recorder.load( std::memory_order_acquire ) : nullptr;
+        if ( recorder == nullptr )
+        {
+            return call();
+        }
+        const Timestamp entry = m_clock.Now();
+        const HRESULT hr = call();
+        if ( type == RecordedCallType::Update || type == RecordedCallType::UpdateWithState || type == RecordedCallType::EndUpdate )
+        {
+            frameIndex = m_frameIndex.load( std::memory_order_relaxed );
+        }
+        recorder->Record( { entry, m_clock.Now() - entry, frameIndex, maxFPS, (std::int32_t)hr, type, flag } );
+        return hr;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::MarkFrameComplete( std::uint64_t frameIndex )
+    {
+        return Backend::kActive ? MarkFrameComplete( frameIndex, m_clock.Now() ) : S_OK;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::MarkFrameComplete( std::uint64_t frameIndex, Timestamp time )
+    {
+        if ( !Backend::kActive )
+        {
+            return S_OK;
+        }
+        FFX_ANTILAG2_TRACE_INSTANT( "AntiLag2::MarkFrameComplete", frameIndex );
+        m_telemetry.RecordFrameComplete( frameIndex, time );
+
+        // The input sample time comes from the frame's record, which is gone once the frame has dropped out of the ring.
+        FrameRecord record;
+        if ( !m_telemetry.GetRecord( frameIndex, &record ) )
+        {
+            return S_FALSE;
+        }
+        m_latencyEstimator.AddFrame( frameIndex, record.updateEntry + record.delay, time );
+        return S_OK;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::GetLatencyInFrames( float* frames ) const
+    {
+        if ( frames == nullptr )
+        {
+            return E_INVALIDARG;
+        }
+        return m_latencyEstimator.GetEstimate( frames ) ? S_OK : S_FALSE;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::GetLatencyStats( TelemetryInterval interval, LatencyStats* stats ) const
+    {
+        if ( stats == nullptr )
+        {
+            return E_INVALIDARG;
+        }
+        return m_telemetry.GetStats( interval, stats ) ? S_OK : S_FALSE;
+    }
+
+    template<class Backend, class Clock>
+    inline HRESULT Context<Backend, Clock>::GetFrameRecord( unsigned int framesAgo, FrameRecord* record ) const
+    {
+        if ( record == nullptr )
+        {
+            return E_INVALIDARG;
+        }
+        const std::uint64_t latest = m_telemetry.GetLatestFrameIndex();
+        return framesAgo < latest && m_telemetry.GetRecord( latest - framesAgo, record ) ? S_OK : S_FALSE;
+    }
+
+    inline HRESULT SoftwareBackend::Initialize()
+    {
+        m_model.SetState( false, 0 ); // Anti-Lag 2.0 is disabled during initialization
+        m_initialized = true;
+        return S_OK;
+    }
+
+    inline unsigned int SoftwareBackend::DeInitialize()
+    {
+        m_model.SetState( false, 0 );
+        m_initialized = false;
+        return 0;
+    }
+
+    inline HRESULT SoftwareBackend::SetState( bool enabled, unsigned int maxFPS )
+    {
+        m_model.SetState( enabled, maxFPS );
+        return S_OK;
+    }
+
+    inline HRESULT SoftwareBackend::InsertDelay()
+    {
+        Timestamp deadline;
+        BeginDelay( &deadline );
+        return EndDelay();
+    }
+
+    inline HRESULT SoftwareBackend::BeginDelay( Timestamp* deadline )
+    {
+        // The split delay of the last frame tells whether this one gets one too. The first frame of a split delays in full.
+        m_delaying = m_model.IsEnabled();
+        m_early = m_delaying && m_split;
+        m_split = false;
+        const Timestamp now = GetTimestamp();
+        m_deadline = !m_delaying ? now : m_early ? m_model.BeginEarlyDelay( now ) : m_model.BeginDelay( now );
+        *deadline = m_deadline;
+        return S_OK;
+    }
+
+    inline HRESULT SoftwareBackend::EndDelay()
+    {
+        if ( !m_delaying )
+        {
+            return S_FALSE;
+        }
+        m_delaying = false;
+        m_wait.WaitUntil( m_deadline );
+        if ( m_early )
+        {
+            m_model.EndEarlyDelay( GetTimestamp() );
+        }
+        else
+        {
+            m_model.EndDelay( GetTimestamp() );
+        }
+        return S_OK;
+    }
+
+    inline HRESULT SoftwareBackend::InsertSplitDelay( std::uint64_t )
+    {
+        m_split = true;
+        if ( !m_early )
+        {
+            return S_FALSE;
+        }
+        m_early = false;
+        m_wait.WaitUntil( m_model.BeginDelay( GetTimestamp() ) );
+        m_model.EndDelay( GetTimestamp() );
+        return S_OK;
+    }
+
+    inline HRESULT SoftwareBackend::SignalInputSample( std::uint64_t frameIndex )
+    {
+        m_model.SetFrameIndex( frameIndex );
+        return S_OK;
+    }
+
+    inline HRESULT SoftwareBackend::MarkEndOfFrame( std::uint64_t frameIndex )
+    {
+        if ( frameIndex )
+        {
+            m_model.MarkEndOfFrame( frameIndex, GetTimestamp() );
+        }
+        else
+        {
+            m_model.MarkEndOfFrame( GetTimestamp() );
+        }
+        return S_OK;
+    }
+
+} // namespace AntiLag2
+} // namespace AMD
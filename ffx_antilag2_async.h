@@ -0,0 +1,195 @@
+// This file is part of the Anti-Lag 2.0 SDK.
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+// Opt-in threads of the SDK: the background driver lookup of InitializeAsync, and the thread that makes the blocking delay of
+// the driver on behalf of BeginUpdate. A game that uses neither does not include this header.
+
+#include "ffx_antilag2.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace AMD {
+namespace AntiLag2 {
+
+    // Thread making one blocking call at a time on behalf of another, for backends that can only insert the delay by blocking.
+    // Attach it to a context with SetDelayExecutor (SetDelayThread in the DX headers) to let BeginUpdate return during the
+    // driver's delay. The thread is started by the first call and stopped by Stop or the destructor.
+    class DelayThread final : public DelayExecutor
+    {
+    public:
+        DelayThread() {}
+        DelayThread( const DelayThread& ) = delete;
+        DelayThread& operator=( const DelayThread& ) = delete;
+        ~DelayThread()                                  { Stop(); }
+
+        // Calls function( argument ) on the thread. The call started before must have been waited for.
+        virtual void Start( Function function, void* argument ) override;
+
+        // Whether the call started last has returned. May be called from any thread.
+        virtual bool IsDone() const override            { return m_done.load( std::memory_order_acquire ); }
+
+        // Waits for the call started last and returns its result.
+        virtual HRESULT Wait() override;
+
+        // Finishes the call in progress, if any, and ends the thread.
+        void Stop();
+
+    private:
+        void Run();
+
+        std::thread                 m_thread;
+        std::mutex                  m_mutex;
+        std::condition_variable     m_condition;
+        Function                    m_function = nullptr;
+        void*                       m_argument = nullptr;
+        bool                        m_exit = false;
+        HRESULT                     m_result = S_OK;
+        std::atomic<bool>           m_done{ true };
+    };
+
+    // Looks for the driver on a background thread, for InitializeAsync in the DX headers. Declare one next to the context and
+    // pass it to every InitializeAsync call of an initialization; it can be used again for the next one.
+    //
+    // Poll must be called from one thread at a time. Cancel, or the destructor, waits for a lookup that is still running and
+    // releases the interface it found: call it before destroying the device when InitializeAsync has not finished.
+    class AsyncDriverProbe
+    {
+    public:
+        AsyncDriverProbe() {}
+        AsyncDriverProbe( const AsyncDriverProbe& ) = delete;
+        AsyncDriverProbe& operator=( const AsyncDriverProbe& ) = delete;
+        ~AsyncDriverProbe()                             { Cancel(); }
+
+        // Runs probe, a callable returning a DriverProbeResult for an Interface, on a background thread the first time, and returns
+        // E_PENDING until it has returned. Then returns S_OK with its result in *result, which owns the interface it found.
+        template<class Interface, class Probe>
+        HRESULT Poll( Probe probe, DriverProbeResult* result );
+
+        // Whether a lookup is running or its result has not been taken yet.
+        bool IsPending() const                          { return m_probe.valid(); }
+
+        // Waits for a lookup that is running and releases the interface it found.
+        void Cancel();
+
+    private:
+        std::future<DriverProbeResult>  m_probe;
+        void                            ( *m_release )( void* pInterface ) = nullptr;
+    };
+
+    //
+    // Private implementation details below.
+    //
+
+    inline void DelayThread::Start( Function function, void* argument )
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( !m_thread.joinable() )
+        {
+            m_thread = std::thread( &DelayThread::Run, this );
+        }
+        m_function = function;
+        m_argument = argument;
+        m_done.store( false, std::memory_order_relaxed );
+        m_condition.notify_all();
+    }
+
+    inline HRESULT DelayThread::Wait()
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_condition.wait( lock, [this]() { return m_done.load( std::memory_order_relaxed ); } );
+        return m_result;
+    }
+
+    inline void DelayThread::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_exit = true;
+            m_condition.notify_all();
+        }
+        if ( m_thread.joinable() )
+        {
+            m_thread.join();
+        }
+        m_exit = false;
+    }
+
+    inline void DelayThread::Run()
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        for ( ;; )
+        {
+            m_condition.wait( lock, [this]() { return m_function != nullptr || m_exit; } );
+            if ( m_function == nullptr )
+            {
+                return;
+            }
+            const Function function = m_function;
+            void* argument = m_argument;
+            m_function = nullptr;
+            lock.unlock();
+            const HRESULT result = function( argument );
+            lock.lock();
+            m_result = result;
+            m_done.store( true, std::memory_order_release );
+            m_condition.notify_all();
+        }
+    }
+
+    template<class Interface, class Probe>
+    inline HRESULT AsyncDriverProbe::Poll( Probe probe, DriverProbeResult* result )
+    {
+        if ( !m_probe.valid() )
+        {
+            m_release = []( void* pInterface ) { static_cast<Interface*>( pInterface )->Release(); };
+            m_probe = std::async( std::launch::async, std::move( probe ) );
+        }
+        if ( m_probe.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+        {
+            return E_PENDING;
+        }
+        *result = m_probe.get();
+        return S_OK;
+    }
+
+    inline void AsyncDriverProbe::Cancel()
+    {
+        if ( m_probe.valid() )
+        {
+            const DriverProbeResult result = m_probe.get();
+            if ( result.hr == S_OK && result.pInterface )
+            {
+                m_release( result.pInterface );
+            }
+        }
+    }
+
+} // namespace AntiLag2
+} // namespace AMD
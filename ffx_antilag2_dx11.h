@@ -21,17 +21,43 @@
 
 #pragma once
 
+#include "ffx_antilag2.h"
+
+#include <cstring>
+
 namespace AMD {
 namespace AntiLag2DX11 {
 
     struct Context;
+    struct SystemLoader;
 
     // Initialize function - call this once before the Update function.
     // context - Declare a persistent Context variable in your game code. Ensure the contents are zero'ed, and pass the address in to initialize it.
     //           Be sure to use the *same* context object everywhere when calling the Anti-Lag 2.0 SDK functions.
     // A return value of S_OK indicates that Anti-Lag 2.0 is available on the system.
+    // Loader - finds the driver module and its entry point; AntiLag2::LibraryLoader loads a stand-in such as tools/bin/MockDriver instead.
+    template<class Loader = SystemLoader>
     HRESULT Initialize( Context* context );
 
+    // InitializeAsync function - call this instead of Initialize to look for the driver on a background thread, so that device creation
+    // does not wait for it. It returns E_PENDING until the driver has been found or ruled out, and then what Initialize would have returned.
+    // Call it again on the thread calling Update, for example once per frame, until it returns something else. Until then the other
+    // functions return E_NOINTERFACE. Whether the driver supports Anti-Lag 2.0 is remembered for the process, so initializing again
+    // after the device has been re-created does not repeat the lookup.
+    // context - Declare a persistent Context variable in your game code. Ensure the contents are zero'ed, and pass the address in to initialize it.
+    // probe - address of a persistent AntiLag2::AsyncDriverProbe (ffx_antilag2_async.h), which runs the lookup. Call its Cancel function
+    //         before game exit if InitializeAsync has not returned something other than E_PENDING yet.
+    // Loader - finds the driver module and its entry point; a stand-in for SystemLoader lets the initialization run without an AMD driver.
+    template<class Loader = SystemLoader, class AsyncDriverProbe>
+    HRESULT InitializeAsync( Context* context, AsyncDriverProbe* probe );
+
+    // InitializeSoftware function - call this instead of Initialize when Initialize does not return S_OK.
+    // It sets up a CPU-only implementation of the latency-reducing delay and the framerate limiter, which works without AMD drivers.
+    // The other functions are used in exactly the same way as with the driver implementation.
+    // context - Declare a persistent Context variable in your game code. Ensure the contents are zero'ed, and pass the address in to initialize it.
+    // A return value of S_OK indicates that the software implementation is active.
+    HRESULT InitializeSoftware( Context* context );
+
     // DeInitialize function - call this on game exit.
     // context - address of the game's context object.
     // The return value is the reference count of the internal API. It should be 0.
@@ -40,14 +66,205 @@ namespace AntiLag2DX11 {
     // Update function - call this just before the input to the game is polled.
     // context - address of the game's context object.
     // enable - enables or disables Anti-Lag 2.0.
-    // maxFPS - sets a framerate limit. Zero will disable the limiter.
+    // maxFPS - sets a framerate limit. Zero will disable the limiter, AntiLag2::kMaxFPSAdaptive lets the SDK pick the limit.
+    //          AntiLag2::MakeMaxFPS makes a fractional limit, AntiLag2::MakeMaxFPSBelowRefresh one relative to the refresh rate.
     HRESULT Update( Context* context, bool enable, unsigned int maxFPS );
 
+    // SetState function - publishes new settings without inserting a delay, for example from a UI thread.
+    // The settings are applied by the next Update call. This function is lock-free and may be called from any thread once the
+    // context is initialized.
+    // context - address of the game's context object.
+    // enable - enables or disables Anti-Lag 2.0.
+    // maxFPS - sets a framerate limit. Zero will disable the limiter, AntiLag2::kMaxFPSAdaptive lets the SDK pick the limit.
+    //          AntiLag2::MakeMaxFPS makes a fractional limit, AntiLag2::MakeMaxFPSBelowRefresh one relative to the refresh rate.
+    HRESULT SetState( Context* context, bool enable, unsigned int maxFPS );
+
+    // Update function - as above, but with the settings last published by SetState.
+    // context - address of the game's context object.
+    HRESULT Update( Context* context );
+
+    // BeginUpdate function - the first half of Update, for engines that have work to do which does not depend on the input.
+    // It applies the settings and starts the latency-reducing delay, but returns without waiting for it. Run the work, then
+    // call EndUpdate, which waits for the rest of the delay, and poll the input right after it.
+    // context - address of the game's context object.
+    // enable - enables or disables Anti-Lag 2.0.
+    // maxFPS - sets a framerate limit. Zero will disable the limiter, AntiLag2::kMaxFPSAdaptive lets the SDK pick the limit.
+    //          AntiLag2::MakeMaxFPS makes a fractional limit, AntiLag2::MakeMaxFPSBelowRefresh one relative to the refresh rate.
+    HRESULT BeginUpdate( Context* context, bool enable, unsigned int maxFPS );
+    HRESULT BeginUpdate( Context* context );
+
+    // EndUpdate function - call this after BeginUpdate, just before the input to the game is polled.
+    // context - address of the game's context object.
+    HRESULT EndUpdate( Context* context );
+
+    // IsUpdateReady function - returns true once the delay started by BeginUpdate is over, so that the job system knows when to stop
+    // starting new work. The driver inserts the delay by blocking, so there is no deadline to plan for, and BeginUpdate only returns
+    // before the delay is over when SetDelayThread has given it a thread to block on. Can be called from any thread.
+    // context - address of the game's context object.
+    bool IsUpdateReady( const Context* context );
+
+    // GetFrameIndex function - returns the index Update assigned to the frame whose input was sampled last.
+    // Indices start at 1 and increase by one per Update call. In an engine where the render and present threads run behind the
+    // game thread, read the index on the game thread right after Update and pass it along with the frame to the overloads below.
+    // context - address of the game's context object.
+    unsigned __int64 GetFrameIndex( const Context* context );
+
+    // Call this on the game render thread once the game's main rendering workload has been submitted, before the Present call of a
+    // game that generates frames of its own. This is only required if frame generation is enabled, but calling it anyway is harmless.
+    // context - address of the game's context object.
+    // frameIndex - the index of the frame being rendered, see GetFrameIndex. Without it the frame whose input was sampled last is assumed.
+    HRESULT MarkEndOfFrameRendering( Context* context );
+    HRESULT MarkEndOfFrameRendering( Context* context, unsigned __int64 frameIndex );
+
+    // Call this on the presentation thread just before the Present call.
+    // This is only required if frame generation is enabled, but calling it anyway is harmless.
+    // context - address of the game's context object.
+    // bInterpolatedFrame - whether the frame about to be presented is interpolated.
+    // frameIndex - the index of the frame being presented, see GetFrameIndex. Without it the frame whose input was sampled last is assumed.
+    HRESULT SetFrameGenFrameType( Context* context, bool bInterpolatedFrame );
+    HRESULT SetFrameGenFrameType( Context* context, bool bInterpolatedFrame, unsigned __int64 frameIndex );
+
+    // PaceFrameGenPresent function - call this instead of SetFrameGenFrameType when the game presents the frame generation
+    // pairs itself. Call it on the presentation thread just before each Present call: it waits until the interpolated frame is
+    // halfway between the real frames around it, or until the real frame is due, then signals the frame type.
+    // Use a presentation thread that does not hold up the rendering of the next frame.
+    // context - address of the game's context object.
+    // bInterpolatedFrame - whether the frame about to be presented is interpolated.
+    // frameIndex - the index of the frame being presented, see GetFrameIndex. Without it the frame whose input was sampled last is assumed.
+    HRESULT PaceFrameGenPresent( Context* context, bool bInterpolatedFrame );
+    HRESULT PaceFrameGenPresent( Context* context, bool bInterpolatedFrame, unsigned __int64 frameIndex );
+
+    // SetLatencyMarker function - reports a point in the frame: the start of the simulation, the start and end of the render
+    // submission, and the start and end of the Present call. GetLatencyStats then breaks the latency down into these stages.
+    // RenderSubmitEnd does what MarkEndOfFrameRendering does, so call one or the other. Can be called from any thread.
+    // The driver keeps the whole delay in Update; splitting it at RenderSubmitStart needs AntiLag2::SoftwareContext::SetSplitDelay.
+    // context - address of the game's context object.
+    // marker - the point in the frame, see AntiLag2::LatencyMarker.
+    // frameIndex - the index of the frame, see GetFrameIndex. Without it the frame whose input was sampled last is assumed.
+    HRESULT SetLatencyMarker( Context* context, AntiLag2::LatencyMarker marker );
+    HRESULT SetLatencyMarker( Context* context, AntiLag2::LatencyMarker marker, unsigned __int64 frameIndex );
+
+    // SetDriverDataVersion function - sets the newest version of the Anti-Lag 2.0 data structures the SDK may use with the driver.
+    // The frame generation signals need version 2. The driver cannot be asked which versions it accepts, and a driver that predates
+    // version 2 may take its structure for a version 1 one, so the default is 1: set 2 only for drivers known to accept it. The
+    // software implementation always uses version 2. Call this after every successful Initialize, before the other functions.
+    // context - address of the game's context object.
+    // version - 1 or 2.
+    HRESULT SetDriverDataVersion( Context* context, unsigned int version );
+
+    // SetDelayThread function - lets BeginUpdate return while the driver inserts the delay, which it can only do by blocking.
+    // The blocking call is then made on the thread, and IsUpdateReady tells when it has returned. Without one BeginUpdate blocks
+    // for the whole delay. Call this after Initialize, not while a BeginUpdate is waiting for its EndUpdate.
+    // context - address of the game's context object.
+    // thread - address of a persistent AntiLag2::DelayThread (ffx_antilag2_async.h) that outlives the context's initialization,
+    //          or nullptr to block in BeginUpdate again.
+    HRESULT SetDelayThread( Context* context, AntiLag2::DelayExecutor* thread );
+
+    // GetDriverDataVersion function - returns the version of the Anti-Lag 2.0 data structures in use, see SetDriverDataVersion.
+    // With version 1 the driver only takes the settings: the frame generation functions above still pace the presents and feed the
+    // telemetry, but do not reach the driver. Zero before initialization.
+    // context - address of the game's context object.
+    unsigned int GetDriverDataVersion( const Context* context );
+
+    // SetRefreshRate function - tells the limiter the refresh rate range of a variable refresh rate display.
+    // The adaptive limit then stays just below the refresh rate, and AntiLag2::MakeMaxFPSBelowRefresh limits follow it.
+    // No limit is placed right at the bottom of the range, where the display starts to show frames more than once.
+    // Can be called from any thread once the context is initialized.
+    // context - address of the game's context object.
+    // refreshHz - the refresh rate in Hz, zero if the display does not have a variable refresh rate.
+    // minRefreshHz - the bottom of the refresh rate range in Hz, zero if it is not known.
+    HRESULT SetRefreshRate( Context* context, double refreshHz );
+    HRESULT SetRefreshRate( Context* context, double refreshHz, double minRefreshHz );
+
+    // GetAdaptiveMaxFPS function - returns the framerate limit picked by the adaptive limiter, zero while it is measuring the game
+    // or when maxFPS is not AntiLag2::kMaxFPSAdaptive. Can be called from any thread.
+    // context - address of the game's context object.
+    unsigned int GetAdaptiveMaxFPS( const Context* context );
+
+    // GetLatencyStats function - returns the p50/p95/p99 of one of the per-frame intervals over the last 127 frames.
+    // Can be called from any thread.
+    // context - address of the game's context object.
+    // interval - which interval of the frame to look at, see AntiLag2::TelemetryInterval.
+    // A return value of S_FALSE means that no frames have been recorded yet.
+    HRESULT GetLatencyStats( const Context* context, AntiLag2::TelemetryInterval interval, AntiLag2::LatencyStats* stats );
+
+    // GetFrameRecord function - returns what the SDK recorded for a recent frame. Can be called from any thread.
+    // context - address of the game's context object.
+    // framesAgo - 0 is the frame of the most recent Update call, up to 127 frames back.
+    // A return value of S_FALSE means that the frame is not available.
+    HRESULT GetFrameRecord( const Context* context, unsigned int framesAgo, AntiLag2::FrameRecord* record );
+
+    // MarkFrameComplete function - call this once the GPU has finished a frame, for example when its fence has been seen signaled.
+    // It feeds GetLatencyInFrames. Call it in frame order, from one thread at a time.
+    // context - address of the game's context object.
+    // frameIndex - the index of the frame, the frameIndex GetFrameRecord returns for framesAgo 0 right after Update.
+    // time - when the GPU finished the frame, in AntiLag2::GetTimestamp() time, or when it was presented if that is all that is known.
+    // Without it the frame is taken to have finished now. A return value of S_FALSE means that the frame is too old to be looked up.
+    HRESULT MarkFrameComplete( Context* context, unsigned __int64 frameIndex );
+    HRESULT MarkFrameComplete( Context* context, unsigned __int64 frameIndex, AntiLag2::Timestamp time );
+
+    // GetLatencyInFrames function - returns an estimate of the latency in GPU frames, the green number of the Radeon Anti-Lag 2
+    // Latency Monitor, averaged over the last 32 frames reported to MarkFrameComplete. With Anti-Lag 2.0 it should be between
+    // 1.0 and 2.0. Can be called from any thread.
+    // context - address of the game's context object.
+    // A return value of S_FALSE means that not enough frames have been reported yet.
+    HRESULT GetLatencyInFrames( const Context* context, float* frames );
+
+    // SetRecorder function - records every call into the SDK with its arguments, timestamps and result into a binary log,
+    // which tools/bin/Replay plays back against a mock or the software implementation. Can be called from any thread once the
+    // context is initialized; DeInitialize removes the recorder.
+    // context - address of the game's context object.
+    // recorder - a started AntiLag2::CallRecorder (ffx_antilag2_record.h) that outlives the recording, or nullptr to stop passing calls to it.
+    HRESULT SetRecorder( Context* context, AntiLag2::CallSink* recorder );
+
+    // SetSharedTelemetry function - publishes the state of every frame to a shared memory ring that tools/bin/al2top shows live,
+    // without any cost beyond a few stores per frame. Can be called from any thread once the context is initialized; DeInitialize
+    // removes the writer.
+    // context - address of the game's context object.
+    // writer - an opened AntiLag2::SharedTelemetryWriter (ffx_antilag2_shared.h) that outlives the publishing, or nullptr to stop publishing.
+    HRESULT SetSharedTelemetry( Context* context, AntiLag2::FrameSink* writer );
+
+    // ContextRegistry - holds one context per swapchain, for games that present to several swapchains at different rates, such as
+    // split-screen modes and tools. Declare a persistent registry instead of a single Context, see AntiLag2::ContextRegistry.
+    typedef AntiLag2::ContextRegistry<Context> ContextRegistry;
+
+    // RegisterSwapChain function - returns the context of a swapchain, and takes a free one from the registry the first time.
+    // Initialize it like a single context, then make every call for the swapchain's frames on it. Each context has its own delay
+    // and framerate limit and does not wait for the others, so call Update on each from the thread that polls the input for its swapchain.
+    // registry - address of the game's registry.
+    // swapChain - the swapchain the context paces.
+    // A return value of nullptr means that every context of the registry is taken.
+    Context* RegisterSwapChain( ContextRegistry* registry, IUnknown* swapChain );
+
+    // FindSwapChainContext function - returns the context of a registered swapchain, nullptr if it has none. Can be called from any thread.
+    // registry - address of the game's registry.
+    // swapChain - the swapchain passed to RegisterSwapChain.
+    Context* FindSwapChainContext( ContextRegistry* registry, IUnknown* swapChain );
+
+    // UnregisterSwapChain function - deinitializes the context of a swapchain, resets it to its default state and frees it for
+    // another one. Call this before releasing the swapchain or destroying the device, while no other call is made on the context.
+    // registry - address of the game's registry.
+    // swapChain - the swapchain passed to RegisterSwapChain.
+    // The return value is the reference count of the internal API. It should be 0.
+    ULONG UnregisterSwapChain( ContextRegistry* registry, IUnknown* swapChain );
+
+    // ResetContext function - deinitializes a context, which leaves it as it was declared. ContextRegistry frees its contexts with it.
+    // context - the game's context object.
+    // The return value is the reference count of the internal API. It should be 0.
+    ULONG ResetContext( Context& context );
+
     //
     // End of public API section.
     // Private implementation details below.
     //
 
+    // Finds the driver module and its entry point with the Win32 loader.
+    struct SystemLoader
+    {
+        static HMODULE  GetModule( const char* name )                   { return GetModuleHandleA( name ); }
+        static FARPROC  GetProc( HMODULE hModule, const char* name )    { return GetProcAddress( hModule, name ); }
+    };
+
     // Forward declaration of the Anti-Lag 2.0 interface into the DX11 driver
     class IAmdDxExtInterface
     {
@@ -57,9 +274,11 @@ namespace AntiLag2DX11 {
 
     protected:
         IAmdDxExtInterface() {} // Default constructor disabled
-        virtual ~IAmdDxExtInterface() = 0 {}
+        virtual ~IAmdDxExtInterface() = 0;
     };
 
+    inline IAmdDxExtInterface::~IAmdDxExtInterface() {}
+
     // Structure version 1 for Anti-Lag 2.0:
     struct APIData_v1
     {
@@ -72,6 +291,30 @@ namespace AntiLag2DX11 {
     };
     static_assert(sizeof(APIData_v1) == 32, "Check structure packing compiler settings.");
 
+    // Structure version 2 for Anti-Lag 2.0, the same as in the DX12 driver. It is passed to UpdateAntiLagStateDx11
+    // in place of APIData_v1, and only accepted by drivers that support it.
+    struct APIData_v2
+    {
+        unsigned int    uiSize;
+        unsigned int    uiVersion;
+        struct Flags
+        {
+            unsigned int unused0               : 1;
+            unsigned int unused1               : 1;
+
+            unsigned int signalFgFrameType     : 1;
+            unsigned int isInterpolatedFrame   : 1;
+
+            unsigned int signalGetUserInputIdx : 1;
+            unsigned int signalEndOfFrameIdx   : 1;
+
+            unsigned int reserved              :26;
+        }               flags;
+        unsigned __int64    iiFrameIdx;
+        unsigned __int64    uiiReserved[19];
+    };
+    static_assert(sizeof(APIData_v2) == 176, "Check structure packing compiler settings.");
+
     // Forward declaration of the Anti-Lag interface into the DX11 driver
     struct IAmdDxExtAntiLagApi : public IAmdDxExtInterface
     {
@@ -79,56 +322,190 @@ namespace AntiLag2DX11 {
         virtual HRESULT UpdateAntiLagStateDx11( APIData_v1* pApiCallbackData ) = 0;
     };
 
+    typedef HRESULT(__cdecl* PFNAmdDxExtCreate11)(ID3D11Device* pDevice, IAmdDxExtInterface** ppAntiLagApi);
+
+    // Creates the driver's Anti-Lag interface. The entry point is kept in the process-wide DriverProbeCache.
+    template<class Loader>
+    AntiLag2::DriverProbeResult ProbeDriver();
+
+    // CPU-only implementation of the Anti-Lag interface, created by InitializeSoftware()
+    class SoftwareAntiLagApi final : public IAmdDxExtAntiLagApi
+    {
+    public:
+        SoftwareAntiLagApi()                                    { m_backend.Initialize(); }
+
+        virtual unsigned int AddRef() override;
+        virtual unsigned int Release() override;
+        virtual HRESULT UpdateAntiLagStateDx11( APIData_v1* pApiCallbackData ) override;
+
+    private:
+        std::atomic<unsigned int>   m_refCount{ 1 };
+        AntiLag2::SoftwareBackend   m_backend;
+    };
+
+    // Backend of the front end in ffx_antilag2.h, driving the Anti-Lag interface.
+    // The frame generation signals need APIData_v2, which a driver is only sent once the game has opted in with SetDriverDataVersion.
+    // Until then they are no-ops. The driver takes whole limits only, the software implementation also fractional ones.
+    class DriverBackend
+    {
+    public:
+        static const bool kActive = true;
+
+        // Takes over the reference to the interface and disables Anti-Lag 2.0 through it. The driver is sent APIData_v1 only until
+        // SetDataVersion allows version 2, the software implementation always both.
+        HRESULT         Initialize( IAmdDxExtAntiLagApi* pAntiLagAPI )  { return Initialize( pAntiLagAPI, false ); }
+        HRESULT         Initialize( SoftwareAntiLagApi* pAntiLagAPI )   { return Initialize( pAntiLagAPI, true ); }
+        bool            IsInitialized() const                   { return m_pAntiLagAPI != nullptr; }
+        unsigned int    DeInitialize();
+        HRESULT         SetState( bool enabled, unsigned int maxFPS );
+        HRESULT         InsertDelay()                           { return m_pAntiLagAPI->UpdateAntiLagStateDx11( nullptr ); }
+        HRESULT         BeginDelay( AntiLag2::Timestamp* )      { return S_FALSE; }
+        HRESULT         EndDelay()                              { return S_FALSE; }
+        HRESULT         SignalInputSample( std::uint64_t frameIndex );
+        HRESULT         MarkEndOfFrame( std::uint64_t frameIndex );
+        HRESULT         SetFrameType( bool interpolated, std::uint64_t frameIndex );
+        HRESULT         InsertSplitDelay( std::uint64_t )       { return S_FALSE; }   // The driver delays in InsertDelay only
+
+        // Structure version in use, 0 while not initialized.
+        unsigned int    GetDataVersion() const                  { return m_dataVersion; }
+
+        // Newest structure version a driver may be sent until the next Initialize, 1 unless the game knows that it accepts APIData_v2.
+        void            SetDataVersion( unsigned int version )  { m_dataVersion = m_software ? 2 : version; }
+
+    private:
+        HRESULT         Initialize( IAmdDxExtAntiLagApi* pAntiLagAPI, bool software );
+        HRESULT         SetFrameGenParams( APIData_v2::Flags flags, std::uint64_t frameIndex );
+
+        IAmdDxExtAntiLagApi*    m_pAntiLagAPI = nullptr;
+        bool                    m_software = false;                 // The interface is a SoftwareAntiLagApi
+        unsigned int            m_dataVersion = 0;
+    };
+
+    typedef AntiLag2::Context<DriverBackend> FrontEndContext;
+
+    // The object m_pAntiLagAPI of an initialized Context points to: the front end in ffx_antilag2.h, allocated by the initialization
+    // and driving the driver interface or the software implementation. Code built against an earlier copy of this header that calls
+    // UpdateAntiLagStateDx11 on it directly reaches the front end too.
+    class FrontEnd final : public IAmdDxExtAntiLagApi
+    {
+    public:
+        virtual unsigned int AddRef() override;
+        virtual unsigned int Release() override;
+        virtual HRESULT UpdateAntiLagStateDx11( APIData_v1* pApiCallbackData ) override;
+
+        FrontEndContext&    GetContext()                { return m_context; }
+
+    private:
+        std::atomic<unsigned int>   m_refCount{ 1 };
+        FrontEndContext             m_context;
+    };
+
     // Context structure for the SDK. Declare a persistent object of this type *once* in your game code.
     // Ensure the contents are initialized to zero before calling Initialize() but do not modify these members directly after that.
+    // The members are the same as in earlier versions of the SDK, see FrontEnd. See AntiLag2::Context for the threading rules.
     struct Context
     {
-        IAmdDxExtAntiLagApi*  m_pAntiLagAPI = nullptr;
-        bool                  m_enabled = false;
+        IAmdDxExtAntiLagApi*  m_pAntiLagAPI = nullptr;  // The FrontEnd while initialized
+        bool                  m_enabled = false;        // The settings last passed to Update or BeginUpdate
         unsigned int          m_maxFPS = 0;
     };
 
-    inline HRESULT Initialize( Context* context )
+    // The front end of an initialized context, nullptr otherwise.
+    FrontEndContext* GetFrontEnd( const Context* context );
+
+    // Initializes a new front end with the interface and makes it the context's.
+    template<class Interface>
+    HRESULT InitializeFrontEnd( Context* context, Interface* pAntiLagAPI );
+
+    template<class Loader>
+    inline AntiLag2::DriverProbeResult ProbeDriver()
     {
-        HRESULT hr = E_INVALIDARG;
-        if ( context && context->m_pAntiLagAPI == nullptr )
+        AntiLag2::DriverProbeResult result = { E_HANDLE, nullptr };
+        HMODULE hModule = Loader::GetModule("amdxx64.dll"); // only 64 bit is supported
+        if ( hModule )
         {
-            HMODULE hModule = GetModuleHandleA("amdxx64.dll"); // only 64 bit is supported
-            if ( hModule )
+            AntiLag2::DriverProbeCache<PFNAmdDxExtCreate11>& cache = AntiLag2::DriverProbeCache<PFNAmdDxExtCreate11>::Get();
+            PFNAmdDxExtCreate11 AmdDxExtCreate11 = nullptr;
+            if ( !cache.Find( hModule, &AmdDxExtCreate11 ) )
+            {
+                AmdDxExtCreate11 = reinterpret_cast<PFNAmdDxExtCreate11>(Loader::GetProc(hModule, "AmdDxExtCreate11"));
+                cache.Store( hModule, AmdDxExtCreate11 );
+            }
+            result.hr = AmdDxExtCreate11 ? S_OK : E_INVALIDARG;
+            if ( result.hr == S_OK )
             {
-                typedef HRESULT(__cdecl* PFNAmdDxExtCreate11)(ID3D11Device* pDevice, IAmdDxExtInterface** ppAntiLagApi);
-                PFNAmdDxExtCreate11 AmdDxExtCreate11 = static_cast<PFNAmdDxExtCreate11>((VOID*)GetProcAddress(hModule, "AmdDxExtCreate11"));
-                if ( AmdDxExtCreate11 )
+                IAmdDxExtAntiLagApi* pAntiLagAPI = nullptr;
+                const unsigned __int64 request = 0xbf380ebc5ab4d0a6; // sets up the request identifier
+                memcpy( &pAntiLagAPI, &request, sizeof(request) );
+                result.hr = AmdDxExtCreate11( nullptr, (IAmdDxExtInterface**)&pAntiLagAPI );
+                if ( result.hr == S_OK )
                 {
-                    *(__int64*)&context->m_pAntiLagAPI = 0xbf380ebc5ab4d0a6; // sets up the request identifier
-                    hr = AmdDxExtCreate11( nullptr, (IAmdDxExtInterface**)&context->m_pAntiLagAPI );
-                    if ( hr == S_OK )
-                    {
-                        APIData_v1 data = {};
-                        data.uiSize = sizeof(data);
-                        data.uiVersion = 1;
-                        data.eMode = 2; // Anti-Lag 2.0 is disabled during initialization
-                        data.sControlStr = nullptr;
-                        data.uiControlStrLength = 0;
-                        data.maxFPS = 0;
-
-                        hr = context->m_pAntiLagAPI->UpdateAntiLagStateDx11( &data );
-                    }
-
-                    if ( hr != S_OK )
-                    {
-                        DeInitialize( context );
-                    }
+                    result.pInterface = pAntiLagAPI;
                 }
             }
-            else
+        }
+        return result;
+    }
+
+    inline FrontEndContext* GetFrontEnd( const Context* context )
+    {
+        return context && context->m_pAntiLagAPI ? &static_cast<FrontEnd*>( context->m_pAntiLagAPI )->GetContext() : nullptr;
+    }
+
+    template<class Interface>
+    inline HRESULT InitializeFrontEnd( Context* context, Interface* pAntiLagAPI )
+    {
+        FrontEnd* frontEnd = new FrontEnd();
+        const HRESULT hr = frontEnd->GetContext().Initialize( pAntiLagAPI );
+        if ( hr != S_OK )
+        {
+            frontEnd->Release();
+            return hr;
+        }
+        context->m_pAntiLagAPI = frontEnd;
+        context->m_enabled = false;
+        context->m_maxFPS = 0;
+        return hr;
+    }
+
+    template<class Loader>
+    inline HRESULT Initialize( Context* context )
+    {
+        HRESULT hr = E_INVALIDARG;
+        if ( context && context->m_pAntiLagAPI == nullptr )
+        {
+            const AntiLag2::DriverProbeResult result = ProbeDriver<Loader>();
+            hr = result.hr == S_OK ? InitializeFrontEnd( context, static_cast<IAmdDxExtAntiLagApi*>( result.pInterface ) ) : result.hr;
+        }
+        return hr;
+    }
+
+    template<class Loader, class AsyncDriverProbe>
+    inline HRESULT InitializeAsync( Context* context, AsyncDriverProbe* probe )
+    {
+        HRESULT hr = E_INVALIDARG;
+        if ( context && probe && context->m_pAntiLagAPI == nullptr )
+        {
+            AntiLag2::DriverProbeResult result = {};
+            hr = probe->template Poll<IAmdDxExtAntiLagApi>( &ProbeDriver<Loader>, &result );
+            if ( hr == S_OK )
             {
-                hr = E_HANDLE;
+                hr = result.hr == S_OK ? InitializeFrontEnd( context, static_cast<IAmdDxExtAntiLagApi*>( result.pInterface ) ) : result.hr;
             }
         }
         return hr;
     }
 
+    inline HRESULT InitializeSoftware( Context* context )
+    {
+        HRESULT hr = E_INVALIDARG;
+        if ( context && context->m_pAntiLagAPI == nullptr )
+        {
+            hr = InitializeFrontEnd( context, new SoftwareAntiLagApi() );
+        }
+        return hr;
+    }
+
     inline ULONG DeInitialize( Context* context )
     {
         ULONG refCount = 0;
@@ -136,56 +513,436 @@ namespace AntiLag2DX11 {
         {
             if ( context->m_pAntiLagAPI )
             {
-                refCount = context->m_pAntiLagAPI->Release();
+                FrontEnd* frontEnd = static_cast<FrontEnd*>( context->m_pAntiLagAPI );
                 context->m_pAntiLagAPI = nullptr;
+                refCount = frontEnd->GetContext().DeInitialize();
+                frontEnd->Release();
             }
             context->m_enabled = false;
+            context->m_maxFPS = 0;
         }
         return refCount;
     }
 
     inline HRESULT Update( Context* context, bool enabled, unsigned int maxFPS )
     {
-        // This function needs to be called once per frame, before the user input
-        // is sampled - or optionally also when the UI settings are modified.
-        if ( context && context->m_pAntiLagAPI )
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        if ( frontEnd == nullptr )
         {
-            // Update the Anti-Lag 2.0 internal state only when necessary:
-            if ( context->m_enabled != enabled || context->m_maxFPS != maxFPS )
-            {
-                context->m_enabled = enabled;
-                context->m_maxFPS = maxFPS;
-
-                APIData_v1 data = {};
-                data.uiSize = sizeof(data);
-                data.uiVersion = 1;
-                data.eMode = enabled ? 1 : 2;
-                data.maxFPS = maxFPS;
-                static const char params[] = "delag_next_osd_supported_in_dxxp = 1";
-                data.sControlStr = params;
-                data.uiControlStrLength = _countof( params ) - 1;
-
-                // Only call the function with non-null arguments when setting state.
-                // Make sure not to set the state every frame.
-                context->m_pAntiLagAPI->UpdateAntiLagStateDx11( &data );
-            }
+            return E_NOINTERFACE;
+        }
+        context->m_enabled = enabled;
+        context->m_maxFPS = maxFPS;
+        return frontEnd->Update( enabled, maxFPS );
+    }
+
+    inline HRESULT SetState( Context* context, bool enabled, unsigned int maxFPS )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->SetState( enabled, maxFPS ) : context ? E_NOINTERFACE : E_INVALIDARG;
+    }
+
+    inline HRESULT Update( Context* context )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->Update() : E_NOINTERFACE;
+    }
+
+    inline HRESULT BeginUpdate( Context* context, bool enable, unsigned int maxFPS )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        if ( frontEnd == nullptr )
+        {
+            return E_NOINTERFACE;
+        }
+        context->m_enabled = enable;
+        context->m_maxFPS = maxFPS;
+        return frontEnd->BeginUpdate( enable, maxFPS );
+    }
+
+    inline HRESULT BeginUpdate( Context* context )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->BeginUpdate() : E_NOINTERFACE;
+    }
 
-            // Call the function with a nullptr to insert the latency-reducing delay.
-            // (if the state has not been set to 'enabled' this call will have no effect)
-            HRESULT hr = context->m_pAntiLagAPI->UpdateAntiLagStateDx11( nullptr );
-            if ( hr == S_OK || hr == S_FALSE )
+    inline HRESULT EndUpdate( Context* context )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->EndUpdate() : E_NOINTERFACE;
+    }
+
+    inline bool IsUpdateReady( const Context* context )
+    {
+        const FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->IsUpdateReady() : true;
+    }
+
+    inline unsigned __int64 GetFrameIndex( const Context* context )
+    {
+        const FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->GetFrameIndex() : 0;
+    }
+
+    inline HRESULT MarkEndOfFrameRendering( Context* context )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->MarkEndOfFrameRendering() : E_NOINTERFACE;
+    }
+
+    inline HRESULT MarkEndOfFrameRendering( Context* context, unsigned __int64 frameIndex )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->MarkEndOfFrameRendering( frameIndex ) : E_NOINTERFACE;
+    }
+
+    inline HRESULT SetFrameGenFrameType( Context* context, bool bInterpolatedFrame )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->SetFrameGenFrameType( bInterpolatedFrame ) : E_NOINTERFACE;
+    }
+
+    inline HRESULT SetFrameGenFrameType( Context* context, bool bInterpolatedFrame, unsigned __int64 frameIndex )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->SetFrameGenFrameType( bInterpolatedFrame, frameIndex ) : E_NOINTERFACE;
+    }
+
+    inline HRESULT PaceFrameGenPresent( Context* context, bool bInterpolatedFrame )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->PaceFrameGenPresent( bInterpolatedFrame ) : E_NOINTERFACE;
+    }
+
+    inline HRESULT PaceFrameGenPresent( Context* context, bool bInterpolatedFrame, unsigned __int64 frameIndex )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->PaceFrameGenPresent( bInterpolatedFrame, frameIndex ) : E_NOINTERFACE;
+    }
+
+    inline HRESULT SetLatencyMarker( Context* context, AntiLag2::LatencyMarker marker )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->SetLatencyMarker( marker ) : E_NOINTERFACE;
+    }
+
+    inline HRESULT SetLatencyMarker( Context* context, AntiLag2::LatencyMarker marker, unsigned __int64 frameIndex )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->SetLatencyMarker( marker, frameIndex ) : E_NOINTERFACE;
+    }
+
+    inline HRESULT SetDriverDataVersion( Context* context, unsigned int version )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        if ( frontEnd == nullptr || version < 1 || version > 2 )
+        {
+            return frontEnd || context == nullptr ? E_INVALIDARG : E_NOINTERFACE;
+        }
+        frontEnd->GetBackend().SetDataVersion( version );
+        return S_OK;
+    }
+
+    inline unsigned int GetDriverDataVersion( const Context* context )
+    {
+        const FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->GetBackend().GetDataVersion() : 0;
+    }
+
+    inline HRESULT SetDelayThread( Context* context, AntiLag2::DelayExecutor* thread )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        if ( frontEnd == nullptr )
+        {
+            return context ? E_NOINTERFACE : E_INVALIDARG;
+        }
+        frontEnd->SetDelayExecutor( thread );
+        return S_OK;
+    }
+
+    inline HRESULT SetRefreshRate( Context* context, double refreshHz )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->SetRefreshRate( refreshHz ) : context ? E_NOINTERFACE : E_INVALIDARG;
+    }
+
+    inline HRESULT SetRefreshRate( Context* context, double refreshHz, double minRefreshHz )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->SetRefreshRate( refreshHz, minRefreshHz ) : context ? E_NOINTERFACE : E_INVALIDARG;
+    }
+
+    inline unsigned int GetAdaptiveMaxFPS( const Context* context )
+    {
+        const FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->GetAdaptiveMaxFPS() : 0;
+    }
+
+    inline HRESULT GetLatencyStats( const Context* context, AntiLag2::TelemetryInterval interval, AntiLag2::LatencyStats* stats )
+    {
+        if ( context == nullptr || stats == nullptr )
+        {
+            return E_INVALIDARG;
+        }
+        const FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->GetLatencyStats( interval, stats ) : S_FALSE;
+    }
+
+    inline HRESULT GetFrameRecord( const Context* context, unsigned int framesAgo, AntiLag2::FrameRecord* record )
+    {
+        if ( context == nullptr || record == nullptr )
+        {
+            return E_INVALIDARG;
+        }
+        const FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->GetFrameRecord( framesAgo, record ) : S_FALSE;
+    }
+
+    inline HRESULT MarkFrameComplete( Context* context, unsigned __int64 frameIndex )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->MarkFrameComplete( frameIndex ) : context ? E_NOINTERFACE : E_INVALIDARG;
+    }
+
+    inline HRESULT MarkFrameComplete( Context* context, unsigned __int64 frameIndex, AntiLag2::Timestamp time )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->MarkFrameComplete( frameIndex, time ) : context ? E_NOINTERFACE : E_INVALIDARG;
+    }
+
+    inline HRESULT GetLatencyInFrames( const Context* context, float* frames )
+    {
+        if ( context == nullptr || frames == nullptr )
+        {
+            return E_INVALIDARG;
+        }
+        const FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->GetLatencyInFrames( frames ) : S_FALSE;
+    }
+
+    inline HRESULT SetRecorder( Context* context, AntiLag2::CallSink* recorder )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        if ( frontEnd == nullptr )
+        {
+            return context ? E_NOINTERFACE : E_INVALIDARG;
+        }
+        frontEnd->SetRecorder( recorder );
+        return S_OK;
+    }
+
+    inline HRESULT SetSharedTelemetry( Context* context, AntiLag2::FrameSink* writer )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        if ( frontEnd == nullptr )
+        {
+            return context ? E_NOINTERFACE : E_INVALIDARG;
+        }
+        frontEnd->SetSharedTelemetry( writer );
+        return S_OK;
+    }
+
+    inline Context* RegisterSwapChain( ContextRegistry* registry, IUnknown* swapChain )
+    {
+        return registry ? registry->Register( swapChain ) : nullptr;
+    }
+
+    inline Context* FindSwapChainContext( ContextRegistry* registry, IUnknown* swapChain )
+    {
+        return registry ? registry->Find( swapChain ) : nullptr;
+    }
+
+    inline ULONG UnregisterSwapChain( ContextRegistry* registry, IUnknown* swapChain )
+    {
+        return registry ? registry->Unregister( swapChain ) : 0;
+    }
+
+    inline ULONG ResetContext( Context& context )
+    {
+        return DeInitialize( &context );
+    }
+
+    inline HRESULT DriverBackend::Initialize( IAmdDxExtAntiLagApi* pAntiLagAPI, bool software )
+    {
+        if ( pAntiLagAPI == nullptr )
+        {
+            return E_INVALIDARG;
+        }
+        m_pAntiLagAPI = pAntiLagAPI;
+
+        APIData_v1 data = {};
+        data.uiSize = sizeof(data);
+        data.uiVersion = 1;
+        data.eMode = 2; // Anti-Lag 2.0 is disabled during initialization
+        data.sControlStr = nullptr;
+        data.uiControlStrLength = 0;
+        data.maxFPS = 0;
+
+        HRESULT hr = m_pAntiLagAPI->UpdateAntiLagStateDx11( &data );
+        if ( hr != S_OK )
+        {
+            DeInitialize();
+            return hr;
+        }
+        m_software = software;
+        m_dataVersion = software ? 2 : 1;
+        return hr;
+    }
+
+    inline unsigned int DriverBackend::DeInitialize()
+    {
+        unsigned int refCount = 0;
+        if ( m_pAntiLagAPI )
+        {
+            refCount = m_pAntiLagAPI->Release();
+            m_pAntiLagAPI = nullptr;
+        }
+        m_software = false;
+        m_dataVersion = 0;
+        return refCount;
+    }
+
+    inline HRESULT DriverBackend::SetState( bool enabled, unsigned int maxFPS )
+    {
+        APIData_v1 data = {};
+        data.uiSize = sizeof(data);
+        data.uiVersion = 1;
+        data.eMode = enabled ? 1 : 2;
+        data.maxFPS = m_software ? maxFPS : AntiLag2::GetWholeMaxFPS( maxFPS );
+        static const char params[] = "delag_next_osd_supported_in_dxxp = 1";
+        data.sControlStr = params;
+        data.uiControlStrLength = _countof( params ) - 1;
+
+        // Only call the function with non-null arguments when setting state.
+        // Make sure not to set the state every frame.
+        return m_pAntiLagAPI->UpdateAntiLagStateDx11( &data );
+    }
+
+    inline HRESULT DriverBackend::SignalInputSample( std::uint64_t frameIndex )
+    {
+        APIData_v2::Flags flags     = {};
+        flags.signalGetUserInputIdx = 1;
+        return SetFrameGenParams( flags, frameIndex );
+    }
+
+    inline HRESULT DriverBackend::MarkEndOfFrame( std::uint64_t frameIndex )
+    {
+        APIData_v2::Flags flags   = {};
+        flags.signalEndOfFrameIdx = 1;
+        return SetFrameGenParams( flags, frameIndex );
+    }
+
+    inline HRESULT DriverBackend::SetFrameType( bool interpolated, std::uint64_t frameIndex )
+    {
+        APIData_v2::Flags flags   = {};
+        flags.signalFgFrameType   = 1;
+        flags.isInterpolatedFrame = interpolated ? 1 : 0;
+        return SetFrameGenParams( flags, frameIndex );
+    }
+
+    inline HRESULT DriverBackend::SetFrameGenParams( APIData_v2::Flags flags, std::uint64_t frameIndex )
+    {
+        if ( m_dataVersion < 2 )
+        {
+            return S_OK;
+        }
+
+        APIData_v2 data = {};
+        data.uiSize = sizeof(data);
+        data.uiVersion = 2;
+        data.flags = flags;
+        data.iiFrameIdx = frameIndex;
+
+        // The driver tells the structures apart by their size and version fields.
+        return m_pAntiLagAPI->UpdateAntiLagStateDx11( reinterpret_cast<APIData_v1*>( &data ) );
+    }
+
+    inline unsigned int FrontEnd::AddRef()
+    {
+        return ++m_refCount;
+    }
+
+    inline unsigned int FrontEnd::Release()
+    {
+        unsigned int refCount = --m_refCount;
+        if ( refCount == 0 )
+        {
+            delete this;
+        }
+        return refCount;
+    }
+
+    inline HRESULT FrontEnd::UpdateAntiLagStateDx11( APIData_v1* pApiCallbackData )
+    {
+        if ( pApiCallbackData == nullptr )
+        {
+            return m_context.Update();
+        }
+
+        if ( pApiCallbackData->uiVersion == 1 && pApiCallbackData->uiSize == sizeof(APIData_v1) )
+        {
+            return m_context.SetState( pApiCallbackData->eMode == 1, pApiCallbackData->maxFPS );
+        }
+        else if ( pApiCallbackData->uiVersion == 2 && pApiCallbackData->uiSize == sizeof(APIData_v2) )
+        {
+            // Update assigns the input sample its index. Callers that predate the frame indices pass 0 for the frame sampled last.
+            const APIData_v2* pDataV2 = reinterpret_cast<const APIData_v2*>( pApiCallbackData );
+            const std::uint64_t frameIndex = pDataV2->iiFrameIdx ? pDataV2->iiFrameIdx : m_context.GetFrameIndex();
+            HRESULT hr = S_OK;
+            if ( pDataV2->flags.signalEndOfFrameIdx )
             {
-                return S_OK;
+                hr = m_context.MarkEndOfFrameRendering( frameIndex );
             }
-            else
+            if ( pDataV2->flags.signalFgFrameType && hr == S_OK )
             {
-                return hr;
+                hr = m_context.SetFrameGenFrameType( pDataV2->flags.isInterpolatedFrame != 0, frameIndex );
             }
+            return hr;
+        }
+        return E_INVALIDARG;
+    }
+
+    inline unsigned int SoftwareAntiLagApi::AddRef()
+    {
+        return ++m_refCount;
+    }
+
+    inline unsigned int SoftwareAntiLagApi::Release()
+    {
+        unsigned int refCount = --m_refCount;
+        if ( refCount == 0 )
+        {
+            delete this;
+        }
+        return refCount;
+    }
+
+    inline HRESULT SoftwareAntiLagApi::UpdateAntiLagStateDx11( APIData_v1* pApiCallbackData )
+    {
+        if ( pApiCallbackData == nullptr )
+        {
+            // Insert the latency-reducing delay.
+            return m_backend.InsertDelay();
         }
-        else
+
+        if ( pApiCallbackData->uiVersion == 1 && pApiCallbackData->uiSize == sizeof(APIData_v1) )
         {
-            return E_NOINTERFACE;
+            return m_backend.SetState( pApiCallbackData->eMode == 1, pApiCallbackData->maxFPS );
+        }
+        else if ( pApiCallbackData->uiVersion == 2 && pApiCallbackData->uiSize == sizeof(APIData_v2) )
+        {
+            const APIData_v2* pDataV2 = reinterpret_cast<const APIData_v2*>( pApiCallbackData );
+            if ( pDataV2->flags.signalGetUserInputIdx && pDataV2->iiFrameIdx )
+            {
+                m_backend.SignalInputSample( pDataV2->iiFrameIdx );
+            }
+            if ( pDataV2->flags.signalEndOfFrameIdx )
+            {
+                m_backend.MarkEndOfFrame( pDataV2->iiFrameIdx );
+            }
+            return S_OK;
         }
+        return E_INVALIDARG;
     }
 
 } // namespace AntiLag2DX11
@@ -21,18 +21,43 @@
 
 #pragma once
 
+#include "ffx_antilag2.h"
+
 namespace AMD {
 namespace AntiLag2DX12 {
 
     struct Context;
+    struct SystemLoader;
 
     // Initialize function - call this once before the Update function.
     // context - Declare a persistent Context variable in your game code. Ensure the contents are zero'ed, and pass the address in to initialize it.
     //           Be sure to use the *same* context object everywhere when calling the Anti-Lag 2.0 SDK functions.
     // device - The game's D3D12 device.
     // A return value of S_OK indicates that Anti-Lag 2.0 is available on the system.
+    // Loader - finds the driver module and its entry point; AntiLag2::LibraryLoader loads a stand-in such as tools/bin/MockDriver instead.
+    template<class Loader = SystemLoader>
     HRESULT Initialize( Context* context, ID3D12Device* device );
 
+    // InitializeAsync function - call this instead of Initialize to look for the driver on a background thread, so that device creation
+    // does not wait for it. It returns E_PENDING until the driver has been found or ruled out, and then what Initialize would have returned.
+    // Call it again on the thread calling Update, for example once per frame, until it returns something else. Until then the other
+    // functions return E_NOINTERFACE. Whether the driver supports Anti-Lag 2.0 is remembered for the process, so initializing again
+    // after the device has been re-created does not repeat the lookup.
+    // context - Declare a persistent Context variable in your game code. Ensure the contents are zero'ed, and pass the address in to initialize it.
+    // device - The game's D3D12 device. It must stay alive until InitializeAsync has returned something other than E_PENDING, or until probe->Cancel().
+    // probe - address of a persistent AntiLag2::AsyncDriverProbe (ffx_antilag2_async.h), which runs the lookup. Call its Cancel function
+    //         before destroying the device if InitializeAsync has not returned something other than E_PENDING yet.
+    // Loader - finds the driver module and its entry point; a stand-in for SystemLoader lets the initialization run without an AMD driver.
+    template<class Loader = SystemLoader, class AsyncDriverProbe>
+    HRESULT InitializeAsync( Context* context, ID3D12Device* device, AsyncDriverProbe* probe );
+
+    // InitializeSoftware function - call this instead of Initialize when Initialize does not return S_OK.
+    // It sets up a CPU-only implementation of the latency-reducing delay and the framerate limiter, which works without AMD drivers.
+    // The other functions are used in exactly the same way as with the driver implementation.
+    // context - Declare a persistent Context variable in your game code. Ensure the contents are zero'ed, and pass the address in to initialize it.
+    // A return value of S_OK indicates that the software implementation is active.
+    HRESULT InitializeSoftware( Context* context );
+
     // DeInitialize function - call this before destroying the device.
     // context - address of the game's context object.
     // The return value is the reference count of the internal API. It should be 0.
@@ -41,26 +66,222 @@ namespace AntiLag2DX12 {
     // Update function - call this just before the input to the game is polled.
     // context - address of the game's context object.
     // enable - enables or disables Anti-Lag 2.0.
-    // maxFPS - sets a framerate limit. Zero will disable the limiter.
+    // maxFPS - sets a framerate limit. Zero will disable the limiter, AntiLag2::kMaxFPSAdaptive lets the SDK pick the limit.
+    //          AntiLag2::MakeMaxFPS makes a fractional limit, AntiLag2::MakeMaxFPSBelowRefresh one relative to the refresh rate.
     HRESULT Update( Context* context, bool enable, unsigned int maxFPS );
 
+    // SetState function - publishes new settings without inserting a delay, for example from a UI thread.
+    // The settings are applied by the next Update call. This function is lock-free and may be called from any thread once the
+    // context is initialized.
+    // context - address of the game's context object.
+    // enable - enables or disables Anti-Lag 2.0.
+    // maxFPS - sets a framerate limit. Zero will disable the limiter, AntiLag2::kMaxFPSAdaptive lets the SDK pick the limit.
+    //          AntiLag2::MakeMaxFPS makes a fractional limit, AntiLag2::MakeMaxFPSBelowRefresh one relative to the refresh rate.
+    HRESULT SetState( Context* context, bool enable, unsigned int maxFPS );
+
+    // Update function - as above, but with the settings last published by SetState.
+    // context - address of the game's context object.
+    HRESULT Update( Context* context );
+
+    // BeginUpdate function - the first half of Update, for engines that have work to do which does not depend on the input.
+    // It applies the settings and starts the latency-reducing delay, but returns without waiting for it. Run the work, then
+    // call EndUpdate, which waits for the rest of the delay, and poll the input right after it.
+    // context - address of the game's context object.
+    // enable - enables or disables Anti-Lag 2.0.
+    // maxFPS - sets a framerate limit. Zero will disable the limiter, AntiLag2::kMaxFPSAdaptive lets the SDK pick the limit.
+    //          AntiLag2::MakeMaxFPS makes a fractional limit, AntiLag2::MakeMaxFPSBelowRefresh one relative to the refresh rate.
+    HRESULT BeginUpdate( Context* context, bool enable, unsigned int maxFPS );
+    HRESULT BeginUpdate( Context* context );
+
+    // EndUpdate function - call this after BeginUpdate, just before the input to the game is polled.
+    // context - address of the game's context object.
+    HRESULT EndUpdate( Context* context );
+
+    // IsUpdateReady function - returns true once the delay started by BeginUpdate is over, so that the job system knows when to stop
+    // starting new work. The driver inserts the delay by blocking, so there is no deadline to plan for, and BeginUpdate only returns
+    // before the delay is over when SetDelayThread has given it a thread to block on. Can be called from any thread.
+    // context - address of the game's context object.
+    bool IsUpdateReady( const Context* context );
+
+    // GetFrameIndex function - returns the index Update assigned to the frame whose input was sampled last.
+    // Indices start at 1 and increase by one per Update call. In an engine where the render and present threads run behind the
+    // game thread, read the index on the game thread right after Update and pass it along with the frame to the overloads below.
+    // context - address of the game's context object.
+    unsigned __int64 GetFrameIndex( const Context* context );
+
     // Call this on the game render thread once the game's main rendering workload has been submitted in an ExecuteCommandLists call.
     // Call before the FSR 3 Present call is made.
     // This is only required if frame generation is enabled, but calling it anyway is harmless.
     // context - address of the game's context object.
+    // frameIndex - the index of the frame being rendered, see GetFrameIndex. Without it the frame whose input was sampled last is assumed.
     HRESULT MarkEndOfFrameRendering( Context* context );
+    HRESULT MarkEndOfFrameRendering( Context* context, unsigned __int64 frameIndex );
 
     // Call this on the presentation thread just before the Present call.
     // This is only required if frame generation is enabled, but calling it anyway is harmless.
     // context - address of the game's context object.
     // bInterpolatedFrame - whether the frame about to be presented is interpolated.
+    // frameIndex - the index of the frame being presented, see GetFrameIndex. Without it the frame whose input was sampled last is assumed.
     HRESULT SetFrameGenFrameType( Context* context, bool bInterpolatedFrame );
+    HRESULT SetFrameGenFrameType( Context* context, bool bInterpolatedFrame, unsigned __int64 frameIndex );
+
+    // PaceFrameGenPresent function - call this instead of SetFrameGenFrameType when the game presents the frame generation
+    // pairs itself rather than through FSR 3. Call it on the presentation thread just before each Present call: it waits until
+    // the interpolated frame is halfway between the real frames around it, or until the real frame is due, then signals the frame type.
+    // Use a presentation thread that does not hold up the rendering of the next frame.
+    // context - address of the game's context object.
+    // bInterpolatedFrame - whether the frame about to be presented is interpolated.
+    // frameIndex - the index of the frame being presented, see GetFrameIndex. Without it the frame whose input was sampled last is assumed.
+    HRESULT PaceFrameGenPresent( Context* context, bool bInterpolatedFrame );
+    HRESULT PaceFrameGenPresent( Context* context, bool bInterpolatedFrame, unsigned __int64 frameIndex );
+
+    // SetLatencyMarker function - reports a point in the frame: the start of the simulation, the start and end of the render
+    // submission, and the start and end of the Present call. GetLatencyStats then breaks the latency down into these stages.
+    // RenderSubmitEnd does what MarkEndOfFrameRendering does, so call one or the other. Can be called from any thread.
+    // The driver keeps the whole delay in Update; splitting it at RenderSubmitStart needs AntiLag2::SoftwareContext::SetSplitDelay.
+    // context - address of the game's context object.
+    // marker - the point in the frame, see AntiLag2::LatencyMarker.
+    // frameIndex - the index of the frame, see GetFrameIndex. Without it the frame whose input was sampled last is assumed.
+    HRESULT SetLatencyMarker( Context* context, AntiLag2::LatencyMarker marker );
+    HRESULT SetLatencyMarker( Context* context, AntiLag2::LatencyMarker marker, unsigned __int64 frameIndex );
+
+    // SetInputSampleSignal function - makes Update tell the driver the index of the frame whose input is sampled, in an APIData_v2
+    // structure, so that it can match the input with the frame indices of MarkEndOfFrameRendering and SetFrameGenFrameType.
+    // Without it the driver is sent the same packets as by SDKs that predate the frame indices, so the default is off: enable it
+    // for drivers known to make use of it. The software implementation always receives it. Call this after every successful
+    // Initialize, on the thread calling Update.
+    // context - address of the game's context object.
+    // enable - whether to send the signal.
+    HRESULT SetInputSampleSignal( Context* context, bool enable );
+
+    // SetDelayThread function - lets BeginUpdate return while the driver inserts the delay, which it can only do by blocking.
+    // The blocking call is then made on the thread, and IsUpdateReady tells when it has returned. Without one BeginUpdate blocks
+    // for the whole delay. Call this after Initialize, not while a BeginUpdate is waiting for its EndUpdate.
+    // context - address of the game's context object.
+    // thread - address of a persistent AntiLag2::DelayThread (ffx_antilag2_async.h) that outlives the context's initialization,
+    //          or nullptr to block in BeginUpdate again.
+    HRESULT SetDelayThread( Context* context, AntiLag2::DelayExecutor* thread );
+
+    // SetRefreshRate function - tells the limiter the refresh rate range of a variable refresh rate display.
+    // The adaptive limit then stays just below the refresh rate, and AntiLag2::MakeMaxFPSBelowRefresh limits follow it.
+    // No limit is placed right at the bottom of the range, where the display starts to show frames more than once.
+    // Can be called from any thread once the context is initialized.
+    // context - address of the game's context object.
+    // refreshHz - the refresh rate in Hz, zero if the display does not have a variable refresh rate.
+    // minRefreshHz - the bottom of the refresh rate range in Hz, zero if it is not known.
+    HRESULT SetRefreshRate( Context* context, double refreshHz );
+    HRESULT SetRefreshRate( Context* context, double refreshHz, double minRefreshHz );
+
+    // GetAdaptiveMaxFPS function - returns the framerate limit picked by the adaptive limiter, zero while it is measuring the game
+    // or when maxFPS is not AntiLag2::kMaxFPSAdaptive. Can be called from any thread.
+    // context - address of the game's context object.
+    unsigned int GetAdaptiveMaxFPS( const Context* context );
+
+    // GetLatencyStats function - returns the p50/p95/p99 of one of the per-frame intervals over the last 127 frames.
+    // Can be called from any thread.
+    // context - address of the game's context object.
+    // interval - which interval of the frame to look at, see AntiLag2::TelemetryInterval.
+    // A return value of S_FALSE means that no frames have been recorded yet.
+    HRESULT GetLatencyStats( const Context* context, AntiLag2::TelemetryInterval interval, AntiLag2::LatencyStats* stats );
+
+    // GetFrameRecord function - returns what the SDK recorded for a recent frame. Can be called from any thread.
+    // context - address of the game's context object.
+    // framesAgo - 0 is the frame of the most recent Update call, up to 127 frames back.
+    // A return value of S_FALSE means that the frame is not available.
+    HRESULT GetFrameRecord( const Context* context, unsigned int framesAgo, AntiLag2::FrameRecord* record );
+
+    // MarkFrameComplete function - call this once the GPU has finished a frame, for example when its fence has been seen signaled.
+    // It feeds GetLatencyInFrames. Call it in frame order, from one thread at a time.
+    // context - address of the game's context object.
+    // frameIndex - the index of the frame, see GetFrameIndex.
+    // time - when the GPU finished the frame, in AntiLag2::GetTimestamp() time, or when it was presented if that is all that is known.
+    // Without it the frame is taken to have finished now. A return value of S_FALSE means that the frame is too old to be looked up.
+    HRESULT MarkFrameComplete( Context* context, unsigned __int64 frameIndex );
+    HRESULT MarkFrameComplete( Context* context, unsigned __int64 frameIndex, AntiLag2::Timestamp time );
+
+    // GetLatencyInFrames function - returns an estimate of the latency in GPU frames, the green number of the Radeon Anti-Lag 2
+    // Latency Monitor, averaged over the last 32 frames reported to MarkFrameComplete. With Anti-Lag 2.0 it should be between
+    // 1.0 and 2.0. Can be called from any thread.
+    // context - address of the game's context object.
+    // A return value of S_FALSE means that not enough frames have been reported yet.
+    HRESULT GetLatencyInFrames( const Context* context, float* frames );
+
+    // SetRecorder function - records every call into the SDK with its arguments, timestamps and result into a binary log,
+    // which tools/bin/Replay plays back against a mock or the software implementation. Can be called from any thread once the
+    // context is initialized; DeInitialize removes the recorder.
+    // context - address of the game's context object.
+    // recorder - a started AntiLag2::CallRecorder (ffx_antilag2_record.h) that outlives the recording, or nullptr to stop passing calls to it.
+    HRESULT SetRecorder( Context* context, AntiLag2::CallSink* recorder );
+
+    // SetSharedTelemetry function - publishes the state of every frame to a shared memory ring that tools/bin/al2top shows live,
+    // without any cost beyond a few stores per frame. Can be called from any thread once the context is initialized; DeInitialize
+    // removes the writer.
+    // context - address of the game's context object.
+    // writer - an opened AntiLag2::SharedTelemetryWriter (ffx_antilag2_shared.h) that outlives the publishing, or nullptr to stop publishing.
+    HRESULT SetSharedTelemetry( Context* context, AntiLag2::FrameSink* writer );
+
+    // ContextRegistry - holds one context per swapchain, for games that present to several swapchains at different rates, such as
+    // split-screen modes and tools. Declare a persistent registry instead of a single Context, see AntiLag2::ContextRegistry.
+    typedef AntiLag2::ContextRegistry<Context> ContextRegistry;
+
+    // RegisterSwapChain function - returns the context of a swapchain, and takes a free one from the registry the first time.
+    // Initialize it like a single context, then make every call for the swapchain's frames on it. Each context has its own delay
+    // and framerate limit and does not wait for the others, so call Update on each from the thread that polls the input for its swapchain.
+    // registry - address of the game's registry.
+    // swapChain - the swapchain the context paces.
+    // A return value of nullptr means that every context of the registry is taken.
+    Context* RegisterSwapChain( ContextRegistry* registry, IUnknown* swapChain );
+
+    // FindSwapChainContext function - returns the context of a registered swapchain, nullptr if it has none. Can be called from any thread.
+    // registry - address of the game's registry.
+    // swapChain - the swapchain passed to RegisterSwapChain.
+    Context* FindSwapChainContext( ContextRegistry* registry, IUnknown* swapChain );
+
+    // UnregisterSwapChain function - deinitializes the context of a swapchain, resets it to its default state and frees it for
+    // another one. Call this before releasing the swapchain or destroying the device, while no other call is made on the context.
+    // registry - address of the game's registry.
+    // swapChain - the swapchain passed to RegisterSwapChain.
+    // The return value is the reference count of the internal API. It should be 0.
+    ULONG UnregisterSwapChain( ContextRegistry* registry, IUnknown* swapChain );
+
+    // ResetContext function - deinitializes a context, which leaves it as it was declared. ContextRegistry frees its contexts with it.
+    // context - the game's context object.
+    // The return value is the reference count of the internal API. It should be 0.
+    ULONG ResetContext( Context& context );
+
+    // {5083ae5b-8070-4fca-8ee5-3582dd367d13}
+    // GUID of the swapchain private data through which FSR 3.1.1 onwards finds the context, see SetSwapChainData.
+    static const GUID IID_IFfxAntiLag2Data =
+        { 0x5083ae5b, 0x8070, 0x4fca, { 0x8e, 0xe5, 0x35, 0x82, 0xdd, 0x36, 0x7d, 0x13 } };
+
+    // The swapchain private data stored under IID_IFfxAntiLag2Data.
+    struct SwapChainData
+    {
+        Context*    context;
+        bool        enabled;
+    };
+
+    // SetSwapChainData function - stores the context of a swapchain and whether Anti-Lag 2.0 is enabled in the swapchain's private
+    // data, where FSR 3.1.1 onwards looks them up to call SetFrameGenFrameType for you. Call this every frame, before Present.
+    // With several swapchains, give each the context RegisterSwapChain returned for it.
+    // swapChain - the swapchain FSR 3 presents to.
+    // context - address of the swapchain's context object, or nullptr to remove the data.
+    // enable - whether Anti-Lag 2.0 is enabled, as passed to Update.
+    template<class SwapChain>
+    HRESULT SetSwapChainData( SwapChain* swapChain, Context* context, bool enable );
 
     //
     // End of public API section.
     // Private implementation details below.
     //
 
+    // Finds the driver module and its entry point with the Win32 loader.
+    struct SystemLoader
+    {
+        static HMODULE  GetModule( const char* name )                   { return GetModuleHandleA( name ); }
+        static FARPROC  GetProc( HMODULE hModule, const char* name )    { return GetProcAddress( hModule, name ); }
+    };
+
     // Forward declaration of the Anti-Lag interface into the DX12 driver
     MIDL_INTERFACE("44085fbe-e839-40c5-bf38-0ebc5ab4d0a6")
     IAmdExtAntiLagApi: public IUnknown
@@ -69,14 +290,11 @@ namespace AntiLag2DX12 {
         virtual HRESULT UpdateAntiLagState(VOID* pData) = 0;
     };
 
-    // Context structure for the SDK. Declare a persistent object of this type *once* in your game code.
-    // Ensure the contents are initialized to zero before calling Initialize() but do not modify these members directly after that.
-    struct Context
-    {
-        IAmdExtAntiLagApi*  m_pAntiLagAPI = nullptr;
-        bool                m_enabled = false;
-        unsigned int        m_maxFPS = 0;
-    };
+    typedef HRESULT(__cdecl* PFNAmdExtD3DCreateInterface)( IUnknown* pOuter, REFIID riid, void** ppvObject );
+
+    // Creates the driver's Anti-Lag interface for the device. The entry point is kept in the process-wide DriverProbeCache.
+    template<class Loader>
+    AntiLag2::DriverProbeResult ProbeDriver( ID3D12Device* device );
 
     // Structure version 1 for Anti-Lag 2.0:
     struct APIData_v1
@@ -113,46 +331,190 @@ namespace AntiLag2DX12 {
     };
     static_assert(sizeof(APIData_v2) == 176, "Check structure packing compiler settings.");
 
-    inline HRESULT Initialize( Context* context, ID3D12Device* device )
+    // CPU-only implementation of the Anti-Lag interface, created by InitializeSoftware()
+    class SoftwareAntiLagApi final : public IAmdExtAntiLagApi
     {
-        HRESULT hr = E_INVALIDARG;
-        if ( context && device && context->m_pAntiLagAPI == nullptr )
+    public:
+        SoftwareAntiLagApi()                                    { m_backend.Initialize(); }
+
+        virtual HRESULT STDMETHODCALLTYPE QueryInterface( REFIID riid, void** ppvObject ) override;
+        virtual ULONG STDMETHODCALLTYPE AddRef() override;
+        virtual ULONG STDMETHODCALLTYPE Release() override;
+        virtual HRESULT UpdateAntiLagState( VOID* pData ) override;
+
+    private:
+        std::atomic<ULONG>          m_refCount{ 1 };
+        AntiLag2::SoftwareBackend   m_backend;
+    };
+
+    // Backend of the front end in ffx_antilag2.h, driving the Anti-Lag interface.
+    // The input sample signal is only sent to a driver once the game has opted in with SetInputSampleSignal. Until then Update
+    // sends the driver the same packets as before frame indices were added. The driver takes whole limits only, the software
+    // implementation also fractional ones.
+    class DriverBackend
+    {
+    public:
+        static const bool kActive = true;
+
+        // Takes over the reference to the interface and disables Anti-Lag 2.0 through it. The driver is not sent the input sample
+        // signal until SetInputSampleSignal enables it, the software implementation always.
+        HRESULT         Initialize( IAmdExtAntiLagApi* pAntiLagAPI )    { return Initialize( pAntiLagAPI, false ); }
+        HRESULT         Initialize( SoftwareAntiLagApi* pAntiLagAPI )   { return Initialize( pAntiLagAPI, true ); }
+        bool            IsInitialized() const                   { return m_pAntiLagAPI != nullptr; }
+        unsigned int    DeInitialize();
+        HRESULT         SetState( bool enabled, unsigned int maxFPS );
+        HRESULT         InsertDelay()                           { return m_pAntiLagAPI->UpdateAntiLagState( nullptr ); }
+        HRESULT         BeginDelay( AntiLag2::Timestamp* )      { return S_FALSE; }
+        HRESULT         EndDelay()                              { return S_FALSE; }
+        HRESULT         SignalInputSample( std::uint64_t frameIndex );
+        HRESULT         MarkEndOfFrame( std::uint64_t frameIndex );
+        HRESULT         SetFrameType( bool interpolated, std::uint64_t frameIndex );
+        HRESULT         InsertSplitDelay( std::uint64_t )       { return S_FALSE; }   // The driver delays in InsertDelay only
+
+        // Whether Update sends the input sample signal, false while not initialized.
+        bool            IsInputSampleSignalOn() const           { return m_inputSampleSignal; }
+
+        // Whether Update sends a driver the input sample signal, until the next Initialize.
+        void            SetInputSampleSignal( bool enable )     { m_inputSampleSignal = m_software || enable; }
+
+    private:
+        HRESULT         Initialize( IAmdExtAntiLagApi* pAntiLagAPI, bool software );
+        HRESULT         SetFrameGenParams( APIData_v2::Flags flags, std::uint64_t frameIndex );
+
+        IAmdExtAntiLagApi*      m_pAntiLagAPI = nullptr;
+        bool                    m_software = false;                 // The interface is a SoftwareAntiLagApi
+        bool                    m_inputSampleSignal = false;
+    };
+
+    typedef AntiLag2::Context<DriverBackend> FrontEndContext;
+
+    // The object m_pAntiLagAPI of an initialized Context points to: the front end in ffx_antilag2.h, allocated by the initialization
+    // and driving the driver interface or the software implementation. Code built against an earlier copy of this header, such as
+    // FSR 3 finding the context through SetSwapChainData, calls UpdateAntiLagState on it directly, and reaches the front end too.
+    class FrontEnd final : public IAmdExtAntiLagApi
+    {
+    public:
+        virtual HRESULT STDMETHODCALLTYPE QueryInterface( REFIID riid, void** ppvObject ) override;
+        virtual ULONG STDMETHODCALLTYPE AddRef() override;
+        virtual ULONG STDMETHODCALLTYPE Release() override;
+        virtual HRESULT UpdateAntiLagState( VOID* pData ) override;
+
+        FrontEndContext&    GetContext()                { return m_context; }
+
+    private:
+        std::atomic<ULONG>          m_refCount{ 1 };
+        FrontEndContext             m_context;
+    };
+
+    // Context structure for the SDK. Declare a persistent object of this type *once* in your game code.
+    // Ensure the contents are initialized to zero before calling Initialize() but do not modify these members directly after that.
+    // The members are the same as in earlier versions of the SDK, see FrontEnd. See AntiLag2::Context for the threading rules.
+    struct Context
+    {
+        IAmdExtAntiLagApi*  m_pAntiLagAPI = nullptr;    // The FrontEnd while initialized
+        bool                m_enabled = false;          // The settings last passed to Update or BeginUpdate
+        unsigned int        m_maxFPS = 0;
+    };
+
+    // The front end of an initialized context, nullptr otherwise.
+    FrontEndContext* GetFrontEnd( const Context* context );
+
+    // Initializes a new front end with the interface and makes it the context's.
+    template<class Interface>
+    HRESULT InitializeFrontEnd( Context* context, Interface* pAntiLagAPI );
+
+    template<class Loader>
+    inline AntiLag2::DriverProbeResult ProbeDriver( ID3D12Device* device )
+    {
+        AntiLag2::DriverProbeResult result = { E_HANDLE, nullptr };
+        HMODULE hModule = Loader::GetModule("amdxc64.dll");
+        if ( hModule )
         {
-            HMODULE hModule = GetModuleHandleA("amdxc64.dll");
-            if ( hModule )
+            AntiLag2::DriverProbeCache<PFNAmdExtD3DCreateInterface>& cache = AntiLag2::DriverProbeCache<PFNAmdExtD3DCreateInterface>::Get();
+            PFNAmdExtD3DCreateInterface AmdExtD3DCreateInterface = nullptr;
+            if ( !cache.Find( hModule, &AmdExtD3DCreateInterface ) )
+            {
+                AmdExtD3DCreateInterface = reinterpret_cast<PFNAmdExtD3DCreateInterface>( Loader::GetProc(hModule, "AmdExtD3DCreateInterface") );
+                cache.Store( hModule, AmdExtD3DCreateInterface );
+            }
+            result.hr = AmdExtD3DCreateInterface ? S_OK : E_INVALIDARG;
+            if ( result.hr == S_OK )
             {
-                typedef HRESULT(__cdecl* PFNAmdExtD3DCreateInterface)( IUnknown* pOuter, REFIID riid, void** ppvObject );
-                PFNAmdExtD3DCreateInterface AmdExtD3DCreateInterface = static_cast<PFNAmdExtD3DCreateInterface>( (VOID*)GetProcAddress(hModule, "AmdExtD3DCreateInterface") );
-                if ( AmdExtD3DCreateInterface )
+                IAmdExtAntiLagApi* pAntiLagAPI = nullptr;
+                result.hr = AmdExtD3DCreateInterface( device, __uuidof(IAmdExtAntiLagApi), (void**)&pAntiLagAPI );
+                if ( result.hr == S_OK )
+                {
+                    result.hr = pAntiLagAPI ? S_OK : E_NOINTERFACE;
+                    result.pInterface = pAntiLagAPI;
+                }
+                else if ( pAntiLagAPI )
                 {
-                    hr = AmdExtD3DCreateInterface( device, __uuidof(IAmdExtAntiLagApi), (void**)&context->m_pAntiLagAPI );
-                    if ( hr == S_OK && context->m_pAntiLagAPI )
-                    {
-                        APIData_v1 data = {};
-                        data.uiSize = sizeof(data);
-                        data.uiVersion = 1;
-                        data.eMode = 2; // Anti-Lag 2.0 is disabled during initialization
-                        data.sControlStr = nullptr;
-                        data.uiControlStrLength = 0;
-                        data.maxFPS = 0;
-
-                        hr = context->m_pAntiLagAPI->UpdateAntiLagState( &data );
-                    }
-
-                    if ( hr != S_OK )
-                    {
-                        DeInitialize( context );
-                    }
+                    pAntiLagAPI->Release();
                 }
             }
-            else
+        }
+        return result;
+    }
+
+    inline FrontEndContext* GetFrontEnd( const Context* context )
+    {
+        return context && context->m_pAntiLagAPI ? &static_cast<FrontEnd*>( context->m_pAntiLagAPI )->GetContext() : nullptr;
+    }
+
+    template<class Interface>
+    inline HRESULT InitializeFrontEnd( Context* context, Interface* pAntiLagAPI )
+    {
+        FrontEnd* frontEnd = new FrontEnd();
+        const HRESULT hr = frontEnd->GetContext().Initialize( pAntiLagAPI );
+        if ( hr != S_OK )
+        {
+            frontEnd->Release();
+            return hr;
+        }
+        context->m_pAntiLagAPI = frontEnd;
+        context->m_enabled = false;
+        context->m_maxFPS = 0;
+        return hr;
+    }
+
+    template<class Loader>
+    inline HRESULT Initialize( Context* context, ID3D12Device* device )
+    {
+        HRESULT hr = E_INVALIDARG;
+        if ( context && device && context->m_pAntiLagAPI == nullptr )
+        {
+            const AntiLag2::DriverProbeResult result = ProbeDriver<Loader>( device );
+            hr = result.hr == S_OK ? InitializeFrontEnd( context, static_cast<IAmdExtAntiLagApi*>( result.pInterface ) ) : result.hr;
+        }
+        return hr;
+    }
+
+    template<class Loader, class AsyncDriverProbe>
+    inline HRESULT InitializeAsync( Context* context, ID3D12Device* device, AsyncDriverProbe* probe )
+    {
+        HRESULT hr = E_INVALIDARG;
+        if ( context && device && probe && context->m_pAntiLagAPI == nullptr )
+        {
+            AntiLag2::DriverProbeResult result = {};
+            hr = probe->template Poll<IAmdExtAntiLagApi>( [device]() { return ProbeDriver<Loader>( device ); }, &result );
+            if ( hr == S_OK )
             {
-                hr = E_HANDLE;
+                hr = result.hr == S_OK ? InitializeFrontEnd( context, static_cast<IAmdExtAntiLagApi*>( result.pInterface ) ) : result.hr;
             }
         }
         return hr;
     }
 
+    inline HRESULT InitializeSoftware( Context* context )
+    {
+        HRESULT hr = E_INVALIDARG;
+        if ( context && context->m_pAntiLagAPI == nullptr )
+        {
+            hr = InitializeFrontEnd( context, new SoftwareAntiLagApi() );
+        }
+        return hr;
+    }
+
     inline ULONG DeInitialize( Context* context )
     {
         ULONG refCount = 0;
@@ -160,90 +522,481 @@ namespace AntiLag2DX12 {
         {
             if ( context->m_pAntiLagAPI )
             {
-                refCount = context->m_pAntiLagAPI->Release();
+                FrontEnd* frontEnd = static_cast<FrontEnd*>( context->m_pAntiLagAPI );
                 context->m_pAntiLagAPI = nullptr;
+                refCount = frontEnd->GetContext().DeInitialize();
+                frontEnd->Release();
             }
             context->m_enabled = false;
+            context->m_maxFPS = 0;
         }
-
         return refCount;
     }
 
     inline HRESULT Update( Context* context, bool enabled, unsigned int maxFPS )
     {
-        // This function needs to be called once per frame, before the user input
-        // is sampled - or optionally also when the UI settings are modified.
-        if ( context && context->m_pAntiLagAPI )
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        if ( frontEnd == nullptr )
         {
-            // Update the Anti-Lag 2.0 internal state only when necessary:
-            if ( context->m_enabled != enabled || context->m_maxFPS != maxFPS )
-            {
-                context->m_enabled = enabled;
-                context->m_maxFPS = maxFPS;
-
-                APIData_v1 data = {};
-                data.uiSize = sizeof(data);
-                data.uiVersion = 1;
-                data.eMode = enabled ? 1 : 2;
-                data.sControlStr = nullptr;
-                data.uiControlStrLength = 0;
-                data.maxFPS = maxFPS;
-
-                // Only call the function with non-null arguments when setting state.
-                // Make sure not to set the state every frame.
-                context->m_pAntiLagAPI->UpdateAntiLagState( &data );
-            }
-
-            // Call the function with a nullptr to insert the latency-reducing delay.
-            // (if the state has not been set to 'enabled' this call will have no effect)
-            HRESULT hr = context->m_pAntiLagAPI->UpdateAntiLagState( nullptr );
-            if ( hr == S_OK || hr == S_FALSE )
-            {
-                return S_OK;
-            }
-            else
-            {
-                return hr;
-            }
+            return E_NOINTERFACE;
         }
-        else
+        context->m_enabled = enabled;
+        context->m_maxFPS = maxFPS;
+        return frontEnd->Update( enabled, maxFPS );
+    }
+
+    inline HRESULT SetState( Context* context, bool enabled, unsigned int maxFPS )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->SetState( enabled, maxFPS ) : context ? E_NOINTERFACE : E_INVALIDARG;
+    }
+
+    inline HRESULT Update( Context* context )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->Update() : E_NOINTERFACE;
+    }
+
+    inline HRESULT BeginUpdate( Context* context, bool enable, unsigned int maxFPS )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        if ( frontEnd == nullptr )
         {
             return E_NOINTERFACE;
         }
+        context->m_enabled = enable;
+        context->m_maxFPS = maxFPS;
+        return frontEnd->BeginUpdate( enable, maxFPS );
+    }
+
+    inline HRESULT BeginUpdate( Context* context )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->BeginUpdate() : E_NOINTERFACE;
+    }
+
+    inline HRESULT EndUpdate( Context* context )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->EndUpdate() : E_NOINTERFACE;
+    }
+
+    inline bool IsUpdateReady( const Context* context )
+    {
+        const FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->IsUpdateReady() : true;
+    }
+
+    inline unsigned __int64 GetFrameIndex( const Context* context )
+    {
+        const FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->GetFrameIndex() : 0;
+    }
+
+    inline HRESULT MarkEndOfFrameRendering( Context* context )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->MarkEndOfFrameRendering() : E_NOINTERFACE;
+    }
+
+    inline HRESULT MarkEndOfFrameRendering( Context* context, unsigned __int64 frameIndex )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->MarkEndOfFrameRendering( frameIndex ) : E_NOINTERFACE;
+    }
+
+    inline HRESULT SetFrameGenFrameType( Context* context, bool bInterpolatedFrame )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->SetFrameGenFrameType( bInterpolatedFrame ) : E_NOINTERFACE;
+    }
+
+    inline HRESULT SetFrameGenFrameType( Context* context, bool bInterpolatedFrame, unsigned __int64 frameIndex )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->SetFrameGenFrameType( bInterpolatedFrame, frameIndex ) : E_NOINTERFACE;
+    }
+
+    inline HRESULT PaceFrameGenPresent( Context* context, bool bInterpolatedFrame )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->PaceFrameGenPresent( bInterpolatedFrame ) : E_NOINTERFACE;
+    }
+
+    inline HRESULT PaceFrameGenPresent( Context* context, bool bInterpolatedFrame, unsigned __int64 frameIndex )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->PaceFrameGenPresent( bInterpolatedFrame, frameIndex ) : E_NOINTERFACE;
+    }
+
+    inline HRESULT SetLatencyMarker( Context* context, AntiLag2::LatencyMarker marker )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->SetLatencyMarker( marker ) : E_NOINTERFACE;
+    }
+
+    inline HRESULT SetLatencyMarker( Context* context, AntiLag2::LatencyMarker marker, unsigned __int64 frameIndex )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->SetLatencyMarker( marker, frameIndex ) : E_NOINTERFACE;
+    }
+
+    inline HRESULT SetInputSampleSignal( Context* context, bool enable )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        if ( frontEnd == nullptr )
+        {
+            return context ? E_NOINTERFACE : E_INVALIDARG;
+        }
+        frontEnd->GetBackend().SetInputSampleSignal( enable );
+        return S_OK;
     }
 
-    // Internal helper function
-    inline HRESULT SetFrameGenParamsInternal( Context* context, APIData_v2::Flags flags )
+    inline HRESULT SetDelayThread( Context* context, AntiLag2::DelayExecutor* thread )
     {
-        if ( context && context->m_pAntiLagAPI )
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        if ( frontEnd == nullptr )
         {
-            APIData_v2 data = {};
-            data.uiSize = sizeof(data);
-            data.uiVersion = 2;
-            data.flags = flags;
-            data.iiFrameIdx = 0;
+            return context ? E_NOINTERFACE : E_INVALIDARG;
+        }
+        frontEnd->SetDelayExecutor( thread );
+        return S_OK;
+    }
+
+    inline HRESULT SetRefreshRate( Context* context, double refreshHz )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->SetRefreshRate( refreshHz ) : context ? E_NOINTERFACE : E_INVALIDARG;
+    }
+
+    inline HRESULT SetRefreshRate( Context* context, double refreshHz, double minRefreshHz )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->SetRefreshRate( refreshHz, minRefreshHz ) : context ? E_NOINTERFACE : E_INVALIDARG;
+    }
+
+    inline unsigned int GetAdaptiveMaxFPS( const Context* context )
+    {
+        const FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->GetAdaptiveMaxFPS() : 0;
+    }
 
-            return context->m_pAntiLagAPI->UpdateAntiLagState( &data );
+    inline HRESULT GetLatencyStats( const Context* context, AntiLag2::TelemetryInterval interval, AntiLag2::LatencyStats* stats )
+    {
+        if ( context == nullptr || stats == nullptr )
+        {
+            return E_INVALIDARG;
         }
-        else
+        const FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->GetLatencyStats( interval, stats ) : S_FALSE;
+    }
+
+    inline HRESULT GetFrameRecord( const Context* context, unsigned int framesAgo, AntiLag2::FrameRecord* record )
+    {
+        if ( context == nullptr || record == nullptr )
         {
-            return E_NOINTERFACE;
+            return E_INVALIDARG;
         }
+        const FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->GetFrameRecord( framesAgo, record ) : S_FALSE;
     }
 
-    inline HRESULT MarkEndOfFrameRendering( Context* context )
+    inline HRESULT MarkFrameComplete( Context* context, unsigned __int64 frameIndex )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->MarkFrameComplete( frameIndex ) : context ? E_NOINTERFACE : E_INVALIDARG;
+    }
+
+    inline HRESULT MarkFrameComplete( Context* context, unsigned __int64 frameIndex, AntiLag2::Timestamp time )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->MarkFrameComplete( frameIndex, time ) : context ? E_NOINTERFACE : E_INVALIDARG;
+    }
+
+    inline HRESULT GetLatencyInFrames( const Context* context, float* frames )
+    {
+        if ( context == nullptr || frames == nullptr )
+        {
+            return E_INVALIDARG;
+        }
+        const FrontEndContext* frontEnd = GetFrontEnd( context );
+        return frontEnd ? frontEnd->GetLatencyInFrames( frames ) : S_FALSE;
+    }
+
+    inline HRESULT SetRecorder( Context* context, AntiLag2::CallSink* recorder )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        if ( frontEnd == nullptr )
+        {
+            return context ? E_NOINTERFACE : E_INVALIDARG;
+        }
+        frontEnd->SetRecorder( recorder );
+        return S_OK;
+    }
+
+    inline HRESULT SetSharedTelemetry( Context* context, AntiLag2::FrameSink* writer )
+    {
+        FrontEndContext* frontEnd = GetFrontEnd( context );
+        if ( frontEnd == nullptr )
+        {
+            return context ? E_NOINTERFACE : E_INVALIDARG;
+        }
+        frontEnd->SetSharedTelemetry( writer );
+        return S_OK;
+    }
+
+    inline Context* RegisterSwapChain( ContextRegistry* registry, IUnknown* swapChain )
+    {
+        return registry ? registry->Register( swapChain ) : nullptr;
+    }
+
+    inline Context* FindSwapChainContext( ContextRegistry* registry, IUnknown* swapChain )
+    {
+        return registry ? registry->Find( swapChain ) : nullptr;
+    }
+
+    inline ULONG UnregisterSwapChain( ContextRegistry* registry, IUnknown* swapChain )
+    {
+        return registry ? registry->Unregister( swapChain ) : 0;
+    }
+
+    inline ULONG ResetContext( Context& context )
+    {
+        return DeInitialize( &context );
+    }
+
+    template<class SwapChain>
+    inline HRESULT SetSwapChainData( SwapChain* swapChain, Context* context, bool enable )
+    {
+        if ( swapChain == nullptr )
+        {
+            return E_INVALIDARG;
+        }
+        if ( context == nullptr )
+        {
+            return swapChain->SetPrivateData( IID_IFfxAntiLag2Data, 0, nullptr );
+        }
+        SwapChainData data = {};
+        data.context = context;
+        data.enabled = enable;
+        return swapChain->SetPrivateData( IID_IFfxAntiLag2Data, (unsigned int)sizeof( data ), &data );
+    }
+
+    inline HRESULT DriverBackend::Initialize( IAmdExtAntiLagApi* pAntiLagAPI, bool software )
+    {
+        if ( pAntiLagAPI == nullptr )
+        {
+            return E_INVALIDARG;
+        }
+        m_pAntiLagAPI = pAntiLagAPI;
+
+        APIData_v1 data = {};
+        data.uiSize = sizeof(data);
+        data.uiVersion = 1;
+        data.eMode = 2; // Anti-Lag 2.0 is disabled during initialization
+        data.sControlStr = nullptr;
+        data.uiControlStrLength = 0;
+        data.maxFPS = 0;
+
+        HRESULT hr = m_pAntiLagAPI->UpdateAntiLagState( &data );
+        if ( hr != S_OK )
+        {
+            DeInitialize();
+            return hr;
+        }
+        m_software = software;
+        m_inputSampleSignal = software;
+        return hr;
+    }
+
+    inline unsigned int DriverBackend::DeInitialize()
+    {
+        ULONG refCount = 0;
+        if ( m_pAntiLagAPI )
+        {
+            refCount = m_pAntiLagAPI->Release();
+            m_pAntiLagAPI = nullptr;
+        }
+        m_software = false;
+        m_inputSampleSignal = false;
+        return refCount;
+    }
+
+    inline HRESULT DriverBackend::SetState( bool enabled, unsigned int maxFPS )
+    {
+        APIData_v1 data = {};
+        data.uiSize = sizeof(data);
+        data.uiVersion = 1;
+        data.eMode = enabled ? 1 : 2;
+        data.sControlStr = nullptr;
+        data.uiControlStrLength = 0;
+        data.maxFPS = m_software ? maxFPS : AntiLag2::GetWholeMaxFPS( maxFPS );
+
+        // Only call the function with non-null arguments when setting state.
+        // Make sure not to set the state every frame.
+        return m_pAntiLagAPI->UpdateAntiLagState( &data );
+    }
+
+    inline HRESULT DriverBackend::SignalInputSample( std::uint64_t frameIndex )
+    {
+        if ( !m_inputSampleSignal )
+        {
+            return S_OK;
+        }
+
+        APIData_v2::Flags flags     = {};
+        flags.signalGetUserInputIdx = 1;
+        return SetFrameGenParams( flags, frameIndex );
+    }
+
+    inline HRESULT DriverBackend::MarkEndOfFrame( std::uint64_t frameIndex )
     {
         APIData_v2::Flags flags   = {};
         flags.signalEndOfFrameIdx = 1;
-        return SetFrameGenParamsInternal( context, flags );
+        return SetFrameGenParams( flags, frameIndex );
     }
 
-    inline HRESULT SetFrameGenFrameType( Context* context, bool bInterpolatedFrame )
+    inline HRESULT DriverBackend::SetFrameType( bool interpolated, std::uint64_t frameIndex )
     {
         APIData_v2::Flags flags   = {};
         flags.signalFgFrameType   = 1;
-        flags.isInterpolatedFrame = bInterpolatedFrame ? 1 : 0;
-        return SetFrameGenParamsInternal( context, flags );
+        flags.isInterpolatedFrame = interpolated ? 1 : 0;
+        return SetFrameGenParams( flags, frameIndex );
+    }
+
+    inline HRESULT DriverBackend::SetFrameGenParams( APIData_v2::Flags flags, std::uint64_t frameIndex )
+    {
+        APIData_v2 data = {};
+        data.uiSize = sizeof(data);
+        data.uiVersion = 2;
+        data.flags = flags;
+        data.iiFrameIdx = frameIndex;
+
+        return m_pAntiLagAPI->UpdateAntiLagState( &data );
+    }
+
+    inline HRESULT STDMETHODCALLTYPE FrontEnd::QueryInterface( REFIID riid, void** ppvObject )
+    {
+        if ( ppvObject == nullptr )
+        {
+            return E_POINTER;
+        }
+        if ( riid == __uuidof(IUnknown) || riid == __uuidof(IAmdExtAntiLagApi) )
+        {
+            AddRef();
+            *ppvObject = static_cast<IAmdExtAntiLagApi*>( this );
+            return S_OK;
+        }
+        *ppvObject = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    inline ULONG STDMETHODCALLTYPE FrontEnd::AddRef()
+    {
+        return ++m_refCount;
+    }
+
+    inline ULONG STDMETHODCALLTYPE FrontEnd::Release()
+    {
+        ULONG refCount = --m_refCount;
+        if ( refCount == 0 )
+        {
+            delete this;
+        }
+        return refCount;
+    }
+
+    inline HRESULT FrontEnd::UpdateAntiLagState( VOID* pData )
+    {
+        if ( pData == nullptr )
+        {
+            return m_context.Update();
+        }
+
+        // Both structure versions start with the size and version fields.
+        const APIData_v1* pHeader = static_cast<const APIData_v1*>( pData );
+        if ( pHeader->uiVersion == 1 && pHeader->uiSize == sizeof(APIData_v1) )
+        {
+            return m_context.SetState( pHeader->eMode == 1, pHeader->maxFPS );
+        }
+        else if ( pHeader->uiVersion == 2 && pHeader->uiSize == sizeof(APIData_v2) )
+        {
+            // Update assigns the input sample its index. Callers that predate the frame indices pass 0 for the frame sampled last.
+            const APIData_v2* pDataV2 = static_cast<const APIData_v2*>( pData );
+            const std::uint64_t frameIndex = pDataV2->iiFrameIdx ? pDataV2->iiFrameIdx : m_context.GetFrameIndex();
+            HRESULT hr = S_OK;
+            if ( pDataV2->flags.signalEndOfFrameIdx )
+            {
+                hr = m_context.MarkEndOfFrameRendering( frameIndex );
+            }
+            if ( pDataV2->flags.signalFgFrameType && hr == S_OK )
+            {
+                hr = m_context.SetFrameGenFrameType( pDataV2->flags.isInterpolatedFrame != 0, frameIndex );
+            }
+            return hr;
+        }
+        return E_INVALIDARG;
+    }
+
+    inline HRESULT STDMETHODCALLTYPE SoftwareAntiLagApi::QueryInterface( REFIID riid, void** ppvObject )
+    {
+        if ( ppvObject == nullptr )
+        {
+            return E_POINTER;
+        }
+        if ( riid == __uuidof(IUnknown) || riid == __uuidof(IAmdExtAntiLagApi) )
+        {
+            AddRef();
+            *ppvObject = static_cast<IAmdExtAntiLagApi*>( this );
+            return S_OK;
+        }
+        *ppvObject = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    inline ULONG STDMETHODCALLTYPE SoftwareAntiLagApi::AddRef()
+    {
+        return ++m_refCount;
+    }
+
+    inline ULONG STDMETHODCALLTYPE SoftwareAntiLagApi::Release()
+    {
+        ULONG refCount = --m_refCount;
+        if ( refCount == 0 )
+        {
+            delete this;
+        }
+        return refCount;
+    }
+
+    inline HRESULT SoftwareAntiLagApi::UpdateAntiLagState( VOID* pData )
+    {
+        if ( pData == nullptr )
+        {
+            // Insert the latency-reducing delay.
+            return m_backend.InsertDelay();
+        }
+
+        // Both structure versions start with the size and version fields.
+        const APIData_v1* pHeader = static_cast<const APIData_v1*>( pData );
+        if ( pHeader->uiVersion == 1 && pHeader->uiSize == sizeof(APIData_v1) )
+        {
+            return m_backend.SetState( pHeader->eMode == 1, pHeader->maxFPS );
+        }
+        else if ( pHeader->uiVersion == 2 && pHeader->uiSize == sizeof(APIData_v2) )
+        {
+            const APIData_v2* pDataV2 = static_cast<const APIData_v2*>( pData );
+            if ( pDataV2->flags.signalGetUserInputIdx && pDataV2->iiFrameIdx )
+            {
+                m_backend.SignalInputSample( pDataV2->iiFrameIdx );
+            }
+            if ( pDataV2->flags.signalEndOfFrameIdx )
+            {
+                m_backend.MarkEndOfFrame( pDataV2->iiFrameIdx );
+            }
+            return S_OK;
+        }
+        return E_INVALIDARG;
     }
 } // namespace AntiLag2DX12
 } // namespace AMD
\ No newline at end of file
@@ -0,0 +1,121 @@
+// This file is part of the Anti-Lag 2.0 SDK.
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "ffx_antilag2_queue.h"
+#include "ffx_antilag2_wait.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace AMD {
+namespace AntiLag2 {
+
+    // One input event, stamped when it arrived.
+    struct InputEvent
+    {
+        Timestamp       time;       // GetTimestamp() when the event arrived
+        unsigned int    type;       // Defined by the game, for example the window message
+        std::uint64_t   param0;     // For example the wParam of the window message
+        std::int64_t    param1;     // For example the lParam of the window message
+    };
+
+    // What a batch handed out by InputQueue::Drain contained, to see how fresh the input of a frame is.
+    struct InputBatch
+    {
+        Timestamp       sampleTime;     // The until argument of Drain
+        unsigned int    count;          // Events in the batch
+        Timestamp       oldestAge;      // sampleTime minus the time of the oldest event, 0 without events
+        Timestamp       newestAge;      // sampleTime minus the time of the newest event, 0 without events
+        std::uint64_t   dropped;        // Events lost since the previous batch because the queue was full
+    };
+
+    // Queue of timestamped input events for sampling the input just in time.
+    //
+    // The latency-reducing delay in Update only pays off when the game reads the input right after it. Engines that read the
+    // input state later in the frame, or that handle window messages as they come, see input that is older than it needs to be.
+    // Instead, push the events into this queue as they arrive, from the window procedure or an input thread, and drain them
+    // right after Update: Drain hands out the events up to a point in time in one batch, oldest first, and leaves later ones for
+    // the next frame.
+    //
+    // Push may be called from any number of threads and never blocks or allocates, see MpscQueue. Events that arrive while the
+    // queue is full are dropped and counted. Drain must only be called from one thread, normally the one calling Update.
+    class InputQueue
+    {
+    public:
+        static const unsigned int kCapacity = 1024;
+
+        // Returns false, and counts the event as dropped, when the queue is full.
+        bool Push( unsigned int type, std::uint64_t param0, std::int64_t param1 )  { return Push( { GetTimestamp(), type, param0, param1 } ); }
+        bool Push( const InputEvent& event )                                        { return m_queue.Push( event ); }
+
+        // Moves up to maxEvents events that arrived at or before until into events, and returns their number. Events of different
+        // threads are handed out in the order they were pushed in. batch is optional.
+        unsigned int Drain( Timestamp until, InputEvent* events, unsigned int maxEvents, InputBatch* batch = nullptr );
+
+    private:
+        MpscQueue<InputEvent, kCapacity>    m_queue;
+    };
+
+    //
+    // Private implementation details below.
+    //
+
+    inline unsigned int InputQueue::Drain( Timestamp until, InputEvent* events, unsigned int maxEvents, InputBatch* batch )
+    {
+        unsigned int count = 0;
+        while ( count < maxEvents )
+        {
+            const InputEvent* event = m_queue.Front();
+            if ( event == nullptr || event->time > until )
+            {
+                break;
+            }
+            events[ count++ ] = *event;
+            m_queue.Pop();
+        }
+
+        if ( batch )
+        {
+            batch->sampleTime = until;
+            batch->count = count;
+            batch->oldestAge = 0;
+            batch->newestAge = 0;
+            if ( count )
+            {
+                Timestamp oldest = events[ 0 ].time;
+                Timestamp newest = events[ 0 ].time;
+                for ( unsigned int i = 1; i < count; ++i )
+                {
+                    oldest = std::min( oldest, events[ i ].time );
+                    newest = std::max( newest, events[ i ].time );
+                }
+                batch->oldestAge = until - oldest;
+                batch->newestAge = until - newest;
+            }
+            batch->dropped = m_queue.TakeDropped();
+        }
+        return count;
+    }
+
+} // namespace AntiLag2
+} // namespace AMD
@@ -0,0 +1,340 @@
+// This file is part of the Anti-Lag 2.0 SDK.
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "ffx_antilag2_wait.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+namespace AMD {
+namespace AntiLag2 {
+
+    // maxFPS value that hands the choice of the framerate limit to AdaptiveLimiter.
+    static const unsigned int kMaxFPSAdaptive = 0x7fffffffu;
+
+    // maxFPS values for limits that are not a whole number of frames per second, made by MakeMaxFPS and MakeMaxFPSBelowRefresh.
+    // The low bits hold the limit in 1/1000ths of a frame per second, or how far below the refresh rate it is in 1/1000ths of Hz.
+    static const unsigned int kMaxFPSFractional     = 0x40000000u;
+    static const unsigned int kMaxFPSBelowRefresh   = 0x20000000u;
+    static const unsigned int kMaxFPSKindMask       = 0x60000000u;
+    static const unsigned int kMaxFPSValueMask      = 0x1fffffffu;
+
+    // maxFPS for a limit with a fraction, such as 59.94. The driver gets it rounded down to a whole number of frames per second,
+    // the software implementation as it is.
+    unsigned int MakeMaxFPS( double fps );
+
+    // maxFPS for a limit the given number of Hz below the refresh rate passed to SetRefreshRate, which keeps the game inside the
+    // range of a variable refresh rate display even when its refresh rate is not a whole number. Without a refresh rate it does
+    // not limit.
+    unsigned int MakeMaxFPSBelowRefresh( double belowHz );
+
+    // Limit of a whole or fractional maxFPS in 1/1000ths of a frame per second, 0 for none.
+    std::int64_t GetMaxFPSMillihertz( unsigned int maxFPS );
+
+    // Frame interval of a whole or fractional maxFPS, 0 for none.
+    Timestamp GetMaxFPSInterval( unsigned int maxFPS );
+
+    // Whole or fractional maxFPS rounded down to the whole number of frames per second the driver takes, but not to 0.
+    unsigned int GetWholeMaxFPS( unsigned int maxFPS );
+
+    // Feedback controller that picks the framerate limit with the lowest stable latency.
+    //
+    // A limit just below the rate the game can sustain keeps the GPU from building up a queue of frames, which is where most of
+    // the latency of a GPU-bound game comes from. The controller takes the median Update-to-Update time over windows of kWindow
+    // frames and compares it with the interval of the current limit:
+    //  - when the game does not keep up with the limit, the limit drops straight to the measured rate minus the headroom;
+    //  - when it does, the limit is probed upwards after a hold period, in steps that double while the game keeps up.
+    //    No probe goes more than one small step past the highest rate the game is known to sustain.
+    // Every failed probe doubles the hold period. The tolerance between the two conditions and the growing hold period are
+    // the hysteresis that keeps the limit from oscillating around the GPU-bound rate. With a refresh rate set the limit stays the headroom below it, which keeps a
+    // variable refresh rate display inside its range.
+    //
+    // Below the bottom of that range the display shows every frame more than once (low framerate compensation). A game running
+    // right at the bottom crosses it back and forth, and the repeated frames come and go, which stutters. With the bottom of the
+    // range set, no limit is placed in a band around it: a limit goes below the band, where every frame is compensated the same
+    // way, and a probe only jumps over it once the game was measured above it. Resolve does the same for the limits the game sets, and turns limits relative to
+    // the refresh rate into fractional ones.
+    //
+    // OnFrame takes an explicit frame time so that the controller can be driven by a virtual clock. OnFrame and Reset must be called
+    // from the thread calling Update(). SetRefreshRate and the getters may be called from any thread.
+    class AdaptiveLimiter
+    {
+    public:
+        struct Settings
+        {
+            // The limit is set this much below the measured rate, in 1/1000ths.
+            std::int64_t    headroomPermille = 30;
+            // The median frame time may exceed the interval of the limit by this much before the limit is lowered, in 1/1000ths.
+            std::int64_t    tolerancePermille = 20;
+            // First step by which the limit is raised when probing, in 1/1000ths.
+            std::int64_t    probePermille = 20;
+            // Largest step by which the limit is raised when probing, in 1/1000ths.
+            std::int64_t    maxProbePermille = 250;
+            // Bounds of the hold period after the limit was lowered, in windows.
+            unsigned int    minHoldWindows = 2;
+            unsigned int    maxHoldWindows = 64;
+            // Bounds of the limit.
+            unsigned int    minFPS = 20;
+            unsigned int    maxFPS = 1000;
+            // Frames with a longer interval than this (window drag, loading screens) are ignored.
+            Timestamp       resetInterval = 250 * kMillisecond;
+            // Limits this close to the bottom of the variable refresh rate range are moved below it, in 1/1000ths of it.
+            std::int64_t    lfcBandPermille = 100;
+        };
+
+        static const unsigned int kWindow = 32;
+
+        AdaptiveLimiter() { Reset(); }
+        explicit AdaptiveLimiter( const Settings& settings ) : m_settings( settings ) { Reset(); }
+
+        // Forgets the measurements. The next window runs without a limit to measure the rate the game can sustain.
+        void Reset();
+
+        // Refresh rate of a variable refresh rate display in Hz, 0 if there is none. minRefreshHz is the bottom of its range,
+        // below which it compensates low framerates, 0 if it is not known.
+        void SetRefreshRate( double refreshHz, double minRefreshHz = 0.0 );
+
+        // Turns a maxFPS below the refresh rate into a fractional one and moves limits out of the band around the bottom of the
+        // refresh rate range. Returns a whole or fractional maxFPS, 0 for no limit. Does not take kMaxFPSAdaptive.
+        unsigned int Resolve( unsigned int maxFPS ) const;
+
+        // Call once per frame with the time since the previous Update(). Returns the limit, 0 while the game is being measured.
+        unsigned int OnFrame( Timestamp frameTime );
+
+        unsigned int GetTarget() const          { return m_target.load( std::memory_order_relaxed ); }
+        unsigned int GetChangeCount() const     { return m_changes.load( std::memory_order_relaxed ); }
+
+    private:
+        unsigned int Below( unsigned int fps ) const;
+
+        // Moves a limit in the band around the bottom of the refresh rate range below it, or above it when up is set.
+        std::int64_t OutsideLfcBand( std::int64_t millihertz, bool up ) const;
+
+        Settings                    m_settings;
+        std::atomic<unsigned int>   m_target{ 0 };
+        std::atomic<unsigned int>   m_changes{ 0 };
+        std::atomic<unsigned int>   m_refreshCeiling{ 0 };
+        std::atomic<std::int64_t>   m_refreshMillihertz{ 0 };
+        std::atomic<std::int64_t>   m_lfcMillihertz{ 0 };     // Bottom of the refresh rate range
+
+        Timestamp                   m_window[ kWindow ] = {};
+        unsigned int                m_count = 0;
+        unsigned int                m_hold = 0;
+        unsigned int                m_holdWindows = 0;
+        unsigned int                m_measuredRate = 0;     // Rate the game can sustain, as of when the limit was last lowered
+        std::int64_t                m_probePermille = 0;
+        bool                        m_probing = false;
+        bool                        m_settling = false;
+    };
+
+    //
+    // Private implementation details below.
+    //
+
+    inline void AdaptiveLimiter::Reset()
+    {
+        m_target.store( 0, std::memory_order_relaxed );
+        m_changes.store( 0, std::memory_order_relaxed );
+        m_count = 0;
+        m_hold = 0;
+        m_holdWindows = m_settings.minHoldWindows;
+        m_measuredRate = 0;
+        m_probePermille = m_settings.probePermille;
+        m_probing = false;
+        m_settling = false;
+    }
+
+    inline unsigned int MakeMaxFPS( double fps )
+    {
+        const double millihertz = fps * 1000.0 + 0.5;
+        return millihertz < 1.0 ? 0u : kMaxFPSFractional | (unsigned int)std::min<double>( millihertz, kMaxFPSValueMask );
+    }
+
+    inline unsigned int MakeMaxFPSBelowRefresh( double belowHz )
+    {
+        const double millihertz = belowHz * 1000.0 + 0.5;
+        return kMaxFPSBelowRefresh | (unsigned int)std::min<double>( std::max( millihertz, 0.0 ), kMaxFPSValueMask );
+    }
+
+    inline std::int64_t GetMaxFPSMillihertz( unsigned int maxFPS )
+    {
+        switch ( maxFPS & kMaxFPSKindMask )
+        {
+            case 0:                 return (std::int64_t)maxFPS * 1000;
+            case kMaxFPSFractional: return maxFPS & kMaxFPSValueMask;
+            default:                return 0;
+        }
+    }
+
+    inline Timestamp GetMaxFPSInterval( unsigned int maxFPS )
+    {
+        const std::int64_t millihertz = GetMaxFPSMillihertz( maxFPS );
+        return millihertz ? kSecond * 1000 / millihertz : 0;
+    }
+
+    inline unsigned int GetWholeMaxFPS( unsigned int maxFPS )
+    {
+        const std::int64_t millihertz = GetMaxFPSMillihertz( maxFPS );
+        return millihertz ? (unsigned int)std::max<std::int64_t>( millihertz / 1000, 1 ) : 0u;
+    }
+
+    inline void AdaptiveLimiter::SetRefreshRate( double refreshHz, double minRefreshHz )
+    {
+        m_refreshCeiling.store( refreshHz > 0.0 ? Below( (unsigned int)refreshHz ) : 0u, std::memory_order_relaxed );
+        m_refreshMillihertz.store( refreshHz > 0.0 ? (std::int64_t)( refreshHz * 1000.0 + 0.5 ) : 0, std::memory_order_relaxed );
+        m_lfcMillihertz.store( minRefreshHz > 0.0 ? (std::int64_t)( minRefreshHz * 1000.0 + 0.5 ) : 0, std::memory_order_relaxed );
+    }
+
+    inline std::int64_t AdaptiveLimiter::OutsideLfcBand( std::int64_t millihertz, bool up ) const
+    {
+        const std::int64_t lfc = m_lfcMillihertz.load( std::memory_order_relaxed );
+        const std::int64_t low = lfc * ( 1000 - m_settings.lfcBandPermille ) / 1000;
+        const std::int64_t high = lfc * ( 1000 + m_settings.lfcBandPermille ) / 1000;
+        if ( lfc && millihertz > low && millihertz < high )
+        {
+            return up ? high : low;
+        }
+        return millihertz;
+    }
+
+    inline unsigned int AdaptiveLimiter::Resolve( unsigned int maxFPS ) const
+    {
+        std::int64_t millihertz = GetMaxFPSMillihertz( maxFPS );
+        if ( ( maxFPS & kMaxFPSKindMask ) == kMaxFPSBelowRefresh )
+        {
+            const std::int64_t refresh = m_refreshMillihertz.load( std::memory_order_relaxed );
+            millihertz = refresh ? std::max<std::int64_t>( refresh - ( maxFPS & kMaxFPSValueMask ), 1000 ) : 0;
+        }
+        if ( millihertz == 0 )
+        {
+            return 0;
+        }
+        millihertz = OutsideLfcBand( millihertz, false );
+        if ( millihertz % 1000 == 0 && millihertz / 1000 < kMaxFPSBelowRefresh )
+        {
+            return (unsigned int)( millihertz / 1000 );
+        }
+        return kMaxFPSFractional | (unsigned int)std::min<std::int64_t>( millihertz, kMaxFPSValueMask );
+    }
+
+    inline unsigned int AdaptiveLimiter::Below( unsigned int fps ) const
+    {
+        return (unsigned int)std::max<std::int64_t>( m_settings.minFPS, fps * ( 1000 - m_settings.headroomPermille ) / 1000 );
+    }
+
+    inline unsigned int AdaptiveLimiter::OnFrame( Timestamp frameTime )
+    {
+        const unsigned int current = m_target.load( std::memory_order_relaxed );
+        if ( frameTime <= 0 || frameTime > m_settings.resetInterval )
+        {
+            m_count = 0;
+            return current;
+        }
+        m_window[ m_count++ ] = frameTime;
+        if ( m_count < kWindow )
+        {
+            return current;
+        }
+        m_count = 0;
+
+        // The first window after a change mixes the old and the new limit, and the frame queue needs time to settle.
+        if ( m_settling )
+        {
+            m_settling = false;
+            return current;
+        }
+
+        // The median ignores the odd hitch in either direction.
+        std::nth_element( m_window, m_window + kWindow / 2, m_window + kWindow );
+        const Timestamp median = m_window[ kWindow / 2 ];
+        const unsigned int rate = (unsigned int)std::min<Timestamp>( kSecond / median, m_settings.maxFPS );
+
+        const unsigned int refreshCeiling = m_refreshCeiling.load( std::memory_order_relaxed );
+        const unsigned int ceiling = refreshCeiling ? std::min( refreshCeiling, m_settings.maxFPS ) : m_settings.maxFPS;
+
+        unsigned int target = current;
+        if ( current == 0 )
+        {
+            // First window, measured without a limit.
+            target = Below( rate );
+            m_hold = m_holdWindows;
+        }
+        else if ( median * 1000 > ( kSecond / current ) * ( 1000 + m_settings.tolerancePermille ) )
+        {
+            // The game does not keep up with the limit: either a probe went too far or the workload got heavier.
+            target = Below( rate );
+            if ( m_probing )
+            {
+                m_holdWindows = std::min( m_holdWindows * 2, m_settings.maxHoldWindows );
+            }
+            m_measuredRate = rate;
+            m_hold = m_holdWindows;
+            m_probePermille = m_settings.probePermille;
+            m_probing = false;
+        }
+        else if ( m_hold )
+        {
+            --m_hold;
+        }
+        else if ( current < ceiling )
+        {
+            if ( m_probing )
+            {
+                // The game kept up with the previous probe. Past the measured rate that means the workload got lighter.
+                m_measuredRate = std::max( m_measuredRate, current );
+                m_probePermille = std::min( m_probePermille * 2, m_settings.maxProbePermille );
+            }
+            std::int64_t next = current * ( 1000 + m_probePermille ) / 1000;
+            if ( m_measuredRate )
+            {
+                next = std::min( next, (std::int64_t)m_measuredRate * ( 1000 + m_settings.tolerancePermille + m_settings.probePermille ) / 1000 );
+            }
+            target = (unsigned int)std::max<std::int64_t>( current + 1, next );
+            m_probing = true;
+        }
+        else
+        {
+            m_probing = false;
+        }
+
+        target = std::min( target, ceiling );
+        if ( target != current )
+        {
+            // A target in the band moves below it, unless the game was measured above it. The band is in whole frames per
+            // second on both sides, so that the target stays a whole number.
+            const std::int64_t above = OutsideLfcBand( (std::int64_t)target * 1000, true );
+            const std::int64_t outside = OutsideLfcBand( (std::int64_t)target * 1000, (std::int64_t)m_measuredRate * 1000 >= above );
+            target = (unsigned int)std::min<std::int64_t>( outside > target * 1000 ? ( outside + 999 ) / 1000 : outside / 1000, ceiling );
+        }
+        if ( target != current )
+        {
+            m_target.store( target, std::memory_order_relaxed );
+            m_changes.fetch_add( 1, std::memory_order_relaxed );
+            m_settling = true;
+        }
+        return target;
+    }
+
+} // namespace AntiLag2
+} // namespace AMD
@@ -0,0 +1,202 @@
+// This file is part of the Anti-Lag 2.0 SDK.
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "ffx_antilag2_wait.h"
+
+#include <atomic>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+namespace AMD {
+namespace AntiLag2 {
+
+    // Clears the DriverProbeCache of every Factory type.
+    class DriverProbeCacheBase
+    {
+    public:
+        // Call when a driver module is unloaded: the next probe looks its entry points up again.
+        static void Clear()                             { GetGeneration().fetch_add( 1, std::memory_order_relaxed ); }
+
+    protected:
+        static std::atomic<unsigned int>& GetGeneration();
+    };
+
+    // The driver's entry point, looked up once per driver module and remembered for the process, so that creating the device
+    // again does not repeat the lookup. The interface is created by the entry point for every device, as whether that succeeds
+    // can depend on the device. The entry belongs to one driver module: a device on another adapter can load another driver,
+    // which is looked up again. Factory is the driver function creating the interface. The entry is guarded by a spin lock,
+    // which is only ever taken by the initialization of a device.
+    template<class Factory>
+    class DriverProbeCache : public DriverProbeCacheBase
+    {
+    public:
+        static DriverProbeCache& Get();
+
+        // Returns false when the module has not been looked up since the cache was last cleared. factory is set to nullptr when
+        // the module has no such entry point.
+        bool Find( const void* module, Factory* factory ) const;
+        void Store( const void* module, Factory factory );
+
+    private:
+        void Lock() const;
+        void Unlock() const                             { m_locked.store( false, std::memory_order_release ); }
+
+        mutable std::atomic<bool>   m_locked{ false };
+        const void*                 m_module = nullptr;
+        Factory                     m_factory = nullptr;
+        unsigned int                m_generation = 0;
+    };
+
+    // Loader for the DX11 and DX12 Initialize and InitializeAsync functions that loads a library of the game's choosing in place
+    // of the driver module, such as tools/bin/MockDriver, a stand-in that exports the driver's entry points. The library is
+    // loaded once for the process, and every driver module the SDK asks for resolves to it.
+    //
+    //     AntiLag2::LibraryLoader::Open( "MockDriver.dll" );
+    //     AntiLag2DX12::Initialize<AntiLag2::LibraryLoader>( &context, device );
+    //
+    // Open and Close must not overlap with each other or with an initialization that uses the loader. Close clears the
+    // DriverProbeCache, so that the next library is looked up again even if it is loaded at the same address.
+    class LibraryLoader
+    {
+    public:
+#ifdef _WIN32
+        typedef HMODULE Module;
+        typedef FARPROC Proc;
+#else
+        typedef void*   Module;
+        typedef void*   Proc;
+#endif
+
+        // Returns false if the library cannot be loaded. A library that is already open is closed first.
+        static bool     Open( const char* path );
+        static void     Close();
+
+        // The library, whatever the module name. nullptr while none is open, which the SDK reports as no driver.
+        static Module   GetModule( const char* name );
+        static Proc     GetProc( Module module, const char* name );
+
+    private:
+        static std::atomic<Module>& GetHandle();
+    };
+
+    //
+    // Private implementation details below.
+    //
+
+    inline std::atomic<unsigned int>& DriverProbeCacheBase::GetGeneration()
+    {
+        static std::atomic<unsigned int> generation{ 0 };
+        return generation;
+    }
+
+    template<class Factory>
+    inline DriverProbeCache<Factory>& DriverProbeCache<Factory>::Get()
+    {
+        static DriverProbeCache cache;
+        return cache;
+    }
+
+    template<class Factory>
+    inline void DriverProbeCache<Factory>::Lock() const
+    {
+        while ( m_locked.exchange( true, std::memory_order_acquire ) )
+        {
+            while ( m_locked.load( std::memory_order_relaxed ) )
+            {
+                SpinPause();
+            }
+        }
+    }
+
+    template<class Factory>
+    inline bool DriverProbeCache<Factory>::Find( const void* module, Factory* factory ) const
+    {
+        Lock();
+        const bool found = module && module == m_module && m_generation == GetGeneration().load( std::memory_order_relaxed );
+        if ( found )
+        {
+            *factory = m_factory;
+        }
+        Unlock();
+        return found;
+    }
+
+    template<class Factory>
+    inline void DriverProbeCache<Factory>::Store( const void* module, Factory factory )
+    {
+        Lock();
+        m_module = module;
+        m_factory = factory;
+        m_generation = GetGeneration().load( std::memory_order_relaxed );
+        Unlock();
+    }
+
+    inline std::atomic<LibraryLoader::Module>& LibraryLoader::GetHandle()
+    {
+        static std::atomic<Module> handle{ nullptr };
+        return handle;
+    }
+
+    inline bool LibraryLoader::Open( const char* path )
+    {
+        Close();
+#ifdef _WIN32
+        GetHandle().store( LoadLibraryA( path ), std::memory_order_release );
+#else
+        GetHandle().store( dlopen( path, RTLD_NOW | RTLD_LOCAL ), std::memory_order_release );
+#endif
+        return GetModule( nullptr ) != nullptr;
+    }
+
+    inline void LibraryLoader::Close()
+    {
+        const Module handle = GetHandle().exchange( nullptr, std::memory_order_acq_rel );
+        if ( handle )
+        {
+#ifdef _WIN32
+            FreeLibrary( handle );
+#else
+            dlclose( handle );
+#endif
+        }
+        DriverProbeCacheBase::Clear();
+    }
+
+    inline LibraryLoader::Module LibraryLoader::GetModule( const char* )
+    {
+        return GetHandle().load( std::memory_order_acquire );
+    }
+
+    inline LibraryLoader::Proc LibraryLoader::GetProc( Module module, const char* name )
+    {
+#ifdef _WIN32
+        return GetProcAddress( module, name );
+#else
+        return dlsym( module, name );
+#endif
+    }
+
+} // namespace AntiLag2
+} // namespace AMD
@@ -0,0 +1,147 @@
+// This file is part of the Anti-Lag 2.0 SDK.
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "ffx_antilag2_wait.h"
+
+#include <algorithm>
+
+namespace AMD {
+namespace AntiLag2 {
+
+    // Present pacing for frame generation.
+    //
+    // With frame generation every real frame is preceded by an interpolated one, and both become ready to present at about
+    // the same time. Presenting them back to back shows the interpolated frame only briefly and makes the output cadence
+    // uneven, which costs more perceived smoothness and latency than frame generation wins. The pacer tracks the cadence of
+    // the real frames and schedules each interpolated frame halfway between the previous real present and the next one:
+    //
+    //   real N-1            interpolated            real N
+    //      |<---- cadence/2 ---->|<---- cadence/2 ---->|
+    //
+    // When a frame arrives late the schedule moves with it. The gap before an interpolated frame may then shrink by
+    // catchUpPermille, so that the extra delay drains over the following frames instead of staying in the pipeline.
+    //
+    // All functions take explicit timestamps so that the pacer can be driven by a virtual clock. Call them from the
+    // presentation thread only.
+    class FrameGenPacer
+    {
+    public:
+        struct Settings
+        {
+            // How much the gap before an interpolated frame may shrink to catch up, in 1/1000ths.
+            std::int64_t    catchUpPermille = 100;
+            // Weight of the newest interval in the cadence average, in 1/1000ths.
+            std::int64_t    cadenceWeightPermille = 125;
+            // Real frames further apart than this (loading screens, window drag) restart the pacing.
+            Timestamp       resetInterval = 100 * kMillisecond;
+        };
+
+        FrameGenPacer() {}
+        explicit FrameGenPacer( const Settings& settings ) : m_settings( settings ) {}
+
+        void Reset();
+
+        // Call when the interpolated frame that precedes a new real frame is ready. Returns when to present it.
+        Timestamp ScheduleInterpolated( Timestamp ready );
+
+        // Call when the real frame is ready, after its interpolated frame. Returns when to present it.
+        // Without a preceding interpolated frame the real frame is presented right away.
+        Timestamp ScheduleReal( Timestamp ready );
+
+        // Average interval between real frames, 0 until two frames were seen.
+        Timestamp GetCadence() const    { return m_cadence; }
+
+    private:
+        void OnRealFrame( Timestamp ready );
+
+        Settings    m_settings;
+        Timestamp   m_cadence = 0;
+        Timestamp   m_lastReady = 0;
+        Timestamp   m_lastRealPresent = 0;
+        Timestamp   m_interpolatedPresent = 0;  // 0 once the real frame of the pair was scheduled
+    };
+
+    //
+    // Private implementation details below.
+    //
+
+    inline void FrameGenPacer::Reset()
+    {
+        m_cadence = 0;
+        m_lastReady = 0;
+        m_lastRealPresent = 0;
+        m_interpolatedPresent = 0;
+    }
+
+    inline void FrameGenPacer::OnRealFrame( Timestamp ready )
+    {
+        const Timestamp interval = ready - m_lastReady;
+        if ( m_lastReady == 0 || interval <= 0 || interval > m_settings.resetInterval )
+        {
+            m_cadence = 0;
+            m_lastRealPresent = 0;
+        }
+        else if ( m_cadence == 0 )
+        {
+            m_cadence = interval;
+        }
+        else
+        {
+            m_cadence += ( interval - m_cadence ) * m_settings.cadenceWeightPermille / 1000;
+        }
+        m_lastReady = ready;
+    }
+
+    inline Timestamp FrameGenPacer::ScheduleInterpolated( Timestamp ready )
+    {
+        OnRealFrame( ready );
+
+        Timestamp present = ready;
+        if ( m_cadence && m_lastRealPresent )
+        {
+            const Timestamp half = m_cadence / 2;
+            present = std::max( ready, m_lastRealPresent + half - half * m_settings.catchUpPermille / 1000 );
+        }
+        m_interpolatedPresent = present;
+        return present;
+    }
+
+    inline Timestamp FrameGenPacer::ScheduleReal( Timestamp ready )
+    {
+        Timestamp present = ready;
+        if ( m_interpolatedPresent )
+        {
+            present = std::max( ready, m_interpolatedPresent + m_cadence / 2 );
+            m_interpolatedPresent = 0;
+        }
+        else
+        {
+            // Frame generation is off for this frame.
+            OnRealFrame( ready );
+        }
+        m_lastRealPresent = present;
+        return present;
+    }
+
+} // namespace AntiLag2
+} // namespace AMD
@@ -0,0 +1,126 @@
+// This file is part of the Anti-Lag 2.0 SDK.
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace AMD {
+namespace AntiLag2 {
+
+    // Fixed-size queue for any number of producer threads and one consumer thread.
+    //
+    // Push never blocks or allocates: a slot is claimed with a compare-and-swap on the push position and published with its
+    // sequence number, so a producer that is preempted halfway only holds up the consumer, not the other producers.
+    // Items that arrive while the queue is full are dropped and counted. Front and Pop must only be called from the consumer.
+    template<class T, unsigned int Capacity>
+    class MpscQueue
+    {
+    public:
+        static const unsigned int kCapacity = Capacity;
+        static_assert( ( Capacity & ( Capacity - 1 ) ) == 0, "The capacity must be a power of two." );
+
+        MpscQueue();
+
+        // Returns false, and counts the item as dropped, when the queue is full.
+        bool Push( const T& item );
+
+        // Oldest item, nullptr when the queue is empty.
+        const T* Front() const;
+        void Pop();
+
+        // Items dropped since the last call.
+        std::uint64_t TakeDropped()     { return m_dropped.exchange( 0, std::memory_order_relaxed ); }
+
+    private:
+        struct Slot
+        {
+            std::atomic<std::uint64_t>  sequence;
+            T                           item;
+        };
+
+        Slot                        m_slots[ Capacity ];
+        std::atomic<std::uint64_t>  m_pushPosition{ 0 };
+        std::uint64_t               m_popPosition = 0;      // Only accessed by the consumer
+        std::atomic<std::uint64_t>  m_dropped{ 0 };
+    };
+
+    //
+    // Private implementation details below.
+    //
+
+    template<class T, unsigned int Capacity>
+    inline MpscQueue<T, Capacity>::MpscQueue()
+    {
+        for ( unsigned int i = 0; i < Capacity; ++i )
+        {
+            m_slots[ i ].sequence.store( i, std::memory_order_relaxed );
+        }
+    }
+
+    template<class T, unsigned int Capacity>
+    inline bool MpscQueue<T, Capacity>::Push( const T& item )
+    {
+        // A slot is free for position p when its sequence is p, and holds the item of position p when it is p + 1.
+        std::uint64_t position = m_pushPosition.load( std::memory_order_relaxed );
+        for ( ;; )
+        {
+            Slot& slot = m_slots[ position % Capacity ];
+            const std::uint64_t sequence = slot.sequence.load( std::memory_order_acquire );
+            if ( sequence == position )
+            {
+                if ( m_pushPosition.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+                {
+                    slot.item = item;
+                    slot.sequence.store( position + 1, std::memory_order_release );
+                    return true;
+                }
+            }
+            else if ( sequence < position )
+            {
+                // Still holds the item from one lap ago.
+                m_dropped.fetch_add( 1, std::memory_order_relaxed );
+                return false;
+            }
+            else
+            {
+                position = m_pushPosition.load( std::memory_order_relaxed );
+            }
+        }
+    }
+
+    template<class T, unsigned int Capacity>
+    inline const T* MpscQueue<T, Capacity>::Front() const
+    {
+        const Slot& slot = m_slots[ m_popPosition % Capacity ];
+        return slot.sequence.load( std::memory_order_acquire ) == m_popPosition + 1 ? &slot.item : nullptr;
+    }
+
+    template<class T, unsigned int Capacity>
+    inline void MpscQueue<T, Capacity>::Pop()
+    {
+        m_slots[ m_popPosition % Capacity ].sequence.store( m_popPosition + Capacity, std::memory_order_release );
+        ++m_popPosition;
+    }
+
+} // namespace AntiLag2
+} // namespace AMD
@@ -0,0 +1,351 @@
+// This file is part of the Anti-Lag 2.0 SDK.
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "ffx_antilag2.h"
+#include "ffx_antilag2_queue.h"
+#include "ffx_antilag2_wait.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace AMD {
+namespace AntiLag2 {
+
+    // Writes the calls into a Context to a compact binary log, for reproducing captures offline with tools/bin/Replay.
+    //
+    // Attach it with SetRecorder. Record is lock-free and does not allocate: the call goes into an MpscQueue, and a background
+    // thread encodes the queued calls every flush interval. Calls that arrive while the queue is full are dropped and counted.
+    //
+    // The log starts with the magic "AL2C", a 32-bit version and the 64-bit timestamp the recording started at, all little-endian.
+    // Each call then takes a type byte, with the flag in the top bit, followed by LEB128 varints: the entry time relative to the
+    // previous call (zigzag encoded, the calls of different threads may arrive out of order), the duration, the frame index
+    // relative to the previous call (zigzag), maxFPS for UpdateWithState, BeginUpdateWithState and SetState (the marker for
+    // SetLatencyMarker), and the result as an unsigned 32-bit value. A typical call takes less than ten bytes. Version 2 added
+    // SetLatencyMarker and SetSplitDelay; logs of version 1 are read as well.
+    class CallRecorder final : public CallSink
+    {
+    public:
+        static const unsigned int   kQueueCapacity = 4096;
+        static const unsigned int   kVersion = 2;
+
+        ~CallRecorder()                                 { Stop(); }
+
+        // Returns false if a recording is already running or the file cannot be created.
+        bool Start( const char* path, Timestamp flushInterval = 100 * kMillisecond );
+
+        // Writes the remaining calls and closes the file.
+        void Stop();
+
+        bool IsActive() const                           { return m_active.load( std::memory_order_relaxed ); }
+
+        // May be called from any thread. Ignored while no recording is running.
+        virtual void Record( const RecordedCall& call ) override;
+
+        // Calls dropped because the queue was full, over the lifetime of the recorder.
+        std::uint64_t GetDroppedCalls() const           { return m_dropped.load( std::memory_order_relaxed ); }
+
+    private:
+        void FlushThread( Timestamp flushInterval );
+        void Flush();
+
+        std::atomic<bool>                               m_active{ false };
+        MpscQueue<RecordedCall, kQueueCapacity>         m_queue;
+        std::atomic<std::uint64_t>                      m_dropped{ 0 };
+
+        std::mutex                                      m_sessionMutex;     // Serializes Start and Stop
+        std::mutex                                      m_wakeMutex;
+        std::condition_variable                         m_wake;
+        bool                                            m_stop = false;
+        std::thread                                     m_thread;
+
+        // Only accessed by the flush thread, and by Start and Stop while it is not running.
+        FILE*                                           m_file = nullptr;
+        Timestamp                                       m_lastEntry = 0;
+        std::uint64_t                                   m_lastFrameIndex = 0;
+    };
+
+    // Reads a log written by CallRecorder.
+    class CallLogReader
+    {
+    public:
+        ~CallLogReader()                                { Close(); }
+
+        // Returns false when the file cannot be opened or is not a call log.
+        bool Open( const char* path );
+        void Close();
+
+        // Returns false at the end of the log, or where it is truncated.
+        bool Read( RecordedCall* call );
+
+        // Timestamp the recording started at, on the clock of the recording machine.
+        Timestamp GetStartTime() const                  { return m_startTime; }
+
+    private:
+        bool ReadVarint( std::uint64_t* value );
+
+        FILE*           m_file = nullptr;
+        Timestamp       m_startTime = 0;
+        Timestamp       m_lastEntry = 0;
+        std::uint64_t   m_lastFrameIndex = 0;
+    };
+
+    //
+    // Private implementation details below.
+    //
+
+    namespace CallLog
+    {
+        static const unsigned char kMagic[ 4 ] = { 'A', 'L', '2', 'C' };
+        static const unsigned int kFlagBit = 0x80;
+
+        inline bool HasMaxFPS( RecordedCallType type )
+        {
+            return type == RecordedCallType::UpdateWithState || type == RecordedCallType::SetState || type == RecordedCallType::BeginUpdateWithState ||
+                   type == RecordedCallType::SetLatencyMarker;
+        }
+
+        inline unsigned char* PutVarint( unsigned char* out, std::uint64_t value )
+        {
+            while ( value >= 0x80 )
+            {
+                *out++ = (unsigned char)( value | 0x80 );
+                value >>= 7;
+            }
+            *out++ = (unsigned char)value;
+            return out;
+        }
+
+        inline std::uint64_t ZigZag( std::int64_t value )       { return ( (std::uint64_t)value << 1 ) ^ (std::uint64_t)( value >> 63 ); }
+        inline std::int64_t UnZigZag( std::uint64_t value )     { return (std::int64_t)( value >> 1 ) ^ -(std::int64_t)( value & 1 ); }
+    }
+
+    inline bool CallRecorder::Start( const char* path, Timestamp flushInterval )
+    {
+        std::lock_guard<std::mutex> lock( m_sessionMutex );
+        if ( m_file )
+        {
+            return false;
+        }
+        m_file = fopen( path, "wb" );
+        if ( m_file == nullptr )
+        {
+            return false;
+        }
+
+        // Discard what was recorded after the end of the previous recording.
+        while ( m_queue.Front() )
+        {
+            m_queue.Pop();
+        }
+        m_queue.TakeDropped();
+
+        unsigned char header[ 16 ];
+        const std::uint64_t version = kVersion;
+        const std::uint64_t startTime = (std::uint64_t)GetTimestamp();
+        for ( int i = 0; i < 4; ++i )
+        {
+            header[ i ] = CallLog::kMagic[ i ];
+            header[ 4 + i ] = (unsigned char)( version >> ( 8 * i ) );
+        }
+        for ( int i = 0; i < 8; ++i )
+        {
+            header[ 8 + i ] = (unsigned char)( startTime >> ( 8 * i ) );
+        }
+        fwrite( header, 1, sizeof( header ), m_file );
+        m_lastEntry = (Timestamp)startTime;
+        m_lastFrameIndex = 0;
+
+        m_stop = false;
+        m_thread = std::thread( &CallRecorder::FlushThread, this, flushInterval );
+        m_active.store( true, std::memory_order_relaxed );
+        return true;
+    }
+
+    inline void CallRecorder::Stop()
+    {
+        std::lock_guard<std::mutex> lock( m_sessionMutex );
+        if ( m_file == nullptr )
+        {
+            return;
+        }
+        m_active.store( false, std::memory_order_relaxed );
+        {
+            std::lock_guard<std::mutex> wakeLock( m_wakeMutex );
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+
+        Flush();
+        fclose( m_file );
+        m_file = nullptr;
+    }
+
+    inline void CallRecorder::Record( const RecordedCall& call )
+    {
+        if ( IsActive() && !m_queue.Push( call ) )
+        {
+            m_dropped.fetch_add( 1, std::memory_order_relaxed );
+        }
+    }
+
+    inline void CallRecorder::FlushThread( Timestamp flushInterval )
+    {
+        std::unique_lock<std::mutex> lock( m_wakeMutex );
+        while ( !m_stop )
+        {
+            m_wake.wait_for( lock, std::chrono::nanoseconds( flushInterval ) );
+            lock.unlock();
+            Flush();
+            lock.lock();
+        }
+    }
+
+    inline void CallRecorder::Flush()
+    {
+        // Type, four varints of up to 10 bytes and maxFPS of up to 5.
+        unsigned char buffer[ 256 * 46 ];
+        unsigned char* out = buffer;
+        while ( const RecordedCall* call = m_queue.Front() )
+        {
+            *out++ = (unsigned char)( (unsigned int)call->type | ( call->flag ? CallLog::kFlagBit : 0 ) );
+            out = CallLog::PutVarint( out, CallLog::ZigZag( call->entry - m_lastEntry ) );
+            out = CallLog::PutVarint( out, (std::uint64_t)call->duration );
+            out = CallLog::PutVarint( out, CallLog::ZigZag( (std::int64_t)( call->frameIndex - m_lastFrameIndex ) ) );
+            if ( CallLog::HasMaxFPS( call->type ) )
+            {
+                out = CallLog::PutVarint( out, call->maxFPS );
+            }
+            out = CallLog::PutVarint( out, (std::uint32_t)call->result );
+            m_lastEntry = call->entry;
+            m_lastFrameIndex = call->frameIndex;
+            m_queue.Pop();
+
+            if ( out - buffer > (std::ptrdiff_t)sizeof( buffer ) - 46 )
+            {
+                fwrite( buffer, 1, out - buffer, m_file );
+                out = buffer;
+            }
+        }
+        fwrite( buffer, 1, out - buffer, m_file );
+        fflush( m_file );
+    }
+
+    inline bool CallLogReader::Open( const char* path )
+    {
+        Close();
+        m_file = fopen( path, "rb" );
+        if ( m_file == nullptr )
+        {
+            return false;
+        }
+        unsigned char header[ 16 ];
+        std::uint32_t version = 0;
+        std::uint64_t startTime = 0;
+        const bool valid = fread( header, 1, sizeof( header ), m_file ) == sizeof( header ) &&
+                           std::equal( header, header + 4, CallLog::kMagic );
+        for ( int i = 0; i < 4; ++i )
+        {
+            version |= (std::uint32_t)header[ 4 + i ] << ( 8 * i );
+        }
+        for ( int i = 0; i < 8; ++i )
+        {
+            startTime |= (std::uint64_t)header[ 8 + i ] << ( 8 * i );
+        }
+        if ( !valid || version == 0 || version > CallRecorder::kVersion )
+        {
+            Close();
+            return false;
+        }
+        m_startTime = (Timestamp)startTime;
+        m_lastEntry = m_startTime;
+        m_lastFrameIndex = 0;
+        return true;
+    }
+
+    inline void CallLogReader::Close()
+    {
+        if ( m_file )
+        {
+            fclose( m_file );
+            m_file = nullptr;
+        }
+    }
+
+    inline bool CallLogReader::ReadVarint( std::uint64_t* value )
+    {
+        *value = 0;
+        for ( int shift = 0; shift < 64; shift += 7 )
+        {
+            const int byte = fgetc( m_file );
+            if ( byte == EOF )
+            {
+                return false;
+            }
+            *value |= (std::uint64_t)( byte & 0x7f ) << shift;
+            if ( ( byte & 0x80 ) == 0 )
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline bool CallLogReader::Read( RecordedCall* call )
+    {
+        const int type = m_file ? fgetc( m_file ) : EOF;
+        if ( type == EOF )
+        {
+            return false;
+        }
+        std::uint64_t entry = 0;
+        std::uint64_t duration = 0;
+        std::uint64_t frameIndex = 0;
+        std::uint64_t maxFPS = 0;
+        std::uint64_t result = 0;
+        *call = {};
+        call->type = (RecordedCallType)( type & ~CallLog::kFlagBit );
+        call->flag = ( type & CallLog::kFlagBit ) != 0;
+        if ( !ReadVarint( &entry ) || !ReadVarint( &duration ) || !ReadVarint( &frameIndex ) ||
+             ( CallLog::HasMaxFPS( call->type ) && !ReadVarint( &maxFPS ) ) || !ReadVarint( &result ) )
+        {
+            return false;
+        }
+        call->entry = m_lastEntry + CallLog::UnZigZag( entry );
+        call->duration = (Timestamp)duration;
+        call->frameIndex = m_lastFrameIndex + (std::uint64_t)CallLog::UnZigZag( frameIndex );
+        call->maxFPS = (unsigned int)maxFPS;
+        call->result = (std::int32_t)(std::uint32_t)result;
+        m_lastEntry = call->entry;
+        m_lastFrameIndex = call->frameIndex;
+        return true;
+    }
+
+} // namespace AntiLag2
+} // namespace AMD
@@ -0,0 +1,187 @@
+// This file is part of the Anti-Lag 2.0 SDK.
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+
+namespace AMD {
+namespace AntiLag2 {
+
+    // Contexts for a game that presents to several swapchains, one context per swapchain.
+    //
+    // A Context paces one stream of presents. Split-screen modes, editors and tools that present to several swapchains at
+    // different rates need one for each, so that every stream gets its own delay, framerate limit and telemetry. The registry
+    // holds Capacity contexts and hands one out per key, normally the swapchain. The contexts share nothing but the
+    // GetTimestamp() clock, so their frame records line up, and one stream's delay never waits for another's: each context is
+    // driven by its own input thread under the threading rules of Context. Each context starts on a cache line of its own, so
+    // that the threads do not contend for the lines either.
+    //
+    // Find and GetCount are lock-free and may be called from any thread. Register and Unregister must not overlap with each
+    // other, nor Unregister with any other call on the context it frees. Declare the registry once and keep it alive for as
+    // long as its contexts are used; it is large, so allocate it statically or on the heap.
+    template<class ContextType, unsigned int Capacity = 8>
+    class ContextRegistry
+    {
+    public:
+        static const unsigned int kCapacity = Capacity;
+
+        ContextRegistry();
+        ContextRegistry( const ContextRegistry& ) = delete;
+        ContextRegistry& operator=( const ContextRegistry& ) = delete;
+
+        // Returns the context of key, and takes a free one for it when it has none yet. The context is not initialized: call
+        // Initialize, InitializeAsync or the software initialization on it. nullptr when key is null or every context is taken.
+        ContextType* Register( const void* key );
+
+        // Returns the context of key, nullptr when it has none.
+        ContextType* Find( const void* key );
+        const ContextType* Find( const void* key ) const;
+
+        // Deinitializes the context of key, resets it to the state it was declared in (see ResetContext) and frees it for
+        // another key, which then starts without the settings, frame index, telemetry or refresh rate of the previous one.
+        // Returns what DeInitialize returned, 0 when key has no context.
+        unsigned int Unregister( const void* key );
+
+        // Number of keys with a context.
+        unsigned int GetCount() const;
+
+        // Calls function( key, context ) for every key with a context, for example to update the settings of all of them.
+        template<class Function>
+        void ForEach( Function function );
+
+    private:
+        struct alignas( 64 ) Slot
+        {
+            ContextType     context;
+        };
+
+        unsigned int FindSlot( const void* key ) const;
+
+        std::atomic<const void*>    m_keys[ Capacity ];     // Only written by Register and Unregister
+        Slot                        m_slots[ Capacity ];
+    };
+
+    //
+    // Private implementation details below.
+    //
+
+    template<class ContextType, unsigned int Capacity>
+    inline ContextRegistry<ContextType, Capacity>::ContextRegistry()
+    {
+        for ( unsigned int i = 0; i < Capacity; ++i )
+        {
+            m_keys[ i ].store( nullptr, std::memory_order_relaxed );
+        }
+    }
+
+    template<class ContextType, unsigned int Capacity>
+    inline unsigned int ContextRegistry<ContextType, Capacity>::FindSlot( const void* key ) const
+    {
+        for ( unsigned int i = 0; i < Capacity; ++i )
+        {
+            if ( key && m_keys[ i ].load( std::memory_order_acquire ) == key )
+            {
+                return i;
+            }
+        }
+        return Capacity;
+    }
+
+    template<class ContextType, unsigned int Capacity>
+    inline ContextType* ContextRegistry<ContextType, Capacity>::Register( const void* key )
+    {
+        if ( key == nullptr )
+        {
+            return nullptr;
+        }
+        unsigned int slot = FindSlot( key );
+        if ( slot == Capacity )
+        {
+            for ( unsigned int i = 0; i < Capacity && slot == Capacity; ++i )
+            {
+                if ( m_keys[ i ].load( std::memory_order_relaxed ) == nullptr )
+                {
+                    slot = i;
+                }
+            }
+            if ( slot == Capacity )
+            {
+                return nullptr;
+            }
+            m_keys[ slot ].store( key, std::memory_order_release );
+        }
+        return &m_slots[ slot ].context;
+    }
+
+    template<class ContextType, unsigned int Capacity>
+    inline ContextType* ContextRegistry<ContextType, Capacity>::Find( const void* key )
+    {
+        const unsigned int slot = FindSlot( key );
+        return slot < Capacity ? &m_slots[ slot ].context : nullptr;
+    }
+
+    template<class ContextType, unsigned int Capacity>
+    inline const ContextType* ContextRegistry<ContextType, Capacity>::Find( const void* key ) const
+    {
+        const unsigned int slot = FindSlot( key );
+        return slot < Capacity ? &m_slots[ slot ].context : nullptr;
+    }
+
+    template<class ContextType, unsigned int Capacity>
+    inline unsigned int ContextRegistry<ContextType, Capacity>::Unregister( const void* key )
+    {
+        const unsigned int slot = FindSlot( key );
+        if ( slot == Capacity )
+        {
+            return 0;
+        }
+        const unsigned int refCount = ResetContext( m_slots[ slot ].context );
+        m_keys[ slot ].store( nullptr, std::memory_order_release );
+        return refCount;
+    }
+
+    template<class ContextType, unsigned int Capacity>
+    inline unsigned int ContextRegistry<ContextType, Capacity>::GetCount() const
+    {
+        unsigned int count = 0;
+        for ( unsigned int i = 0; i < Capacity; ++i )
+        {
+            count += m_keys[ i ].load( std::memory_order_relaxed ) != nullptr ? 1 : 0;
+        }
+        return count;
+    }
+
+    template<class ContextType, unsigned int Capacity>
+    template<class Function>
+    inline void ContextRegistry<ContextType, Capacity>::ForEach( Function function )
+    {
+        for ( unsigned int i = 0; i < Capacity; ++i )
+        {
+            const void* key = m_keys[ i ].load( std::memory_order_acquire );
+            if ( key )
+            {
+                function( key, m_slots[ i ].context );
+            }
+        }
+    }
+} // namespace AntiLag2
+} // namespace AMD
@@ -0,0 +1,371 @@
+// This file is part of the Anti-Lag 2.0 SDK.
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "ffx_antilag2.h"
+#include "ffx_antilag2_telemetry.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace AMD {
+namespace AntiLag2 {
+
+    namespace SharedTelemetry
+    {
+        struct Layout;
+    }
+
+    // One frame as published through the shared telemetry channel.
+    struct SharedFrame
+    {
+        std::uint64_t   frameIndex;     // Index Update() assigned to the frame
+        Timestamp       updateEntry;    // Update() was called, on the game's GetTimestamp() clock
+        Timestamp       delay;          // Time spent in the latency-reducing delay
+        unsigned int    maxFPS;         // Limit passed to the backend, which the adaptive limiter may have picked. 0 for none
+        unsigned int    frameType;      // kFrameType bits from SetFrameGenFrameType(), 0 if it was not called
+        bool            enabled;        // Anti-Lag 2.0 was enabled for the frame
+    };
+
+    // Publishes the per-frame state of a Context to a ring in named shared memory, which tools/bin/al2top or any other process
+    // can read while the game runs.
+    //
+    // Attach it with SetSharedTelemetry. Publishing a frame is a handful of relaxed stores into the ring: it does not lock,
+    // allocate or make a system call, and a reader that is slow or gone costs the game nothing. Each slot is guarded by its
+    // frame index the same way as in FrameTelemetry, so a reader notices a frame that is overwritten while it reads it.
+    //
+    // PublishFrame must only be called from the thread calling Update(), PublishFrameType may be called from any thread.
+    // Open and Close must not overlap with either: remove the writer from the context before closing it.
+    class SharedTelemetryWriter final : public FrameSink
+    {
+    public:
+        ~SharedTelemetryWriter()                        { Close(); }
+
+        // Creates the ring of this process, see GetSharedTelemetryName.
+        // Returns false if it is already open or the shared memory cannot be created.
+        bool Open();
+        void Close();
+        bool IsOpen() const                             { return m_layout != nullptr; }
+
+        virtual void PublishFrame( std::uint64_t frameIndex, Timestamp updateEntry, Timestamp delay, bool enabled, unsigned int maxFPS ) override;
+        virtual void PublishFrameType( std::uint64_t frameIndex, bool interpolated ) override;
+
+    private:
+        SharedTelemetry::Layout*    m_layout = nullptr;
+#ifdef _WIN32
+        HANDLE                      m_mapping = nullptr;
+#else
+        char                        m_name[ 64 ] = {};
+#endif
+    };
+
+    // Reads the ring a game publishes to. All functions may be called from any thread once Open has returned.
+    class SharedTelemetryReader
+    {
+    public:
+        ~SharedTelemetryReader()                        { Close(); }
+
+        // Returns false when the process has no ring, or one of another version.
+        bool Open( std::uint32_t processId );
+        void Close();
+        bool IsOpen() const                             { return m_layout != nullptr; }
+
+        // Whether the game still has the ring open. A game that exited without closing it stops publishing but looks open.
+        bool IsWriterOpen() const;
+
+        // Index of the most recent frame, 0 before the first one.
+        std::uint64_t GetLatestFrameIndex() const;
+
+        // Returns false when the frame is not, or no longer, in the ring.
+        bool GetFrame( std::uint64_t frameIndex, SharedFrame* frame ) const;
+
+    private:
+        const SharedTelemetry::Layout*  m_layout = nullptr;
+#ifdef _WIN32
+        HANDLE                          m_mapping = nullptr;
+#endif
+    };
+
+    // Name of the shared memory the process publishes to: Local\AMD_AntiLag2_Telemetry_<pid> on Windows and
+    // /amd_antilag2_telemetry_<pid> elsewhere.
+    void GetSharedTelemetryName( std::uint32_t processId, char* name, std::size_t size );
+
+    //
+    // Private implementation details below.
+    //
+
+    namespace SharedTelemetry
+    {
+        static const std::uint32_t  kMagic = 0x54324c41;   // "AL2T"
+        static const std::uint32_t  kVersion = 1;
+        static const unsigned int   kCapacity = 1024;
+        static const std::uint64_t  kInvalidFrame = ~0ull;
+        static const unsigned int   kEnabledFlag = 0x80000000u;
+
+        static_assert( ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "The ring is shared between processes and needs lock-free atomics" );
+
+        struct Slot
+        {
+            std::atomic<std::uint64_t>  frameIndex{ kInvalidFrame };
+            std::atomic<Timestamp>      updateEntry{ 0 };
+            std::atomic<Timestamp>      delay{ 0 };
+            std::atomic<std::uint32_t>  maxFPS{ 0 };
+            std::atomic<std::uint32_t>  flags{ 0 };         // kFrameType bits and kEnabledFlag
+        };
+
+        // The magic is stored last, so a reader never sees a half initialized header.
+        struct Layout
+        {
+            std::atomic<std::uint32_t>  magic{ 0 };
+            std::uint32_t               version = kVersion;
+            std::uint32_t               capacity = kCapacity;
+            std::uint32_t               processId = 0;
+            std::atomic<std::uint32_t>  writerOpen{ 0 };
+            std::atomic<std::uint64_t>  latestFrameIndex{ 0 };
+            Slot                        slots[ kCapacity ];
+        };
+
+        inline std::uint32_t GetCurrentProcessId()
+        {
+#ifdef _WIN32
+            return ::GetCurrentProcessId();
+#else
+            return (std::uint32_t)getpid();
+#endif
+        }
+    }
+
+    inline void GetSharedTelemetryName( std::uint32_t processId, char* name, std::size_t size )
+    {
+#ifdef _WIN32
+        snprintf( name, size, "Local\\AMD_AntiLag2_Telemetry_%u", processId );
+#else
+        snprintf( name, size, "/amd_antilag2_telemetry_%u", processId );
+#endif
+    }
+
+    inline bool SharedTelemetryWriter::Open()
+    {
+        if ( m_layout )
+        {
+            return false;
+        }
+        char name[ 64 ];
+        const std::uint32_t processId = SharedTelemetry::GetCurrentProcessId();
+        GetSharedTelemetryName( processId, name, sizeof( name ) );
+
+#ifdef _WIN32
+        m_mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof( SharedTelemetry::Layout ), name );
+        if ( m_mapping == nullptr )
+        {
+            return false;
+        }
+        void* memory = MapViewOfFile( m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof( SharedTelemetry::Layout ) );
+        if ( memory == nullptr )
+        {
+            CloseHandle( m_mapping );
+            m_mapping = nullptr;
+            return false;
+        }
+#else
+        const int fd = shm_open( name, O_CREAT | O_RDWR, 0600 );
+        if ( fd < 0 )
+        {
+            return false;
+        }
+        void* memory = ftruncate( fd, sizeof( SharedTelemetry::Layout ) ) == 0 ?
+                       mmap( nullptr, sizeof( SharedTelemetry::Layout ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 ) : MAP_FAILED;
+        close( fd );
+        if ( memory == MAP_FAILED )
+        {
+            shm_unlink( name );
+            return false;
+        }
+        snprintf( m_name, sizeof( m_name ), "%s", name );
+#endif
+
+        m_layout = new ( memory ) SharedTelemetry::Layout;
+        m_layout->processId = processId;
+        m_layout->writerOpen.store( 1, std::memory_order_relaxed );
+        m_layout->magic.store( SharedTelemetry::kMagic, std::memory_order_release );
+        return true;
+    }
+
+    inline void SharedTelemetryWriter::Close()
+    {
+        if ( m_layout == nullptr )
+        {
+            return;
+        }
+        m_layout->writerOpen.store( 0, std::memory_order_release );
+#ifdef _WIN32
+        UnmapViewOfFile( m_layout );
+        CloseHandle( m_mapping );
+        m_mapping = nullptr;
+#else
+        // Readers that have the ring mapped keep it until they close it.
+        munmap( m_layout, sizeof( SharedTelemetry::Layout ) );
+        shm_unlink( m_name );
+#endif
+        m_layout = nullptr;
+    }
+
+    inline void SharedTelemetryWriter::PublishFrame( std::uint64_t frameIndex, Timestamp updateEntry, Timestamp delay, bool enabled, unsigned int maxFPS )
+    {
+        if ( m_layout == nullptr )
+        {
+            return;
+        }
+        SharedTelemetry::Slot& slot = m_layout->slots[ frameIndex % SharedTelemetry::kCapacity ];
+
+        // Invalidate the slot before rewriting it, so that readers of the old frame notice.
+        slot.frameIndex.store( SharedTelemetry::kInvalidFrame, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+        slot.updateEntry.store( updateEntry, std::memory_order_relaxed );
+        slot.delay.store( delay, std::memory_order_relaxed );
+        slot.maxFPS.store( maxFPS, std::memory_order_relaxed );
+        slot.flags.store( enabled ? SharedTelemetry::kEnabledFlag : 0, std::memory_order_relaxed );
+        slot.frameIndex.store( frameIndex, std::memory_order_release );
+        m_layout->latestFrameIndex.store( frameIndex, std::memory_order_release );
+    }
+
+    inline void SharedTelemetryWriter::PublishFrameType( std::uint64_t frameIndex, bool interpolated )
+    {
+        if ( m_layout == nullptr )
+        {
+            return;
+        }
+        SharedTelemetry::Slot& slot = m_layout->slots[ frameIndex % SharedTelemetry::kCapacity ];
+        if ( slot.frameIndex.load( std::memory_order_acquire ) == frameIndex )
+        {
+            slot.flags.fetch_or( interpolated ? kFrameTypeInterpolated : kFrameTypeRendered, std::memory_order_relaxed );
+        }
+    }
+
+    inline bool SharedTelemetryReader::Open( std::uint32_t processId )
+    {
+        if ( m_layout )
+        {
+            return false;
+        }
+        char name[ 64 ];
+        GetSharedTelemetryName( processId, name, sizeof( name ) );
+
+#ifdef _WIN32
+        m_mapping = OpenFileMappingA( FILE_MAP_READ, FALSE, name );
+        if ( m_mapping == nullptr )
+        {
+            return false;
+        }
+        const void* memory = MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, sizeof( SharedTelemetry::Layout ) );
+        if ( memory == nullptr )
+        {
+            CloseHandle( m_mapping );
+            m_mapping = nullptr;
+            return false;
+        }
+#else
+        const int fd = shm_open( name, O_RDONLY, 0 );
+        if ( fd < 0 )
+        {
+            return false;
+        }
+        struct stat info = {};
+        const void* memory = fstat( fd, &info ) == 0 && info.st_size >= (off_t)sizeof( SharedTelemetry::Layout ) ?
+                             mmap( nullptr, sizeof( SharedTelemetry::Layout ), PROT_READ, MAP_SHARED, fd, 0 ) : MAP_FAILED;
+        close( fd );
+        if ( memory == MAP_FAILED )
+        {
+            return false;
+        }
+#endif
+
+        m_layout = static_cast<const SharedTelemetry::Layout*>( memory );
+        if ( m_layout->magic.load( std::memory_order_acquire ) != SharedTelemetry::kMagic || m_layout->version != SharedTelemetry::kVersion ||
+             m_layout->capacity != SharedTelemetry::kCapacity || m_layout->processId != processId )
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    inline void SharedTelemetryReader::Close()
+    {
+        if ( m_layout == nullptr )
+        {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile( m_layout );
+        CloseHandle( m_mapping );
+        m_mapping = nullptr;
+#else
+        munmap( const_cast<SharedTelemetry::Layout*>( m_layout ), sizeof( SharedTelemetry::Layout ) );
+#endif
+        m_layout = nullptr;
+    }
+
+    inline bool SharedTelemetryReader::IsWriterOpen() const
+    {
+        return m_layout && m_layout->writerOpen.load( std::memory_order_acquire ) != 0;
+    }
+
+    inline std::uint64_t SharedTelemetryReader::GetLatestFrameIndex() const
+    {
+        return m_layout ? m_layout->latestFrameIndex.load( std::memory_order_acquire ) : 0;
+    }
+
+    inline bool SharedTelemetryReader::GetFrame( std::uint64_t frameIndex, SharedFrame* frame ) const
+    {
+        if ( m_layout == nullptr || frame == nullptr || frameIndex == SharedTelemetry::kInvalidFrame )
+        {
+            return false;
+        }
+        const SharedTelemetry::Slot& slot = m_layout->slots[ frameIndex % SharedTelemetry::kCapacity ];
+        if ( slot.frameIndex.load( std::memory_order_acquire ) != frameIndex )
+        {
+            return false;
+        }
+        const std::uint32_t flags = slot.flags.load( std::memory_order_relaxed );
+        frame->frameIndex = frameIndex;
+        frame->updateEntry = slot.updateEntry.load( std::memory_order_relaxed );
+        frame->delay = slot.delay.load( std::memory_order_relaxed );
+        frame->maxFPS = slot.maxFPS.load( std::memory_order_relaxed );
+        frame->frameType = flags & ~SharedTelemetry::kEnabledFlag;
+        frame->enabled = ( flags & SharedTelemetry::kEnabledFlag ) != 0;
+        std::atomic_thread_fence( std::memory_order_acquire );
+        return slot.frameIndex.load( std::memory_order_relaxed ) == frameIndex;
+    }
+
+} // namespace AntiLag2
+} // namespace AMD
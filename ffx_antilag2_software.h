@@ -0,0 +1,475 @@
+// This file is part of the Anti-Lag 2.0 SDK.
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "ffx_antilag2_limiter.h"
+#include "ffx_antilag2_wait.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace AMD {
+namespace AntiLag2 {
+
+    // Software reference implementation of the Anti-Lag 2.0 latency-reducing delay.
+    //
+    // The driver implementation knows when the GPU finishes each frame. This model only sees CPU timestamps:
+    // the Update() call, the moment input is sampled after the delay and (if available) the end-of-frame marker.
+    // From those it estimates the GPU-bound frame time and paces the frame start so that the frame queue drains.
+    //
+    // Every sampled input starts a new frame. Frames are numbered by EndDelay, or by the caller through SetFrameIndex, so that an
+    // end-of-frame marker which arrives from a render thread running behind is attributed to the frame it belongs to.
+    //
+    // With a split delay a GPU-bound frame is paced at a later point, just before the render submission, where only the render
+    // workload is left between the delay and the GPU queue. A shorter early delay at the start of the frame takes out most of
+    // the wait, up to the point where the simulation would end if it took as long as it recently did at most; the late delay
+    // only waits for the rest. Input sampled at the start of the frame gets a little older, input sampled before the render
+    // submission gets fresher, and the simulation no longer adds to the variation of the frame's arrival at the GPU.
+    // While the framerate limit holds the frame rate there is no queue to drain, and the whole delay stays early.
+    //
+    // All functions take explicit timestamps so that the model can be driven by a virtual clock.
+    // BeginDelay/EndDelay/SetFrameIndex must be called from the thread calling Update(), MarkEndOfFrame may be called from any thread.
+    class SoftwareLatencyModel
+    {
+    public:
+        struct Settings
+        {
+            // The frame is paced this much slower than the GPU-bound frame time, in 1/1000ths. This lets the queue drain.
+            std::int64_t    headroomPermille = 20;
+            // The GPU-bound frame time estimate is lowered by this much per frame when the frame queue is not full,
+            // in 1/1000ths. This lets the model notice that the GPU got faster.
+            std::int64_t    probePermille = 1;
+            // Number of frames after a full frame queue was seen before the estimate is lowered again.
+            unsigned int    probeHoldFrames = 120;
+            // Time the game must spend blocked after the end of the frame before the frame queue is considered full.
+            Timestamp       blockThreshold = kMillisecond / 4;
+            // Upper bound for a single delay.
+            Timestamp       maxDelay = 50 * kMillisecond;
+            // Frames with a longer interval than this (window drag, loading screens) reset the model.
+            Timestamp       resetInterval = 250 * kMillisecond;
+            // Number of frames to observe before the first delay is inserted.
+            unsigned int    warmupFrames = 8;
+            // Maximum number of frames the game queues ahead of the GPU (IDXGIDevice1::SetMaximumFrameLatency, 3 by default).
+            unsigned int    maxFrameLatency = 3;
+            // A frame that takes this much longer from the input sample to the next Update() than the median of the recent frames,
+            // in 1/1000ths, and at least hitchMinimum longer, is a hitch (shader compilation, streaming). It is kept out of the estimates, and the frames after it are
+            // not delayed until the frame queue has refilled. 0 disables hitch detection.
+            std::int64_t    hitchPermille = 2000;
+            Timestamp       hitchMinimum = 8 * kMillisecond;
+            // Number of frames after a hitch that are not delayed either.
+            unsigned int    hitchRecoveryFrames = 3;
+        };
+
+        SoftwareLatencyModel() {}
+        explicit SoftwareLatencyModel( const Settings& settings ) : m_settings( settings ) {}
+
+        // Equivalent of the APIData_v1 packet, except that maxFPS may also be fractional, see MakeMaxFPS.
+        void SetState( bool enabled, unsigned int maxFPS );
+
+        // Call at the start of the delay. Returns the absolute time to wait for before the input is sampled.
+        Timestamp BeginDelay( Timestamp now );
+
+        // Call once the wait is over, with the time the input is about to be sampled. This starts a new frame, unless the
+        // frame was started by EndEarlyDelay.
+        void EndDelay( Timestamp now );
+
+        // Split delay: call at the start of the frame, and BeginDelay/EndDelay later in the same frame, before the render
+        // submission. The model switches between a split and a single delay, and starts over, when the calls change.
+        Timestamp BeginEarlyDelay( Timestamp now );
+        void EndEarlyDelay( Timestamp now );
+
+        // Replaces the index of the frame started last with the caller's own frame index. Indices must increase.
+        void SetFrameIndex( std::uint64_t frameIndex );
+
+        // Call once the main rendering workload of a frame has been submitted.
+        // Without a frame index the marker applies to the frame started last.
+        void MarkEndOfFrame( Timestamp now );
+        void MarkEndOfFrame( std::uint64_t frameIndex, Timestamp now );
+
+        bool        IsEnabled() const               { return m_enabled; }
+        Timestamp   GetFrameTimeEstimate() const    { return m_frameTime; }
+        Timestamp   GetCpuTimeEstimate() const      { return m_cpuTime; }
+        Timestamp   GetLastDelay() const            { return m_lastDelay; }
+        Timestamp   GetStageEstimate() const        { return m_stagePeak; }
+        unsigned int GetHitchCount() const          { return m_hitchCount; }
+
+    private:
+        // Number of recent frames an end-of-frame marker may arrive for.
+        static const unsigned int kMarkerHistory = 8;
+        // Number of recent frames hitches are detected against.
+        static const unsigned int kWorkHistory = 15;
+
+        void Reset();
+        bool IsHitch( Timestamp work ) const;
+
+        Settings                    m_settings;
+        bool                        m_enabled = false;
+        Timestamp                   m_limiterInterval = 0;
+
+        Timestamp                   m_lastEntry = 0;
+        Timestamp                   m_lastSample = 0;
+        Timestamp                   m_lastDeadline = 0;
+        Timestamp                   m_lastDelay = 0;
+        Timestamp                   m_targetInterval = 0;
+
+        bool                        m_split = false;        // BeginDelay is the late half of a split delay
+        bool                        m_earlyPending = false; // BeginEarlyDelay was called, BeginDelay was not yet
+        Timestamp                   m_earlyEntry = 0;
+        Timestamp                   m_lastEarlyEntry = 0;
+        Timestamp                   m_earlySample = 0;
+        Timestamp                   m_earlyDelay = 0;
+        Timestamp                   m_earlyDeadline = 0;
+        bool                        m_earlyPaced = false;   // The limiter paced this frame at the early delay
+        Timestamp                   m_stagePeak = 0;        // Upper envelope of the time from the early to the late delay
+
+        std::atomic<std::uint64_t>  m_frameIndex{ 0 };
+        std::atomic<std::uint64_t>  m_markedFrame{ 0 };
+        std::atomic<Timestamp>      m_endOfFrames[ kMarkerHistory ] = {};
+        std::uint64_t               m_usedMarker = 0;
+
+        Timestamp                   m_frameTime = 0;
+        Timestamp                   m_cpuTime = 0;
+        Timestamp                   m_workFloor = 0;
+        Timestamp                   m_workSpread = 0;
+        Timestamp                   m_tailFloor = 0;
+        Timestamp                   m_tailSpread = 0;
+        unsigned int                m_frameCount = 0;
+        unsigned int                m_lastQueueFull = 0;
+
+        Timestamp                   m_works[ kWorkHistory ] = {};
+        unsigned int                m_workCount = 0;
+        unsigned int                m_hitchFrames = 0;
+        unsigned int                m_hitchCount = 0;
+    };
+
+    //
+    // Private implementation details below.
+    //
+
+    inline void SoftwareLatencyModel::SetState( bool enabled, unsigned int maxFPS )
+    {
+        if ( m_enabled != enabled )
+        {
+            Reset();
+        }
+        m_enabled = enabled;
+        m_limiterInterval = GetMaxFPSInterval( maxFPS );
+    }
+
+    inline void SoftwareLatencyModel::Reset()
+    {
+        m_lastEntry = 0;
+        m_lastSample = 0;
+        m_lastDeadline = 0;
+        m_lastDelay = 0;
+        m_targetInterval = 0;
+        m_earlyDelay = 0;
+        m_earlyDeadline = 0;
+        m_earlyPaced = false;
+        m_stagePeak = 0;
+        m_markedFrame.store( 0, std::memory_order_relaxed );
+        m_usedMarker = 0;
+        m_frameTime = 0;
+        m_cpuTime = 0;
+        m_workFloor = 0;
+        m_workSpread = 0;
+        m_tailFloor = 0;
+        m_tailSpread = 0;
+        m_frameCount = 0;
+        m_lastQueueFull = 0;
+        m_workCount = 0;
+        m_hitchFrames = 0;
+    }
+
+    inline bool SoftwareLatencyModel::IsHitch( Timestamp work ) const
+    {
+        if ( m_settings.hitchPermille == 0 || m_workCount < kWorkHistory )
+        {
+            return false;
+        }
+        Timestamp works[ kWorkHistory ];
+        std::copy( m_works, m_works + kWorkHistory, works );
+        std::nth_element( works, works + kWorkHistory / 2, works + kWorkHistory );
+        const Timestamp median = works[ kWorkHistory / 2 ];
+        return work - median > m_settings.hitchMinimum && work > median * m_settings.hitchPermille / 1000;
+    }
+
+    inline Timestamp SoftwareLatencyModel::BeginDelay( Timestamp now )
+    {
+        const Timestamp lastEntry = m_lastEntry;
+        m_lastEntry = now;
+
+        // The measurements of one kind of delay say nothing about the other.
+        const bool split = m_earlyPending;
+        m_earlyPending = false;
+        if ( split != m_split )
+        {
+            m_split = split;
+            m_lastSample = 0;
+        }
+        const Timestamp lastEarlyEntry = m_lastEarlyEntry;
+        m_lastEarlyEntry = split ? m_earlyEntry : 0;
+
+        if ( !m_enabled )
+        {
+            return now;
+        }
+
+        if ( m_lastSample == 0 || now - lastEntry > m_settings.resetInterval )
+        {
+            Reset();
+            m_lastEntry = now;
+            return now;
+        }
+
+        // The time since the last input sample is CPU work plus any time spent blocked in Present.
+        // The lower envelope of a duration (it follows decreases immediately and increases slowly) is its unblocked cost,
+        // anything above it is blocking. With an end-of-frame marker only the part after the marker is looked at, which
+        // keeps the variation of the render workload out of the measurement. The marker may belong to an older frame when
+        // rendering runs behind the game thread, but each one is only used once, and not at all when it came before the last
+        // input sample: the time since then includes the last delay, which would read as blocking and lengthen the next one.
+        // With a split delay Present blocks before the early delay, which is neither work nor blocking, so the blocking is
+        // looked for up to the early delay. The stage from there to the late delay is work. The early delay would absorb
+        // the blocking into a paced interval, so the frame interval is taken between the early delays as well.
+        const Timestamp interval = split && lastEarlyEntry ? m_earlyEntry - lastEarlyEntry : now - lastEntry;
+        const Timestamp end = split ? m_earlyEntry : now;
+        const Timestamp stage = split ? now - m_earlySample : 0;
+        const Timestamp cycle = end - m_lastSample;
+        const Timestamp work = cycle + stage;
+
+        // The frames after a hitch run with an empty queue and their timing says nothing about the steady state,
+        // so none of them feed the estimates. Delaying them would only add latency to a frame that is already late.
+        // The delay itself is not part of the frame, so hitches are looked for in the time since the input sample.
+        // A hitch still goes into the history it is looked for against, so that a frame that stays longer, for example when
+        // a higher limit fills the queue, becomes the new median instead of a hitch every frame.
+        const bool hitch = IsHitch( work );
+        m_works[ m_workCount++ % kWorkHistory ] = work;
+        if ( m_workCount >= 2 * kWorkHistory )
+        {
+            m_workCount -= kWorkHistory;
+        }
+        if ( hitch )
+        {
+            m_hitchFrames = m_settings.hitchRecoveryFrames + 1;
+            ++m_hitchCount;
+        }
+        if ( m_hitchFrames > 0 )
+        {
+            --m_hitchFrames;
+            m_usedMarker = m_markedFrame.load( std::memory_order_acquire );
+            m_lastDeadline = now;
+            m_lastDelay = 0;
+            return now;
+        }
+        if ( split )
+        {
+            m_stagePeak = stage > m_stagePeak ? stage : m_stagePeak - ( m_stagePeak - stage ) / 32;
+        }
+
+        const std::uint64_t markedFrame = m_markedFrame.load( std::memory_order_acquire );
+        const Timestamp endOfFrame = m_endOfFrames[ markedFrame % kMarkerHistory ].load( std::memory_order_relaxed );
+        const bool haveMarker = markedFrame > m_usedMarker && markedFrame + kMarkerHistory > m_frameIndex.load( std::memory_order_relaxed ) &&
+                                endOfFrame >= m_lastSample && endOfFrame <= end;
+        if ( haveMarker )
+        {
+            m_usedMarker = markedFrame;
+        }
+        const Timestamp tail = haveMarker ? end - endOfFrame : cycle;
+        Timestamp& floor = haveMarker ? m_tailFloor : m_workFloor;
+        Timestamp& spread = haveMarker ? m_tailSpread : m_workSpread;
+        if ( floor == 0 || tail < floor )
+        {
+            floor = tail;
+        }
+        const Timestamp blocked = tail - floor;
+        const bool queueFull = m_frameCount > m_settings.warmupFrames && blocked > m_settings.blockThreshold && blocked > 4 * spread;
+        if ( !queueFull )
+        {
+            floor += ( tail - floor ) / 32;
+            spread += ( blocked - spread ) / 16;
+        }
+        // The frame time estimate is never lowered below the CPU time. With a split delay that includes the stage, which
+        // varies from frame to frame while the pacing happens after it, so only its average counts. Otherwise the CPU time
+        // follows decreases at once but rises by at most an eighth per frame, so that a single long frame, hitch rejection
+        // or not, cannot lift the frame time estimate to its length and hold the framerate down until the probe brings it back.
+        const Timestamp cpuTime = work - blocked;
+        if ( split && m_cpuTime )
+        {
+            m_cpuTime += ( cpuTime - m_cpuTime ) / 8;
+        }
+        else
+        {
+            m_cpuTime = m_cpuTime && cpuTime > m_cpuTime + m_cpuTime / 8 ? m_cpuTime + m_cpuTime / 8 : cpuTime;
+        }
+
+        // A full frame queue means the frame interval is the GPU-bound frame time.
+        // Otherwise keep lowering the estimate until the queue fills again.
+        if ( m_frameCount <= m_settings.warmupFrames )
+        {
+            // Nothing has been delayed yet, so the interval is the natural frame time.
+            m_frameTime = m_frameCount ? m_frameTime + ( interval - m_frameTime ) / 4 : interval;
+        }
+        else if ( queueFull )
+        {
+            // When the previous frame was delayed its interval includes the headroom, which must not feed back into the estimate.
+            // A misdetected full queue would otherwise grow the estimate without bound.
+            const Timestamp headroom = m_lastDelay > 0 || ( split && m_earlyDelay > 0 ) ? m_frameTime * m_settings.headroomPermille / 1000 : 0;
+            Timestamp observed = interval - headroom;
+            if ( observed > m_frameTime + blocked )
+            {
+                observed = m_frameTime + blocked;
+            }
+            m_frameTime += ( observed - m_frameTime ) / 4;
+            m_lastQueueFull = m_frameCount;
+        }
+        else if ( m_frameCount > m_lastQueueFull + m_settings.probeHoldFrames )
+        {
+            m_frameTime -= m_frameTime * m_settings.probePermille / 1000;
+            if ( m_frameTime < m_cpuTime )
+            {
+                m_frameTime = m_cpuTime;
+            }
+        }
+        ++m_frameCount;
+
+        Timestamp targetInterval = m_limiterInterval;
+        if ( m_frameCount > m_settings.warmupFrames )
+        {
+            const Timestamp paced = m_frameTime + m_frameTime * m_settings.headroomPermille / 1000;
+            if ( paced > targetInterval )
+            {
+                targetInterval = paced;
+            }
+        }
+
+        // Pace against the previous deadline rather than the previous sample so that wake-up error does not accumulate.
+        Timestamp deadline = ( m_lastDeadline > m_lastSample - targetInterval ? m_lastDeadline : m_lastSample ) + targetInterval;
+        if ( queueFull && m_frameCount > m_settings.warmupFrames )
+        {
+            // Present only returns once the queue has room for one frame, so the GPU has the rest of the queue to work on.
+            // Waiting for most of that drains the queue at once instead of through the headroom.
+            const Timestamp drain = ( m_settings.maxFrameLatency > 1 ? m_settings.maxFrameLatency - 1 : 0 ) * m_frameTime - m_cpuTime;
+            // With a split delay the drain starts at the early delay, which is part of it.
+            if ( deadline < end + stage + drain )
+            {
+                deadline = end + stage + drain;
+            }
+        }
+        if ( deadline > now + m_settings.maxDelay )
+        {
+            deadline = now + m_settings.maxDelay;
+        }
+
+        // The stage before a late delay varies, and a frame it made late must not push back the frames after it.
+        const Timestamp scheduled = deadline;
+        if ( deadline < now )
+        {
+            deadline = now;
+        }
+
+        m_targetInterval = targetInterval;
+        if ( m_earlyPaced )
+        {
+            // The early delay paced the frame already. A GPU-bound frame is paced from here on.
+            m_earlyPaced = false;
+            m_lastDeadline = now;
+            m_lastDelay = 0;
+            return now;
+        }
+        m_lastDeadline = split ? scheduled : deadline;
+        m_lastDelay = deadline - now;
+        return deadline;
+    }
+
+    inline void SoftwareLatencyModel::EndDelay( Timestamp now )
+    {
+        m_lastSample = now;
+        if ( !m_split )
+        {
+            m_frameIndex.store( m_frameIndex.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+        }
+    }
+
+    inline Timestamp SoftwareLatencyModel::BeginEarlyDelay( Timestamp now )
+    {
+        m_earlyEntry = now;
+        m_earlyPending = true;
+        const Timestamp lastEarlyDeadline = m_earlyDeadline;
+        m_earlyDeadline = now;
+        m_earlyPaced = false;
+        if ( !m_enabled || !m_split || m_lastSample == 0 || m_hitchFrames > 0 || m_frameCount <= m_settings.warmupFrames || m_stagePeak == 0 )
+        {
+            return now;
+        }
+
+        Timestamp deadline;
+        if ( m_limiterInterval && m_limiterInterval >= m_targetInterval )
+        {
+            // The limit holds the frame rate: pace the start of the frame like a single delay does.
+            m_earlyPaced = true;
+            deadline = ( lastEarlyDeadline > m_earlySample - m_limiterInterval ? lastEarlyDeadline : m_earlySample ) + m_limiterInterval;
+        }
+        else
+        {
+            // Wait until the late delay is due, less the longest the stage in between recently took. Whatever the stage
+            // leaves of the pacing is waited for by the late delay.
+            const Timestamp due = ( m_lastDeadline > m_lastSample - m_targetInterval ? m_lastDeadline : m_lastSample ) + m_targetInterval;
+            deadline = due - GetStageEstimate();
+        }
+        if ( deadline > now + m_settings.maxDelay )
+        {
+            deadline = now + m_settings.maxDelay;
+        }
+        m_earlyDeadline = deadline > now ? deadline : now;
+        return m_earlyDeadline;
+    }
+
+    inline void SoftwareLatencyModel::EndEarlyDelay( Timestamp now )
+    {
+        m_earlySample = now;
+        m_earlyDelay = now - m_earlyEntry;
+        m_frameIndex.store( m_frameIndex.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+    }
+
+    inline void SoftwareLatencyModel::SetFrameIndex( std::uint64_t frameIndex )
+    {
+        m_frameIndex.store( frameIndex, std::memory_order_relaxed );
+    }
+
+    inline void SoftwareLatencyModel::MarkEndOfFrame( Timestamp now )
+    {
+        MarkEndOfFrame( m_frameIndex.load( std::memory_order_relaxed ), now );
+    }
+
+    inline void SoftwareLatencyModel::MarkEndOfFrame( std::uint64_t frameIndex, Timestamp now )
+    {
+        m_endOfFrames[ frameIndex % kMarkerHistory ].store( now, std::memory_order_relaxed );
+
+        // Markers may arrive out of order from several threads, only the newest frame is kept.
+        std::uint64_t markedFrame = m_markedFrame.load( std::memory_order_relaxed );
+        while ( frameIndex > markedFrame && !m_markedFrame.compare_exchange_weak( markedFrame, frameIndex, std::memory_order_release, std::memory_order_relaxed ) )
+        {
+        }
+    }
+
+} // namespace AntiLag2
+} // namespace AMD
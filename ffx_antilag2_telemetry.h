@@ -0,0 +1,472 @@
+// This file is part of the Anti-Lag 2.0 SDK.
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "ffx_antilag2_wait.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+namespace AMD {
+namespace AntiLag2 {
+
+    // Bits of FrameRecord::frameType. A frame followed by an interpolated frame has both bits set.
+    static const unsigned int kFrameTypeRendered     = 1;
+    static const unsigned int kFrameTypeInterpolated = 2;
+
+    // Points in a frame the game reports with SetLatencyMarker(), to break its latency down into stages.
+    enum class LatencyMarker : unsigned int
+    {
+        SimulationStart,    // The game starts to simulate the frame, usually right after Update()
+        RenderSubmitStart,  // The game starts to record and submit the frame's rendering work
+        RenderSubmitEnd,    // All of the frame's rendering work is submitted, the same as MarkEndOfFrameRendering()
+        PresentStart,       // Just before Present()
+        PresentEnd,         // Present() returned
+        Count
+    };
+
+    static const unsigned int kLatencyMarkerCount = (unsigned int)LatencyMarker::Count;
+
+    inline const char* GetLatencyMarkerName( LatencyMarker marker )
+    {
+        switch ( marker )
+        {
+            case LatencyMarker::SimulationStart:    return "AntiLag2::SimulationStart";
+            case LatencyMarker::RenderSubmitStart:  return "AntiLag2::RenderSubmitStart";
+            case LatencyMarker::RenderSubmitEnd:    return "AntiLag2::RenderSubmitEnd";
+            case LatencyMarker::PresentStart:       return "AntiLag2::PresentStart";
+            case LatencyMarker::PresentEnd:         return "AntiLag2::PresentEnd";
+            default:                                return "AntiLag2::LatencyMarker";
+        }
+    }
+
+    // What the SDK saw of one frame. All times come from GetTimestamp().
+    struct FrameRecord
+    {
+        std::uint64_t   frameIndex;     // Index Update() assigned to the frame
+        Timestamp       updateEntry;    // Update() was called
+        Timestamp       delay;          // Time spent in the latency-reducing delay
+        Timestamp       endOfFrame;     // MarkEndOfFrameRendering() was called, 0 if it was not
+        Timestamp       frameComplete;  // Time passed to MarkFrameComplete(), 0 if it was not called
+        unsigned int    frameType;      // kFrameType bits from SetFrameGenFrameType(), 0 if it was not called
+        Timestamp       markers[ kLatencyMarkerCount ];  // SetLatencyMarker() was called, indexed by LatencyMarker, 0 if it was not
+        Timestamp       splitDelay;     // Time spent in the late half of a split delay, before RenderSubmitStart was recorded
+    };
+
+    enum class TelemetryInterval
+    {
+        FrameTime,          // Update() to the next Update()
+        Delay,              // Latency-reducing delay inside Update()
+        InputToEndOfFrame,  // End of the delay, when the input is sampled, to MarkEndOfFrameRendering()
+        EndOfFrameToUpdate, // MarkEndOfFrameRendering() to the next Update()
+        InputToComplete,    // End of the delay to the time passed to MarkFrameComplete()
+
+        // Stages between the latency markers. Frames without both markers are left out.
+        Simulation,         // SimulationStart to RenderSubmitStart, without the split delay
+        SplitDelay,         // Late half of a split delay, in frames that had one
+        RenderSubmit,       // RenderSubmitStart to RenderSubmitEnd
+        SubmitToPresent,    // RenderSubmitEnd to PresentStart
+        Present,            // PresentStart to PresentEnd, where the game blocks on a full frame queue
+        InputToPresent,     // End of the delay to PresentEnd
+        LateInputToPresent, // RenderSubmitStart, the last point at which input can be sampled for the frame, to PresentEnd
+    };
+
+    struct LatencyStats
+    {
+        unsigned int    count;  // Number of frames the percentiles were taken over
+        Timestamp       p50;
+        Timestamp       p95;
+        Timestamp       p99;
+    };
+
+    // Fixed-size ring of the most recent frame records.
+    //
+    // Frames are identified by the increasing frame index Update() assigns, starting at 1.
+    // RecordUpdate() must only be called from the thread calling Update(). The other Record functions may be called
+    // from any thread and are dropped when their frame is no longer in the ring. Queries may run on any thread at any time:
+    // each slot is guarded by its frame index, and a record that is overwritten while it is being read is reported as missing.
+    class FrameTelemetry
+    {
+    public:
+        static const unsigned int kCapacity = 128;
+
+        // Forgets every frame. Must not overlap with any other call.
+        void Reset();
+
+        void RecordUpdate( std::uint64_t frameIndex, Timestamp updateEntry, Timestamp delay );
+        void RecordEndOfFrame( std::uint64_t frameIndex, Timestamp now );
+        void RecordFrameType( std::uint64_t frameIndex, bool interpolated );
+        void RecordFrameComplete( std::uint64_t frameIndex, Timestamp time );
+        void RecordMarker( std::uint64_t frameIndex, LatencyMarker marker, Timestamp now );
+        void RecordSplitDelay( std::uint64_t frameIndex, Timestamp delay );
+
+        // Index of the most recent frame, 0 before the first one.
+        std::uint64_t GetLatestFrameIndex() const { return m_latestFrameIndex.load( std::memory_order_acquire ); }
+
+        // Returns false when the frame is not, or no longer, in the ring.
+        bool GetRecord( std::uint64_t frameIndex, FrameRecord* record ) const;
+
+        // Percentiles of an interval over the frames in the ring. The most recent frame is still in flight and is not included.
+        // Returns false when there are no complete frames.
+        bool GetStats( TelemetryInterval interval, LatencyStats* stats ) const;
+
+    private:
+        static const std::uint64_t kInvalidFrame = ~0ull;
+
+        static Timestamp GetStage( const FrameRecord& record, LatencyMarker from, LatencyMarker to );
+
+        struct Slot
+        {
+            std::atomic<std::uint64_t>  frameIndex{ kInvalidFrame };
+            std::atomic<Timestamp>      updateEntry{ 0 };
+            std::atomic<Timestamp>      delay{ 0 };
+            std::atomic<Timestamp>      endOfFrame{ 0 };
+            std::atomic<Timestamp>      frameComplete{ 0 };
+            std::atomic<unsigned int>   frameType{ 0 };
+            std::atomic<Timestamp>      markers[ kLatencyMarkerCount ] = {};
+            std::atomic<Timestamp>      splitDelay{ 0 };
+        };
+
+        Slot* GetSlot( std::uint64_t frameIndex );
+
+        Slot                        m_slots[ kCapacity ];
+        std::atomic<std::uint64_t>  m_latestFrameIndex{ 0 };
+    };
+
+    // Estimate of the latency in GPU frames, the green number of the Radeon Anti-Lag 2 Latency Monitor: the time from the
+    // input sample to the end of the frame, divided by the interval between the ends of consecutive frames. Both are summed
+    // over a sliding window of kWindow frames and the estimate is the ratio of the sums, so each frame costs O(1) and a
+    // single slow frame does not move the estimate by more than its share of the window.
+    //
+    // AddFrame must be called from one thread at a time, with increasing frame indices. GetEstimate may be called from any thread.
+    class FrameLatencyEstimator
+    {
+    public:
+        static const unsigned int kWindow = 32;
+
+        void Reset();
+
+        // The frame whose input was sampled at inputSample ended at complete: the GPU finished it, or failing that it was presented.
+        // Frames that are not reported are left out; the interval to the next frame that is is split evenly between them.
+        void AddFrame( std::uint64_t frameIndex, Timestamp inputSample, Timestamp complete );
+
+        // Returns false until a full window of frames has been seen.
+        bool GetEstimate( float* frames ) const;
+
+    private:
+        Timestamp                   m_latencies[ kWindow ] = {};
+        Timestamp                   m_intervals[ kWindow ] = {};
+        Timestamp                   m_latencySum = 0;
+        Timestamp                   m_intervalSum = 0;
+        unsigned int                m_next = 0;
+        unsigned int                m_count = 0;
+        std::uint64_t               m_lastFrameIndex = 0;
+        Timestamp                   m_lastComplete = 0;
+        std::atomic<float>          m_estimate{ 0.0f };
+    };
+
+    //
+    // Private implementation details below.
+    //
+
+    inline void FrameTelemetry::Reset()
+    {
+        for ( Slot& slot : m_slots )
+        {
+            slot.frameIndex.store( kInvalidFrame, std::memory_order_relaxed );
+        }
+        m_latestFrameIndex.store( 0, std::memory_order_release );
+    }
+
+    inline void FrameTelemetry::RecordUpdate( std::uint64_t frameIndex, Timestamp updateEntry, Timestamp delay )
+    {
+        Slot& slot = m_slots[ frameIndex % kCapacity ];
+
+        // Invalidate the slot before rewriting it, so that readers of the old frame notice.
+        slot.frameIndex.store( kInvalidFrame, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+        slot.updateEntry.store( updateEntry, std::memory_order_relaxed );
+        slot.delay.store( delay, std::memory_order_relaxed );
+        slot.endOfFrame.store( 0, std::memory_order_relaxed );
+        slot.frameComplete.store( 0, std::memory_order_relaxed );
+        slot.frameType.store( 0, std::memory_order_relaxed );
+        for ( std::atomic<Timestamp>& marker : slot.markers )
+        {
+            marker.store( 0, std::memory_order_relaxed );
+        }
+        slot.splitDelay.store( 0, std::memory_order_relaxed );
+        slot.frameIndex.store( frameIndex, std::memory_order_release );
+        m_latestFrameIndex.store( frameIndex, std::memory_order_release );
+    }
+
+    inline FrameTelemetry::Slot* FrameTelemetry::GetSlot( std::uint64_t frameIndex )
+    {
+        Slot& slot = m_slots[ frameIndex % kCapacity ];
+        return slot.frameIndex.load( std::memory_order_acquire ) == frameIndex ? &slot : nullptr;
+    }
+
+    inline void FrameTelemetry::RecordEndOfFrame( std::uint64_t frameIndex, Timestamp now )
+    {
+        if ( Slot* slot = GetSlot( frameIndex ) )
+        {
+            slot->endOfFrame.store( now, std::memory_order_relaxed );
+        }
+    }
+
+    inline void FrameTelemetry::RecordFrameType( std::uint64_t frameIndex, bool interpolated )
+    {
+        if ( Slot* slot = GetSlot( frameIndex ) )
+        {
+            slot->frameType.fetch_or( interpolated ? kFrameTypeInterpolated : kFrameTypeRendered, std::memory_order_relaxed );
+        }
+    }
+
+    inline void FrameTelemetry::RecordFrameComplete( std::uint64_t frameIndex, Timestamp time )
+    {
+        if ( Slot* slot = GetSlot( frameIndex ) )
+        {
+            slot->frameComplete.store( time, std::memory_order_relaxed );
+        }
+    }
+
+    inline void FrameTelemetry::RecordMarker( std::uint64_t frameIndex, LatencyMarker marker, Timestamp now )
+    {
+        Slot* slot = GetSlot( frameIndex );
+        if ( slot && (unsigned int)marker < kLatencyMarkerCount )
+        {
+            slot->markers[ (unsigned int)marker ].store( now, std::memory_order_relaxed );
+        }
+    }
+
+    inline void FrameTelemetry::RecordSplitDelay( std::uint64_t frameIndex, Timestamp delay )
+    {
+        if ( Slot* slot = GetSlot( frameIndex ) )
+        {
+            slot->splitDelay.store( delay, std::memory_order_relaxed );
+        }
+    }
+
+    inline bool FrameTelemetry::GetRecord( std::uint64_t frameIndex, FrameRecord* record ) const
+    {
+        const Slot& slot = m_slots[ frameIndex % kCapacity ];
+        if ( record == nullptr || frameIndex == kInvalidFrame || slot.frameIndex.load( std::memory_order_acquire ) != frameIndex )
+        {
+            return false;
+        }
+        record->frameIndex = frameIndex;
+        record->updateEntry = slot.updateEntry.load( std::memory_order_relaxed );
+        record->delay = slot.delay.load( std::memory_order_relaxed );
+        record->endOfFrame = slot.endOfFrame.load( std::memory_order_relaxed );
+        record->frameComplete = slot.frameComplete.load( std::memory_order_relaxed );
+        record->frameType = slot.frameType.load( std::memory_order_relaxed );
+        for ( unsigned int i = 0; i < kLatencyMarkerCount; ++i )
+        {
+            record->markers[ i ] = slot.markers[ i ].load( std::memory_order_relaxed );
+        }
+        record->splitDelay = slot.splitDelay.load( std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_acquire );
+        return slot.frameIndex.load( std::memory_order_relaxed ) == frameIndex;
+    }
+
+    inline Timestamp FrameTelemetry::GetStage( const FrameRecord& record, LatencyMarker from, LatencyMarker to )
+    {
+        const Timestamp start = record.markers[ (unsigned int)from ];
+        const Timestamp end = record.markers[ (unsigned int)to ];
+        return start && end > start ? end - start : 0;
+    }
+
+    inline bool FrameTelemetry::GetStats( TelemetryInterval interval, LatencyStats* stats ) const
+    {
+        if ( stats == nullptr )
+        {
+            return false;
+        }
+
+        Timestamp values[ kCapacity ];
+        unsigned int count = 0;
+
+        // The newest frame is still in flight. Walk back from it until the ring runs out or a slot has been overwritten.
+        const std::uint64_t latest = GetLatestFrameIndex();
+        const std::uint64_t first = latest > kCapacity - 1 ? latest - ( kCapacity - 1 ) : 0;
+        FrameRecord next = {};
+        bool haveNext = GetRecord( latest, &next );
+        for ( std::uint64_t frameIndex = latest; frameIndex-- > first; )
+        {
+            FrameRecord record;
+            if ( !GetRecord( frameIndex, &record ) )
+            {
+                break;
+            }
+
+            switch ( interval )
+            {
+                case TelemetryInterval::FrameTime:
+                    if ( haveNext )
+                    {
+                        values[ count++ ] = next.updateEntry - record.updateEntry;
+                    }
+                    break;
+                case TelemetryInterval::Delay:
+                    values[ count++ ] = record.delay;
+                    break;
+                case TelemetryInterval::InputToEndOfFrame:
+                    if ( record.endOfFrame )
+                    {
+                        values[ count++ ] = record.endOfFrame - ( record.updateEntry + record.delay );
+                    }
+                    break;
+                case TelemetryInterval::EndOfFrameToUpdate:
+                    if ( haveNext && record.endOfFrame )
+                    {
+                        values[ count++ ] = next.updateEntry - record.endOfFrame;
+                    }
+                    break;
+                case TelemetryInterval::InputToComplete:
+                    if ( record.frameComplete )
+                    {
+                        values[ count++ ] = record.frameComplete - ( record.updateEntry + record.delay );
+                    }
+                    break;
+                case TelemetryInterval::Simulation:
+                    if ( const Timestamp stage = GetStage( record, LatencyMarker::SimulationStart, LatencyMarker::RenderSubmitStart ) )
+                    {
+                        values[ count++ ] = stage > record.splitDelay ? stage - record.splitDelay : 0;
+                    }
+                    break;
+                case TelemetryInterval::SplitDelay:
+                    if ( record.splitDelay )
+                    {
+                        values[ count++ ] = record.splitDelay;
+                    }
+                    break;
+                case TelemetryInterval::RenderSubmit:
+                    if ( const Timestamp stage = GetStage( record, LatencyMarker::RenderSubmitStart, LatencyMarker::RenderSubmitEnd ) )
+                    {
+                        values[ count++ ] = stage;
+                    }
+                    break;
+                case TelemetryInterval::SubmitToPresent:
+                    if ( const Timestamp stage = GetStage( record, LatencyMarker::RenderSubmitEnd, LatencyMarker::PresentStart ) )
+                    {
+                        values[ count++ ] = stage;
+                    }
+                    break;
+                case TelemetryInterval::Present:
+                    if ( const Timestamp stage = GetStage( record, LatencyMarker::PresentStart, LatencyMarker::PresentEnd ) )
+                    {
+                        values[ count++ ] = stage;
+                    }
+                    break;
+                case TelemetryInterval::InputToPresent:
+                    if ( record.markers[ (unsigned int)LatencyMarker::PresentEnd ] )
+                    {
+                        values[ count++ ] = record.markers[ (unsigned int)LatencyMarker::PresentEnd ] - ( record.updateEntry + record.delay );
+                    }
+                    break;
+                case TelemetryInterval::LateInputToPresent:
+                    if ( const Timestamp stage = GetStage( record, LatencyMarker::RenderSubmitStart, LatencyMarker::PresentEnd ) )
+                    {
+                        values[ count++ ] = stage;
+                    }
+                    break;
+            }
+
+            next = record;
+            haveNext = true;
+        }
+
+        *stats = {};
+        if ( count == 0 )
+        {
+            return false;
+        }
+        std::sort( values, values + count );
+        stats->count = count;
+        stats->p50 = values[ ( count - 1 ) * 50 / 100 ];
+        stats->p95 = values[ ( count - 1 ) * 95 / 100 ];
+        stats->p99 = values[ ( count - 1 ) * 99 / 100 ];
+        return true;
+    }
+
+    inline void FrameLatencyEstimator::Reset()
+    {
+        m_latencySum = 0;
+        m_intervalSum = 0;
+        m_next = 0;
+        m_count = 0;
+        m_lastFrameIndex = 0;
+        m_lastComplete = 0;
+        m_estimate.store( 0.0f, std::memory_order_relaxed );
+    }
+
+    inline void FrameLatencyEstimator::AddFrame( std::uint64_t frameIndex, Timestamp inputSample, Timestamp complete )
+    {
+        if ( frameIndex <= m_lastFrameIndex )
+        {
+            return;
+        }
+        const bool haveInterval = m_lastFrameIndex != 0 && complete > m_lastComplete && complete > inputSample;
+        const Timestamp interval = haveInterval ? ( complete - m_lastComplete ) / (Timestamp)( frameIndex - m_lastFrameIndex ) : 0;
+        m_lastFrameIndex = frameIndex;
+        m_lastComplete = complete;
+        if ( !haveInterval )
+        {
+            return;
+        }
+
+        // The frame kWindow frames back drops out of the sums.
+        const unsigned int slot = m_next;
+        m_next = ( m_next + 1 ) % kWindow;
+        if ( m_count == kWindow )
+        {
+            m_latencySum -= m_latencies[ slot ];
+            m_intervalSum -= m_intervals[ slot ];
+        }
+        else
+        {
+            ++m_count;
+        }
+        m_latencies[ slot ] = complete - inputSample;
+        m_intervals[ slot ] = interval;
+        m_latencySum += m_latencies[ slot ];
+        m_intervalSum += interval;
+
+        if ( m_count == kWindow && m_intervalSum > 0 )
+        {
+            m_estimate.store( (float)( (double)m_latencySum / (double)m_intervalSum ), std::memory_order_relaxed );
+        }
+    }
+
+    inline bool FrameLatencyEstimator::GetEstimate( float* frames ) const
+    {
+        const float estimate = m_estimate.load( std::memory_order_relaxed );
+        if ( frames == nullptr || estimate <= 0.0f )
+        {
+            return false;
+        }
+        *frames = estimate;
+        return true;
+    }
+
+} // namespace AntiLag2
+} // namespace AMD
@@ -0,0 +1,468 @@
+// This file is part of the Anti-Lag 2.0 SDK.
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+// Opt-in tracing of the SDK entry points, for trace viewers such as chrome://tracing and ui.perfetto.dev.
+//
+// Define FFX_ANTILAG2_TRACE to 1 before including any of the Anti-Lag 2.0 headers to compile it in. Otherwise the
+// FFX_ANTILAG2_TRACE_ macros expand to nothing and none of the code below is compiled.
+#ifndef FFX_ANTILAG2_TRACE
+#define FFX_ANTILAG2_TRACE 0
+#endif
+
+#if FFX_ANTILAG2_TRACE
+
+#include "ffx_antilag2_wait.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace AMD {
+namespace AntiLag2 {
+namespace Trace {
+
+    enum class Format
+    {
+        ChromeJson,     // Trace Event Format JSON, for chrome://tracing and ui.perfetto.dev
+        Perfetto,       // Perfetto protobuf trace, for ui.perfetto.dev
+    };
+
+    enum class Phase : char
+    {
+        Begin = 'B',
+        End = 'E',
+        Instant = 'i',
+    };
+
+    struct Event
+    {
+        const char*     name;   // Must have static storage duration
+        Timestamp       time;
+        std::uint64_t   arg;    // Frame index, 0 if there is none
+        Phase           phase;
+    };
+
+    // Fixed-size ring of the events of one thread. The owning thread pushes, the flush thread drains.
+    // Events that do not fit are dropped and counted.
+    class ThreadBuffer
+    {
+    public:
+        static const unsigned int kCapacity = 4096;
+
+        explicit ThreadBuffer( unsigned int id ) : m_id( id ) {}
+
+        void Push( const Event& event );
+
+        template<class Function>
+        void Drain( Function&& function );
+
+        unsigned int    GetId() const           { return m_id; }
+        const char*     GetName() const         { return m_name.load( std::memory_order_acquire ); }
+        void            SetName( const char* name ) { m_name.store( name, std::memory_order_release ); }
+        std::uint64_t   GetDropped() const      { return m_dropped.load( std::memory_order_relaxed ); }
+
+        // Only accessed by the flush thread.
+        bool            m_described = false;
+
+    private:
+        Event                       m_events[ kCapacity ];
+        std::atomic<unsigned int>   m_head{ 0 };    // Next slot to write, only written by the owning thread
+        std::atomic<unsigned int>   m_tail{ 0 };    // Next slot to read, only written by the flush thread
+        std::atomic<std::uint64_t>  m_dropped{ 0 };
+        std::atomic<const char*>    m_name{ nullptr };
+        unsigned int                m_id;
+    };
+
+    // Process-wide trace writer.
+    //
+    // Recording an event is a relaxed load when no trace is running. While one is running it is a clock read and a store into
+    // the calling thread's ring. The ring is allocated the first time a thread records an event or calls SetThreadName, so call
+    // SetThreadName once on each thread up front to keep that allocation off the frame. Rings live until the process exits.
+    // A background thread drains the rings every flush interval and writes the events to the file.
+    class Tracer
+    {
+    public:
+        static Tracer& Get();
+
+        ~Tracer()                               { Stop(); }
+
+        // Starts a trace. Returns false if a trace is already running or the file cannot be created.
+        bool Start( const char* path, Format format = Format::ChromeJson, Timestamp flushInterval = 10 * kMillisecond );
+
+        // Writes the remaining events and closes the file.
+        void Stop();
+
+        bool IsActive() const                   { return m_active.load( std::memory_order_relaxed ); }
+
+        void Record( const char* name, Phase phase, std::uint64_t arg );
+
+        // Names the calling thread's track. The name must have static storage duration.
+        void SetThreadName( const char* name )  { GetThreadBuffer()->SetName( name ); }
+
+        // Events dropped because a ring was full, over the lifetime of the process.
+        std::uint64_t GetDroppedEvents();
+
+    private:
+        Tracer() {}
+
+        ThreadBuffer* GetThreadBuffer();
+        void FlushThread( Timestamp flushInterval );
+        void Flush();
+        void WriteEvent( const ThreadBuffer& buffer, const Event& event );
+        void WriteThreadName( const ThreadBuffer& buffer );
+        void WritePacket( const std::string& packet );
+
+        std::atomic<bool>                           m_active{ false };
+
+        std::mutex                                  m_buffersMutex;
+        std::vector<std::unique_ptr<ThreadBuffer>>  m_buffers;
+
+        std::mutex                                  m_sessionMutex;     // Serializes Start and Stop
+        std::mutex                                  m_wakeMutex;
+        std::condition_variable                     m_wake;
+        bool                                        m_stop = false;
+        std::thread                                 m_thread;
+
+        // Only accessed by the flush thread, and by Start and Stop while it is not running.
+        FILE*                                       m_file = nullptr;
+        Format                                      m_format = Format::ChromeJson;
+        bool                                        m_firstEvent = true;
+    };
+
+    //
+    // Private implementation details below.
+    //
+
+    inline void ThreadBuffer::Push( const Event& event )
+    {
+        const unsigned int head = m_head.load( std::memory_order_relaxed );
+        if ( head - m_tail.load( std::memory_order_acquire ) >= kCapacity )
+        {
+            m_dropped.fetch_add( 1, std::memory_order_relaxed );
+            return;
+        }
+        m_events[ head % kCapacity ] = event;
+        m_head.store( head + 1, std::memory_order_release );
+    }
+
+    template<class Function>
+    inline void ThreadBuffer::Drain( Function&& function )
+    {
+        const unsigned int head = m_head.load( std::memory_order_acquire );
+        unsigned int tail = m_tail.load( std::memory_order_relaxed );
+        for ( ; tail != head; ++tail )
+        {
+            function( m_events[ tail % kCapacity ] );
+        }
+        m_tail.store( tail, std::memory_order_release );
+    }
+
+    inline Tracer& Tracer::Get()
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    inline ThreadBuffer* Tracer::GetThreadBuffer()
+    {
+        static thread_local ThreadBuffer* buffer = nullptr;
+        if ( buffer == nullptr )
+        {
+            std::lock_guard<std::mutex> lock( m_buffersMutex );
+            m_buffers.emplace_back( new ThreadBuffer( (unsigned int)m_buffers.size() + 1 ) );
+            buffer = m_buffers.back().get();
+        }
+        return buffer;
+    }
+
+    inline void Tracer::Record( const char* name, Phase phase, std::uint64_t arg )
+    {
+        if ( !IsActive() )
+        {
+            return;
+        }
+        GetThreadBuffer()->Push( Event{ name, GetTimestamp(), arg, phase } );
+    }
+
+    inline std::uint64_t Tracer::GetDroppedEvents()
+    {
+        std::lock_guard<std::mutex> lock( m_buffersMutex );
+        std::uint64_t dropped = 0;
+        for ( const auto& buffer : m_buffers )
+        {
+            dropped += buffer->GetDropped();
+        }
+        return dropped;
+    }
+
+    inline bool Tracer::Start( const char* path, Format format, Timestamp flushInterval )
+    {
+        std::lock_guard<std::mutex> lock( m_sessionMutex );
+        if ( m_file )
+        {
+            return false;
+        }
+        m_file = fopen( path, "wb" );
+        if ( m_file == nullptr )
+        {
+            return false;
+        }
+        m_format = format;
+        m_firstEvent = true;
+
+        // Discard what was recorded after the end of the previous trace, and describe every track again.
+        {
+            std::lock_guard<std::mutex> buffersLock( m_buffersMutex );
+            for ( const auto& buffer : m_buffers )
+            {
+                buffer->Drain( []( const Event& ) {} );
+                buffer->m_described = false;
+            }
+        }
+        if ( m_format == Format::ChromeJson )
+        {
+            fputs( "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", m_file );
+        }
+
+        m_stop = false;
+        m_thread = std::thread( &Tracer::FlushThread, this, flushInterval );
+        m_active.store( true, std::memory_order_relaxed );
+        return true;
+    }
+
+    inline void Tracer::Stop()
+    {
+        std::lock_guard<std::mutex> lock( m_sessionMutex );
+        if ( m_file == nullptr )
+        {
+            return;
+        }
+        m_active.store( false, std::memory_order_relaxed );
+        {
+            std::lock_guard<std::mutex> wakeLock( m_wakeMutex );
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+
+        Flush();
+        if ( m_format == Format::ChromeJson )
+        {
+            fputs( "\n]}\n", m_file );
+        }
+        fclose( m_file );
+        m_file = nullptr;
+    }
+
+    inline void Tracer::FlushThread( Timestamp flushInterval )
+    {
+        std::unique_lock<std::mutex> lock( m_wakeMutex );
+        while ( !m_stop )
+        {
+            m_wake.wait_for( lock, std::chrono::nanoseconds( flushInterval ) );
+            lock.unlock();
+            Flush();
+            lock.lock();
+        }
+    }
+
+    inline void Tracer::Flush()
+    {
+        // Rings are only ever added, so the ones present now can be drained without holding the lock.
+        std::vector<ThreadBuffer*> buffers;
+        {
+            std::lock_guard<std::mutex> lock( m_buffersMutex );
+            for ( const auto& buffer : m_buffers )
+            {
+                buffers.push_back( buffer.get() );
+            }
+        }
+        for ( ThreadBuffer* buffer : buffers )
+        {
+            buffer->Drain( [this, buffer]( const Event& event )
+            {
+                if ( !buffer->m_described )
+                {
+                    WriteThreadName( *buffer );
+                    buffer->m_described = true;
+                }
+                WriteEvent( *buffer, event );
+            } );
+        }
+        fflush( m_file );
+    }
+
+    // Chrome JSON: one object per event, with timestamps in microseconds.
+    // Perfetto: one TracePacket per event on a track per thread, without interning. Field numbers from
+    // protos/perfetto/trace/trace_packet.proto and protos/perfetto/trace/track_event/track_event.proto.
+    namespace Proto
+    {
+        inline void Varint( std::string& out, std::uint64_t value )
+        {
+            while ( value >= 0x80 )
+            {
+                out.push_back( (char)( ( value & 0x7f ) | 0x80 ) );
+                value >>= 7;
+            }
+            out.push_back( (char)value );
+        }
+
+        inline void VarintField( std::string& out, unsigned int field, std::uint64_t value )
+        {
+            Varint( out, field << 3 );
+            Varint( out, value );
+        }
+
+        inline void BytesField( std::string& out, unsigned int field, const std::string& bytes )
+        {
+            Varint( out, ( field << 3 ) | 2 );
+            Varint( out, bytes.size() );
+            out += bytes;
+        }
+
+        static const unsigned int kTracePacket                  = 1;    // Trace
+        static const unsigned int kTimestamp                    = 8;    // TracePacket
+        static const unsigned int kTrustedPacketSequenceId      = 10;
+        static const unsigned int kTrackEvent                   = 11;
+        static const unsigned int kSequenceFlags                = 13;
+        static const unsigned int kTrackDescriptor              = 60;
+        static const unsigned int kDebugAnnotations             = 4;    // TrackEvent
+        static const unsigned int kType                         = 9;
+        static const unsigned int kTrackUuid                    = 11;
+        static const unsigned int kName                         = 23;
+        static const unsigned int kAnnotationUintValue          = 3;    // DebugAnnotation
+        static const unsigned int kAnnotationName               = 10;
+        static const unsigned int kUuid                         = 1;    // TrackDescriptor
+        static const unsigned int kThread                       = 4;
+        static const unsigned int kPid                          = 1;    // ThreadDescriptor
+        static const unsigned int kTid                          = 2;
+        static const unsigned int kThreadName                   = 5;
+
+        static const unsigned int kSequenceId                   = 1;
+        static const unsigned int kIncrementalStateCleared      = 1;
+        static const std::uint64_t kTrackUuidBase               = 0x414c32ull << 32;
+    }
+
+    inline void Tracer::WritePacket( const std::string& packet )
+    {
+        std::string framed;
+        Proto::BytesField( framed, Proto::kTracePacket, packet );
+        fwrite( framed.data(), 1, framed.size(), m_file );
+    }
+
+    inline void Tracer::WriteThreadName( const ThreadBuffer& buffer )
+    {
+        const char* name = buffer.GetName();
+        std::string threadName = name ? name : "Thread " + std::to_string( buffer.GetId() );
+        if ( m_format == Format::Perfetto )
+        {
+            std::string thread;
+            Proto::VarintField( thread, Proto::kPid, 1 );
+            Proto::VarintField( thread, Proto::kTid, buffer.GetId() );
+            Proto::BytesField( thread, Proto::kThreadName, threadName );
+            std::string track;
+            Proto::VarintField( track, Proto::kUuid, Proto::kTrackUuidBase + buffer.GetId() );
+            Proto::BytesField( track, Proto::kThread, thread );
+            std::string packet;
+            Proto::VarintField( packet, Proto::kTrustedPacketSequenceId, Proto::kSequenceId );
+            if ( m_firstEvent )
+            {
+                Proto::VarintField( packet, Proto::kSequenceFlags, Proto::kIncrementalStateCleared );
+                m_firstEvent = false;
+            }
+            Proto::BytesField( packet, Proto::kTrackDescriptor, track );
+            WritePacket( packet );
+            return;
+        }
+
+        std::string escaped;
+        for ( char c : threadName )
+        {
+            if ( c == '"' || c == '\\' )
+            {
+                escaped.push_back( '\\' );
+            }
+            escaped.push_back( c );
+        }
+        fprintf( m_file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                 m_firstEvent ? "" : ",", buffer.GetId(), escaped.c_str() );
+        m_firstEvent = false;
+    }
+
+    inline void Tracer::WriteEvent( const ThreadBuffer& buffer, const Event& event )
+    {
+        if ( m_format == Format::Perfetto )
+        {
+            std::string trackEvent;
+            Proto::VarintField( trackEvent, Proto::kType, event.phase == Phase::Begin ? 1 : event.phase == Phase::End ? 2 : 3 );
+            Proto::VarintField( trackEvent, Proto::kTrackUuid, Proto::kTrackUuidBase + buffer.GetId() );
+            if ( event.phase != Phase::End )
+            {
+                Proto::BytesField( trackEvent, Proto::kName, event.name );
+            }
+            if ( event.arg )
+            {
+                std::string annotation;
+                Proto::BytesField( annotation, Proto::kAnnotationName, "frame" );
+                Proto::VarintField( annotation, Proto::kAnnotationUintValue, event.arg );
+                Proto::BytesField( trackEvent, Proto::kDebugAnnotations, annotation );
+            }
+            std::string packet;
+            Proto::VarintField( packet, Proto::kTimestamp, (std::uint64_t)event.time );
+            Proto::VarintField( packet, Proto::kTrustedPacketSequenceId, Proto::kSequenceId );
+            Proto::BytesField( packet, Proto::kTrackEvent, trackEvent );
+            WritePacket( packet );
+            return;
+        }
+
+        fprintf( m_file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld.%03lld,\"pid\":1,\"tid\":%u%s",
+                 event.name, (char)event.phase, (long long)( event.time / kMicrosecond ), (long long)( event.time % kMicrosecond ),
+                 buffer.GetId(), event.phase == Phase::Instant ? ",\"s\":\"t\"" : "" );
+        if ( event.arg )
+        {
+            fprintf( m_file, ",\"args\":{\"frame\":%llu}", (unsigned long long)event.arg );
+        }
+        fputs( "}", m_file );
+    }
+
+} // namespace Trace
+} // namespace AntiLag2
+} // namespace AMD
+
+#define FFX_ANTILAG2_TRACE_BEGIN( name )                AMD::AntiLag2::Trace::Tracer::Get().Record( name, AMD::AntiLag2::Trace::Phase::Begin, 0 )
+#define FFX_ANTILAG2_TRACE_END( name, frameIndex )      AMD::AntiLag2::Trace::Tracer::Get().Record( name, AMD::AntiLag2::Trace::Phase::End, frameIndex )
+#define FFX_ANTILAG2_TRACE_INSTANT( name, frameIndex )  AMD::AntiLag2::Trace::Tracer::Get().Record( name, AMD::AntiLag2::Trace::Phase::Instant, frameIndex )
+
+#else
+
+#define FFX_ANTILAG2_TRACE_BEGIN( name )                ((void)0)
+#define FFX_ANTILAG2_TRACE_END( name, frameIndex )      ((void)0)
+#define FFX_ANTILAG2_TRACE_INSTANT( name, frameIndex )  ((void)0)
+
+#endif
@@ -0,0 +1,229 @@
+// This file is part of the Anti-Lag 2.0 SDK.
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#ifndef _WIN32
+#include <sched.h>
+#include <time.h>
+#endif
+
+namespace AMD {
+namespace AntiLag2 {
+
+    // Timestamps used by the software implementation, in nanoseconds.
+    typedef std::int64_t Timestamp;
+
+    static const Timestamp kMicrosecond = 1000;
+    static const Timestamp kMillisecond = 1000000;
+    static const Timestamp kSecond      = 1000000000;
+
+    // Returns the current time from a monotonic clock.
+    Timestamp GetTimestamp();
+
+    // Waits for absolute deadlines with a precision of tens of microseconds.
+    //
+    // The thread sleeps while the deadline is further away than the spin threshold, then spins with pause instructions.
+    // The threshold follows how late the OS actually wakes the thread up: it grows immediately when a sleep overshoots
+    // and shrinks slowly otherwise. Calibrate() measures it up front instead of learning it over the first frames.
+    //
+    // Pace against absolute deadlines (previous deadline + interval) rather than sleeping for intervals,
+    // so that wake-up error does not accumulate as drift.
+    class PreciseWait
+    {
+    public:
+        PreciseWait();
+        ~PreciseWait();
+
+        PreciseWait( const PreciseWait& ) = delete;
+        PreciseWait& operator=( const PreciseWait& ) = delete;
+
+        // Blocks until the given absolute time. Returns how late the call returned.
+        Timestamp WaitUntil( Timestamp deadline );
+
+        // Measures the sleep overshoot of this system and sets the spin threshold from the worst of the samples.
+        // Takes roughly iterations milliseconds.
+        void Calibrate( unsigned int iterations = 32 );
+
+        Timestamp GetSpinThreshold() const  { return m_spinThreshold; }
+
+        // Disables sleeping entirely - the wait spins for its whole duration.
+        void SetSpinOnly( bool spinOnly )   { m_spinOnly = spinOnly; }
+
+    private:
+        // Sleeps for roughly the given duration, may return early or late.
+        void Sleep( Timestamp duration );
+        void OnOvershoot( Timestamp overshoot );
+
+        static const Timestamp kMinSpinThreshold = 50 * kMicrosecond;
+        static const Timestamp kMaxSpinThreshold = 4 * kMillisecond;
+
+        Timestamp   m_spinThreshold = 2 * kMillisecond;
+        bool        m_spinOnly = false;
+#ifdef _WIN32
+        HANDLE      m_timer = nullptr;
+        bool        m_timerCreated = false;
+#endif
+    };
+
+    // Clock of AntiLag2::Context: GetTimestamp() time, waited for with a PreciseWait.
+    class SystemClock
+    {
+    public:
+        Timestamp   Now() const                     { return GetTimestamp(); }
+        void        WaitUntil( Timestamp deadline ) { m_wait.WaitUntil( deadline ); }
+
+    private:
+        PreciseWait m_wait;
+    };
+
+    //
+    // Private implementation details below.
+    //
+
+    inline Timestamp GetTimestamp()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+
+    inline void SpinPause()
+    {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(_WIN32)
+        YieldProcessor();
+#else
+        sched_yield();
+#endif
+    }
+
+    inline PreciseWait::PreciseWait()
+    {
+    }
+
+    inline PreciseWait::~PreciseWait()
+    {
+#ifdef _WIN32
+        if ( m_timer )
+        {
+            CloseHandle( m_timer );
+        }
+#endif
+    }
+
+    inline void PreciseWait::Sleep( Timestamp duration )
+    {
+#ifdef _WIN32
+        // The timer is created on first use, so that a PreciseWait that never sleeps costs no handle.
+        // High resolution waitable timers are available from Windows 10 1803 and wake up within about 0.5ms.
+        // Older systems fall back to Sleep() with the system timer resolution.
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+        if ( !m_timerCreated )
+        {
+            m_timer = CreateWaitableTimerExW( nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS );
+            m_timerCreated = true;
+        }
+        if ( m_timer )
+        {
+            LARGE_INTEGER dueTime = {};
+            dueTime.QuadPart = -( duration / 100 ); // relative time in 100ns units
+            if ( SetWaitableTimerEx( m_timer, &dueTime, 0, nullptr, nullptr, nullptr, 0 ) )
+            {
+                WaitForSingleObject( m_timer, INFINITE );
+                return;
+            }
+        }
+        ::Sleep( (DWORD)( duration / kMillisecond ) );
+#else
+        timespec request = {};
+        request.tv_sec = (time_t)( duration / kSecond );
+        request.tv_nsec = (long)( duration % kSecond );
+        nanosleep( &request, nullptr );
+#endif
+    }
+
+    inline void PreciseWait::OnOvershoot( Timestamp overshoot )
+    {
+        // Keep a margin above the worst recent overshoot, decay slowly towards the typical one.
+        Timestamp threshold = overshoot + overshoot / 2 + kMinSpinThreshold;
+        if ( threshold > m_spinThreshold )
+        {
+            m_spinThreshold = threshold;
+        }
+        else
+        {
+            m_spinThreshold -= ( m_spinThreshold - threshold ) / 64;
+        }
+        if ( m_spinThreshold > kMaxSpinThreshold )
+        {
+            m_spinThreshold = kMaxSpinThreshold;
+        }
+    }
+
+    inline Timestamp PreciseWait::WaitUntil( Timestamp deadline )
+    {
+        Timestamp now = GetTimestamp();
+        if ( !m_spinOnly )
+        {
+            while ( deadline - now > m_spinThreshold )
+            {
+                const Timestamp sleep = deadline - now - m_spinThreshold;
+                Sleep( sleep );
+                const Timestamp wake = GetTimestamp();
+                OnOvershoot( wake - now > sleep ? wake - now - sleep : 0 );
+                now = wake;
+            }
+        }
+        while ( now < deadline )
+        {
+            SpinPause();
+            now = GetTimestamp();
+        }
+        return now - deadline;
+    }
+
+    inline void PreciseWait::Calibrate( unsigned int iterations )
+    {
+        Timestamp worst = 0;
+        for ( unsigned int i = 0; i < iterations; ++i )
+        {
+            const Timestamp start = GetTimestamp();
+            Sleep( kMillisecond );
+            const Timestamp overshoot = GetTimestamp() - start - kMillisecond;
+            if ( overshoot > worst )
+            {
+                worst = overshoot;
+            }
+        }
+        m_spinThreshold = kMinSpinThreshold;
+        OnOvershoot( worst );
+    }
+
+} // namespace AntiLag2
+} // namespace AMD
@@ -12,6 +12,11 @@
 //--------------------------------------------------------------------------------------
 #include "DXUT.h"
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #ifndef NDEBUG
 #include <dxgidebug.h>
 #endif
@@ -209,6 +214,8 @@ protected:
         bool  m_AppCalledWasKeyPressed;         // true if the app ever calls DXUTWasKeyPressed().  Allows for optimzation
         bool  m_ReleasingSwapChain;             // if true, the app is releasing its swapchain
         bool  m_IsInGammaCorrectMode;           // Tell DXUTRes and DXUTMisc that we are in gamma correct mode
+        void* m_FramePacket;                    // set by the frame move callback for the render callback of the same frame
+        void* m_RenderFramePacket;              // packet of the frame the render callback is rendering
 
         LPDXUTCALLBACKPREMESSAGEPUMP            m_PreMessagePumpFunc;
         LPDXUTCALLBACKMODIFYDEVICESETTINGS      m_ModifyDeviceSettingsFunc;     // modify Direct3D device settings callback
@@ -424,6 +431,8 @@ public:
     GET_SET_ACCESSOR( int, OverrideForceVsync );
     GET_SET_ACCESSOR( bool, ReleasingSwapChain );
     GET_SET_ACCESSOR( bool, IsInGammaCorrectMode );
+    GET_SET_ACCESSOR( void*, FramePacket );
+    GET_SET_ACCESSOR( void*, RenderFramePacket );
     
     GET_SET_ACCESSOR( LPDXUTCALLBACKPREMESSAGEPUMP, PreMessagePumpFunc );
     GET_SET_ACCESSOR( LPDXUTCALLBACKMODIFYDEVICESETTINGS, ModifyDeviceSettingsFunc );
@@ -545,6 +554,12 @@ HRESULT DXUTGetOutputOrdinalFromMonitor( _In_ HMONITOR hMonitor, _Out_ UINT* pOu
 HRESULT DXUTHandleDeviceRemoved();
 void DXUTUpdateBackBufferDesc();
 void DXUTSetupCursor();
+HRESULT DXUTEnterMainLoop( _In_z_ LPCWSTR strFunction );
+bool DXUTMessageMayChangeDevice( _In_ UINT uMsg );
+bool DXUTCanMoveFrame();
+bool DXUTMoveFrame( _Out_ double* pfTime, _Out_ float* pfElapsedTime );
+HRESULT DXUTRenderFrame( _In_ double fTime, _In_ float fElapsedTime, _In_opt_ void* pPacket, _Out_ bool* pbShutdown );
+void DXUTHandlePresentResult( _In_ HRESULT hr );
 
 // Direct3D 11
 HRESULT DXUTCreateD3D11Views( _In_ ID3D11Device* pd3dDevice, _In_ ID3D11DeviceContext* pd3dDeviceContext, _In_ DXUTDeviceSettings* pDeviceSettings );
@@ -1584,10 +1599,10 @@ LRESULT CALLBACK DXUTStaticWndProc( HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
 
 
 //--------------------------------------------------------------------------------------
-// Handles app's message loop and rendering when idle.  If DXUTCreateDevice()
-// has not already been called, it will call DXUTCreateWindow() with the default parameters.  
+// Checks that the main loop can be entered, creating the device with the default
+// parameters if DXUTCreateDevice() has not already been called.
 //--------------------------------------------------------------------------------------
-HRESULT WINAPI DXUTMainLoop( _In_opt_ HACCEL hAccel )
+HRESULT DXUTEnterMainLoop( _In_z_ LPCWSTR strFunction )
 {
     HRESULT hr;
 
@@ -1596,7 +1611,7 @@ HRESULT WINAPI DXUTMainLoop( _In_opt_ HACCEL hAccel )
     {
         if( ( GetDXUTState().GetExitCode() == 0 ) || ( GetDXUTState().GetExitCode() == 10 ) )
             GetDXUTState().SetExitCode( 1 );
-        return DXUT_ERR_MSGBOX( L"DXUTMainLoop", E_FAIL );
+        return DXUT_ERR_MSGBOX( strFunction, E_FAIL );
     }
 
     GetDXUTState().SetInsideMainloop( true );
@@ -1621,8 +1636,6 @@ HRESULT WINAPI DXUTMainLoop( _In_opt_ HACCEL hAccel )
         }
     }
 
-    HWND hWnd = DXUTGetHWND();
-
     // DXUTInit() must have been called and succeeded for this function to proceed
     // DXUTCreateWindow() or DXUTSetWindow() must have been called and succeeded for this function to proceed
     // DXUTCreateDevice() or DXUTCreateDeviceFromSettings() must have been called and succeeded for this function to proceed
@@ -1630,9 +1643,23 @@ HRESULT WINAPI DXUTMainLoop( _In_opt_ HACCEL hAccel )
     {
         if( ( GetDXUTState().GetExitCode() == 0 ) || ( GetDXUTState().GetExitCode() == 10 ) )
             GetDXUTState().SetExitCode( 1 );
-        return DXUT_ERR_MSGBOX( L"DXUTMainLoop", E_FAIL );
+        return DXUT_ERR_MSGBOX( strFunction, E_FAIL );
     }
 
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Handles app's message loop and rendering when idle.  If DXUTCreateDevice()
+// has not already been called, it will call DXUTCreateWindow() with the default parameters.  
+//--------------------------------------------------------------------------------------
+HRESULT WINAPI DXUTMainLoop( _In_opt_ HACCEL hAccel )
+{
+    HRESULT hr = DXUTEnterMainLoop( L"DXUTMainLoop" );
+    if( FAILED( hr ) )
+        return hr;
+
     // Now we're ready to receive and process Windows messages.
     MSG msg;
     msg.message = WM_NULL;
@@ -1661,6 +1688,173 @@ HRESULT WINAPI DXUTMainLoop( _In_opt_ HACCEL hAccel )
 }
 
 
+//--------------------------------------------------------------------------------------
+// Handles app's message loop like DXUTMainLoop(), but renders on a render thread of its
+// own: this thread pumps the messages and calls the pre message pump and frame move
+// callbacks, then queues the frame for the render thread, which calls the render
+// callback and Present() while the next frame is moved. At most maxQueuedFrames frames
+// wait for the render thread; when the queue is full this thread waits for it.
+//
+// The frame move callback runs while the previous frame renders, so it must not use the
+// immediate context, and hands what its frame needs to the render callback through
+// DXUTSetFramePacket(). A frame is only moved once there is room in the queue, so at most
+// maxQueuedFrames + 1 packets are in use at a time. The pre message pump callback is only
+// called right before a frame is moved, once there is room for it.
+//
+// Window messages and the results of Present() are handled on this thread. Only the
+// messages that may change the device or the swap chain wait for the frame being
+// rendered, so the GUI and whatever else the message callback changes must reach the
+// render callback through the packet as well.
+//--------------------------------------------------------------------------------------
+HRESULT WINAPI DXUTMainLoopPipelined( _In_opt_ HACCEL hAccel, _In_ UINT maxQueuedFrames )
+{
+    HRESULT hr = DXUTEnterMainLoop( L"DXUTMainLoopPipelined" );
+    if( FAILED( hr ) )
+        return hr;
+
+    struct Frame
+    {
+        double  fTime;
+        float   fElapsedTime;
+        void*   pPacket;
+    };
+
+    std::mutex              renderMutex;            // Held while rendering, and while this thread handles what may change the device
+    std::mutex              queueMutex;             // Protects everything below
+    std::condition_variable queueChanged;
+    std::deque<Frame>       frames;
+    std::vector<HRESULT>    results;                // What Present() returned, for each frame rendered
+    bool                    bHoldRendering = false; // A result has to be handled before the next frame is rendered
+    bool                    bShutdown = false;      // The render callback asked for a shutdown
+    bool                    bQuit = false;
+
+    maxQueuedFrames = std::max( maxQueuedFrames, 1u );
+
+    std::thread renderThread( [&]()
+    {
+        for( ;; )
+        {
+            Frame frame;
+            {
+                std::unique_lock<std::mutex> lock( queueMutex );
+                queueChanged.wait( lock, [&]() { return bQuit || ( !frames.empty() && !bHoldRendering ); } );
+                if( bQuit )
+                    return;
+                frame = frames.front();
+                frames.pop_front();
+            }
+            queueChanged.notify_all();
+
+            {
+                // The result is queued before the render mutex is released, so none arrives while they are handled
+                std::lock_guard<std::mutex> renderLock( renderMutex );
+                bool bShutdownFrame;
+                HRESULT hrPresent = DXUTRenderFrame( frame.fTime, frame.fElapsedTime, frame.pPacket, &bShutdownFrame );
+
+                std::lock_guard<std::mutex> lock( queueMutex );
+                results.push_back( hrPresent );
+                bShutdown = bShutdown || bShutdownFrame;
+                bHoldRendering = bShutdown || FAILED( hrPresent );
+            }
+            queueChanged.notify_all();
+        }
+    } );
+
+    // Now we're ready to receive and process Windows messages.
+    MSG msg;
+    msg.message = WM_NULL;
+    PeekMessage( &msg, nullptr, 0U, 0U, PM_NOREMOVE );
+    std::vector<HRESULT> handled;
+    while( msg.message != WM_QUIT )
+    {
+        if ( PeekMessage( &msg, nullptr, 0U, 0U, PM_REMOVE ) )
+        {
+            // Only a message that may change the device or the swap chain waits for the frame being rendered, so the input
+            // reaches the message callback right away
+            std::unique_lock<std::mutex> renderLock( renderMutex, std::defer_lock );
+            if( DXUTMessageMayChangeDevice( msg.message ) )
+                renderLock.lock();
+            TranslateMessage( &msg );
+            DispatchMessage( &msg );
+        }
+
+        bool bShutdownNow, bHeld;
+        {
+            std::lock_guard<std::mutex> lock( queueMutex );
+            handled.swap( results );
+            bShutdownNow = bShutdown;
+            bShutdown = false;
+            bHeld = bHoldRendering;
+        }
+        if( !handled.empty() || bShutdownNow )
+        {
+            // A device reset or a shutdown happens while the render thread holds off, so the lock is free. Successful
+            // frames only touch the device when the app is to quit after a number of frames.
+            std::unique_lock<std::mutex> renderLock( renderMutex, std::defer_lock );
+            if( bHeld || GetDXUTState().GetOverrideQuitAfterFrame() != 0 )
+                renderLock.lock();
+            for( HRESULT hrPresent : handled )
+                DXUTHandlePresentResult( hrPresent );
+            handled.clear();
+            if( bShutdownNow )
+                DXUTShutdown();
+
+            if( bHeld )
+            {
+                std::lock_guard<std::mutex> lock( queueMutex );
+                bHoldRendering = false;
+            }
+            queueChanged.notify_all();
+        }
+
+        // Wait for room in the queue before the frame is moved, so that the frame move callback never reuses the packet of a
+        // frame that is queued or being rendered. Nothing is moved while the render thread holds off for a result, which is
+        // handled above in the next iteration.
+        {
+            std::unique_lock<std::mutex> lock( queueMutex );
+            queueChanged.wait( lock, [&]() { return frames.size() < maxQueuedFrames || bHoldRendering; } );
+            if( bHoldRendering )
+                continue;
+        }
+
+        // The pre message pump callback comes right before the frame it is for is moved
+        if( !DXUTCanMoveFrame() )
+            continue;
+        DXUTPreMessagePump();
+
+        double fTime;
+        float fElapsedTime;
+        if( !DXUTMoveFrame( &fTime, &fElapsedTime ) )
+            continue;
+
+        // Drop the frame if the render thread started holding off for a result while it was moved
+        std::unique_lock<std::mutex> lock( queueMutex );
+        if( !bHoldRendering )
+        {
+            Frame frame = { fTime, fElapsedTime, GetDXUTState().GetFramePacket() };
+            frames.push_back( frame );
+            lock.unlock();
+            queueChanged.notify_all();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( queueMutex );
+        bQuit = true;
+    }
+    queueChanged.notify_all();
+    renderThread.join();
+
+    // Cleanup the accelerator table
+    if( hAccel )
+        DestroyAcceleratorTable( hAccel );
+
+    GetDXUTState().SetInsideMainloop( false );
+
+    return S_OK;
+}
+
+
 //======================================================================================
 //======================================================================================
 // Direct3D section
@@ -2807,28 +3001,74 @@ void WINAPI DXUTPreMessagePump()
     }
 }
 
+_Use_decl_annotations_
+void WINAPI DXUTSetFramePacket( void* pPacket )
+{
+    GetDXUTState().SetFramePacket( pPacket );
+}
+
+void* WINAPI DXUTGetFramePacket()
+{
+    return GetDXUTState().GetRenderFramePacket();
+}
+
 //--------------------------------------------------------------------------------------
-// Render the 3D environment by:
-//      - Checking if the device is lost and trying to reset it if it is
-//      - Get the elapsed time since the last frame
-//      - Calling the app's framemove and render callback
-//      - Calling Present()
+// Whether handling the message may change the device or the swap chain: the window being
+// sized, moved, activated, painted or closed, the keys that toggle the full screen mode or
+// close the app, and the clicks that may press a GUI button doing the same. Mouse moves
+// and the other input go through DXUTMainLoopPipelined() without waiting for the frame
+// being rendered.
 //--------------------------------------------------------------------------------------
-void WINAPI DXUTRender3DEnvironment()
+bool DXUTMessageMayChangeDevice( _In_ UINT uMsg )
 {
-    HRESULT hr;
+    switch( uMsg )
+    {
+        case WM_PAINT:
+        case WM_SIZE:
+        case WM_ENTERSIZEMOVE:
+        case WM_EXITSIZEMOVE:
+        case WM_ACTIVATEAPP:
+        case WM_DISPLAYCHANGE:
+        case WM_POWERBROADCAST:
+        case WM_SYSCOMMAND:
+        case WM_NCLBUTTONDOWN:      // Starts the modal loop that sizes or moves the window
+        case WM_NCLBUTTONDBLCLK:
+        case WM_CLOSE:
+        case WM_DESTROY:
+        case WM_KEYDOWN:
+        case WM_KEYUP:
+        case WM_SYSKEYDOWN:
+        case WM_SYSKEYUP:
+        case WM_LBUTTONDOWN:
+        case WM_LBUTTONUP:
+        case WM_LBUTTONDBLCLK:
+            return true;
+    }
 
-    auto pd3dDevice = DXUTGetD3D11Device();
-    if( !pd3dDevice )
-        return;
+    return false;
+}
 
-    auto pd3dImmediateContext = DXUTGetD3D11DeviceContext();
-    if( !pd3dImmediateContext )
-        return;
 
-    auto pSwapChain = DXUTGetDXGISwapChain();
-    if( !pSwapChain )
-        return;
+//--------------------------------------------------------------------------------------
+// Whether there is a device to move a frame for
+//--------------------------------------------------------------------------------------
+bool DXUTCanMoveFrame()
+{
+    return DXUTGetD3D11Device() && DXUTGetD3D11DeviceContext() && DXUTGetDXGISwapChain();
+}
+
+
+//--------------------------------------------------------------------------------------
+// First half of a frame, on the thread that handles the messages:
+//      - Yielding the CPU while paused, minimized or occluded
+//      - Get the elapsed time since the last frame
+//      - Calling the app's framemove callback
+// Returns false if there is no device to render to.
+//--------------------------------------------------------------------------------------
+bool DXUTMoveFrame( _Out_ double* pfTime, _Out_ float* pfElapsedTime )
+{
+    if( !DXUTCanMoveFrame() )
+        return false;
 
     if( DXUTIsRenderingPaused() || !DXUTIsActive() || GetDXUTState().GetRenderingOccluded() )
     {
@@ -2857,15 +3097,44 @@ void WINAPI DXUTRender3DEnvironment()
     DXUTHandleTimers();
 
     // Animate the scene by calling the app's frame move callback
+    GetDXUTState().SetFramePacket( nullptr );
     LPDXUTCALLBACKFRAMEMOVE pCallbackFrameMove = GetDXUTState().GetFrameMoveFunc();
     if( pCallbackFrameMove )
     {
         pCallbackFrameMove( fTime, fElapsedTime, GetDXUTState().GetFrameMoveFuncUserContext() );
-        pd3dDevice = DXUTGetD3D11Device();
-        if( !pd3dDevice ) // Handle DXUTShutdown from inside callback
-            return;
+        if( !DXUTGetD3D11Device() ) // Handle DXUTShutdown from inside callback
+            return false;
     }
 
+    *pfTime = fTime;
+    *pfElapsedTime = fElapsedTime;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Second half of a frame: calls the app's render callback and Present(). Returns what
+// Present() returned, or S_FALSE if nothing was presented, with *pbShutdown set if the
+// app should shut down after taking a screenshot.
+//--------------------------------------------------------------------------------------
+HRESULT DXUTRenderFrame( _In_ double fTime, _In_ float fElapsedTime, _In_opt_ void* pPacket, _Out_ bool* pbShutdown )
+{
+    *pbShutdown = false;
+
+    auto pd3dDevice = DXUTGetD3D11Device();
+    if( !pd3dDevice )
+        return S_FALSE;
+
+    auto pd3dImmediateContext = DXUTGetD3D11DeviceContext();
+    if( !pd3dImmediateContext )
+        return S_FALSE;
+
+    auto pSwapChain = DXUTGetDXGISwapChain();
+    if( !pSwapChain )
+        return S_FALSE;
+
+    GetDXUTState().SetRenderFramePacket( pPacket );
+
     if( !GetDXUTState().GetRenderingPaused() )
     {
         // Render the scene by calling the app's render callback
@@ -2877,7 +3146,7 @@ void WINAPI DXUTRender3DEnvironment()
             
             pd3dDevice = DXUTGetD3D11Device();
             if( !pd3dDevice ) // Handle DXUTShutdown from inside callback
-                return;
+                return S_FALSE;
         }
 
 /*#if defined(DEBUG) || defined(_DEBUG)
@@ -2901,8 +3170,8 @@ void WINAPI DXUTRender3DEnvironment()
     }
     if ( GetDXUTState().GetExitAfterScreenShot() )
     {
-        DXUTShutdown();
-        return;
+        *pbShutdown = true;
+        return S_FALSE;
     }
 
     DWORD dwFlags = 0;
@@ -2913,7 +3182,20 @@ void WINAPI DXUTRender3DEnvironment()
     UINT SyncInterval = GetDXUTState().GetCurrentDeviceSettings()->d3d11.SyncInterval;
 
     // Show the frame on the primary surface.
-    hr = pSwapChain->Present( SyncInterval, dwFlags );
+    return pSwapChain->Present( SyncInterval, dwFlags );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Handles what Present() returned, on the thread that handles the messages:
+//      - Checking if the device is lost and trying to reset it if it is
+//      - Counting the frame
+//--------------------------------------------------------------------------------------
+void DXUTHandlePresentResult( _In_ HRESULT hr )
+{
+    if( S_FALSE == hr )
+        return;
+
     if( DXGI_STATUS_OCCLUDED == hr )
     {
         // There is a window covering our entire rendering area.
@@ -2980,8 +3262,32 @@ void WINAPI DXUTRender3DEnvironment()
         if( nFrame > GetDXUTState().GetOverrideQuitAfterFrame() )
             DXUTShutdown();
     }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Render the 3D environment by:
+//      - Checking if the device is lost and trying to reset it if it is
+//      - Get the elapsed time since the last frame
+//      - Calling the app's framemove and render callback
+//      - Calling Present()
+//--------------------------------------------------------------------------------------
+void WINAPI DXUTRender3DEnvironment()
+{
+    double fTime;
+    float fElapsedTime;
+    if( !DXUTMoveFrame( &fTime, &fElapsedTime ) )
+        return;
+
+    bool bShutdown;
+    HRESULT hr = DXUTRenderFrame( fTime, fElapsedTime, GetDXUTState().GetFramePacket(), &bShutdown );
+    if( bShutdown )
+    {
+        DXUTShutdown();
+        return;
+    }
 
-    return;
+    DXUTHandlePresentResult( hr );
 }
 
 
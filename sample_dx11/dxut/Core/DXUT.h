@@ -265,6 +265,13 @@ HRESULT WINAPI DXUTCreateDeviceFromSettings( _In_ DXUTDeviceSettings* pDeviceSet
 // Choose either DXUTMainLoop or implement your own main loop 
 HRESULT WINAPI DXUTMainLoop( _In_opt_ HACCEL hAccel = nullptr );
 
+// DXUTMainLoop with the render callback and Present() on a render thread of their own
+HRESULT WINAPI DXUTMainLoopPipelined( _In_opt_ HACCEL hAccel = nullptr, _In_ UINT maxQueuedFrames = 1 );
+
+// Set by the frame move callback, returned to the render callback of the same frame
+void  WINAPI DXUTSetFramePacket( _In_opt_ void* pPacket );
+void* WINAPI DXUTGetFramePacket();
+
 // If not using DXUTMainLoop consider using DXUTRender3DEnvironment
 void WINAPI DXUTRender3DEnvironment();
 void WINAPI DXUTPreMessagePump();
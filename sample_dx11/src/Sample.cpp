@@ -32,6 +32,11 @@
 #include "SDKMesh.h"
 #include "resource.h"
 #include "../../ffx_antilag2_dx11.h"
+#include "../../ffx_antilag2_async.h"
+#include "../../ffx_antilag2_record.h"
+#include "../../ffx_antilag2_shared.h"
+
+#include <algorithm>
 
 #pragma warning( disable : 4100 ) // disable unreference formal parameter warnings for /W4 builds
 
@@ -52,6 +57,7 @@ CFirstPersonCamera                  g_Camera;					// A model viewing camera
 CDXUTDialogResourceManager          g_DialogResourceManager;	// manager for shared resources of dialogs
 CEF_D3DSettingsDlg                  g_D3DSettingsDlg;			// modified device settings dialog which will always shows on the main display
 CDXUTDialog                         g_HUD;						// manages the 3D UI
+CDXUTDialog                         g_HUDView;                  // copy of g_HUD the pipelined loop's render thread draws
 CDXUTDialog                         g_SampleUI;					// dialog for sample specific controls
 CDXUTTextHelper*                    g_pTxtHelper = nullptr;
 UINT                                g_iWidth;
@@ -74,7 +80,10 @@ RECT								g_MainDisplayRect;
 DirectX::XMMATRIX					g_SingleCameraProjM;
 
 AMD::AntiLag2DX11::Context          g_AntiLagContext = {};
+AMD::AntiLag2::AsyncDriverProbe     g_AntiLagProbe;
+bool                                g_AntiLagInitializing = false;
 bool                                g_AntiLagAvailable = false;
+bool                                g_AntiLagSoftware = false;
 
 bool                                g_AntiLagEnabled = false;
 CDXUTCheckBox*                      g_AntiLagEnabledCheckBox = nullptr;
@@ -86,10 +95,30 @@ int                                 g_AntiLagLimiterValue = 0;
 CDXUTStatic*                        g_AntiLagLimiterText = nullptr;
 
 bool                                g_AntiLagTestingMode = false;
+AMD::AntiLag2::CallRecorder         g_AntiLagRecorder;
+AMD::AntiLag2::SharedTelemetryWriter g_AntiLagSharedTelemetry;
+
+// Synthetic frame generation: each rendered frame is presented twice, first as the interpolated frame, which repeats the
+// previous rendered frame, then as the real one. Both are presented by the thread that renders, so the frame types are signaled
+// with SetFrameGenFrameType: PaceFrameGenPresent waits, and belongs on a presentation thread of its own.
+bool                                g_SyntheticFrameGen = false;
+ID3D11Texture2D*                    g_pSyntheticFrame = nullptr;                // Copy of the last rendered frame
+bool                                g_SyntheticFrameValid = false;
+AMD::AntiLag2::Timestamp            g_SyntheticLastPresent = 0;
+float                               g_SyntheticPresentIntervals[ 64 ] = {};     // ms between consecutive presents
+unsigned int                        g_SyntheticPresentCount = 0;
+
 
+// The last slider position lets the SDK pick the limit
+const int                           g_AntiLagLimiterSliderAuto = 252;
 
 int MapLimiterSliderToFPS( int sliderValue )
 {
+    if ( sliderValue == g_AntiLagLimiterSliderAuto )
+    {
+        return (int)AMD::AntiLag2::kMaxFPSAdaptive;
+    }
+
     // Map to 50fps+ range
     return sliderValue == 0 ? 0 : sliderValue + 49;
 }
@@ -135,6 +164,39 @@ static const wchar_t* gHelpText0 = L"Press M to enable FLM testing mode.\nThis l
 static const wchar_t* gHelpText1 = L"Press M to disable FLM testing mode.";
 
 
+// What a HUD control shows
+struct HUDControlState
+{
+    bool                                enabled;
+    bool                                checked;                // Check boxes
+    int                                 value;                  // Sliders
+    WCHAR                               text[ 128 ];            // Statics
+};
+
+// Pipelined main loop: the frame is moved on the main thread, which samples the input in Update, and rendered on a render
+// thread while the next one is moved. OnFrameMove fills a packet with what OnD3D11FrameRender needs, as the camera, the GUI
+// and the Anti-Lag 2.0 state move on: the main thread handles the messages to g_HUD, and the render thread draws g_HUDView.
+struct FramePacket
+{
+    DirectX::XMMATRIX                   viewProjection;
+    unsigned __int64                    frameIndex;             // Anti-Lag 2.0 frame whose input the packet was moved with
+    bool                                antiLagAvailable;       // Anti-Lag 2.0 was initialized when the frame was moved
+    bool                                antiLagSoftware;
+    bool                                delayStatsValid;
+    AMD::AntiLag2::LatencyStats         delayStats;
+    int                                 limiterValue;
+    unsigned int                        adaptiveMaxFPS;
+    unsigned int                        driverDataVersion;
+    WCHAR                               frameStats[ 256 ];
+    WCHAR                               deviceStats[ 256 ];
+    HUDControlState                     hud[ IDC_ANTILAG_HELPTEXT ];    // State of the HUD control with ID i + 1
+};
+bool                                g_Pipelined = false;
+const UINT                          g_PipelinedQueuedFrames = 1;
+FramePacket                         g_FramePackets[ g_PipelinedQueuedFrames + 2 ];  // Queued, being rendered and being moved, and a dropped one
+unsigned int                        g_FramePacketCount = 0;
+
+
 //--------------------------------------------------------------------------------------
 // Forward declarations 
 //--------------------------------------------------------------------------------------
@@ -156,7 +218,7 @@ void CALLBACK OnD3D11DestroyDevice( void* pUserContext );
 void CALLBACK PreMessagePump( void* pUserContext );
 
 void InitApp();
-void RenderText();
+void RenderText( const FramePacket* packet );
 
 //--------------------------------------------------------------------------------------
 // Helper function to compile an hlsl shader from file, 
@@ -246,16 +308,75 @@ int WINAPI wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     DXUTSetCursorSettings( true, true ); // Show the cursor and clip it when in full screen
     DXUTCreateWindow( L"Anti-Lag 2.0 DX11 Sample v1.0" );
 
+    // -recordcalls: write every Anti-Lag 2.0 call to a log that tools/Replay can play back
+    // PollAntiLagInitialization attaches both once the context is initialized.
+    if ( lpCmdLine && wcsstr( lpCmdLine, L"-recordcalls" ) )
+    {
+        g_AntiLagRecorder.Start( "antilag2_calls.bin" );
+    }
+
+    // -sharedtelemetry: publish the Anti-Lag 2.0 state of every frame for tools/al2top
+    if ( lpCmdLine && wcsstr( lpCmdLine, L"-sharedtelemetry" ) )
+    {
+        g_AntiLagSharedTelemetry.Open();
+    }
+
+    // -syntheticfg: present every frame twice, as a frame generation pair, to measure the pacing of the presents
+    g_SyntheticFrameGen = lpCmdLine && wcsstr( lpCmdLine, L"-syntheticfg" ) != nullptr;
+
+    // -pipelined: render on a render thread while the next frame is moved
+    g_Pipelined = lpCmdLine && wcsstr( lpCmdLine, L"-pipelined" ) != nullptr;
+
     int width = 1920;
     int height = 1080;
     bool windowed = true;
 
     DXUTCreateDevice( D3D_FEATURE_LEVEL_11_0, windowed, width, height );
 
-    DXUTMainLoop(); // Enter into the DXUT render loop	
+#if FFX_ANTILAG2_TRACE
+    // Built with -DANTILAG2_TRACE=ON: record the Anti-Lag 2.0 calls for chrome://tracing or ui.perfetto.dev
+    AMD::AntiLag2::Trace::Tracer::Get().SetThreadName( "Main thread" );
+    AMD::AntiLag2::Trace::Tracer::Get().Start( "antilag2_trace.json" );
+#endif
+
+    // Enter into the DXUT render loop
+    if ( g_Pipelined )
+    {
+        DXUTMainLoopPipelined( nullptr, g_PipelinedQueuedFrames );
+    }
+    else
+    {
+        DXUTMainLoop();
+    }
+
+#if FFX_ANTILAG2_TRACE
+    AMD::AntiLag2::Trace::Tracer::Get().Stop();
+#endif
+
+    AMD::AntiLag2DX11::SetRecorder( &g_AntiLagContext, nullptr );
+    g_AntiLagRecorder.Stop();
+    AMD::AntiLag2DX11::SetSharedTelemetry( &g_AntiLagContext, nullptr );
+    g_AntiLagSharedTelemetry.Close();
 
     return DXUTGetExitCode();
 }
+//--------------------------------------------------------------------------------------
+// Adds the controls of the HUD to g_HUD or g_HUDView
+//--------------------------------------------------------------------------------------
+void AddHUDControls( CDXUTDialog& hud )
+{
+    int iY = 10;
+    hud.AddButton( IDC_TOGGLEFULLSCREEN, L"Toggle full screen", 260, iY, 150, 22 );
+    hud.AddButton( IDC_CHANGEDEVICE, L"Change device (F2)", 260, iY += 24, 150, 22, VK_F2 );
+
+    hud.AddCheckBox( IDC_ANTILAG_ENABLED, L"Toggle Anti-Lag 2.0", 5, iY += 24, 250, 22, g_AntiLagEnabled );
+    hud.AddCheckBox( IDC_ANTILAG_LIMITER_ENABLED, L"Anti-Lag 2.0 Framerate Limiter", 5, iY += 24, 250, 22, g_AntiLagLimiterEnabled );
+    hud.AddSlider( IDC_ANTILAG_LIMITER_SLIDER, 5, iY += 24, 250, 22, 0, g_AntiLagLimiterSliderAuto, g_AntiLagLimiterValue );
+    hud.AddStatic( IDC_ANTILAG_LIMITER_TEXT, L"", 265, iY, 50, 22 );
+    hud.AddStatic( IDC_ANTILAG_HELPTEXT, g_AntiLagTestingMode ? gHelpText1 : gHelpText0, 5, iY += 24, 250, 22 );
+}
+
+
 //--------------------------------------------------------------------------------------
 // Initialize the app 
 //--------------------------------------------------------------------------------------
@@ -266,22 +387,122 @@ void InitApp()
     g_SampleUI.Init( &g_DialogResourceManager );
     g_SampleUI.GetFont( 0 );
 
-    g_HUD.SetCallback( OnGUIEvent ); int iY = 10;
-    g_HUD.AddButton( IDC_TOGGLEFULLSCREEN, L"Toggle full screen", 260, iY, 150, 22 );
-    g_HUD.AddButton( IDC_CHANGEDEVICE, L"Change device (F2)", 260, iY += 24, 150, 22, VK_F2 );
+    g_HUD.SetCallback( OnGUIEvent );
+    AddHUDControls( g_HUD );
+    g_AntiLagEnabledCheckBox = g_HUD.GetCheckBox( IDC_ANTILAG_ENABLED );
+    g_AntiLagLimiterCheckBox = g_HUD.GetCheckBox( IDC_ANTILAG_LIMITER_ENABLED );
+    g_AntiLagLimiterSlider = g_HUD.GetSlider( IDC_ANTILAG_LIMITER_SLIDER );
+    g_AntiLagLimiterText = g_HUD.GetStatic( IDC_ANTILAG_LIMITER_TEXT );
 
-    g_HUD.AddCheckBox( IDC_ANTILAG_ENABLED, L"Toggle Anti-Lag 2.0", 5, iY += 24, 250, 22, g_AntiLagEnabled, 0, false, &g_AntiLagEnabledCheckBox );
-    g_HUD.AddCheckBox( IDC_ANTILAG_LIMITER_ENABLED, L"Anti-Lag 2.0 Framerate Limiter", 5, iY += 24, 250, 22, g_AntiLagLimiterEnabled, 0, false, &g_AntiLagLimiterCheckBox );
-    g_HUD.AddSlider( IDC_ANTILAG_LIMITER_SLIDER, 5, iY += 24, 250, 22, 0, 251, g_AntiLagLimiterValue, false, &g_AntiLagLimiterSlider );
-    g_HUD.AddStatic( IDC_ANTILAG_LIMITER_TEXT, L"", 265, iY, 50, 22, false, &g_AntiLagLimiterText );
-    g_HUD.AddStatic( IDC_ANTILAG_HELPTEXT, g_AntiLagTestingMode ? gHelpText1 : gHelpText0, 5, iY += 24, 250, 22 );
+    // Gets no messages: the render thread of the pipelined loop draws it with the state in the frame packet
+    g_HUDView.Init( &g_DialogResourceManager, false );
+    AddHUDControls( g_HUDView );
 
     g_SampleUI.SetCallback( OnGUIEvent );
 }
 
 
+//--------------------------------------------------------------------------------------
+// Copies what the HUD shows into the packet, on the main thread, which handles the messages to g_HUD
+//--------------------------------------------------------------------------------------
+void CopyHUDState( FramePacket* packet )
+{
+    for ( int id = IDC_TOGGLEFULLSCREEN; id <= IDC_ANTILAG_HELPTEXT; ++id )
+    {
+        const CDXUTControl* control = g_HUD.GetControl( id );
+        HUDControlState& state = packet->hud[ id - 1 ];
+        state.enabled = control->GetEnabled();
+        switch ( control->GetType() )
+        {
+            case DXUT_CONTROL_CHECKBOX:
+                state.checked = static_cast<const CDXUTCheckBox*>( control )->GetChecked();
+                break;
+            case DXUT_CONTROL_SLIDER:
+                state.value = static_cast<const CDXUTSlider*>( control )->GetValue();
+                break;
+            case DXUT_CONTROL_STATIC:
+                wcscpy_s( state.text, _countof( state.text ), static_cast<const CDXUTStatic*>( control )->GetText() );
+                break;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Sets the controls of g_HUDView to what the HUD showed when the frame was moved
+//--------------------------------------------------------------------------------------
+void ApplyHUDState( const FramePacket* packet )
+{
+    for ( int id = IDC_TOGGLEFULLSCREEN; id <= IDC_ANTILAG_HELPTEXT; ++id )
+    {
+        CDXUTControl* control = g_HUDView.GetControl( id );
+        const HUDControlState& state = packet->hud[ id - 1 ];
+        control->SetEnabled( state.enabled );
+        switch ( control->GetType() )
+        {
+            case DXUT_CONTROL_CHECKBOX:
+                static_cast<CDXUTCheckBox*>( control )->SetChecked( state.checked );
+                break;
+            case DXUT_CONTROL_SLIDER:
+                static_cast<CDXUTSlider*>( control )->SetValue( state.value );
+                break;
+            case DXUT_CONTROL_STATIC:
+                static_cast<CDXUTStatic*>( control )->SetText( state.text );
+                break;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Finishes the Anti-Lag 2.0 initialization once the driver has been looked for on the background thread. This runs on
+// the main thread while the pipelined loop renders: the render thread only uses the context for the frames moved after
+// antiLagAvailable was set in their packet, and draws the HUD from the packet rather than from g_HUD.
+//--------------------------------------------------------------------------------------
+void PollAntiLagInitialization()
+{
+    const HRESULT hr = AMD::AntiLag2DX11::InitializeAsync( &g_AntiLagContext, &g_AntiLagProbe );
+    if ( hr == E_PENDING )
+    {
+        return;
+    }
+    g_AntiLagInitializing = false;
+
+    if ( hr == S_OK )
+    {
+        g_AntiLagAvailable = true;
+        g_AntiLagEnabled = true;
+    }
+    else if ( AMD::AntiLag2DX11::InitializeSoftware( &g_AntiLagContext ) == S_OK )
+    {
+        // No driver support - fall back to the CPU-only implementation
+        g_AntiLagAvailable = true;
+        g_AntiLagSoftware = true;
+        g_AntiLagEnabled = true;
+    }
+
+    if ( g_AntiLagAvailable && g_AntiLagRecorder.IsActive() )
+    {
+        AMD::AntiLag2DX11::SetRecorder( &g_AntiLagContext, &g_AntiLagRecorder );
+    }
+    if ( g_AntiLagAvailable && g_AntiLagSharedTelemetry.IsOpen() )
+    {
+        AMD::AntiLag2DX11::SetSharedTelemetry( &g_AntiLagContext, &g_AntiLagSharedTelemetry );
+    }
+
+    g_AntiLagEnabledCheckBox->SetEnabled( g_AntiLagAvailable );
+    g_AntiLagEnabledCheckBox->SetChecked( g_AntiLagEnabled );
+
+    g_AntiLagLimiterCheckBox->SetEnabled( g_AntiLagAvailable && g_AntiLagEnabled );
+}
+
+
 void CALLBACK PreMessagePump( void* pUserContext )
 {
+    if ( g_AntiLagInitializing )
+    {
+        PollAntiLagInitialization();
+    }
     if ( g_AntiLagAvailable )
     {
         AMD::AntiLag2DX11::Update( &g_AntiLagContext, g_AntiLagEnabled, g_AntiLagLimiterValue );
@@ -308,6 +529,21 @@ void CALLBACK OnFrameMove( double fTime, float fElapsedTime, void* pUserContext
 
      // Update the camera's position based on user input 
     g_Camera.FrameMove( fElapsedTime );
+
+    // Update ran on this thread right before the frame was moved
+    FramePacket* packet = &g_FramePackets[ g_FramePacketCount++ % _countof( g_FramePackets ) ];
+    packet->viewProjection = g_Camera.GetViewMatrix() * g_SingleCameraProjM;
+    packet->frameIndex = AMD::AntiLag2DX11::GetFrameIndex( &g_AntiLagContext );
+    packet->antiLagAvailable = g_AntiLagAvailable;
+    packet->antiLagSoftware = g_AntiLagSoftware;
+    packet->delayStatsValid = AMD::AntiLag2DX11::GetLatencyStats( &g_AntiLagContext, AMD::AntiLag2::TelemetryInterval::Delay, &packet->delayStats ) == S_OK;
+    packet->limiterValue = g_AntiLagLimiterValue;
+    packet->adaptiveMaxFPS = AMD::AntiLag2DX11::GetAdaptiveMaxFPS( &g_AntiLagContext );
+    packet->driverDataVersion = AMD::AntiLag2DX11::GetDriverDataVersion( &g_AntiLagContext );
+    wcscpy_s( packet->frameStats, _countof( packet->frameStats ), DXUTGetFrameStats( DXUTIsVsyncEnabled() ) );
+    wcscpy_s( packet->deviceStats, _countof( packet->deviceStats ), DXUTGetDeviceStats() );
+    CopyHUDState( packet );
+    DXUTSetFramePacket( packet );
 }
 //--------------------------------------------------------------------------------------
 // Handle messages to the application
@@ -353,11 +589,34 @@ void CALLBACK KeyboardProc( UINT nChar, bool bKeyDown, bool bAltDown, void* pUse
 }
 
 
+//--------------------------------------------------------------------------------------
+// Signals the type of a synthetic frame generation frame and measures the time since the previous present
+//--------------------------------------------------------------------------------------
+void SignalSyntheticPresent( bool interpolated, const FramePacket* packet )
+{
+    if ( packet->antiLagAvailable )
+    {
+        AMD::AntiLag2DX11::SetFrameGenFrameType( &g_AntiLagContext, interpolated, packet->frameIndex );
+    }
+
+    const AMD::AntiLag2::Timestamp now = AMD::AntiLag2::GetTimestamp();
+    if ( g_SyntheticLastPresent )
+    {
+        g_SyntheticPresentIntervals[ g_SyntheticPresentCount++ % _countof( g_SyntheticPresentIntervals ) ] = ( now - g_SyntheticLastPresent ) / 1e6f;
+    }
+    g_SyntheticLastPresent = now;
+}
+
+
 void UpdateSlider()
 {
     g_AntiLagLimiterValue = MapLimiterSliderToFPS( g_AntiLagLimiterSlider->GetValue() );
 
-    if ( g_AntiLagLimiterValue > 0 )
+    if ( g_AntiLagLimiterValue == (int)AMD::AntiLag2::kMaxFPSAdaptive )
+    {
+        g_AntiLagLimiterText->SetText( L"Auto" );
+    }
+    else if ( g_AntiLagLimiterValue > 0 )
     {
         wchar_t valueString[64] = {};
         swprintf_s( valueString, _countof( valueString ), L"%d fps", g_AntiLagLimiterValue );
@@ -482,17 +741,13 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFA
     g_Camera.SetRotateButtons(true, false, false);
     g_Camera.SetEnableYAxisMovement( false );
 
-    if ( AMD::AntiLag2DX11::Initialize( &g_AntiLagContext ) == S_OK )
-    {
-        g_AntiLagAvailable = true;
-        g_AntiLagEnabled = true;
-    }
-
-    g_AntiLagEnabledCheckBox->SetEnabled( g_AntiLagAvailable );
-    g_AntiLagEnabledCheckBox->SetChecked( g_AntiLagEnabled );
-
-    g_AntiLagLimiterCheckBox->SetEnabled( g_AntiLagAvailable && g_AntiLagEnabled );
+    // Look for the driver on a background thread rather than holding up the device creation.
+    // The controls are enabled by PollAntiLagInitialization once Anti-Lag 2.0 is ready.
+    g_AntiLagInitializing = true;
+    g_AntiLagEnabledCheckBox->SetEnabled( false );
+    g_AntiLagLimiterCheckBox->SetEnabled( false );
     g_AntiLagLimiterSlider->SetEnabled( false );
+    PollAntiLagInitialization();
 
     return S_OK;
 }
@@ -515,6 +770,18 @@ HRESULT CALLBACK OnD3D11SwapChainResized( ID3D11Device* pd3dDevice, IDXGISwapCha
     V_RETURN( g_DialogResourceManager.OnD3D11ResizedSwapChain( pd3dDevice, pBackBufferSurfaceDesc ) );
     V_RETURN( g_D3DSettingsDlg.OnD3D11ResizedSwapChain( pd3dDevice, pBackBufferSurfaceDesc ) );
 
+    if ( g_SyntheticFrameGen )
+    {
+        ID3D11Texture2D* pBackBuffer = nullptr;
+        V_RETURN( pSwapChain->GetBuffer( 0, __uuidof( ID3D11Texture2D ), (void**)&pBackBuffer ) );
+        D3D11_TEXTURE2D_DESC desc = {};
+        pBackBuffer->GetDesc( &desc );
+        desc.BindFlags = 0;
+        SAFE_RELEASE( pBackBuffer );
+        V_RETURN( pd3dDevice->CreateTexture2D( &desc, nullptr, &g_pSyntheticFrame ) );
+        g_SyntheticFrameValid = false;
+    }
+
     float YFOV = DirectX::XM_PI/4.0f;
 
     float fAspectRatio = pBackBufferSurfaceDesc->Width / ( FLOAT )pBackBufferSurfaceDesc->Height;
@@ -524,6 +791,8 @@ HRESULT CALLBACK OnD3D11SwapChainResized( ID3D11Device* pd3dDevice, IDXGISwapCha
     // Locate the HUD and UI based on the area of main display.
     g_HUD.SetLocation( g_MainDisplayRect.right - 500, g_MainDisplayRect.top );
     g_HUD.SetSize( 500, 170 );
+    g_HUDView.SetLocation( g_MainDisplayRect.right - 500, g_MainDisplayRect.top );
+    g_HUDView.SetSize( 500, 170 );
     g_SampleUI.SetLocation( g_MainDisplayRect.right - 170, g_MainDisplayRect.top + 300 );
     g_SampleUI.SetSize( 170, 170 );
 
@@ -571,8 +840,30 @@ void CALLBACK RenderScene( ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dIm
 //--------------------------------------------------------------------------------------
 void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext, double fTime, float fElapsedTime, void* pUserContext )
 {
-    // Clear the render target
+    // With the pipelined loop the main thread already moved on to the next frame. There is no packet for a paint before the
+    // first frame was moved.
+    const FramePacket* packet = (const FramePacket*)DXUTGetFramePacket();
+    if ( !packet )
+    {
+        return;
+    }
+
     ID3D11RenderTargetView* pRTV = DXUTGetD3D11RenderTargetView();
+    ID3D11Resource* pBackBuffer = nullptr;
+    pRTV->GetResource( &pBackBuffer );
+
+    // Present the interpolated frame of the synthetic frame generation pair ahead of the real one
+    if ( g_SyntheticFrameGen && g_pSyntheticFrame && g_SyntheticFrameValid )
+    {
+        pd3dImmediateContext->CopyResource( pBackBuffer, g_pSyntheticFrame );
+        SignalSyntheticPresent( true, packet );
+
+        // With the same sync interval and flags DXUT presents the real frame with
+        const DXUTDeviceSettings deviceSettings = DXUTGetDeviceSettings();
+        DXUTGetDXGISwapChain()->Present( deviceSettings.d3d11.SyncInterval, deviceSettings.d3d11.PresentFlags );
+    }
+
+    // Clear the render target
     float ClearColor[4] = { 0.369f, 0.369f, 0.369f, 0.0f };
     pd3dImmediateContext->ClearRenderTargetView( pRTV, ClearColor );
     ID3D11DepthStencilView* pDSV = DXUTGetD3D11DepthStencilView();
@@ -582,31 +873,100 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
     if( g_D3DSettingsDlg.IsActive() )
     {
         g_D3DSettingsDlg.OnRender( fElapsedTime );
+        SAFE_RELEASE( pBackBuffer );
         return;
     }
 
     D3D11_VIEWPORT Viewport;
     DirectX::XMMATRIX ViewM, VPM;
 
-    VPM = g_Camera.GetViewMatrix() * g_SingleCameraProjM;
+    VPM = packet->viewProjection;
     RenderScene(pd3dDevice, pd3dImmediateContext, VPM);
 
     DXUT_BeginPerfEvent( DXUT_PERFEVENTCOLOR, L"HUD / Stats" );
-    RenderText();
+    RenderText( packet );
     g_SampleUI.OnRender( fElapsedTime );
-    g_HUD.OnRender( fElapsedTime );
+    if ( g_Pipelined )
+    {
+        // The main thread handles the messages to g_HUD meanwhile
+        ApplyHUDState( packet );
+        g_HUDView.OnRender( fElapsedTime );
+    }
+    else
+    {
+        g_HUD.OnRender( fElapsedTime );
+    }
     DXUT_EndPerfEvent();
+
+    // The real frame is presented by DXUT right after this function returns
+    if ( g_SyntheticFrameGen && g_pSyntheticFrame )
+    {
+        pd3dImmediateContext->CopyResource( g_pSyntheticFrame, pBackBuffer );
+        g_SyntheticFrameValid = true;
+        if ( packet->antiLagAvailable )
+        {
+            AMD::AntiLag2DX11::MarkEndOfFrameRendering( &g_AntiLagContext, packet->frameIndex );
+        }
+        SignalSyntheticPresent( false, packet );
+    }
+    else if ( g_Pipelined && packet->antiLagAvailable )
+    {
+        // The frame index ties the end of the render thread's frame to the input it was moved with
+        AMD::AntiLag2DX11::MarkEndOfFrameRendering( &g_AntiLagContext, packet->frameIndex );
+    }
+    SAFE_RELEASE( pBackBuffer );
 }
 //--------------------------------------------------------------------------------------
 // Render the help and statistics text
 //--------------------------------------------------------------------------------------
-void RenderText()
+void RenderText( const FramePacket* packet )
 {
     g_pTxtHelper->Begin();
     g_pTxtHelper->SetInsertionPos( g_MainDisplayRect.left, g_MainDisplayRect.top );
     g_pTxtHelper->SetForegroundColor( DirectX::XMVectorSet( 1.0f, 1.0f, 0.0f, 1.0f ) );
-    g_pTxtHelper->DrawTextLine( DXUTGetFrameStats( DXUTIsVsyncEnabled() ) );
-    g_pTxtHelper->DrawTextLine( DXUTGetDeviceStats() );
+    g_pTxtHelper->DrawTextLine( packet->frameStats );
+    g_pTxtHelper->DrawTextLine( packet->deviceStats );
+    if ( packet->antiLagSoftware )
+    {
+        g_pTxtHelper->DrawTextLine( L"Anti-Lag 2.0: software implementation" );
+    }
+    if ( packet->delayStatsValid )
+    {
+        const AMD::AntiLag2::LatencyStats& delayStats = packet->delayStats;
+        wchar_t statsString[ 128 ] = {};
+        swprintf_s( statsString, _countof( statsString ), L"Anti-Lag 2.0 delay: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms",
+                    delayStats.p50 / 1e6, delayStats.p95 / 1e6, delayStats.p99 / 1e6 );
+        g_pTxtHelper->DrawTextLine( statsString );
+    }
+    if ( packet->limiterValue == (int)AMD::AntiLag2::kMaxFPSAdaptive )
+    {
+        const unsigned int adaptiveMaxFPS = packet->adaptiveMaxFPS;
+        wchar_t limitString[ 64 ] = {};
+        if ( adaptiveMaxFPS )
+        {
+            swprintf_s( limitString, _countof( limitString ), L"Anti-Lag 2.0 adaptive limit: %u fps", adaptiveMaxFPS );
+        }
+        else
+        {
+            swprintf_s( limitString, _countof( limitString ), L"Anti-Lag 2.0 adaptive limit: measuring" );
+        }
+        g_pTxtHelper->DrawTextLine( limitString );
+    }
+    if ( g_SyntheticFrameGen )
+    {
+        const unsigned int count = std::min( g_SyntheticPresentCount, (unsigned int)_countof( g_SyntheticPresentIntervals ) );
+        float minInterval = 0.0f;
+        float maxInterval = 0.0f;
+        for ( unsigned int i = 0; i < count; ++i )
+        {
+            minInterval = i ? std::min( minInterval, g_SyntheticPresentIntervals[ i ] ) : g_SyntheticPresentIntervals[ i ];
+            maxInterval = std::max( maxInterval, g_SyntheticPresentIntervals[ i ] );
+        }
+        wchar_t pacingString[ 128 ] = {};
+        swprintf_s( pacingString, _countof( pacingString ), L"Synthetic frame generation: present interval min %.2f ms, max %.2f ms, driver structures v%u",
+                    minInterval, maxInterval, packet->driverDataVersion );
+        g_pTxtHelper->DrawTextLine( pacingString );
+    }
     g_pTxtHelper->End();
 }
 //--------------------------------------------------------------------------------------
@@ -615,16 +975,27 @@ void RenderText()
 void CALLBACK OnD3D11ReleasingSwapChain( void* pUserContext )
 {
     g_DialogResourceManager.OnD3D11ReleasingSwapChain();
+    SAFE_RELEASE( g_pSyntheticFrame );
 }
 //--------------------------------------------------------------------------------------
 // Release D3D11 resources created in OnD3D11CreateDevice 
 //--------------------------------------------------------------------------------------
 void CALLBACK OnD3D11DestroyDevice( void* pUserContext )
 {
+    g_AntiLagProbe.Cancel();
     AMD::AntiLag2DX11::DeInitialize( &g_AntiLagContext );
+    g_AntiLagInitializing = false;
     g_AntiLagAvailable = false;
+    g_AntiLagSoftware = false;
     g_AntiLagEnabled = false;
 
+    // The device changes while the render thread waits, so a frame still queued cannot use the context once it is
+    // initialized again for the next device
+    for ( FramePacket& packet : g_FramePackets )
+    {
+        packet.antiLagAvailable = false;
+    }
+
     g_DialogResourceManager.OnD3D11DestroyDevice();
     g_D3DSettingsDlg.OnD3D11DestroyDevice();
     CDXUTDirectionWidget::StaticOnD3D11DestroyDevice();
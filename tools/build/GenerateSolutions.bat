@@ -0,0 +1,4 @@
+mkdir VS2022
+cd VS2022
+cmake ..\.. -G "Visual Studio 17 2022" -A x64
+cd ..
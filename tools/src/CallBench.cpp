@@ -0,0 +1,476 @@
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: CallBench.cpp
+//
+// Measures the CPU cost of the SDK's own code in every public entry point. The driver
+// backend runs against a mock of the driver interface that only counts the calls, so
+// what is left is the front end, the packets it builds and the virtual call. Reports
+// ns/call and, where the OS exposes them, instructions, branch misses and cache misses.
+//--------------------------------------------------------------------------------------
+
+#include "DriverHeaders.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace AMD;
+using namespace AMD::AntiLag2;
+
+typedef Driver::Api                         DriverApi;
+typedef Driver::Data_v1                     DriverData_v1;
+typedef Driver::Data_v2                     DriverData_v2;
+typedef Driver::FrontEnd                    DriverContext;
+
+//--------------------------------------------------------------------------------------
+// Mock of the driver interface. Counts the calls and checks the packet headers.
+//--------------------------------------------------------------------------------------
+class CountingAntiLagApi : public DriverApi
+{
+public:
+    virtual HRESULT STDMETHODCALLTYPE QueryInterface( REFIID, void** ppvObject ) override
+    {
+        *ppvObject = nullptr;
+        return E_NOINTERFACE;
+    }
+    virtual ULONG STDMETHODCALLTYPE AddRef() override   { return ++m_refCount; }
+    virtual ULONG STDMETHODCALLTYPE Release() override  { return --m_refCount; }
+
+    virtual HRESULT UpdateAntiLagState( void* pData ) override
+    {
+        ++m_calls;
+        if ( pData == nullptr )
+        {
+            return S_OK;
+        }
+        const DriverData_v1* pHeader = static_cast<const DriverData_v1*>( pData );
+        if ( pHeader->uiVersion == 2 && pHeader->uiSize == sizeof(DriverData_v2) )
+        {
+            return S_OK;
+        }
+        return pHeader->uiVersion == 1 && pHeader->uiSize == sizeof(DriverData_v1) ? S_OK : E_INVALIDARG;
+    }
+
+    std::uint64_t GetCalls() const                          { return m_calls; }
+
+private:
+    unsigned int    m_refCount = 1;
+    std::uint64_t   m_calls = 0;
+};
+
+//--------------------------------------------------------------------------------------
+// Hardware counters of the calling thread, user mode only
+//--------------------------------------------------------------------------------------
+enum Counter
+{
+    kInstructions,
+    kBranchMisses,
+    kCacheMisses,
+    kCounterCount
+};
+
+class HardwareCounters
+{
+public:
+#if defined(__linux__)
+    HardwareCounters()
+    {
+        const std::uint64_t configs[ kCounterCount ] = { PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES };
+        for ( int i = 0; i < kCounterCount; ++i )
+        {
+            perf_event_attr attr = {};
+            attr.size = sizeof( attr );
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[ i ];
+            attr.disabled = i == 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            m_fds[ i ] = (int)syscall( __NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : m_fds[ 0 ], 0 );
+            if ( m_fds[ i ] < 0 )
+            {
+                Close();
+                return;
+            }
+        }
+    }
+
+    ~HardwareCounters()                                     { Close(); }
+
+    bool IsAvailable() const                                { return m_fds[ 0 ] >= 0; }
+
+    void Start()
+    {
+        if ( IsAvailable() )
+        {
+            ioctl( m_fds[ 0 ], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+            ioctl( m_fds[ 0 ], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+        }
+    }
+
+    void Stop( std::uint64_t values[ kCounterCount ] )
+    {
+        std::uint64_t group[ 1 + kCounterCount ] = {};
+        if ( IsAvailable() )
+        {
+            ioctl( m_fds[ 0 ], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP );
+            if ( read( m_fds[ 0 ], group, sizeof( group ) ) != (ssize_t)sizeof( group ) )
+            {
+                group[ 0 ] = 0;
+            }
+        }
+        for ( int i = 0; i < kCounterCount; ++i )
+        {
+            values[ i ] = group[ 0 ] == kCounterCount ? group[ 1 + i ] : 0;
+        }
+    }
+
+private:
+    void Close()
+    {
+        for ( int& fd : m_fds )
+        {
+            if ( fd >= 0 )
+            {
+                close( fd );
+            }
+            fd = -1;
+        }
+    }
+
+    int m_fds[ kCounterCount ] = { -1, -1, -1 };
+#else
+    // Reading the counters needs a kernel-mode driver or ETW on Windows; only the time is measured there.
+    bool IsAvailable() const                                { return false; }
+    void Start()                                            {}
+    void Stop( std::uint64_t values[ kCounterCount ] )      { std::fill( values, values + kCounterCount, 0 ); }
+#endif
+};
+
+//--------------------------------------------------------------------------------------
+// Benchmark cases
+//--------------------------------------------------------------------------------------
+enum class BackendKind
+{
+    Null,
+    Software,
+    Driver,
+};
+
+static const char* BackendName( BackendKind backend )
+{
+    switch ( backend )
+    {
+        case BackendKind::Null:     return "null";
+        case BackendKind::Software: return "software";
+        case BackendKind::Driver:   return "driver";
+    }
+    return "";
+}
+
+enum class Case
+{
+    Frame,              // Update, MarkEndOfFrameRendering and SetFrameGenFrameType: what a game pays per frame
+    Update,             // settings unchanged, as in a game
+    UpdateStateChange,  // enabled and disabled on alternate calls, so the settings are passed to the backend every time
+    UpdateAdaptive,     // maxFPS = kMaxFPSAdaptive
+    SetStateUpdate,     // SetState followed by Update()
+    SetState,
+    MarkEndOfFrame,
+    SetFrameGenFrameType,
+    GetFrameIndex,
+    GetFrameRecord,
+    GetLatencyStats,
+    Count
+};
+
+static const char* CaseName( Case c )
+{
+    switch ( c )
+    {
+        case Case::Frame:                return "frame";
+        case Case::Update:               return "Update";
+        case Case::UpdateStateChange:    return "Update(state change)";
+        case Case::UpdateAdaptive:       return "Update(adaptive)";
+        case Case::SetStateUpdate:       return "SetState+Update()";
+        case Case::SetState:             return "SetState";
+        case Case::MarkEndOfFrame:       return "MarkEndOfFrameRendering";
+        case Case::SetFrameGenFrameType: return "SetFrameGenFrameType";
+        case Case::GetFrameIndex:        return "GetFrameIndex";
+        case Case::GetFrameRecord:       return "GetFrameRecord";
+        case Case::GetLatencyStats:      return "GetLatencyStats";
+        case Case::Count:                break;
+    }
+    return "";
+}
+
+// The telemetry queries are much slower than the rest, they run fewer iterations.
+static unsigned int CaseIterationDivisor( Case c )
+{
+    return c == Case::GetLatencyStats ? 64 : 1;
+}
+
+// Keeps the results alive so that the calls are not optimized away.
+static volatile std::uint64_t g_sink;
+
+template<class ContextType>
+static std::uint64_t RunCase( ContextType& context, Case c, std::uint64_t iterations )
+{
+    std::uint64_t sink = 0;
+    for ( std::uint64_t i = 0; i < iterations; ++i )
+    {
+        switch ( c )
+        {
+            case Case::Frame:
+                sink += (std::uint64_t)context.Update( true, 0 );
+                sink += (std::uint64_t)context.MarkEndOfFrameRendering();
+                sink += (std::uint64_t)context.SetFrameGenFrameType( false );
+                break;
+            case Case::Update:
+                sink += (std::uint64_t)context.Update( true, 0 );
+                break;
+            case Case::UpdateStateChange:
+                sink += (std::uint64_t)context.Update( ( i & 1 ) != 0, 0 );
+                break;
+            case Case::UpdateAdaptive:
+                sink += (std::uint64_t)context.Update( true, kMaxFPSAdaptive );
+                break;
+            case Case::SetStateUpdate:
+                sink += (std::uint64_t)context.SetState( true, 0 );
+                sink += (std::uint64_t)context.Update();
+                break;
+            case Case::SetState:
+                sink += (std::uint64_t)context.SetState( true, (unsigned int)i & 0xff );
+                break;
+            case Case::MarkEndOfFrame:
+                sink += (std::uint64_t)context.MarkEndOfFrameRendering();
+                break;
+            case Case::SetFrameGenFrameType:
+                sink += (std::uint64_t)context.SetFrameGenFrameType( ( i & 1 ) != 0 );
+                break;
+            case Case::GetFrameIndex:
+                sink += context.GetFrameIndex();
+                break;
+            case Case::GetFrameRecord:
+            {
+                FrameRecord record = {};
+                sink += (std::uint64_t)context.GetFrameRecord( (unsigned int)i & 63, &record ) + record.frameIndex;
+                break;
+            }
+            case Case::GetLatencyStats:
+            {
+                LatencyStats stats;
+                sink += (std::uint64_t)context.GetLatencyStats( TelemetryInterval::FrameTime, &stats ) + stats.p50;
+                break;
+            }
+            case Case::Count:
+                break;
+        }
+    }
+    return sink;
+}
+
+struct Result
+{
+    double  medianNs = 0.0;
+    double  minNs = 0.0;
+    double  driverCalls = 0.0;                  // driver interface calls per iteration
+    double  perCall[ kCounterCount ] = {};      // hardware counters per iteration
+};
+
+template<class ContextType>
+static Result Measure( ContextType& context, CountingAntiLagApi* api, Case c, std::uint64_t iterations, unsigned int repeats,
+                       HardwareCounters& counters )
+{
+    iterations = std::max<std::uint64_t>( iterations / CaseIterationDivisor( c ), 1 );
+
+    // Fill the telemetry ring and warm up the caches and branch predictors.
+    g_sink = g_sink + RunCase( context, Case::Frame, FrameTelemetry::kCapacity );
+    g_sink = g_sink + RunCase( context, c, iterations / 10 + 1 );
+
+    std::vector<double> ns;
+    std::uint64_t totals[ kCounterCount ] = {};
+    const std::uint64_t driverCallsBefore = api ? api->GetCalls() : 0;
+    for ( unsigned int r = 0; r < repeats; ++r )
+    {
+        std::uint64_t values[ kCounterCount ];
+        counters.Start();
+        const Timestamp start = GetTimestamp();
+        g_sink = g_sink + RunCase( context, c, iterations );
+        const Timestamp end = GetTimestamp();
+        counters.Stop( values );
+
+        ns.push_back( (double)( end - start ) / iterations );
+        for ( int i = 0; i < kCounterCount; ++i )
+        {
+            totals[ i ] += values[ i ];
+        }
+    }
+    std::sort( ns.begin(), ns.end() );
+
+    Result result;
+    result.medianNs = ns[ ns.size() / 2 ];
+    result.minNs = ns.front();
+    result.driverCalls = api ? (double)( api->GetCalls() - driverCallsBefore ) / ( iterations * repeats ) : 0.0;
+    for ( int i = 0; i < kCounterCount; ++i )
+    {
+        result.perCall[ i ] = (double)totals[ i ] / ( iterations * repeats );
+    }
+    return result;
+}
+
+static void PrintHeader( bool haveCounters )
+{
+    printf( "%-9s %-24s | %9s %9s | %6s |", "backend", "call", "median", "min", "driver" );
+    printf( haveCounters ? " %8s %10s %10s\n" : "\n", "instr", "br-miss", "cache-miss" );
+    printf( "%-9s %-24s | %9s %9s | %6s |", "", "", "ns/call", "ns/call", "calls" );
+    printf( haveCounters ? " %8s %10s %10s\n" : "\n", "/call", "/1k calls", "/1k calls" );
+}
+
+static void PrintResult( BackendKind backend, Case c, const Result& result, bool haveCounters )
+{
+    printf( "%-9s %-24s | %9.2f %9.2f | %6.2f |", BackendName( backend ), CaseName( c ), result.medianNs, result.minNs, result.driverCalls );
+    if ( haveCounters )
+    {
+        printf( " %8.1f %10.3f %10.3f", result.perCall[ kInstructions ], result.perCall[ kBranchMisses ] * 1000.0,
+                result.perCall[ kCacheMisses ] * 1000.0 );
+    }
+    printf( "\n" );
+}
+
+template<class ContextType>
+static void RunBackend( BackendKind backend, ContextType& context, CountingAntiLagApi* api, const std::vector<Case>& cases,
+                        std::uint64_t iterations, unsigned int repeats, HardwareCounters& counters )
+{
+    for ( Case c : cases )
+    {
+        // The software backend enforces the adaptive limit itself, which would measure the limit rather than the call.
+        if ( backend == BackendKind::Software && c == Case::UpdateAdaptive )
+        {
+            continue;
+        }
+        PrintResult( backend, c, Measure( context, api, c, iterations, repeats, counters ), counters.IsAvailable() );
+    }
+}
+
+static void PrintUsage()
+{
+    printf( "Usage: CallBench [options]\n"
+            "  --backend null|software|driver   backend to measure (default: all)\n"
+            "  --call NAME                      only the calls whose name contains NAME\n"
+            "  --iterations N                   calls per repeat (default: 200000)\n"
+            "  --repeats N                      repeats, the median is reported (default: 7)\n" );
+}
+
+int main( int argc, char** argv )
+{
+    std::vector<BackendKind> backends = { BackendKind::Null, BackendKind::Software, BackendKind::Driver };
+    std::vector<Case> cases;
+    const char* filter = "";
+    std::uint64_t iterations = 200000;
+    unsigned int repeats = 7;
+
+    for ( int i = 1; i < argc; i += 2 )
+    {
+        const char* arg = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+        if ( !value )
+        {
+            PrintUsage();
+            return 1;
+        }
+        if ( !strcmp( arg, "--backend" ) )
+        {
+            BackendKind backend = !strcmp( value, "null" ) ? BackendKind::Null : !strcmp( value, "software" ) ? BackendKind::Software :
+                                  BackendKind::Driver;
+            backends.assign( 1, backend );
+        }
+        else if ( !strcmp( arg, "--call" ) )         filter = value;
+        else if ( !strcmp( arg, "--iterations" ) )   iterations = std::max( strtoull( value, nullptr, 10 ), 1ull );
+        else if ( !strcmp( arg, "--repeats" ) )      repeats = std::max( (unsigned int)atoi( value ), 1u );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    for ( int c = 0; c < (int)Case::Count; ++c )
+    {
+        if ( strstr( CaseName( (Case)c ), filter ) )
+        {
+            cases.push_back( (Case)c );
+        }
+    }
+
+    HardwareCounters counters;
+    if ( !counters.IsAvailable() )
+    {
+        printf( "Hardware counters are not available, only the time is measured.\n" );
+    }
+    PrintHeader( counters.IsAvailable() );
+
+    for ( BackendKind backend : backends )
+    {
+        // The contexts are too large for the stack.
+        switch ( backend )
+        {
+            case BackendKind::Null:
+            {
+                std::unique_ptr<NullContext> context( new NullContext() );
+                context->Initialize();
+                RunBackend( backend, *context, nullptr, cases, iterations, repeats, counters );
+                break;
+            }
+            case BackendKind::Software:
+            {
+                std::unique_ptr<SoftwareContext> context( new SoftwareContext() );
+                context->Initialize();
+                RunBackend( backend, *context, nullptr, cases, iterations, repeats, counters );
+                context->DeInitialize();
+                break;
+            }
+            case BackendKind::Driver:
+            {
+                CountingAntiLagApi api;
+                std::unique_ptr<DriverContext> context( new DriverContext() );
+                context->Initialize( static_cast<DriverApi*>( &api ) );
+                RunBackend( backend, *context, &api, cases, iterations, repeats, counters );
+                context->DeInitialize();
+                break;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,324 @@
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ContextStress.cpp
+//
+// Hammers one software context from the threads of a multi-threaded engine: UI threads
+// publish settings with SetState, the game thread calls Update, a render thread marks
+// the end of each frame, a present thread reports the present markers, frame types and
+// completed frames, and a reader polls the telemetry. Checks that the settings passed
+// to the backend are never torn and converge to the last ones published, and that the
+// frame indices every thread sees only move forward. Build with -DANTILAG2_TSAN=ON to
+// run it under ThreadSanitizer.
+//--------------------------------------------------------------------------------------
+
+#include "../../ffx_antilag2.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace AMD::AntiLag2;
+
+// The software backend, recording the settings Update passes on. Settings are published with an odd limit when enabled and an
+// even one when disabled, so a torn enable flag and limit show up as a mismatch.
+class CheckedBackend : public SoftwareBackend
+{
+public:
+    HRESULT SetState( bool enabled, unsigned int maxFPS )
+    {
+        if ( enabled != ( ( maxFPS & 1 ) != 0 ) )
+        {
+            m_torn.fetch_add( 1, std::memory_order_relaxed );
+        }
+        m_applied.store( ( enabled ? 0x80000000u : 0u ) | maxFPS, std::memory_order_relaxed );
+        m_changes.fetch_add( 1, std::memory_order_relaxed );
+        return SoftwareBackend::SetState( enabled, maxFPS );
+    }
+
+    unsigned int    GetApplied() const                      { return m_applied.load( std::memory_order_relaxed ); }
+    unsigned int    GetTornCount() const                    { return m_torn.load( std::memory_order_relaxed ); }
+    unsigned int    GetChangeCount() const                  { return m_changes.load( std::memory_order_relaxed ); }
+
+private:
+    std::atomic<unsigned int>   m_applied{ 0 };
+    std::atomic<unsigned int>   m_torn{ 0 };
+    std::atomic<unsigned int>   m_changes{ 0 };
+};
+
+struct Config
+{
+    unsigned int    frames = 5000;          // Update calls of the game thread
+    unsigned int    uiThreads = 2;
+    Timestamp       work = 50 * 1000;       // game thread work per frame
+    std::uint64_t   seed = 1;
+};
+
+// Counts the failed checks of one thread.
+struct Failures
+{
+    std::atomic<unsigned int>   count{ 0 };
+    std::atomic<bool>           reported{ false };
+
+    void Fail( const char* thread, const char* check, std::uint64_t seen, std::uint64_t before )
+    {
+        count.fetch_add( 1, std::memory_order_relaxed );
+        if ( !reported.exchange( true ) )
+        {
+            printf( "%s: %s (%llu after %llu)\n", thread, check, (unsigned long long)seen, (unsigned long long)before );
+        }
+    }
+};
+
+static void Spin( Timestamp duration )
+{
+    const Timestamp end = GetTimestamp() + duration;
+    while ( GetTimestamp() < end )
+    {
+    }
+}
+
+// Settings in the encoding CheckedBackend checks: limits from 1000 to 1999 fps, odd when enabled, and no limit when disabled.
+static void PublishRandom( Context<CheckedBackend>& context, std::uint64_t& random )
+{
+    random ^= random >> 12;
+    random ^= random << 25;
+    random ^= random >> 27;
+    const std::uint64_t value = random * 2685821657736338717ull;
+    const bool enable = ( value >> 32 ) & 1;
+    const bool unlimited = !enable && ( value >> 40 ) % 8 == 0;
+    context.SetState( enable, unlimited ? 0 : 1000 + (unsigned int)( ( value >> 16 ) % 500 ) * 2 + ( enable ? 1 : 0 ) );
+}
+
+static bool Run( const Config& config )
+{
+    Context<CheckedBackend> context;
+    context.Initialize();
+
+    Failures failures;
+    std::atomic<bool> uiDone{ false };
+    std::atomic<bool> stop{ false };
+    std::atomic<std::uint64_t> rendered{ 0 };
+    std::atomic<unsigned int> framesAfterUi{ 0 };
+    const bool finalEnable = true;
+    const unsigned int finalMaxFPS = 1501;
+
+    std::vector<std::thread> ui;
+    for ( unsigned int t = 0; t < config.uiThreads; ++t )
+    {
+        ui.emplace_back( [&, t]()
+        {
+            std::uint64_t random = config.seed * 0x9E3779B97F4A7C15ull + t + 1;
+            while ( context.GetFrameIndex() < config.frames / 2 )
+            {
+                PublishRandom( context, random );
+                std::this_thread::yield();
+            }
+        } );
+    }
+
+    std::thread game( [&]()
+    {
+        std::uint64_t last = context.GetFrameIndex();
+        unsigned int frames = 0;
+        while ( frames < config.frames || framesAfterUi.load( std::memory_order_relaxed ) < 3 )
+        {
+            const bool afterUi = uiDone.load( std::memory_order_acquire );
+            context.Update();
+            const std::uint64_t index = context.GetFrameIndex();
+            if ( index != last + 1 )
+            {
+                failures.Fail( "game", "frame index did not advance by one", index, last );
+            }
+            last = index;
+            ++frames;
+            if ( afterUi )
+            {
+                framesAfterUi.fetch_add( 1, std::memory_order_relaxed );
+            }
+            Spin( config.work );
+        }
+        stop.store( true, std::memory_order_release );
+    } );
+
+    std::thread render( [&]()
+    {
+        std::uint64_t last = 0;
+        while ( !stop.load( std::memory_order_acquire ) )
+        {
+            const std::uint64_t index = context.GetFrameIndex();
+            if ( index < last )
+            {
+                failures.Fail( "render", "frame index went back", index, last );
+            }
+            if ( index > last )
+            {
+                context.SetLatencyMarker( LatencyMarker::RenderSubmitStart, index );
+                context.MarkEndOfFrameRendering( index );
+                rendered.store( index, std::memory_order_release );
+                last = index;
+            }
+            std::this_thread::yield();
+        }
+    } );
+
+    std::thread present( [&]()
+    {
+        std::uint64_t last = 0;
+        while ( !stop.load( std::memory_order_acquire ) )
+        {
+            const std::uint64_t index = rendered.load( std::memory_order_acquire );
+            if ( index < last )
+            {
+                failures.Fail( "present", "frame index went back", index, last );
+            }
+            if ( index > last )
+            {
+                context.SetLatencyMarker( LatencyMarker::PresentStart, index );
+                context.SetFrameGenFrameType( false, index );
+                context.SetLatencyMarker( LatencyMarker::PresentEnd, index );
+                context.MarkFrameComplete( index );
+                last = index;
+            }
+            std::this_thread::yield();
+        }
+    } );
+
+    std::thread reader( [&]()
+    {
+        std::uint64_t last = 0;
+        while ( !stop.load( std::memory_order_acquire ) )
+        {
+            FrameRecord record = {};
+            if ( context.GetFrameRecord( 0, &record ) == S_OK )
+            {
+                const std::uint64_t current = context.GetFrameIndex();
+                if ( record.frameIndex < last || record.frameIndex > current )
+                {
+                    failures.Fail( "reader", "frame record out of order", record.frameIndex, last );
+                }
+                last = record.frameIndex;
+            }
+            LatencyStats stats = {};
+            context.GetLatencyStats( TelemetryInterval::FrameTime, &stats );
+            float latencyFrames = 0.0f;
+            context.GetLatencyInFrames( &latencyFrames );
+            std::this_thread::yield();
+        }
+    } );
+
+    for ( std::thread& thread : ui )
+    {
+        thread.join();
+    }
+    // The last settings published after every UI thread is done are the ones Update has to end up with.
+    context.SetState( finalEnable, finalMaxFPS );
+    uiDone.store( true, std::memory_order_release );
+
+    game.join();
+    render.join();
+    present.join();
+    reader.join();
+
+    const CheckedBackend& backend = context.GetBackend();
+    const unsigned int applied = backend.GetApplied();
+    const unsigned int expected = ( finalEnable ? 0x80000000u : 0u ) | finalMaxFPS;
+    printf( "frames %llu, settings changes %u, torn %u, failed checks %u\n", (unsigned long long)context.GetFrameIndex(),
+            backend.GetChangeCount(), backend.GetTornCount(), failures.count.load() );
+    bool passed = backend.GetTornCount() == 0 && failures.count.load() == 0;
+    if ( applied != expected )
+    {
+        printf( "applied settings %s %u, expected %s %u\n", ( applied & 0x80000000u ) ? "on" : "off", applied & ~0x80000000u,
+                finalEnable ? "on" : "off", finalMaxFPS );
+        passed = false;
+    }
+
+    context.DeInitialize();
+    return passed;
+}
+
+static void PrintUsage()
+{
+    printf( "Usage: ContextStress [options]\n"
+            "  --frames N                 Update calls of the game thread (default: 5000) \n"
+            "  --ui-threads N             threads publishing settings with SetState (default: 2)\n"
+            "  --work US                  game thread work per frame (default: 50)\n"
+            "  --runs N                   runs, each with the next seed (default: 1)\n"
+            "  --seed N                   seed of the first run (default: 1)\n" );
+}
+
+int main( int argc, char** argv )
+{
+    Config config;
+    unsigned int runs = 1;
+    for ( int i = 1; i < argc; ++i )
+    {
+        const char* arg = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : "";
+        if ( !strcmp( arg, "--frames" ) )
+        {
+            config.frames = (unsigned int)atoi( value );
+        }
+        else if ( !strcmp( arg, "--ui-threads" ) )
+        {
+            config.uiThreads = (unsigned int)atoi( value );
+        }
+        else if ( !strcmp( arg, "--work" ) )
+        {
+            config.work = (Timestamp)( atof( value ) * 1000 );
+        }
+        else if ( !strcmp( arg, "--runs" ) )
+        {
+            runs = (unsigned int)atoi( value );
+        }
+        else if ( !strcmp( arg, "--seed" ) )
+        {
+            config.seed = strtoull( value, nullptr, 10 );
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+        ++i;
+    }
+    if ( config.frames == 0 || runs == 0 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    unsigned int failed = 0;
+    for ( unsigned int run = 0; run < runs; ++run, ++config.seed )
+    {
+        if ( !Run( config ) )
+        {
+            ++failed;
+        }
+    }
+    printf( "%s: %u of %u runs failed\n", failed ? "FAILED" : "passed", failed, runs );
+    return failed ? 1 : 0;
+}
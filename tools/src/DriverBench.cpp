@@ -0,0 +1,375 @@
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: DriverBench.cpp
+//
+// Runs the SDK's driver path end to end against tools/bin/MockDriver: the module lookup
+// through AMD::AntiLag2::LibraryLoader, the driver probe and its cache, the interface
+// calls and the packets they carry. Each scenario configures the mock, initializes a
+// DX12 or DX11 context with it and runs a game loop, then compares what the driver saw
+// with what the SDK should have sent. Reports the framerate, the cost of an Update and
+// the packets by type.
+//--------------------------------------------------------------------------------------
+
+#include "MockDriver.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace AMD::AntiLag2;
+
+enum class Api
+{
+    DX12,
+    DX11,
+};
+
+struct Scenario
+{
+    const char*         name;
+    MockDriverSettings  settings;
+    bool                enable;
+    unsigned int        maxFPS;
+    Timestamp           work;               // per frame
+    bool                frameGen;           // every second frame is interpolated
+    bool                clearCache;         // false to reuse the entry point the previous scenario looked up
+};
+
+struct Result
+{
+    HRESULT             initResult = S_OK;
+    unsigned int        dataVersion = 0;    // structure version negotiated with the driver
+    double              fps = 0.0;
+    double              updateNs = 0.0;     // mean time in Update
+    unsigned int        failedCalls = 0;    // calls into the context that returned an error
+    unsigned int        mismatches = 0;     // counters of the driver that differ from the expected ones
+    MockDriverStats     stats;
+};
+
+struct MockDriver
+{
+    PFNMockDriverConfigure  configure = nullptr;
+    PFNMockDriverGetStats   getStats = nullptr;
+};
+
+static void Spin( Timestamp duration )
+{
+    const Timestamp end = GetTimestamp() + duration;
+    while ( GetTimestamp() < end )
+    {
+    }
+}
+
+static std::vector<Scenario> GetScenarios()
+{
+    std::vector<Scenario> scenarios;
+    MockDriverSettings limiter;
+
+    MockDriverSettings software;
+    software.model = MockLatencyModel::Software;
+
+    MockDriverSettings createFails;
+    createFails.createResult = E_FAIL;
+
+    MockDriverSettings callFails;
+    callFails.failEvery = 7;
+
+    MockDriverSettings version1;
+    version1.dx11DataVersion = 1;
+
+    //                      name            settings        enable  maxFPS  work                    frameGen    clearCache
+    scenarios.push_back( { "frames",        limiter,        false,  0,      500 * 1000,             true,       true } );
+    scenarios.push_back( { "version-1",     version1,       false,  0,      500 * 1000,             true,       true } );
+    scenarios.push_back( { "limiter",       limiter,        true,   240,    500 * 1000,             false,      true } );
+    scenarios.push_back( { "software",      software,       true,   0,      2 * kMillisecond,       false,      true } );
+    scenarios.push_back( { "create-fails",  createFails,    true,   0,      0,                      false,      true } );
+    scenarios.push_back( { "create-cached", limiter,        true,   0,      0,                      false,      false } );
+    scenarios.push_back( { "call-fails",    callFails,      true,   0,      0,                      true,       true } );
+    scenarios.push_back( { "overhead",      limiter,        false,  0,      0,                      false,      true } );
+    return scenarios;
+}
+
+template<class ContextType>
+static void RunFrames( ContextType& context, const Scenario& scenario, unsigned int frames, Result* result )
+{
+    Timestamp updateTime = 0;
+    const Timestamp start = GetTimestamp();
+    for ( unsigned int i = 0; i < frames; ++i )
+    {
+        const Timestamp entry = GetTimestamp();
+        result->failedCalls += context.Update( scenario.enable, scenario.maxFPS ) == S_OK ? 0 : 1;
+        updateTime += GetTimestamp() - entry;
+
+        Spin( scenario.work );
+
+        result->failedCalls += context.MarkEndOfFrameRendering() == S_OK ? 0 : 1;
+        if ( scenario.frameGen )
+        {
+            result->failedCalls += context.SetFrameGenFrameType( ( i & 1 ) != 0 ) == S_OK ? 0 : 1;
+        }
+    }
+    const Timestamp elapsed = GetTimestamp() - start;
+    result->fps = (double)frames * kSecond / elapsed;
+    result->updateNs = (double)updateTime / frames;
+}
+
+static unsigned int Check( unsigned long long actual, unsigned long long expected )
+{
+    return actual == expected ? 0 : 1;
+}
+
+static Result Run( const MockDriver& driver, Api api, const Scenario& scenario, unsigned int frames, const char* recordPath )
+{
+    MockDriverSettings settings = scenario.settings;
+    settings.recordPath = recordPath;
+    driver.configure( &settings );
+    if ( scenario.clearCache )
+    {
+        DriverProbeCacheBase::Clear();
+    }
+
+    // The mock does not look at the device.
+    int device = 0;
+    Result result;
+    if ( api == Api::DX12 )
+    {
+        // Like a game that uses the frame indices, opt in to the input sample signal. The version-1 scenario runs DX12 without it,
+        // with the packets of an SDK that predates the frame indices.
+        std::unique_ptr<Driver::Context> context( new Driver::Context() );
+        result.initResult = Driver::Initialize<LibraryLoader>( context.get(), &device );
+        if ( result.initResult == S_OK )
+        {
+            AMD::AntiLag2DX12::SetInputSampleSignal( context.get(), scenario.settings.dx11DataVersion >= 2 );
+            result.dataVersion = 2;
+            RunFrames( *AMD::AntiLag2DX12::GetFrontEnd( context.get() ), scenario, frames, &result );
+            AMD::AntiLag2DX12::DeInitialize( context.get() );
+        }
+    }
+    else
+    {
+        // Like a game that knows its driver, opt in to APIData_v2 only when the mock accepts it.
+        std::unique_ptr<Driver::Context11> context( new Driver::Context11() );
+        result.initResult = Driver::Initialize11<LibraryLoader>( context.get() );
+        if ( result.initResult == S_OK )
+        {
+            AMD::AntiLag2DX11::SetDriverDataVersion( context.get(), scenario.settings.dx11DataVersion < 2 ? 1 : 2 );
+            result.dataVersion = AMD::AntiLag2DX11::GetDriverDataVersion( context.get() );
+            RunFrames( *AMD::AntiLag2DX11::GetFrontEnd( context.get() ), scenario, frames, &result );
+            AMD::AntiLag2DX11::DeInitialize( context.get() );
+        }
+    }
+    driver.getStats( &result.stats );
+
+    // With injected failures the SDK may resend the state, only the lifetime of the interface is checked.
+    const MockDriverStats& stats = result.stats;
+    const bool created = result.initResult == S_OK;
+
+    // A DX11 driver without APIData_v2 is never sent one, and sees no signals. A DX12 driver that was not opted in to the input
+    // sample signal still sees the others.
+    const bool version1 = api == Api::DX11 && scenario.settings.dx11DataVersion < 2;
+    const bool inputSignal = !version1 && scenario.settings.dx11DataVersion >= 2;
+    result.mismatches += Check( stats.creates, created ? 1 : 0 );
+    result.mismatches += Check( stats.liveInterfaces, 0 );
+    result.mismatches += Check( stats.badPackets, 0 );
+    if ( scenario.settings.failEvery == 0 )
+    {
+        const unsigned long long sdkFrames = created ? frames : 0;
+        const bool signals = !version1;
+        result.mismatches += Check( result.dataVersion, created ? ( version1 ? 1 : 2 ) : 0 );
+        result.mismatches += Check( result.failedCalls, 0 );
+        result.mismatches += Check( stats.delays, sdkFrames );
+        result.mismatches += Check( stats.statePackets, created ? ( scenario.enable ? 2 : 1 ) : 0 );
+        result.mismatches += Check( stats.maxFPS, created ? scenario.maxFPS : 0 );
+        result.mismatches += Check( stats.inputSamples, inputSignal ? sdkFrames : 0 );
+        result.mismatches += Check( stats.endOfFrames, signals ? sdkFrames : 0 );
+        result.mismatches += Check( stats.frameTypes, signals && scenario.frameGen ? sdkFrames : 0 );
+        result.mismatches += Check( stats.interpolated, signals && scenario.frameGen ? sdkFrames / 2 : 0 );
+        result.mismatches += Check( stats.outOfOrder, 0 );
+    }
+    else
+    {
+        result.mismatches += Check( result.failedCalls > stats.injectedFailures, false );
+    }
+    return result;
+}
+
+// Sends packets of unknown versions and sizes straight to the interface, which the driver must reject.
+static unsigned int RunBadPackets( const MockDriver& driver )
+{
+    MockDriverSettings settings;
+    driver.configure( &settings );
+    Driver::PFNCreate create = reinterpret_cast<Driver::PFNCreate>( LibraryLoader::GetProc( LibraryLoader::GetModule( nullptr ), "AmdExtD3DCreateInterface" ) );
+    Driver::Api* pApi = nullptr;
+    int device = 0;
+    const HRESULT hr = create( reinterpret_cast<IUnknown*>( &device ), __uuidof( Driver::Api ), (void**)&pApi );
+    if ( hr != S_OK || pApi == nullptr )
+    {
+        return 1;
+    }
+
+    unsigned int mismatches = 0;
+    Driver::Data_v1 state = {};
+    state.uiSize = sizeof( state ) - 8;
+    state.uiVersion = 1;
+    mismatches += Check( pApi->UpdateAntiLagState( &state ) == E_INVALIDARG, true );
+    Driver::Data_v2 params = {};
+    params.uiSize = sizeof( params );
+    params.uiVersion = 3;
+    mismatches += Check( pApi->UpdateAntiLagState( &params ) == E_INVALIDARG, true );
+    pApi->Release();
+
+    MockDriverStats stats;
+    driver.getStats( &stats );
+    mismatches += Check( stats.badPackets, 2 );
+    mismatches += Check( stats.liveInterfaces, 0 );
+    return mismatches;
+}
+
+static void PrintHeader()
+{
+    printf( "%-4s %-13s %10s %3s %10s %9s | %5s %6s %6s %6s %6s %4s | %6s %8s %5s\n", "api", "scenario", "init", "ver", "fps", "update",
+            "state", "delay", "input", "eof", "ftype", "bad", "failed", "injected", "diffs" );
+    printf( "%-4s %-13s %10s %3s %10s %9s | %5s %6s %6s %6s %6s %4s | %6s %8s %5s\n", "", "", "hr", "", "", "ns", "", "", "", "", "", "", "", "", "" );
+}
+
+static void PrintResult( Api api, const Scenario& scenario, const Result& result )
+{
+    const MockDriverStats& stats = result.stats;
+    printf( "%-4s %-13s 0x%08x %3u %10.1f %9.0f | %5llu %6llu %6llu %6llu %6llu %4llu | %6u %8llu %5u\n", api == Api::DX12 ? "dx12" : "dx11",
+            scenario.name, (unsigned int)result.initResult, result.dataVersion, result.fps, result.updateNs, stats.statePackets, stats.delays,
+            stats.inputSamples, stats.endOfFrames, stats.frameTypes, stats.badPackets, result.failedCalls, stats.injectedFailures,
+            result.mismatches );
+}
+
+static void PrintUsage()
+{
+    printf( "Usage: DriverBench [options]\n"
+            "  --driver PATH      mock driver library (default: MockDriver next to DriverBench)\n"
+            "  --api dx12|dx11    API to run, both by default\n"
+            "  --scenario NAME    frames, version-1, limiter, software, create-fails, create-cached,\n"
+            "                     call-fails or overhead\n"
+            "  --frames N         frames per scenario (default: 200)\n"
+            "  --record PATH      record the calls the driver sees, for tools/bin/Replay; needs --api and --scenario\n" );
+}
+
+static std::string GetDefaultDriverPath( const char* argv0 )
+{
+    const std::string path = argv0;
+    const size_t slash = path.find_last_of( "/\\" );
+    return ( slash == std::string::npos ? std::string( "./" ) : path.substr( 0, slash + 1 ) ) + MOCKDRIVER_FILE_NAME;
+}
+
+int main( int argc, char** argv )
+{
+    std::string driverPath = GetDefaultDriverPath( argv[ 0 ] );
+    const char* apiName = nullptr;
+    const char* scenarioName = nullptr;
+    const char* recordPath = nullptr;
+    unsigned int frames = 200;
+    for ( int i = 1; i < argc; ++i )
+    {
+        const char* arg = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : "";
+        if ( !strcmp( arg, "--driver" ) )
+        {
+            driverPath = value;
+        }
+        else if ( !strcmp( arg, "--api" ) )
+        {
+            apiName = value;
+        }
+        else if ( !strcmp( arg, "--scenario" ) )
+        {
+            scenarioName = value;
+        }
+        else if ( !strcmp( arg, "--frames" ) )
+        {
+            frames = (unsigned int)atoi( value );
+        }
+        else if ( !strcmp( arg, "--record" ) )
+        {
+            recordPath = value;
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+        ++i;
+    }
+    if ( frames == 0 || ( recordPath && ( !apiName || !scenarioName ) ) )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if ( !LibraryLoader::Open( driverPath.c_str() ) )
+    {
+        printf( "Cannot load the mock driver %s.\n", driverPath.c_str() );
+        return 1;
+    }
+    MockDriver driver;
+    driver.configure = reinterpret_cast<PFNMockDriverConfigure>( LibraryLoader::GetProc( LibraryLoader::GetModule( nullptr ), "MockDriverConfigure" ) );
+    driver.getStats = reinterpret_cast<PFNMockDriverGetStats>( LibraryLoader::GetProc( LibraryLoader::GetModule( nullptr ), "MockDriverGetStats" ) );
+    if ( !driver.configure || !driver.getStats )
+    {
+        printf( "%s is not a mock driver.\n", driverPath.c_str() );
+        LibraryLoader::Close();
+        return 1;
+    }
+
+    unsigned int mismatches = 0;
+    PrintHeader();
+    for ( Api api : { Api::DX12, Api::DX11 } )
+    {
+        if ( apiName && strcmp( apiName, api == Api::DX12 ? "dx12" : "dx11" ) )
+        {
+            continue;
+        }
+        for ( const Scenario& scenario : GetScenarios() )
+        {
+            if ( scenarioName && strcmp( scenarioName, scenario.name ) )
+            {
+                continue;
+            }
+            const Result result = Run( driver, api, scenario, frames, recordPath );
+            PrintResult( api, scenario, result );
+            mismatches += result.mismatches;
+        }
+    }
+    if ( !scenarioName && ( !apiName || !strcmp( apiName, "dx12" ) ) )
+    {
+        const unsigned int badPackets = RunBadPackets( driver );
+        printf( "packets of unknown versions and sizes: %s\n", badPackets ? "accepted" : "rejected" );
+        mismatches += badPackets;
+    }
+
+    driver.configure( nullptr );
+    LibraryLoader::Close();
+    printf( "%u counters differ from the expected ones.\n", mismatches );
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,152 @@
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: DriverHeaders.h
+//
+// The DX11 and DX12 headers of the SDK, for the tools that talk to a driver or stand in
+// for one. On Windows they come with the Windows and D3D headers. Elsewhere a shim of
+// the few Windows types and functions they use takes their place: IUnknown with the
+// same layout, the GUIDs of the interfaces, and GetModuleHandleA and GetProcAddress
+// resolving to AMD::AntiLag2::LibraryLoader, so that the same packets and virtual calls
+// are made against tools/bin/MockDriver loaded with dlopen. Namespace Driver names the
+// types the tools use.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <d3d11.h>
+#include <d3d12.h>
+#else
+#include "../../ffx_antilag2.h"
+
+#include <cstdint>
+#include <cstring>
+
+#define __cdecl
+#define __int64             long long
+#define STDMETHODCALLTYPE
+#define MIDL_INTERFACE(x)   struct
+#define _countof(a)         ( sizeof(a) / sizeof((a)[0]) )
+#define __uuidof(T)         ShimUuid<T>::Get()
+
+#define E_FAIL              ((HRESULT)0x80004005L)
+#define E_POINTER           ((HRESULT)0x80004003L)
+#define E_HANDLE            ((HRESULT)0x80070006L)
+
+typedef void                VOID;
+typedef unsigned int        ULONG;
+typedef void*               HMODULE;
+typedef void*               FARPROC;
+
+struct GUID
+{
+    std::uint32_t   Data1;
+    std::uint16_t   Data2;
+    std::uint16_t   Data3;
+    std::uint8_t    Data4[ 8 ];
+};
+typedef const GUID& REFIID;
+
+inline bool operator==( const GUID& a, const GUID& b )  { return memcmp( &a, &b, sizeof(GUID) ) == 0; }
+inline bool operator!=( const GUID& a, const GUID& b )  { return !( a == b ); }
+
+// GUID of the MIDL_INTERFACE of T
+template<class T>
+struct ShimUuid;
+
+struct IUnknown
+{
+    virtual HRESULT STDMETHODCALLTYPE QueryInterface( REFIID riid, void** ppvObject ) = 0;
+    virtual ULONG STDMETHODCALLTYPE AddRef() = 0;
+    virtual ULONG STDMETHODCALLTYPE Release() = 0;
+};
+
+// The device is only passed on to the driver.
+struct ID3D11Device : public IUnknown {};
+struct ID3D12Device : public IUnknown {};
+
+inline HMODULE GetModuleHandleA( const char* name )        { return AMD::AntiLag2::LibraryLoader::GetModule( name ); }
+inline FARPROC GetProcAddress( HMODULE hModule, const char* name ) { return AMD::AntiLag2::LibraryLoader::GetProc( hModule, name ); }
+
+namespace AMD {
+namespace AntiLag2DX12 {
+    struct IAmdExtAntiLagApi;
+}
+}
+
+template<>
+struct ShimUuid<IUnknown>
+{
+    static const GUID& Get()    { static const GUID guid = { 0x00000000, 0x0000, 0x0000, { 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } }; return guid; }
+};
+
+template<>
+struct ShimUuid<AMD::AntiLag2DX12::IAmdExtAntiLagApi>
+{
+    static const GUID& Get()    { static const GUID guid = { 0x44085fbe, 0xe839, 0x40c5, { 0xbf, 0x38, 0x0e, 0xbc, 0x5a, 0xb4, 0xd0, 0xa6 } }; return guid; }
+};
+#endif
+
+#include "../../ffx_antilag2_dx11.h"
+#include "../../ffx_antilag2_dx12.h"
+
+namespace Driver
+{
+    typedef AMD::AntiLag2DX12::IAmdExtAntiLagApi            Api;
+    typedef AMD::AntiLag2DX12::APIData_v1                   Data_v1;
+    typedef AMD::AntiLag2DX12::APIData_v2                   Data_v2;
+    typedef AMD::AntiLag2DX12::Context                      Context;
+    typedef AMD::AntiLag2DX12::PFNAmdExtD3DCreateInterface  PFNCreate;
+    typedef AMD::AntiLag2DX12::FrontEndContext              FrontEnd;
+
+    typedef AMD::AntiLag2DX11::IAmdDxExtInterface           Interface11;
+    typedef AMD::AntiLag2DX11::IAmdDxExtAntiLagApi          Api11;
+    typedef AMD::AntiLag2DX11::APIData_v1                   Data11_v1;
+    typedef AMD::AntiLag2DX11::APIData_v2                   Data11_v2;
+    typedef AMD::AntiLag2DX11::Context                      Context11;
+    typedef AMD::AntiLag2DX11::PFNAmdDxExtCreate11          PFNCreate11;
+    typedef AMD::AntiLag2DX11::FrontEndContext              FrontEnd11;
+
+    inline bool IsAntiLagApi( REFIID riid )                 { return riid == __uuidof(Api); }
+
+    // The device is only passed on to the driver, so a stand-in that does not look at it can be given any non-null pointer.
+    template<class Loader>
+    inline HRESULT Initialize( Context* context, void* device )
+    {
+        return AMD::AntiLag2DX12::Initialize<Loader>( context, static_cast<ID3D12Device*>( device ) );
+    }
+
+    template<class Loader>
+    inline HRESULT Initialize11( Context11* context )
+    {
+        return AMD::AntiLag2DX11::Initialize<Loader>( context );
+    }
+
+    // Request identifier AmdDxExtCreate11 expects in *ppAntiLagApi
+    static const unsigned long long kCreate11Request = 0xbf380ebc5ab4d0a6;
+}
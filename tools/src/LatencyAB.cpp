@@ -0,0 +1,583 @@
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: LatencyAB.cpp
+//
+// A/B comparison of the input-to-GPU-complete latency between Anti-Lag settings. Each
+// arm is an enable flag and a maxFPS passed to Update(context, enable, maxFPS). A real
+// time game loop with a GPU thread and a bounded frame queue runs the arms in blocks of
+// frames, in a new random order every round, so that drift of the machine over the run
+// is spread over all of them. The latency of each frame comes from the SDK's telemetry:
+// the input sample of its FrameRecord to the time passed to MarkFrameComplete. The
+// first frames of a block are left out while the pipeline settles on the new setting.
+//
+// Every arm is compared with the first one. The frames of a block are not independent,
+// so the confidence intervals come from a bootstrap that resamples whole blocks. Runs
+// against the software backend or tools/bin/MockDriver, and can fail the run when a
+// latency reduction is not shown, to gate a build.
+//--------------------------------------------------------------------------------------
+
+#include "MockDriver.h"
+#include "PipelineSim.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace AMD::AntiLag2;
+using PipelineSim::Random;
+
+struct Arm
+{
+    std::string     name;
+    bool            enable = false;
+    unsigned int    maxFPS = 0;
+};
+
+struct Config
+{
+    bool                software = true;
+    std::vector<Arm>    arms;
+    Timestamp           cpu = 4 * kMillisecond;     // per frame, from the input sample to the submission
+    Timestamp           gpu = 8 * kMillisecond;     // per frame
+    int                 jitterPercent = 10;
+    unsigned int        queue = 3;                  // frames the GPU may fall behind before the submission blocks
+    unsigned int        blockFrames = 60;
+    unsigned int        settleFrames = 20;          // left out at the start of each block
+    unsigned int        rounds = 10;                // every arm runs one block per round
+    unsigned int        resamples = 2000;
+    std::uint64_t       seed = 1;
+    double              gatePercent = -1.0;         // reduction of the mean each arm must show, negative for no gate
+};
+
+// Latencies of one arm, in ms, by block.
+struct ArmResult
+{
+    std::vector<std::vector<double>>    blocks;
+    Timestamp                           frameTime = 0;      // summed over the frames kept
+    unsigned int                        frameTimes = 0;
+    unsigned int                        missing = 0;        // frames without a complete record
+};
+
+// Difference of an arm to the first one, with the bounds of its 95% confidence interval.
+struct Effect
+{
+    double  value = 0.0;
+    double  low = 0.0;
+    double  high = 0.0;
+};
+
+static void Spin( Timestamp duration )
+{
+    const Timestamp end = GetTimestamp() + duration;
+    while ( GetTimestamp() < end )
+    {
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Stands in for the GPU and the swap chain. Submit blocks like Present does while the
+// queue is full; the GPU thread runs the frames in order and reports them complete.
+//--------------------------------------------------------------------------------------
+template<class ContextType>
+class GpuQueue
+{
+public:
+    GpuQueue( ContextType& context, unsigned int depth ) : m_context( context ), m_depth( depth ), m_thread( [this]() { Run(); } ) {}
+
+    ~GpuQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_stop = true;
+        }
+        m_changed.notify_all();
+        m_thread.join();
+    }
+
+    void Submit( std::uint64_t frameIndex, Timestamp gpuTime )
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_changed.wait( lock, [this]() { return m_inFlight < m_depth; } );
+        m_frames.push_back( { frameIndex, gpuTime } );
+        ++m_inFlight;
+        lock.unlock();
+        m_changed.notify_all();
+    }
+
+    // Waits until the GPU has finished every frame submitted so far.
+    void Drain()
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_changed.wait( lock, [this]() { return m_inFlight == 0; } );
+    }
+
+private:
+    struct Frame
+    {
+        std::uint64_t   index;
+        Timestamp       gpuTime;
+    };
+
+    void Run()
+    {
+        PreciseWait wait;
+        Timestamp idle = 0;
+        for ( ;; )
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_changed.wait( lock, [this]() { return m_stop || !m_frames.empty(); } );
+            if ( m_stop )
+            {
+                return;
+            }
+            const Frame frame = m_frames.front();
+            m_frames.pop_front();
+            lock.unlock();
+
+            // A frame starts once it is submitted and the previous one is done.
+            idle = std::max( idle, GetTimestamp() ) + frame.gpuTime;
+            wait.WaitUntil( idle );
+            m_context.MarkFrameComplete( frame.index, idle );
+
+            lock.lock();
+            --m_inFlight;
+            lock.unlock();
+            m_changed.notify_all();
+        }
+    }
+
+    ContextType&                m_context;
+    const unsigned int          m_depth;
+    std::mutex                  m_mutex;
+    std::condition_variable     m_changed;
+    std::deque<Frame>           m_frames;
+    unsigned int                m_inFlight = 0;
+    bool                        m_stop = false;
+    std::thread                 m_thread;   // Last, so that it starts once the rest is constructed
+};
+
+// Arm of each block, every round in a new order.
+static std::vector<unsigned int> GetSchedule( const Config& config, Random& random )
+{
+    std::vector<unsigned int> schedule;
+    std::vector<unsigned int> order( config.arms.size() );
+    for ( unsigned int round = 0; round < config.rounds; ++round )
+    {
+        for ( unsigned int i = 0; i < order.size(); ++i )
+        {
+            order[ i ] = i;
+        }
+        for ( unsigned int i = (unsigned int)order.size(); i > 1; --i )
+        {
+            std::swap( order[ i - 1 ], order[ random.Next() % i ] );
+        }
+        schedule.insert( schedule.end(), order.begin(), order.end() );
+    }
+    return schedule;
+}
+
+template<class ContextType>
+static std::vector<ArmResult> Run( ContextType& context, const Config& config )
+{
+    // Records are read this many frames after their Update, when the GPU is done with them.
+    const unsigned int readLag = config.queue + 4;
+
+    Random random( config.seed );
+    const std::vector<unsigned int> schedule = GetSchedule( config, random );
+    const std::uint64_t frames = (std::uint64_t)schedule.size() * config.blockFrames;
+
+    std::vector<ArmResult> results( config.arms.size() );
+    for ( unsigned int block = 0; block < schedule.size(); ++block )
+    {
+        results[ schedule[ block ] ].blocks.push_back( std::vector<double>() );
+    }
+    std::vector<unsigned int> blockOfArm( schedule.size() );
+    std::vector<unsigned int> armBlocks( config.arms.size(), 0 );
+    for ( unsigned int block = 0; block < schedule.size(); ++block )
+    {
+        blockOfArm[ block ] = armBlocks[ schedule[ block ] ]++;
+    }
+
+    // Frame indices start at 1 after Initialize; the first frame of a block runs at firstIndex + block * blockFrames.
+    std::vector<Timestamp> updateEntries( (size_t)frames + 1, 0 );
+    const std::uint64_t firstIndex = context.GetFrameIndex() + 1;
+    auto collect = [&]( unsigned int framesAgo )
+    {
+        FrameRecord record;
+        if ( context.GetFrameRecord( framesAgo, &record ) != S_OK || record.frameIndex < firstIndex )
+        {
+            return;
+        }
+        const std::uint64_t frame = record.frameIndex - firstIndex;
+        const unsigned int block = (unsigned int)( frame / config.blockFrames );
+        updateEntries[ (size_t)frame ] = record.updateEntry;
+        if ( frame % config.blockFrames < config.settleFrames )
+        {
+            return;
+        }
+        ArmResult& result = results[ schedule[ block ] ];
+        if ( record.frameComplete == 0 )
+        {
+            ++result.missing;
+            return;
+        }
+        result.blocks[ blockOfArm[ block ] ].push_back( (double)( record.frameComplete - ( record.updateEntry + record.delay ) ) / kMillisecond );
+        if ( frame > 0 && updateEntries[ (size_t)frame - 1 ] && frame % config.blockFrames > config.settleFrames )
+        {
+            result.frameTime += record.updateEntry - updateEntries[ (size_t)frame - 1 ];
+            ++result.frameTimes;
+        }
+    };
+
+    {
+        GpuQueue<ContextType> gpu( context, config.queue );
+        for ( std::uint64_t frame = 0; frame < frames; ++frame )
+        {
+            const Arm& arm = config.arms[ schedule[ (size_t)( frame / config.blockFrames ) ] ];
+            context.Update( arm.enable, arm.maxFPS );
+            const std::uint64_t frameIndex = context.GetFrameIndex();
+
+            Spin( random.Jitter( config.cpu, config.jitterPercent ) );
+            context.MarkEndOfFrameRendering( frameIndex );
+            gpu.Submit( frameIndex, random.Jitter( config.gpu, config.jitterPercent ) );
+
+            if ( frame >= readLag )
+            {
+                collect( readLag );
+            }
+        }
+        gpu.Drain();
+        for ( unsigned int framesAgo = std::min<unsigned int>( readLag, (unsigned int)frames ); framesAgo-- > 0; )
+        {
+            collect( framesAgo );
+        }
+    }
+    return results;
+}
+
+static std::vector<ArmResult> Run( const Config& config, PFNMockDriverConfigure configure )
+{
+    if ( config.software )
+    {
+        std::unique_ptr<SoftwareContext> context( new SoftwareContext() );
+        context->Initialize();
+        std::vector<ArmResult> results = Run( *context, config );
+        context->DeInitialize();
+        return results;
+    }
+
+    // The mock runs the software implementation behind the driver interface, so that the packets the SDK sends are part of the run.
+    // Its latency model pairs the input samples with the ends of the frames, like the software implementation does.
+    MockDriverSettings settings;
+    settings.model = MockLatencyModel::Software;
+    configure( &settings );
+    int device = 0;
+    std::unique_ptr<Driver::Context> context( new Driver::Context() );
+    if ( Driver::Initialize<LibraryLoader>( context.get(), &device ) != S_OK )
+    {
+        return std::vector<ArmResult>();
+    }
+    AMD::AntiLag2DX12::SetInputSampleSignal( context.get(), true );
+    std::vector<ArmResult> results = Run( *AMD::AntiLag2DX12::GetFrontEnd( context.get() ), config );
+    AMD::AntiLag2DX12::DeInitialize( context.get() );
+    return results;
+}
+
+static std::vector<double> Pool( const std::vector<std::vector<double>>& blocks )
+{
+    std::vector<double> pooled;
+    for ( const std::vector<double>& block : blocks )
+    {
+        pooled.insert( pooled.end(), block.begin(), block.end() );
+    }
+    return pooled;
+}
+
+static double Mean( const std::vector<double>& values )
+{
+    double sum = 0.0;
+    for ( double value : values )
+    {
+        sum += value;
+    }
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+// Nearest-rank percentile, reorders values.
+static double Percentile( std::vector<double>& values, unsigned int percent )
+{
+    if ( values.empty() )
+    {
+        return 0.0;
+    }
+    std::vector<double>::iterator nth = values.begin() + ( values.size() - 1 ) * percent / 100;
+    std::nth_element( values.begin(), nth, values.end() );
+    return *nth;
+}
+
+// Draws as many blocks as there are, with replacement, and pools them.
+static void Resample( const std::vector<std::vector<double>>& blocks, Random& random, std::vector<double>* pooled )
+{
+    pooled->clear();
+    for ( size_t i = 0; i < blocks.size(); ++i )
+    {
+        const std::vector<double>& block = blocks[ random.Next() % blocks.size() ];
+        pooled->insert( pooled->end(), block.begin(), block.end() );
+    }
+}
+
+// Percentile bootstrap interval, reorders replicates.
+static void SetInterval( std::vector<double>& replicates, Effect* effect )
+{
+    std::sort( replicates.begin(), replicates.end() );
+    auto quantile = [&]( double q )
+    {
+        const double rank = q * ( replicates.size() - 1 );
+        const size_t below = (size_t)rank;
+        const size_t above = std::min( below + 1, replicates.size() - 1 );
+        return replicates[ below ] + ( replicates[ above ] - replicates[ below ] ) * ( rank - below );
+    };
+    effect->low = quantile( 0.025 );
+    effect->high = quantile( 0.975 );
+}
+
+// Change of the mean in ms and in percent, and of the median in ms, of arm against base.
+static void Compare( const ArmResult& base, const ArmResult& arm, const Config& config, Effect* mean, Effect* percent, Effect* median )
+{
+    std::vector<double> a = Pool( base.blocks );
+    std::vector<double> b = Pool( arm.blocks );
+    mean->value = Mean( b ) - Mean( a );
+    percent->value = ( Mean( b ) / Mean( a ) - 1.0 ) * 100.0;
+    median->value = Percentile( b, 50 ) - Percentile( a, 50 );
+
+    Random random( config.seed + 1 );
+    std::vector<double> means, percents, medians;
+    for ( unsigned int i = 0; i < config.resamples; ++i )
+    {
+        Resample( base.blocks, random, &a );
+        Resample( arm.blocks, random, &b );
+        const double meanA = Mean( a );
+        const double meanB = Mean( b );
+        means.push_back( meanB - meanA );
+        percents.push_back( ( meanB / meanA - 1.0 ) * 100.0 );
+        medians.push_back( Percentile( b, 50 ) - Percentile( a, 50 ) );
+    }
+    SetInterval( means, mean );
+    SetInterval( percents, percent );
+    SetInterval( medians, median );
+}
+
+static void PrintHeader()
+{
+    printf( "%-12s %6s %7s | %7s %7s %7s | %22s %22s %22s\n", "arm", "frames", "fps", "mean", "p50", "p99", "mean change", "mean change", "p50 change" );
+    printf( "%-12s %6s %7s | %7s %7s %7s | %22s %22s %22s\n", "", "", "", "ms", "ms", "ms", "ms [95% CI]", "% [95% CI]", "ms [95% CI]" );
+}
+
+static void PrintEffect( const Effect& effect, const char* format )
+{
+    char text[ 64 ];
+    snprintf( text, sizeof( text ), format, effect.value, effect.low, effect.high );
+    printf( " %22s", text );
+}
+
+static void PrintResult( const Arm& arm, const ArmResult& result, const Effect* mean, const Effect* percent, const Effect* median )
+{
+    std::vector<double> latencies = Pool( result.blocks );
+    const double fps = result.frameTime ? (double)result.frameTimes * kSecond / result.frameTime : 0.0;
+    printf( "%-12s %6u %7.1f | %7.2f %7.2f %7.2f |", arm.name.c_str(), (unsigned int)latencies.size(), fps, Mean( latencies ),
+            Percentile( latencies, 50 ), Percentile( latencies, 99 ) );
+    if ( mean )
+    {
+        PrintEffect( *mean, "%+.2f [%+.2f, %+.2f]" );
+        PrintEffect( *percent, "%+.1f [%+.1f, %+.1f]" );
+        PrintEffect( *median, "%+.2f [%+.2f, %+.2f]" );
+    }
+    else
+    {
+        printf( " %22s %22s %22s", "baseline", "", "" );
+    }
+    printf( result.missing ? "  %u frames not complete\n" : "\n", result.missing );
+}
+
+// off, on, or on:LIMIT with LIMIT a number of frames per second, which may have a fraction, or auto.
+static bool ParseArm( const char* text, Arm* arm )
+{
+    arm->name = text;
+    arm->enable = strncmp( text, "on", 2 ) == 0;
+    arm->maxFPS = 0;
+    if ( !strcmp( text, "off" ) || !strcmp( text, "on" ) )
+    {
+        return true;
+    }
+    if ( !arm->enable || text[ 2 ] != ':' )
+    {
+        return false;
+    }
+    const char* limit = text + 3;
+    if ( !strcmp( limit, "auto" ) )
+    {
+        arm->maxFPS = kMaxFPSAdaptive;
+        return true;
+    }
+    const double fps = atof( limit );
+    arm->maxFPS = strchr( limit, '.' ) ? MakeMaxFPS( fps ) : (unsigned int)fps;
+    return fps > 0.0;
+}
+
+static void PrintUsage()
+{
+    printf( "Usage: LatencyAB [options]\n"
+            "  --backend software|mock    backend to run (default: software)\n"
+            "  --driver PATH              mock driver library (default: MockDriver next to LatencyAB)\n"
+            "  --arm off|on|on:LIMIT      adds an arm, LIMIT is a framerate limit or auto; the first one is the baseline\n"
+            "                             (default: --arm off --arm on)\n"
+            "  --cpu MS --gpu MS          per-frame cost of the game thread and the GPU (default: 4 and 8)\n"
+            "  --jitter PERCENT           random variation of both (default: 10)\n"
+            "  --queue N                  frames the GPU may fall behind before the submission blocks (default: 3)\n"
+            "  --block N --settle N       frames per block and frames left out at its start (default: 60 and 20)\n"
+            "  --rounds N                 blocks per arm (default: 10)\n"
+            "  --resamples N              bootstrap resamples (default: 2000)\n"
+            "  --seed N                   seed of the workload jitter, the block order and the bootstrap\n"
+            "  --gate PERCENT             fail unless every arm lowers the mean latency by at least PERCENT, with 95%%\n"
+            "                             confidence\n" );
+}
+
+static std::string GetDefaultDriverPath( const char* argv0 )
+{
+    const std::string path = argv0;
+    const size_t slash = path.find_last_of( "/\\" );
+    return ( slash == std::string::npos ? std::string( "./" ) : path.substr( 0, slash + 1 ) ) + MOCKDRIVER_FILE_NAME;
+}
+
+int main( int argc, char** argv )
+{
+    Config config;
+    std::string driverPath = GetDefaultDriverPath( argv[ 0 ] );
+    bool valid = true;
+    for ( int i = 1; i < argc && valid; ++i )
+    {
+        const char* arg = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : "";
+        if ( !strcmp( arg, "--backend" ) )
+        {
+            config.software = strcmp( value, "mock" ) != 0;
+            valid = !strcmp( value, "software" ) || !strcmp( value, "mock" );
+        }
+        else if ( !strcmp( arg, "--driver" ) )      driverPath = value;
+        else if ( !strcmp( arg, "--arm" ) )
+        {
+            Arm arm;
+            valid = ParseArm( value, &arm );
+            config.arms.push_back( arm );
+        }
+        else if ( !strcmp( arg, "--cpu" ) )         config.cpu = (Timestamp)( atof( value ) * kMillisecond );
+        else if ( !strcmp( arg, "--gpu" ) )         config.gpu = (Timestamp)( atof( value ) * kMillisecond );
+        else if ( !strcmp( arg, "--jitter" ) )      config.jitterPercent = atoi( value );
+        else if ( !strcmp( arg, "--queue" ) )       config.queue = (unsigned int)atoi( value );
+        else if ( !strcmp( arg, "--block" ) )       config.blockFrames = (unsigned int)atoi( value );
+        else if ( !strcmp( arg, "--settle" ) )      config.settleFrames = (unsigned int)atoi( value );
+        else if ( !strcmp( arg, "--rounds" ) )      config.rounds = (unsigned int)atoi( value );
+        else if ( !strcmp( arg, "--resamples" ) )   config.resamples = (unsigned int)atoi( value );
+        else if ( !strcmp( arg, "--seed" ) )        config.seed = strtoull( value, nullptr, 10 );
+        else if ( !strcmp( arg, "--gate" ) )        config.gatePercent = atof( value );
+        else
+        {
+            valid = false;
+        }
+        ++i;
+    }
+    if ( config.arms.empty() )
+    {
+        Arm arm;
+        ParseArm( "off", &arm );
+        config.arms.push_back( arm );
+        ParseArm( "on", &arm );
+        config.arms.push_back( arm );
+    }
+    // The telemetry ring has to hold the frames until they are read, and a block needs frames that are kept.
+    if ( !valid || config.gpu <= 0 || config.queue == 0 || config.queue + 4 >= FrameTelemetry::kCapacity ||
+         config.settleFrames + 2 > config.blockFrames || config.rounds < 2 || config.resamples < 100 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    PFNMockDriverConfigure configure = nullptr;
+    if ( !config.software )
+    {
+        if ( !LibraryLoader::Open( driverPath.c_str() ) )
+        {
+            printf( "Cannot load the mock driver %s.\n", driverPath.c_str() );
+            return 1;
+        }
+        configure = reinterpret_cast<PFNMockDriverConfigure>( LibraryLoader::GetProc( LibraryLoader::GetModule( nullptr ), "MockDriverConfigure" ) );
+        if ( !configure )
+        {
+            printf( "%s is not a mock driver.\n", driverPath.c_str() );
+            LibraryLoader::Close();
+            return 1;
+        }
+    }
+
+    const std::vector<ArmResult> results = Run( config, configure );
+    if ( configure )
+    {
+        LibraryLoader::Close();
+    }
+    if ( results.empty() )
+    {
+        printf( "Cannot initialize the mock driver.\n" );
+        return 1;
+    }
+
+    bool passed = true;
+    PrintHeader();
+    for ( size_t i = 0; i < config.arms.size(); ++i )
+    {
+        if ( i == 0 )
+        {
+            PrintResult( config.arms[ i ], results[ i ], nullptr, nullptr, nullptr );
+            continue;
+        }
+        Effect mean, percent, median;
+        Compare( results[ 0 ], results[ i ], config, &mean, &percent, &median );
+        PrintResult( config.arms[ i ], results[ i ], &mean, &percent, &median );
+        passed = passed && percent.high <= -config.gatePercent;
+    }
+    if ( config.gatePercent >= 0.0 )
+    {
+        printf( "\nGate: %s - the mean latency of %s arm must be at least %.1f%% below %s.\n", passed ? "passed" : "FAILED",
+                config.arms.size() > 2 ? "every" : "the", config.gatePercent, config.arms[ 0 ].name.c_str() );
+        return passed ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,429 @@
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: MockDriver.cpp
+//
+// Stand-in for the AMD driver module, see MockDriver.h. Built as a shared library that
+// exports the same entry points as the driver, so that the SDK's whole path from the
+// module lookup to the packets it sends can run without AMD hardware.
+//--------------------------------------------------------------------------------------
+
+#include "MockDriver.h"
+
+#include "../../ffx_antilag2_record.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+using namespace AMD::AntiLag2;
+
+namespace
+{
+    // Process-wide state of the driver, shared by all the interfaces it hands out.
+    class MockDriver
+    {
+    public:
+        static MockDriver& Get()
+        {
+            static MockDriver driver;
+            return driver;
+        }
+
+        void Configure( const MockDriverSettings& settings );
+        void GetStats( MockDriverStats* stats ) const;
+
+        HRESULT Create()
+        {
+            if ( m_settings.createResult == S_OK )
+            {
+                m_creates++;
+                m_liveInterfaces++;
+            }
+            Record( RecordedCallType::Initialize, false, 0, 0, 0, m_settings.createResult );
+            return m_settings.createResult;
+        }
+
+        void Release( unsigned int refCount )
+        {
+            if ( refCount == 0 )
+            {
+                m_liveInterfaces--;
+                Record( RecordedCallType::DeInitialize, false, 0, 0, 0, 0 );
+            }
+        }
+
+        // Everything UpdateAntiLagState and UpdateAntiLagStateDx11 receive.
+        HRESULT Update( void* pData, bool dx11 );
+
+    private:
+        HRESULT SetState( unsigned int mode, unsigned int maxFPS );
+        HRESULT Delay();
+        HRESULT SetFrameGenParams( const Driver::Data_v2& data );
+        void    Record( RecordedCallType type, bool flag, unsigned int maxFPS, std::uint64_t frameIndex, Timestamp entry, HRESULT hr );
+
+        MockDriverSettings              m_settings;
+        std::string                     m_recordPath;
+        CallRecorder                    m_recorder;
+
+        // Latency models, only used by the thread calling Update in the SDK
+        std::mutex                      m_modelMutex;
+        SoftwareBackend                 m_software;
+        PreciseWait                     m_wait;
+        bool                            m_enabled = false;
+        Timestamp                       m_interval = 0;
+        Timestamp                       m_deadline = 0;
+
+        std::atomic<std::uint64_t>      m_calls{ 0 };
+        std::atomic<std::uint64_t>      m_lastInputIndex{ 0 };
+        std::atomic<std::uint64_t>      m_creates{ 0 };
+        std::atomic<std::uint64_t>      m_liveInterfaces{ 0 };
+        std::atomic<std::uint64_t>      m_statePackets{ 0 };
+        std::atomic<std::uint64_t>      m_enables{ 0 };
+        std::atomic<std::uint64_t>      m_delays{ 0 };
+        std::atomic<std::uint64_t>      m_inputSamples{ 0 };
+        std::atomic<std::uint64_t>      m_endOfFrames{ 0 };
+        std::atomic<std::uint64_t>      m_frameTypes{ 0 };
+        std::atomic<std::uint64_t>      m_interpolated{ 0 };
+        std::atomic<std::uint64_t>      m_outOfOrder{ 0 };
+        std::atomic<std::uint64_t>      m_badPackets{ 0 };
+        std::atomic<std::uint64_t>      m_injectedFailures{ 0 };
+        std::atomic<unsigned int>       m_maxFPS{ 0 };
+        std::atomic<Timestamp>          m_delayTime{ 0 };
+    };
+
+    void MockDriver::Configure( const MockDriverSettings& settings )
+    {
+        m_recorder.Stop();
+        m_settings = settings;
+        m_recordPath = settings.recordPath ? settings.recordPath : "";
+        m_settings.recordPath = nullptr;
+        if ( !m_recordPath.empty() )
+        {
+            m_recorder.Start( m_recordPath.c_str() );
+        }
+
+        m_software.DeInitialize();
+        if ( m_settings.model == MockLatencyModel::Software )
+        {
+            m_software.Initialize();
+        }
+        m_enabled = false;
+        m_interval = 0;
+        m_deadline = 0;
+
+        m_calls = 0;
+        m_lastInputIndex = 0;
+        m_creates = 0;
+        m_statePackets = 0;
+        m_enables = 0;
+        m_delays = 0;
+        m_inputSamples = 0;
+        m_endOfFrames = 0;
+        m_frameTypes = 0;
+        m_interpolated = 0;
+        m_outOfOrder = 0;
+        m_badPackets = 0;
+        m_injectedFailures = 0;
+        m_maxFPS = 0;
+        m_delayTime = 0;
+    }
+
+    void MockDriver::GetStats( MockDriverStats* stats ) const
+    {
+        stats->creates = m_creates;
+        stats->liveInterfaces = m_liveInterfaces;
+        stats->statePackets = m_statePackets;
+        stats->enables = m_enables;
+        stats->delays = m_delays;
+        stats->inputSamples = m_inputSamples;
+        stats->endOfFrames = m_endOfFrames;
+        stats->frameTypes = m_frameTypes;
+        stats->interpolated = m_interpolated;
+        stats->outOfOrder = m_outOfOrder;
+        stats->badPackets = m_badPackets;
+        stats->injectedFailures = m_injectedFailures;
+        stats->maxFPS = m_maxFPS;
+        stats->delayTime = m_delayTime;
+    }
+
+    HRESULT MockDriver::Update( void* pData, bool dx11 )
+    {
+        if ( m_settings.failEvery && ++m_calls % m_settings.failEvery == 0 )
+        {
+            m_injectedFailures++;
+            return m_settings.failResult;
+        }
+        if ( pData == nullptr )
+        {
+            return Delay();
+        }
+
+        // Both packet versions start with the size and the version.
+        const unsigned int* pHeader = static_cast<const unsigned int*>( pData );
+        if ( dx11 && pHeader[ 1 ] == 1 && pHeader[ 0 ] == sizeof(Driver::Data11_v1) )
+        {
+            const Driver::Data11_v1* pState = static_cast<const Driver::Data11_v1*>( pData );
+            return SetState( pState->eMode, pState->maxFPS );
+        }
+        if ( !dx11 && pHeader[ 1 ] == 1 && pHeader[ 0 ] == sizeof(Driver::Data_v1) )
+        {
+            const Driver::Data_v1* pState = static_cast<const Driver::Data_v1*>( pData );
+            return SetState( pState->eMode, pState->maxFPS );
+        }
+        if ( !dx11 && pHeader[ 1 ] == 2 && pHeader[ 0 ] == sizeof(Driver::Data_v2) )
+        {
+            return SetFrameGenParams( *static_cast<const Driver::Data_v2*>( pData ) );
+        }
+        if ( dx11 && m_settings.dx11DataVersion >= 2 && pHeader[ 1 ] == 2 && pHeader[ 0 ] == sizeof(Driver::Data11_v2) )
+        {
+            const Driver::Data11_v2* pParams = static_cast<const Driver::Data11_v2*>( pData );
+            Driver::Data_v2 params = {};
+            params.flags.signalFgFrameType = pParams->flags.signalFgFrameType;
+            params.flags.isInterpolatedFrame = pParams->flags.isInterpolatedFrame;
+            params.flags.signalGetUserInputIdx = pParams->flags.signalGetUserInputIdx;
+            params.flags.signalEndOfFrameIdx = pParams->flags.signalEndOfFrameIdx;
+            params.iiFrameIdx = pParams->iiFrameIdx;
+            return SetFrameGenParams( params );
+        }
+        m_badPackets++;
+        return E_INVALIDARG;
+    }
+
+    HRESULT MockDriver::SetState( unsigned int mode, unsigned int maxFPS )
+    {
+        const Timestamp entry = GetTimestamp();
+        const bool enabled = mode == 1;
+        m_statePackets++;
+        m_enables += enabled ? 1 : 0;
+        m_maxFPS = maxFPS;
+
+        HRESULT hr = S_OK;
+        {
+            std::lock_guard<std::mutex> lock( m_modelMutex );
+            m_enabled = enabled;
+            m_interval = enabled && maxFPS ? kSecond / maxFPS : 0;
+            m_deadline = 0;
+            if ( m_settings.model == MockLatencyModel::Software )
+            {
+                hr = m_software.SetState( enabled, maxFPS );
+            }
+        }
+        Record( RecordedCallType::SetState, enabled, maxFPS, m_lastInputIndex, entry, hr );
+        return hr;
+    }
+
+    HRESULT MockDriver::Delay()
+    {
+        const Timestamp entry = GetTimestamp();
+        HRESULT hr = S_OK;
+        {
+            std::lock_guard<std::mutex> lock( m_modelMutex );
+            if ( m_settings.model == MockLatencyModel::Software )
+            {
+                hr = m_software.InsertDelay();
+            }
+            else if ( m_enabled )
+            {
+                Timestamp deadline = entry;
+                if ( m_interval )
+                {
+                    m_deadline = m_deadline && m_deadline + m_interval > entry ? m_deadline + m_interval : entry;
+                    deadline = m_deadline;
+                }
+                m_wait.WaitUntil( deadline + m_settings.fixedDelay );
+            }
+        }
+        m_delays++;
+        m_delayTime += GetTimestamp() - entry;
+        // A DX11 driver without APIData_v2 does not see the input samples, so its frames are numbered by the delays.
+        Record( RecordedCallType::Update, false, 0, m_inputSamples ? m_lastInputIndex + 1 : m_delays.load(), entry, hr );
+        return hr;
+    }
+
+    HRESULT MockDriver::SetFrameGenParams( const Driver::Data_v2& data )
+    {
+        const Timestamp entry = GetTimestamp();
+        const std::uint64_t frameIndex = data.iiFrameIdx;
+        if ( data.flags.signalGetUserInputIdx )
+        {
+            m_inputSamples++;
+            if ( frameIndex <= m_lastInputIndex )
+            {
+                m_outOfOrder++;
+            }
+            m_lastInputIndex = frameIndex;
+            if ( m_settings.model == MockLatencyModel::Software )
+            {
+                std::lock_guard<std::mutex> lock( m_modelMutex );
+                m_software.SignalInputSample( frameIndex );
+            }
+        }
+        if ( data.flags.signalEndOfFrameIdx )
+        {
+            m_endOfFrames++;
+            if ( m_settings.model == MockLatencyModel::Software )
+            {
+                // The model takes end-of-frame markers from any thread.
+                m_software.MarkEndOfFrame( frameIndex );
+            }
+            Record( RecordedCallType::MarkEndOfFrameRendering, false, 0, frameIndex, entry, S_OK );
+        }
+        if ( data.flags.signalFgFrameType )
+        {
+            m_frameTypes++;
+            m_interpolated += data.flags.isInterpolatedFrame ? 1 : 0;
+            Record( RecordedCallType::SetFrameGenFrameType, data.flags.isInterpolatedFrame != 0, 0, frameIndex, entry, S_OK );
+        }
+        return S_OK;
+    }
+
+    void MockDriver::Record( RecordedCallType type, bool flag, unsigned int maxFPS, std::uint64_t frameIndex, Timestamp entry, HRESULT hr )
+    {
+        if ( m_recorder.IsActive() )
+        {
+            const Timestamp now = GetTimestamp();
+            m_recorder.Record( { entry ? entry : now, entry ? now - entry : 0, frameIndex, maxFPS, (std::int32_t)hr, type, flag } );
+        }
+    }
+
+    class MockAntiLagApi final : public Driver::Api
+    {
+    public:
+        virtual HRESULT STDMETHODCALLTYPE QueryInterface( REFIID riid, void** ppvObject ) override
+        {
+            if ( !Driver::IsAntiLagApi( riid ) )
+            {
+                *ppvObject = nullptr;
+                return E_NOINTERFACE;
+            }
+            AddRef();
+            *ppvObject = this;
+            return S_OK;
+        }
+
+        virtual ULONG STDMETHODCALLTYPE AddRef() override
+        {
+            return ++m_refCount;
+        }
+
+        virtual ULONG STDMETHODCALLTYPE Release() override
+        {
+            const unsigned int refCount = --m_refCount;
+            MockDriver::Get().Release( refCount );
+            if ( refCount == 0 )
+            {
+                delete this;
+            }
+            return refCount;
+        }
+
+        virtual HRESULT UpdateAntiLagState( void* pData ) override
+        {
+            return MockDriver::Get().Update( pData, false );
+        }
+
+    private:
+        std::atomic<unsigned int>   m_refCount{ 1 };
+    };
+
+    class MockAntiLagApi11 final : public Driver::Api11
+    {
+    public:
+        virtual unsigned int AddRef() override
+        {
+            return ++m_refCount;
+        }
+
+        virtual unsigned int Release() override
+        {
+            const unsigned int refCount = --m_refCount;
+            MockDriver::Get().Release( refCount );
+            if ( refCount == 0 )
+            {
+                delete this;
+            }
+            return refCount;
+        }
+
+        virtual HRESULT UpdateAntiLagStateDx11( Driver::Data11_v1* pApiCallbackData ) override
+        {
+            return MockDriver::Get().Update( pApiCallbackData, true );
+        }
+
+    private:
+        std::atomic<unsigned int>   m_refCount{ 1 };
+    };
+}
+
+MOCKDRIVER_EXPORT HRESULT AmdExtD3DCreateInterface( void* pOuter, REFIID riid, void** ppvObject )
+{
+    if ( ppvObject == nullptr )
+    {
+        return E_INVALIDARG;
+    }
+    *ppvObject = nullptr;
+    if ( pOuter == nullptr )
+    {
+        return E_INVALIDARG;
+    }
+    if ( !Driver::IsAntiLagApi( riid ) )
+    {
+        return E_NOINTERFACE;
+    }
+    const HRESULT hr = MockDriver::Get().Create();
+    if ( hr == S_OK )
+    {
+        *ppvObject = static_cast<Driver::Api*>( new MockAntiLagApi() );
+    }
+    return hr;
+}
+
+MOCKDRIVER_EXPORT HRESULT AmdDxExtCreate11( void*, Driver::Interface11** ppAntiLagApi )
+{
+    // The caller asks for the Anti-Lag interface by writing its identifier into the output pointer.
+    if ( ppAntiLagApi == nullptr || *reinterpret_cast<unsigned long long*>( ppAntiLagApi ) != Driver::kCreate11Request )
+    {
+        return E_INVALIDARG;
+    }
+    *ppAntiLagApi = nullptr;
+    const HRESULT hr = MockDriver::Get().Create();
+    if ( hr == S_OK )
+    {
+        *ppAntiLagApi = new MockAntiLagApi11();
+    }
+    return hr;
+}
+
+MOCKDRIVER_EXPORT void MockDriverConfigure( const MockDriverSettings* settings )
+{
+    MockDriver::Get().Configure( settings && settings->size == sizeof( MockDriverSettings ) ? *settings : MockDriverSettings() );
+}
+
+MOCKDRIVER_EXPORT void MockDriverGetStats( MockDriverStats* stats )
+{
+    if ( stats && stats->size == sizeof( MockDriverStats ) )
+    {
+        MockDriver::Get().GetStats( stats );
+    }
+}
@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: MockDriver.h
+//
+// Control interface of tools/bin/MockDriver, a shared library that stands in for the AMD
+// driver module. It exports the driver's entry points, AmdExtD3DCreateInterface for DX12
+// and AmdDxExtCreate11 for DX11, and implements the Anti-Lag interfaces behind them with
+// a configurable latency model, call recording and fault injection. Load it with
+// AMD::AntiLag2::LibraryLoader and look the functions below up in it.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "DriverHeaders.h"
+
+#if defined(_WIN32)
+#define MOCKDRIVER_EXPORT extern "C" __declspec(dllexport)
+#else
+#define MOCKDRIVER_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+// How the delay is inserted
+enum class MockLatencyModel : unsigned int
+{
+    Limiter,        // Holds the frame to maxFPS, plus fixedDelay, while Anti-Lag 2.0 is enabled
+    Software,       // AMD::AntiLag2::SoftwareBackend, the CPU-only implementation of the SDK
+};
+
+struct MockDriverSettings
+{
+    unsigned int        size = sizeof( MockDriverSettings );
+    MockLatencyModel    model = MockLatencyModel::Limiter;
+    long long           fixedDelay = 0;             // ns added to every delay of the Limiter model
+    HRESULT             createResult = S_OK;        // Returned by the entry points; with an error no interface is created
+    unsigned int        failEvery = 0;              // Every Nth call into the interface fails with failResult, 0 for never
+    HRESULT             failResult = E_FAIL;
+    const char*         recordPath = nullptr;       // AMD::AntiLag2::CallRecorder log of what the driver saw, nullptr for none
+    unsigned int        dx11DataVersion = 2;        // Newest structure version the DX11 interface accepts, 1 for drivers without APIData_v2
+};
+
+// What the driver saw since the last MockDriverConfigure. liveInterfaces is never cleared.
+struct MockDriverStats
+{
+    unsigned int        size = sizeof( MockDriverStats );
+    unsigned long long  creates = 0;                // Interfaces created
+    unsigned long long  liveInterfaces = 0;         // Interfaces not released yet
+    unsigned long long  statePackets = 0;           // APIData_v1
+    unsigned long long  enables = 0;                // APIData_v1 with Anti-Lag 2.0 enabled
+    unsigned long long  delays = 0;                 // Calls without a packet
+    unsigned long long  inputSamples = 0;           // APIData_v2 with signalGetUserInputIdx, DX11 too with dx11DataVersion 2
+    unsigned long long  endOfFrames = 0;            // APIData_v2 with signalEndOfFrameIdx
+    unsigned long long  frameTypes = 0;             // APIData_v2 with signalFgFrameType
+    unsigned long long  interpolated = 0;           // of which isInterpolatedFrame
+    unsigned long long  outOfOrder = 0;             // Input sample indices that did not increase
+    unsigned long long  badPackets = 0;             // Packets of an unknown version or size, which fail with E_INVALIDARG
+    unsigned long long  injectedFailures = 0;
+    unsigned int        maxFPS = 0;                 // Of the last APIData_v1
+    long long           delayTime = 0;              // ns spent in the delays
+};
+
+// Applies the settings and clears the stats. Must not overlap with calls into the interfaces.
+typedef void ( *PFNMockDriverConfigure )( const MockDriverSettings* settings );
+typedef void ( *PFNMockDriverGetStats )( MockDriverStats* stats );
@@ -0,0 +1,287 @@
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: OverlapBench.cpp
+//
+// Measures the CPU time BeginUpdate/EndUpdate give back to the game thread. A game loop
+// with a fixed amount of work per frame is held at a framerate limit, so that most of
+// the frame is spent in the latency-reducing delay. Update sleeps through it; with
+// BeginUpdate the loop runs small input-independent tasks until the delay is over.
+// Reports the task time recovered per frame and how late the input is sampled for it.
+//--------------------------------------------------------------------------------------
+
+#include "../../ffx_antilag2_async.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace AMD::AntiLag2;
+
+// Stands in for the driver: the delay holds the frame to the limit by blocking, and there is no deadline to plan for.
+class BlockingBackend
+{
+public:
+    static const bool kActive = true;
+
+    HRESULT         Initialize()                            { m_initialized = true; return S_OK; }
+    bool            IsInitialized() const                   { return m_initialized; }
+    unsigned int    DeInitialize()                          { m_initialized = false; return 0; }
+    HRESULT         SetState( bool enabled, unsigned int maxFPS );
+    HRESULT         InsertDelay();
+    HRESULT         BeginDelay( Timestamp* )                { return S_FALSE; }
+    HRESULT         EndDelay()                              { return S_FALSE; }
+    HRESULT         SignalInputSample( std::uint64_t )      { return S_OK; }
+    HRESULT         MarkEndOfFrame( std::uint64_t )         { return S_OK; }
+    HRESULT         SetFrameType( bool, std::uint64_t )     { return S_OK; }
+    HRESULT         InsertSplitDelay( std::uint64_t )       { return S_FALSE; }
+
+    // When the last delay was over.
+    Timestamp       GetDelayEnd() const                     { return m_delayEnd.load( std::memory_order_acquire ); }
+
+private:
+    bool                    m_initialized = false;
+    Timestamp               m_interval = 0;
+    Timestamp               m_deadline = 0;
+    PreciseWait             m_wait;
+    std::atomic<Timestamp>  m_delayEnd{ 0 };
+};
+
+HRESULT BlockingBackend::SetState( bool enabled, unsigned int maxFPS )
+{
+    m_interval = enabled ? GetMaxFPSInterval( maxFPS ) : 0;
+    m_deadline = 0;
+    return S_OK;
+}
+
+HRESULT BlockingBackend::InsertDelay()
+{
+    const Timestamp now = GetTimestamp();
+    if ( m_interval )
+    {
+        m_deadline = m_deadline && m_deadline + m_interval > now ? m_deadline + m_interval : now;
+        m_wait.WaitUntil( m_deadline );
+    }
+    m_delayEnd.store( GetTimestamp(), std::memory_order_release );
+    return S_OK;
+}
+
+enum class Mode
+{
+    Update,     // Update() sleeps through the delay
+    Overlap,    // BeginUpdate(), tasks until the delay is over, EndUpdate()
+};
+
+struct Config
+{
+    bool            software = true;
+    Mode            mode = Mode::Update;
+    unsigned int    maxFPS = 60;
+    Timestamp       work = 4 * kMillisecond;        // input-dependent work per frame
+    Timestamp       task = 100 * 1000;              // one input-independent task
+    unsigned int    frames = 300;
+};
+
+struct Result
+{
+    double          fps = 0.0;
+    double          delayMs = 0.0;          // mean time from Update entry to the input sample
+    double          recoveredMs = 0.0;      // mean task time per frame
+    double          tasks = 0.0;            // mean tasks per frame
+    double          lateP50Us = 0.0;        // input sample after the end of the delay
+    double          lateP99Us = 0.0;
+};
+
+static void Spin( Timestamp duration )
+{
+    const Timestamp end = GetTimestamp() + duration;
+    while ( GetTimestamp() < end )
+    {
+    }
+}
+
+template<class ContextType, class DelayEnd>
+static Result Run( ContextType& context, const Config& config, DelayEnd delayEnd )
+{
+    context.Initialize();
+    context.SetState( true, config.maxFPS );
+
+    std::vector<Timestamp> late;
+    Timestamp tasks = 0;
+    Timestamp delay = 0;
+    const unsigned int warmup = config.frames / 10;
+    Timestamp start = 0;
+    for ( unsigned int i = 0; i < config.frames + warmup; ++i )
+    {
+        if ( i == warmup )
+        {
+            start = GetTimestamp();
+            late.clear();
+            tasks = 0;
+            delay = 0;
+        }
+
+        const Timestamp entry = GetTimestamp();
+        Timestamp deadline = 0;
+        if ( config.mode == Mode::Update )
+        {
+            context.Update();
+        }
+        else
+        {
+            context.BeginUpdate();
+
+            // With a deadline only the tasks that fit are started; without one, until the delay is over.
+            deadline = context.GetUpdateDeadline();
+            while ( deadline ? GetTimestamp() + config.task <= deadline : !context.IsUpdateReady() )
+            {
+                Spin( config.task );
+                ++tasks;
+            }
+            context.EndUpdate();
+        }
+        const Timestamp sample = GetTimestamp();
+        delay += sample - entry;
+        const Timestamp end = deadline ? deadline : delayEnd( context );
+        late.push_back( sample - std::min( sample, end ) );
+
+        Spin( config.work );
+    }
+    const Timestamp elapsed = GetTimestamp() - start;
+    context.DeInitialize();
+
+    Result result;
+    std::sort( late.begin(), late.end() );
+    result.fps = (double)config.frames * kSecond / elapsed;
+    result.delayMs = (double)delay / config.frames / kMillisecond;
+    result.tasks = (double)tasks / config.frames;
+    result.recoveredMs = result.tasks * config.task / kMillisecond;
+    result.lateP50Us = late[ ( late.size() - 1 ) * 50 / 100 ] / 1000.0;
+    result.lateP99Us = late[ ( late.size() - 1 ) * 99 / 100 ] / 1000.0;
+    return result;
+}
+
+static Result Run( const Config& config )
+{
+    if ( config.software )
+    {
+        // With BeginUpdate the software model has a deadline, with Update the delay ends where the frame record says.
+        SoftwareContext context;
+        return Run( context, config, []( SoftwareContext& c )
+        {
+            FrameRecord record = {};
+            c.GetFrameRecord( 0, &record );
+            return record.updateEntry + record.delay;
+        } );
+    }
+    // The driver can only block, so BeginUpdate hands its delay to a thread.
+    DelayThread thread;
+    Context<BlockingBackend> context;
+    context.SetDelayExecutor( &thread );
+    return Run( context, config, []( Context<BlockingBackend>& c ) { return c.GetBackend().GetDelayEnd(); } );
+}
+
+static void PrintHeader()
+{
+    printf( "%-9s %-8s %6s %7s %8s | %9s %7s | %8s %8s\n", "backend", "mode", "maxfps", "work", "fps", "recovered", "tasks", "late", "late" );
+    printf( "%-9s %-8s %6s %7s %8s | %9s %7s | %8s %8s\n", "", "", "", "ms", "", "ms/frame", "/frame", "p50 us", "p99 us" );
+}
+
+static void PrintResult( const Config& config, const Result& result )
+{
+    printf( "%-9s %-8s %6u %7.2f %8.1f | %9.2f %7.1f | %8.1f %8.1f\n", config.software ? "software" : "driver",
+            config.mode == Mode::Update ? "update" : "overlap", config.maxFPS, (double)config.work / kMillisecond, result.fps,
+            result.recoveredMs, result.tasks, result.lateP50Us, result.lateP99Us );
+}
+
+static void PrintUsage()
+{
+    printf( "Usage: OverlapBench [options]\n"
+            "  --backend software|driver  backend to run, both by default\n"
+            "  --maxfps N                 framerate limit (default: 60)\n"
+            "  --work MS                  input-dependent work per frame (default: 4)\n"
+            "  --task US                  length of one input-independent task (default: 100)\n"
+            "  --frames N                 frames per run (default: 300)\n" );
+}
+
+int main( int argc, char** argv )
+{
+    Config base;
+    const char* backend = nullptr;
+    for ( int i = 1; i < argc; ++i )
+    {
+        const char* arg = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : "";
+        if ( !strcmp( arg, "--backend" ) )
+        {
+            backend = value;
+        }
+        else if ( !strcmp( arg, "--maxfps" ) )
+        {
+            base.maxFPS = (unsigned int)atoi( value );
+        }
+        else if ( !strcmp( arg, "--work" ) )
+        {
+            base.work = (Timestamp)( atof( value ) * kMillisecond );
+        }
+        else if ( !strcmp( arg, "--task" ) )
+        {
+            base.task = (Timestamp)( atof( value ) * 1000 );
+        }
+        else if ( !strcmp( arg, "--frames" ) )
+        {
+            base.frames = (unsigned int)atoi( value );
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+        ++i;
+    }
+    if ( base.maxFPS == 0 || base.task <= 0 || base.frames == 0 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    PrintHeader();
+    for ( int b = 0; b < 2; ++b )
+    {
+        Config config = base;
+        config.software = b == 0;
+        if ( backend && strcmp( backend, config.software ? "software" : "driver" ) )
+        {
+            continue;
+        }
+        for ( Mode mode : { Mode::Update, Mode::Overlap } )
+        {
+            config.mode = mode;
+            PrintResult( config, Run( config ) );
+        }
+    }
+    return 0;
+}
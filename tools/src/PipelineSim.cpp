@@ -0,0 +1,752 @@
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: PipelineSim.cpp
+//
+// Command line front end of the pipeline simulator. Without arguments it runs a matrix
+// of CPU-bound, GPU-bound and balanced workloads with and without Anti-Lag 2.0, followed
+// by the adaptive limiter against fixed limits, frame generation with and without
+// present pacing, hitches, the delay in Update() against a split delay, and whole,
+// fractional and refresh-relative limits on a variable refresh rate display, and a
+// single game thread against one that hands its frames to a render thread.
+//--------------------------------------------------------------------------------------
+
+#include "PipelineSim.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace PipelineSim;
+
+static const char* BackendName( Backend backend )
+{
+    switch ( backend )
+    {
+        case Backend::None:     return "off";
+        case Backend::Software: return "software";
+        case Backend::Driver:   return "driver";
+    }
+    return "";
+}
+
+static const char* PlacementName( Placement placement )
+{
+    switch ( placement )
+    {
+        case Placement::BeforeInput: return "before-input";
+        case Placement::FrameStart:  return "frame-start";
+        case Placement::AfterInput:  return "after-input";
+    }
+    return "";
+}
+
+static const char* LimitName( unsigned int maxFPS, char* buffer, size_t size )
+{
+    if ( maxFPS == AMD::AntiLag2::kMaxFPSAdaptive )
+    {
+        return "auto";
+    }
+    switch ( maxFPS & AMD::AntiLag2::kMaxFPSKindMask )
+    {
+        case AMD::AntiLag2::kMaxFPSFractional:
+            snprintf( buffer, size, "%.2f", ( maxFPS & AMD::AntiLag2::kMaxFPSValueMask ) / 1000.0 );
+            break;
+        case AMD::AntiLag2::kMaxFPSBelowRefresh:
+            snprintf( buffer, size, "r-%g", ( maxFPS & AMD::AntiLag2::kMaxFPSValueMask ) / 1000.0 );
+            break;
+        default:
+            snprintf( buffer, size, "%u", maxFPS );
+            break;
+    }
+    return buffer;
+}
+
+static void PrintHeader()
+{
+    printf( "%-12s %-9s %-13s %6s %8s | %7s %7s %7s %7s | %6s %6s %6s | %7s %6s\n",
+            "workload", "backend", "placement", "maxfps", "fps",
+            "mean", "p50", "p95", "p99", "frames", "p99", "sdk", "delay", "gpuidle" );
+    printf( "%-12s %-9s %-13s %6s %8s | %7s %7s %7s %7s | %6s %6s %6s | %7s %6s\n",
+            "", "", "", "", "",
+            "ms", "ms", "ms", "ms", "mean", "", "est", "ms", "%" );
+}
+
+static void PrintResult( const char* name, const Config& config, const Result& result )
+{
+    char limit[ 16 ];
+    printf( "%-12s %-9s %-13s %6s %8.1f | %7.2f %7.2f %7.2f %7.2f | %6.2f %6.2f %6.2f | %7.2f %6.1f\n",
+            name, BackendName( config.backend ), PlacementName( config.placement ), LimitName( config.maxFPS, limit, sizeof( limit ) ), result.fps,
+            result.latencyMs.mean, result.latencyMs.p50, result.latencyMs.p95, result.latencyMs.p99,
+            result.latencyFrames.mean, result.latencyFrames.p99, result.latencyEstimate, result.delayMs, result.gpuIdlePercent );
+}
+
+static void PrintHistogram( const Result& result, unsigned int warmupFrames )
+{
+    const int kBuckets = 40;
+    unsigned int histogram[ kBuckets ] = {};
+    unsigned int count = 0;
+    for ( size_t i = warmupFrames; i < result.frames.size(); ++i )
+    {
+        int bucket = (int)ToMs( result.frames[ i ].Latency() );
+        histogram[ std::min( bucket, kBuckets - 1 ) ]++;
+        count++;
+    }
+    printf( "\ninput-to-photon latency histogram (1ms buckets)\n" );
+    for ( int i = 0; i < kBuckets; ++i )
+    {
+        if ( histogram[ i ] )
+        {
+            int bar = (int)( 60.0 * histogram[ i ] / count + 0.5 );
+            printf( "%3d%s ms %6u %.*s\n", i, i == kBuckets - 1 ? "+" : " ", histogram[ i ], bar,
+                    "############################################################" );
+        }
+    }
+}
+
+static void PrintAdaptiveHeader()
+{
+    printf( "%-12s %-9s %6s %8s | %7s %7s %7s | %6s %7s %7s\n",
+            "workload", "backend", "maxfps", "fps", "mean", "p95", "p99", "limit", "settle", "changes" );
+    printf( "%-12s %-9s %6s %8s | %7s %7s %7s | %6s %7s %7s\n",
+            "", "", "", "", "ms", "ms", "ms", "fps", "frames", "" );
+}
+
+static void PrintAdaptiveResult( const char* name, const Config& config, const Result& result )
+{
+    char limit[ 16 ];
+    const unsigned int settle = result.settleFrame - config.workload.stepFrame;
+    printf( "%-12s %-9s %6s %8.1f | %7.2f %7.2f %7.2f | %6u %7u %7u\n",
+            name, BackendName( config.backend ), LimitName( config.maxFPS, limit, sizeof( limit ) ), result.fps,
+            result.latencyMs.mean, result.latencyMs.p95, result.latencyMs.p99,
+            result.frames.empty() ? 0 : result.frames.back().maxFPS, settle, result.limitChanges );
+}
+
+// The adaptive limiter against no limit and fixed limits, over runs three times as long as the others. The settle
+// column counts the frames the adaptive limit takes to come within 5% of where it settles, from the start or from
+// the workload step, and the changes column how often it changed in total.
+static void RunAdaptive( const Config& base )
+{
+    struct Scenario
+    {
+        const char*     name;
+        Timestamp       simulation, render, gpu, gpuStep;
+        double          vrrHz;
+    };
+    const Scenario scenarios[] =
+    {
+        { "gpu-bound",  2 * kMillisecond, 3 * kMillisecond, 12 * kMillisecond, 0,                0.0 },
+        { "gpu-step",   2 * kMillisecond, 3 * kMillisecond,  8 * kMillisecond, 6 * kMillisecond, 0.0 },
+        { "vrr-144hz",  1 * kMillisecond, 2 * kMillisecond,  5 * kMillisecond, 0,                144.0 },
+    };
+    const Backend backends[] = { Backend::Software, Backend::Driver };
+    const unsigned int limits[] = { 0, 60, 100, AMD::AntiLag2::kMaxFPSAdaptive };
+
+    PrintAdaptiveHeader();
+    for ( const Scenario& scenario : scenarios )
+    {
+        for ( Backend backend : backends )
+        {
+            for ( unsigned int limit : limits )
+            {
+                Config config = base;
+                config.workload.simulation = scenario.simulation;
+                config.workload.render = scenario.render;
+                config.workload.gpu = scenario.gpu;
+                config.workload.gpuStep = scenario.gpuStep;
+                config.vrrHz = scenario.vrrHz;
+                config.frames = 3 * base.frames;
+                if ( scenario.gpuStep )
+                {
+                    // Measure the latency after the step only
+                    config.workload.stepFrame = base.frames;
+                    config.warmupFrames = base.frames + base.warmupFrames;
+                }
+                config.backend = backend;
+                config.maxFPS = limit;
+                PrintAdaptiveResult( scenario.name, config, Run( config ) );
+            }
+        }
+    }
+}
+
+static void PrintFrameGenerationHeader()
+{
+    printf( "%-12s %-9s %-7s %8s %8s | %7s %7s %7s %7s | %7s %7s\n",
+            "workload", "backend", "pacing", "fps", "shown", "mean", "stddev", "p99", "max", "latency", "p99" );
+    printf( "%-12s %-9s %-7s %8s %8s | %7s %7s %7s %7s | %7s %7s\n",
+            "", "", "", "", "fps", "ms", "ms", "ms", "ms", "ms", "ms" );
+}
+
+static void PrintFrameGenerationResult( const char* name, const Config& config, const Result& result )
+{
+    printf( "%-12s %-9s %-7s %8.1f %8.1f | %7.2f %7.2f %7.2f %7.2f | %7.2f %7.2f\n",
+            name, BackendName( config.backend ), config.framePacing ? "on" : "off", result.fps,
+            result.presentIntervalMs.mean > 0.0 ? 1000.0 / result.presentIntervalMs.mean : 0.0,
+            result.presentIntervalMs.mean, result.presentIntervalMs.stddev, result.presentIntervalMs.p99, result.presentIntervalMs.max,
+            result.latencyMs.mean, result.latencyMs.p99 );
+}
+
+// Frame generation with the interpolated and real frames presented back to back and paced by FrameGenPacer.
+// The present interval columns cover every frame on screen, the latency columns the real frames.
+static void RunFrameGeneration( const Config& base )
+{
+    struct Scenario
+    {
+        const char*     name;
+        Timestamp       simulation, render, gpu;
+        int             jitterPercent;
+    };
+    const Scenario scenarios[] =
+    {
+        { "gpu-bound",  2 * kMillisecond, 3 * kMillisecond, 12 * kMillisecond, 10 },
+        { "balanced",   3 * kMillisecond, 4 * kMillisecond,  8 * kMillisecond, 10 },
+        { "jittery",    2 * kMillisecond, 3 * kMillisecond, 12 * kMillisecond, 30 },
+    };
+    const Backend backends[] = { Backend::None, Backend::Driver };
+
+    PrintFrameGenerationHeader();
+    for ( const Scenario& scenario : scenarios )
+    {
+        for ( Backend backend : backends )
+        {
+            for ( bool pacing : { false, true } )
+            {
+                Config config = base;
+                config.workload.simulation = scenario.simulation;
+                config.workload.render = scenario.render;
+                config.workload.gpu = scenario.gpu;
+                config.workload.jitterPercent = scenario.jitterPercent;
+                config.backend = backend;
+                config.frameGeneration = true;
+                config.framePacing = pacing;
+                PrintFrameGenerationResult( scenario.name, config, Run( config ) );
+            }
+        }
+    }
+}
+
+static void PrintHitchHeader()
+{
+    printf( "%-12s %-9s %-9s %8s | %7s %7s %7s | %7s %8s %7s\n",
+            "workload", "backend", "rejection", "fps", "mean", "p99", "max", "hitches", "after", "recover" );
+    printf( "%-12s %-9s %-9s %8s | %7s %7s %7s | %7s %8s %7s\n",
+            "", "", "", "", "ms", "ms", "ms", "", "ms", "frames" );
+}
+
+static void PrintHitchResult( const char* name, const Config& config, const Result& result )
+{
+    const bool rejection = config.backend == Backend::Software && config.software.hitchPermille;
+    printf( "%-12s %-9s %-9s %8.1f | %7.2f %7.2f %7.2f | %7u %8.2f %7.1f\n",
+            name, BackendName( config.backend ), config.backend == Backend::Software ? ( rejection ? "on" : "off" ) : "", result.fps,
+            result.latencyMs.mean, result.latencyMs.p99, result.latencyMs.max, result.hitches, result.hitchLatencyMs, result.recoveryFrames );
+}
+
+// Injected CPU stalls, such as shader compilation or streaming hitches, against the software model with and without its
+// hitch rejection. The after column is the mean latency of the frames following a hitch, the recover column the number of
+// frames it takes the latency to return to normal.
+static void RunHitches( const Config& base )
+{
+    struct Scenario
+    {
+        const char*     name;
+        Timestamp       simulation, render, gpu, hitch;
+        unsigned int    hitchEvery, hitchLength;
+    };
+    const Scenario scenarios[] =
+    {
+        { "gpu-60ms",   2 * kMillisecond, 3 * kMillisecond, 12 * kMillisecond, 60 * kMillisecond,  150, 1 },
+        { "gpu-200ms",  2 * kMillisecond, 3 * kMillisecond, 12 * kMillisecond, 200 * kMillisecond, 150, 1 },
+        { "gpu-burst",  2 * kMillisecond, 3 * kMillisecond, 12 * kMillisecond, 25 * kMillisecond,  150, 4 },
+        { "balanced",   3 * kMillisecond, 4 * kMillisecond,  8 * kMillisecond, 40 * kMillisecond,   90, 1 },
+    };
+
+    PrintHitchHeader();
+    for ( const Scenario& scenario : scenarios )
+    {
+        for ( int run = 0; run < 3; ++run )
+        {
+            Config config = base;
+            config.workload.simulation = scenario.simulation;
+            config.workload.render = scenario.render;
+            config.workload.gpu = scenario.gpu;
+            config.workload.hitch = scenario.hitch;
+            config.workload.hitchEvery = scenario.hitchEvery;
+            config.workload.hitchLength = scenario.hitchLength;
+            config.backend = run < 2 ? Backend::Software : Backend::Driver;
+            if ( run == 0 )
+            {
+                config.software.hitchPermille = 0;
+            }
+            PrintHitchResult( scenario.name, config, Run( config ) );
+        }
+    }
+}
+
+static void PrintSplitDelayHeader()
+{
+    printf( "%-12s %-9s %-6s %6s %8s | %7s %7s | %7s %7s | %7s %7s %6s\n",
+            "workload", "backend", "delay", "maxfps", "fps", "early", "early", "late", "late", "delay", "split", "gpuidle" );
+    printf( "%-12s %-9s %-6s %6s %8s | %7s %7s | %7s %7s | %7s %7s %6s\n",
+            "", "", "", "", "", "mean ms", "p99 ms", "mean ms", "p99 ms", "ms", "ms", "%" );
+}
+
+static void PrintSplitDelayResult( const char* name, const Config& config, const Result& result )
+{
+    char limit[ 16 ];
+    printf( "%-12s %-9s %-6s %6s %8.1f | %7.2f %7.2f | %7.2f %7.2f | %7.2f %7.2f %6.1f\n",
+            name, BackendName( config.backend ), config.splitDelay ? "split" : "update", LimitName( config.maxFPS, limit, sizeof( limit ) ),
+            result.fps, result.latencyMs.mean, result.latencyMs.p99, result.lateLatencyMs.mean, result.lateLatencyMs.p99,
+            result.delayMs, result.splitDelayMs, result.gpuIdlePercent );
+}
+
+// The delay in Update() alone against a delay split between Update() and the RenderSubmitStart marker. Early is the
+// latency of the input sampled after Update() (the camera), late that of the input sampled just before the render
+// submission (a weapon firing). The split moves the pacing past the simulation, so that its variation no longer
+// reaches the GPU queue.
+static void RunSplitDelay( const Config& base )
+{
+    struct Scenario
+    {
+        const char*     name;
+        Timestamp       simulation, render, gpu;
+        int             simulationJitter;
+        unsigned int    maxFPS;
+    };
+    const Scenario scenarios[] =
+    {
+        { "gpu-bound",  2 * kMillisecond, 3 * kMillisecond, 12 * kMillisecond, 10,  0 },
+        { "sim-jitter", 5 * kMillisecond, 3 * kMillisecond, 12 * kMillisecond, 60,  0 },
+        { "sim-heavy",  8 * kMillisecond, 2 * kMillisecond, 12 * kMillisecond, 40,  0 },
+        { "limited",    5 * kMillisecond, 3 * kMillisecond,  8 * kMillisecond, 60, 60 },
+    };
+
+    PrintSplitDelayHeader();
+    for ( const Scenario& scenario : scenarios )
+    {
+        for ( int run = 0; run < 4; ++run )
+        {
+            Config config = base;
+            config.workload.simulation = scenario.simulation;
+            config.workload.render = scenario.render;
+            config.workload.gpu = scenario.gpu;
+            config.workload.simulationJitterPercent = scenario.simulationJitter;
+            config.maxFPS = scenario.maxFPS;
+            config.backend = run == 0 ? Backend::None : run == 3 ? Backend::Driver : Backend::Software;
+            config.splitDelay = run == 2;
+            if ( config.backend == Backend::None && config.maxFPS )
+            {
+                continue;
+            }
+            PrintSplitDelayResult( scenario.name, config, Run( config ) );
+        }
+    }
+}
+
+static void PrintVrrHeader()
+{
+    printf( "%-12s %-9s %6s %8s | %7s %7s | %7s | %6s %7s | %7s %7s\n",
+            "workload", "backend", "maxfps", "fps", "mean", "p99", "ceiling", "lfc", "lfc", "shown", "shown" );
+    printf( "%-12s %-9s %6s %8s | %7s %7s | %7s | %6s %7s | %7s %7s\n",
+            "", "", "", "", "ms", "ms", "%", "%", "changes", "stddev", "p99 ms" );
+}
+
+static void PrintVrrResult( const char* name, const Config& config, const Result& result )
+{
+    char limit[ 16 ];
+    printf( "%-12s %-9s %6s %8.1f | %7.2f %7.2f | %7.1f | %6.1f %7u | %7.2f %7.2f\n",
+            name, BackendName( config.backend ), LimitName( config.maxFPS, limit, sizeof( limit ) ), result.fps,
+            result.latencyMs.mean, result.latencyMs.p99, result.overCeilingPercent, result.compensatedPercent,
+            result.compensationSwitches, result.presentIntervalMs.stddev, result.presentIntervalMs.p99 );
+}
+
+// Limits on variable refresh rate displays. The ceiling column counts the frames done before the display could refresh
+// again: with VSync off they tear, with VSync on they wait, which builds a queue. On the first display the refresh rate
+// is not a whole number, so a whole limit is either past it or up to a frame per second short; a limit below the refresh
+// rate follows it exactly and needs to be as far below it as the present times vary. On the second the game runs at the
+// bottom of the range, and the lfc columns count the frames the display repeated the previous frame for and how often
+// that started or stopped. Limits in the band around the bottom are moved below it.
+static void RunVrr( const Config& base )
+{
+    struct Scenario
+    {
+        const char*     name;
+        Timestamp       simulation, render, gpu;
+        int             jitterPercent;
+        double          vrrHz, vrrMinHz;
+        unsigned int    limits[ 6 ];
+    };
+    const Scenario scenarios[] =
+    {
+        { "vrr-143.86", 1 * kMillisecond, 2 * kMillisecond,  5 * kMillisecond, 5, 144000.0 / 1001.0, 48.0,
+          { 0, 144, 143, AMD::AntiLag2::MakeMaxFPSBelowRefresh( 3.0 ), AMD::AntiLag2::MakeMaxFPSBelowRefresh( 6.0 ), AMD::AntiLag2::kMaxFPSAdaptive } },
+        { "vrr-lfc",    2 * kMillisecond, 3 * kMillisecond, 20 * kMillisecond, 5, 144.0, 48.0,
+          { 0, 48, AMD::AntiLag2::MakeMaxFPS( 49.5 ), AMD::AntiLag2::kMaxFPSAdaptive } },
+    };
+    const Backend backends[] = { Backend::Software, Backend::Driver };
+
+    PrintVrrHeader();
+    for ( const Scenario& scenario : scenarios )
+    {
+        for ( Backend backend : backends )
+        {
+            for ( size_t i = 0; i < sizeof( scenario.limits ) / sizeof( scenario.limits[ 0 ] ); ++i )
+            {
+                if ( i && scenario.limits[ i ] == 0 )
+                {
+                    continue;
+                }
+                Config config = base;
+                config.workload.simulation = scenario.simulation;
+                config.workload.render = scenario.render;
+                config.workload.gpu = scenario.gpu;
+                config.workload.jitterPercent = scenario.jitterPercent;
+                config.vrrHz = scenario.vrrHz;
+                config.vrrMinHz = scenario.vrrMinHz;
+                config.backend = backend;
+                config.maxFPS = scenario.limits[ i ];
+                config.frames = 3 * base.frames;
+                PrintVrrResult( scenario.name, config, Run( config ) );
+            }
+        }
+    }
+}
+
+static void PrintRenderThreadHeader()
+{
+    printf( "%-12s %-9s %-6s %6s %8s | %7s %7s | %6s | %7s %7s %6s\n",
+            "workload", "backend", "loop", "maxfps", "fps", "mean", "p99", "frames", "delay", "packet", "gpuidle" );
+    printf( "%-12s %-9s %-6s %6s %8s | %7s %7s | %6s | %7s %7s %6s\n",
+            "", "", "", "", "", "ms", "ms", "mean", "ms", "wait ms", "%" );
+}
+
+static void PrintRenderThreadResult( const char* name, const Config& config, const Result& result )
+{
+    char limit[ 16 ];
+    printf( "%-12s %-9s %-6s %6s %8.1f | %7.2f %7.2f | %6.2f | %7.2f %7.2f %6.1f\n",
+            name, BackendName( config.backend ), config.renderThread ? "render" : "single", LimitName( config.maxFPS, limit, sizeof( limit ) ),
+            result.fps, result.latencyMs.mean, result.latencyMs.p99, result.latencyFrames.mean, result.delayMs,
+            result.packetWaitMs, result.gpuIdlePercent );
+}
+
+// A single game thread against a game thread that hands each frame to a render thread, which submits it and presents
+// while the next frame is simulated. When the CPU is the bottleneck this overlaps the simulation with the submission;
+// the packet queue adds a frame of latency that the delay in Update() has to take back. The driver sees the Present()
+// on the render thread block and drains the whole pipeline. The software backend only sees the game thread wait for
+// the render thread, so it drains the packet queue but not the GPU queue behind it.
+static void RunRenderThread( const Config& base )
+{
+    struct Scenario
+    {
+        const char*     name;
+        Timestamp       preInput, simulation, render, gpu;
+    };
+    const Scenario scenarios[] =
+    {
+        { "cpu-bound",  1 * kMillisecond, 5 * kMillisecond, 5 * kMillisecond,  6 * kMillisecond },
+        { "gpu-bound",  1 * kMillisecond, 2 * kMillisecond, 3 * kMillisecond, 12 * kMillisecond },
+    };
+    const Backend backends[] = { Backend::None, Backend::Software, Backend::Driver };
+
+    PrintRenderThreadHeader();
+    for ( const Scenario& scenario : scenarios )
+    {
+        for ( Backend backend : backends )
+        {
+            for ( int renderThread = 0; renderThread < 2; ++renderThread )
+            {
+                Config config = base;
+                config.workload.preInput = scenario.preInput;
+                config.workload.simulation = scenario.simulation;
+                config.workload.render = scenario.render;
+                config.workload.gpu = scenario.gpu;
+                config.backend = backend;
+                config.renderThread = renderThread != 0;
+                PrintRenderThreadResult( scenario.name, config, Run( config ) );
+            }
+        }
+    }
+}
+
+static void RunMatrix( const Config& base )
+{
+    struct Scenario
+    {
+        const char*     name;
+        Timestamp       preInput, simulation, render, gpu;
+    };
+    const Scenario scenarios[] =
+    {
+        { "gpu-bound",  1 * kMillisecond, 2 * kMillisecond, 3 * kMillisecond, 12 * kMillisecond },
+        { "cpu-bound",  2 * kMillisecond, 5 * kMillisecond, 6 * kMillisecond,  7 * kMillisecond },
+        { "balanced",   1 * kMillisecond, 3 * kMillisecond, 4 * kMillisecond,  8 * kMillisecond },
+    };
+    const Backend backends[] = { Backend::None, Backend::Software, Backend::Driver };
+    const unsigned int limits[] = { 0, 60 };
+
+    PrintHeader();
+    for ( const Scenario& scenario : scenarios )
+    {
+        for ( unsigned int limit : limits )
+        {
+            for ( Backend backend : backends )
+            {
+                if ( backend == Backend::None && limit )
+                {
+                    continue;
+                }
+                Config config = base;
+                config.workload.preInput = scenario.preInput;
+                config.workload.simulation = scenario.simulation;
+                config.workload.render = scenario.render;
+                config.workload.gpu = scenario.gpu;
+                config.backend = backend;
+                config.maxFPS = limit;
+                PrintResult( scenario.name, config, Run( config ) );
+            }
+        }
+    }
+
+    // Update() placement, with a GPU-bound workload and a significant amount of pre-input work
+    printf( "\n" );
+    PrintHeader();
+    const Placement placements[] = { Placement::BeforeInput, Placement::FrameStart, Placement::AfterInput };
+    for ( Placement placement : placements )
+    {
+        Config config = base;
+        config.workload.preInput = 4 * kMillisecond;
+        config.workload.gpu = 12 * kMillisecond;
+        config.backend = Backend::Driver;
+        config.placement = placement;
+        PrintResult( "placement", config, Run( config ) );
+    }
+
+    printf( "\n" );
+    RunAdaptive( base );
+
+    printf( "\n" );
+    RunFrameGeneration( base );
+
+    printf( "\n" );
+    RunHitches( base );
+
+    printf( "\n" );
+    RunSplitDelay( base );
+
+    printf( "\n" );
+    RunVrr( base );
+
+    printf( "\n" );
+    RunRenderThread( base );
+}
+
+static unsigned int ParseLimit( const char* value )
+{
+    if ( !strcmp( value, "auto" ) )
+    {
+        return AMD::AntiLag2::kMaxFPSAdaptive;
+    }
+    if ( !strncmp( value, "r-", 2 ) )
+    {
+        return AMD::AntiLag2::MakeMaxFPSBelowRefresh( atof( value + 2 ) );
+    }
+    return strchr( value, '.' ) ? AMD::AntiLag2::MakeMaxFPS( atof( value ) ) : (unsigned int)atoi( value );
+}
+
+static void PrintUsage()
+{
+    printf( "Usage: PipelineSim [options]\n"
+            "  --backend off|software|driver    Anti-Lag implementation (default: run the scenario matrix)\n"
+            "  --placement before-input|frame-start|after-input\n"
+            "  --maxfps N|auto|r-N               framerate limit passed to Update(), 0 = off, auto = adaptive limiter,\n"
+            "                                    r-N = N Hz below the refresh rate; N may have a fraction\n"
+            "  --preinput MS --sim MS --render MS --gpu MS\n"
+            "                                    per-frame cost of each stage\n"
+            "  --jitter PERCENT                  random variation of each stage\n"
+            "  --sim-jitter PERCENT              random variation of the simulation alone\n"
+            "  --vsync HZ                        refresh rate, 0 = VSync off\n"
+            "  --vrr HZ                          maximum refresh rate of a variable refresh rate display\n"
+            "  --vrr-min HZ                      bottom of its range, where low framerate compensation starts\n"
+            "  --gpu-step MS --step-frame N      GPU cost added from frame N on\n"
+            "  --display MS                      scanout and panel latency\n"
+            "  --queue N                         maximum frame latency\n"
+            "  --no-markers                      do not call MarkEndOfFrameRendering\n"
+            "  --split                           split the delay between Update() and the RenderSubmitStart marker\n"
+            "  --render-thread                   submit the rendering and present on a render thread\n"
+            "  --render-queue N                  frame packets the game thread can queue ahead of it (default: 1)\n"
+            "  --framegen --no-pacing            present an interpolated frame before every real one, back to back\n"
+            "  --interpolation MS                GPU cost of the interpolated frame\n"
+            "  --hitch MS --hitch-every N        CPU stall added to every Nth frame\n"
+            "  --hitch-length N                  number of consecutive frames that stall\n"
+            "  --no-rejection                    turn off the hitch rejection of the software backend\n"
+            "  --frames N --seed N\n"
+            "  --histogram                       print the latency histogram\n" );
+}
+
+int main( int argc, char** argv )
+{
+    Config config;
+    bool single = false;
+    bool histogram = false;
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        const char* arg = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+        auto ms = [&value]() { return (Timestamp)( atof( value ) * kMillisecond ); };
+
+        if ( !strcmp( arg, "--histogram" ) )
+        {
+            histogram = true;
+            single = true;
+        }
+        else if ( !strcmp( arg, "--no-markers" ) )
+        {
+            config.endOfFrameMarkers = false;
+        }
+        else if ( !strcmp( arg, "--framegen" ) )
+        {
+            config.frameGeneration = true;
+            single = true;
+        }
+        else if ( !strcmp( arg, "--no-pacing" ) )
+        {
+            config.framePacing = false;
+        }
+        else if ( !strcmp( arg, "--split" ) )
+        {
+            config.splitDelay = true;
+            single = true;
+        }
+        else if ( !strcmp( arg, "--render-thread" ) )
+        {
+            config.renderThread = true;
+            single = true;
+        }
+        else if ( !strcmp( arg, "--no-rejection" ) )
+        {
+            config.software.hitchPermille = 0;
+        }
+        else if ( !value )
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            if ( !strcmp( arg, "--backend" ) )
+            {
+                config.backend = !strcmp( value, "off" ) ? Backend::None : !strcmp( value, "driver" ) ? Backend::Driver : Backend::Software;
+                single = true;
+            }
+            else if ( !strcmp( arg, "--placement" ) )
+            {
+                config.placement = !strcmp( value, "frame-start" ) ? Placement::FrameStart : !strcmp( value, "after-input" ) ? Placement::AfterInput : Placement::BeforeInput;
+                single = true;
+            }
+            else if ( !strcmp( arg, "--maxfps" ) )   config.maxFPS = ParseLimit( value );
+            else if ( !strcmp( arg, "--preinput" ) ) config.workload.preInput = ms();
+            else if ( !strcmp( arg, "--sim" ) )      config.workload.simulation = ms();
+            else if ( !strcmp( arg, "--render" ) )   config.workload.render = ms();
+            else if ( !strcmp( arg, "--gpu" ) )      config.workload.gpu = ms();
+            else if ( !strcmp( arg, "--interpolation" ) ) config.workload.interpolation = ms();
+            else if ( !strcmp( arg, "--jitter" ) )   config.workload.jitterPercent = atoi( value );
+            else if ( !strcmp( arg, "--sim-jitter" ) ) config.workload.simulationJitterPercent = atoi( value );
+            else if ( !strcmp( arg, "--vsync" ) )    config.refreshHz = atof( value );
+            else if ( !strcmp( arg, "--vrr" ) )      config.vrrHz = atof( value );
+            else if ( !strcmp( arg, "--vrr-min" ) )  config.vrrMinHz = atof( value );
+            else if ( !strcmp( arg, "--gpu-step" ) ) config.workload.gpuStep = ms();
+            else if ( !strcmp( arg, "--step-frame" ) ) config.workload.stepFrame = (unsigned int)atoi( value );
+            else if ( !strcmp( arg, "--hitch" ) )    config.workload.hitch = ms();
+            else if ( !strcmp( arg, "--hitch-every" ) ) config.workload.hitchEvery = (unsigned int)atoi( value );
+            else if ( !strcmp( arg, "--hitch-length" ) ) config.workload.hitchLength = (unsigned int)atoi( value );
+            else if ( !strcmp( arg, "--display" ) )  config.displayLatency = ms();
+            else if ( !strcmp( arg, "--queue" ) )    config.maxFrameLatency = (unsigned int)atoi( value );
+            else if ( !strcmp( arg, "--render-queue" ) ) config.renderQueue = (unsigned int)atoi( value );
+            else if ( !strcmp( arg, "--frames" ) )   config.frames = (unsigned int)atoi( value );
+            else if ( !strcmp( arg, "--seed" ) )     config.seed = strtoull( value, nullptr, 10 );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+            ++i;
+        }
+    }
+
+    if ( config.frames <= config.warmupFrames )
+    {
+        config.warmupFrames = config.frames / 10;
+    }
+
+    if ( !single )
+    {
+        RunMatrix( config );
+        return 0;
+    }
+
+    Result result = Run( config );
+    PrintHeader();
+    PrintResult( "custom", config, result );
+    if ( config.maxFPS == AMD::AntiLag2::kMaxFPSAdaptive )
+    {
+        printf( "\n" );
+        PrintAdaptiveHeader();
+        PrintAdaptiveResult( "custom", config, result );
+    }
+    if ( config.frameGeneration )
+    {
+        printf( "\n" );
+        PrintFrameGenerationHeader();
+        PrintFrameGenerationResult( "custom", config, result );
+    }
+    if ( config.workload.hitch && config.workload.hitchEvery )
+    {
+        printf( "\n" );
+        PrintHitchHeader();
+        PrintHitchResult( "custom", config, result );
+    }
+    if ( config.splitDelay )
+    {
+        printf( "\n" );
+        PrintSplitDelayHeader();
+        PrintSplitDelayResult( "custom", config, result );
+    }
+    if ( config.vrrHz > 0.0 )
+    {
+        printf( "\n" );
+        PrintVrrHeader();
+        PrintVrrResult( "custom", config, result );
+    }
+    if ( config.renderThread )
+    {
+        printf( "\n" );
+        PrintRenderThreadHeader();
+        PrintRenderThreadResult( "custom", config, result );
+    }
+    if ( histogram )
+    {
+        PrintHistogram( result, config.warmupFrames );
+    }
+    return 0;
+}
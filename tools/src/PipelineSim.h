@@ -0,0 +1,729 @@
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: PipelineSim.h
+//
+// Deterministic simulator of a game loop: input sample, simulation, render submission,
+// GPU execution, flip queue and scanout. Time is virtual, so the results only depend on
+// the configuration and the random seed. The game calls the SDK's own front end,
+// AMD::AntiLag2::Context, which runs on the virtual clock against a mock of the driver.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "../../ffx_antilag2.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace PipelineSim
+{
+    using AMD::AntiLag2::Timestamp;
+    using AMD::AntiLag2::kMillisecond;
+    using AMD::AntiLag2::kSecond;
+
+    //--------------------------------------------------------------------------------------
+    // xorshift64* random numbers - identical sequences on every platform for a given seed
+    //--------------------------------------------------------------------------------------
+    class Random
+    {
+    public:
+        explicit Random( uint64_t seed ) : m_state( seed ? seed : 0x9e3779b97f4a7c15ull ) {}
+
+        uint64_t Next()
+        {
+            m_state ^= m_state >> 12;
+            m_state ^= m_state << 25;
+            m_state ^= m_state >> 27;
+            return m_state * 0x2545f4914f6cdd1dull;
+        }
+
+        // Uniform value in [0, 1)
+        double Uniform()
+        {
+            return ( Next() >> 11 ) * ( 1.0 / 9007199254740992.0 );
+        }
+
+        // mean +/- jitterPercent, uniformly distributed
+        Timestamp Jitter( Timestamp mean, int jitterPercent )
+        {
+            double scale = 1.0 + ( Uniform() * 2.0 - 1.0 ) * jitterPercent / 100.0;
+            return (Timestamp)( mean * scale );
+        }
+
+    private:
+        uint64_t m_state;
+    };
+
+    // Per-frame cost of each pipeline stage
+    struct Workload
+    {
+        Timestamp   preInput = 1 * kMillisecond;    // CPU work done before the input is polled
+        Timestamp   simulation = 2 * kMillisecond;  // CPU work between the input poll and render submission
+        Timestamp   render = 3 * kMillisecond;      // CPU render submission
+        Timestamp   gpu = 10 * kMillisecond;        // GPU execution
+        Timestamp   interpolation = kMillisecond;   // GPU frame interpolation, with frame generation only
+        int         jitterPercent = 10;
+        int         simulationJitterPercent = -1;   // jitter of the simulation alone, -1 for jitterPercent
+        Timestamp   gpuStep = 0;                    // added to the GPU execution time from stepFrame on
+        unsigned int stepFrame = 0;
+        Timestamp   hitch = 0;                      // CPU stall (shader compilation, streaming) in the simulation of every hitchEvery-th frame
+        unsigned int hitchEvery = 0;
+        unsigned int hitchLength = 1;               // number of consecutive frames that stall
+    };
+
+    // Where the game calls Update() relative to the input poll
+    enum class Placement
+    {
+        BeforeInput,    // correct: just before the input is polled
+        FrameStart,     // at the start of the frame, before the pre-input work
+        AfterInput,     // after the input is polled - the delay ends up adding latency
+    };
+
+    enum class Backend
+    {
+        None,           // Update() is not called
+        Software,       // the SDK's CPU-only latency model
+        Driver,         // idealized driver: knows when the GPU will be idle
+    };
+
+    struct Config
+    {
+        Workload        workload;
+        Placement       placement = Placement::BeforeInput;
+        Backend         backend = Backend::Software;
+        bool            enable = true;
+        unsigned int    maxFPS = 0;                     // AMD::AntiLag2::kMaxFPSAdaptive runs the adaptive limiter
+        unsigned int    maxFrameLatency = 3;            // frames the CPU can queue ahead of the display
+        double          refreshHz = 0.0;                // 0 disables VSync
+        double          vrrHz = 0.0;                    // VSync off: maximum refresh rate of a variable refresh rate display, 0 = none
+        double          vrrMinHz = 0.0;                 // bottom of its range, below which it repeats frames on its own, 0 = none
+        Timestamp       displayLatency = 0;             // scanout and panel latency added to every frame
+        bool            endOfFrameMarkers = true;       // whether MarkEndOfFrameRendering is called
+        bool            splitDelay = false;             // the delay is split between Update() and the RenderSubmitStart marker
+        bool            frameGeneration = false;        // an interpolated frame is presented before every real one
+        bool            framePacing = true;             // frame generation: present through FrameGenPacer instead of back to back
+        bool            renderThread = false;           // the render submission and Present run on a thread of their own
+        unsigned int    renderQueue = 1;                // render thread: frame packets the game thread can queue ahead of it
+        AMD::AntiLag2::SoftwareLatencyModel::Settings software; // settings of the software backend
+        unsigned int    frames = 2000;
+        unsigned int    warmupFrames = 200;             // frames excluded from the statistics
+        uint64_t        seed = 1;
+    };
+
+    // Timeline of a single frame
+    struct FrameRecord
+    {
+        Timestamp   frameStart = 0;
+        Timestamp   updateEntry = 0;
+        Timestamp   updateReturn = 0;
+        Timestamp   inputSample = 0;
+        Timestamp   renderSubmit = 0;                   // the render submission starts, the last input sample of the frame
+        Timestamp   splitDelay = 0;                     // late half of a split delay, just before renderSubmit
+        Timestamp   packetWait = 0;                     // render thread: the game thread waited for room in the packet queue
+        Timestamp   endOfFrame = 0;
+        Timestamp   presentReturn = 0;
+        Timestamp   gpuStart = 0;
+        Timestamp   gpuDone = 0;
+        Timestamp   photon = 0;
+        Timestamp   interpolatedPhoton = 0;             // frame generation only
+        unsigned int maxFPS = 0;                        // limit the frame was started with, rounded down
+        bool        overCeiling = false;                // VRR: done before the display could refresh again, tears with VSync off
+        bool        compensated = false;                // VRR: the display repeated the previous frame before this one
+
+        Timestamp   Delay() const   { return updateReturn - updateEntry; }
+        Timestamp   Latency() const { return photon - inputSample; }
+        Timestamp   LateLatency() const { return photon - renderSubmit; }
+    };
+
+    struct Distribution
+    {
+        double      mean = 0.0;
+        double      p50 = 0.0;
+        double      p95 = 0.0;
+        double      p99 = 0.0;
+        double      max = 0.0;
+        double      stddev = 0.0;
+    };
+
+    struct Result
+    {
+        std::vector<FrameRecord>    frames;
+        double                      fps = 0.0;
+        Distribution                latencyMs;          // input-to-photon
+        Distribution                lateLatencyMs;      // render submission start to photon, for input sampled late in the frame
+        Distribution                latencyFrames;      // input-to-photon in units of the frame interval
+        double                      latencyEstimate = 0.0;  // mean of the SDK's FrameLatencyEstimator, fed the photon times
+        Distribution                presentIntervalMs;  // between consecutive frames on screen, interpolated ones included
+        double                      delayMs = 0.0;      // mean delay inserted by Update()
+        double                      splitDelayMs = 0.0; // mean late half of a split delay
+        double                      packetWaitMs = 0.0; // render thread: mean wait of the game thread for room in the packet queue
+        double                      gpuIdlePercent = 0.0;
+        double                      overCeilingPercent = 0.0;   // VRR: frames faster than the top of the range
+        double                      compensatedPercent = 0.0;   // VRR: frames after a repeat below the bottom of the range
+        unsigned int                compensationSwitches = 0;   // VRR: how often the repeats started or stopped
+        unsigned int                limitChanges = 0;   // adaptive limiter only
+        unsigned int                settleFrame = 0;    // first frame the limit is within 5% of where it settles
+        unsigned int                hitches = 0;        // hitches after the warm-up
+        double                      hitchLatencyMs = 0.0;   // mean latency of the kHitchWindow frames after a hitch
+        double                      recoveryFrames = 0.0;   // mean frames after a hitch until the latency is back to normal
+    };
+
+    // Frames after a hitch that hitchLatencyMs is taken over
+    static const unsigned int kHitchWindow = 30;
+
+    //--------------------------------------------------------------------------------------
+    // Mock of the Anti-Lag interface. Follows the UpdateAntiLagState contract: a state
+    // packet when the settings change, a null call every frame to insert the delay and
+    // end-of-frame signals from the render thread. The delay is returned as a wake-up time
+    // on the virtual clock instead of blocking.
+    //--------------------------------------------------------------------------------------
+    class MockAntiLagApi
+    {
+    public:
+        MockAntiLagApi( Backend backend, const AMD::AntiLag2::SoftwareLatencyModel::Settings& settings, bool splitDelay )
+            : m_backend( backend ), m_splitDelay( splitDelay && backend == Backend::Software ), m_software( settings ) {}
+
+        // APIData_v1
+        void SetState( bool enabled, unsigned int maxFPS )
+        {
+            // Like the real one, the idealized driver takes whole frames per second only
+            m_enabled = enabled;
+            m_limiterInterval = AMD::AntiLag2::GetMaxFPSInterval( AMD::AntiLag2::GetWholeMaxFPS( maxFPS ) );
+            m_software.SetState( enabled, maxFPS );
+        }
+
+        // UpdateAntiLagState( nullptr ) - returns the time the input is sampled at
+        Timestamp InsertDelay( Timestamp now )
+        {
+            Timestamp wake = now;
+            if ( m_backend == Backend::Software && m_splitDelay )
+            {
+                wake = m_software.BeginEarlyDelay( now );
+                m_software.EndEarlyDelay( wake );
+            }
+            else if ( m_backend == Backend::Software )
+            {
+                wake = m_software.BeginDelay( now );
+                m_software.EndDelay( wake );
+            }
+            else if ( m_backend == Backend::Driver && m_enabled )
+            {
+                // Start the frame so that its submission completes just as the GPU runs out of work
+                Timestamp deadline = m_gpuIdle - m_cpuTime - kDriverMargin;
+                if ( m_limiterInterval && m_lastSample + m_limiterInterval > deadline )
+                {
+                    deadline = m_lastSample + m_limiterInterval;
+                }
+                wake = std::max( now, deadline );
+            }
+            m_lastSample = wake;
+            return wake;
+        }
+
+        // The late half of a split delay at the RenderSubmitStart marker - returns the time the render submission starts.
+        // Like the driver backend of the SDK, the idealized driver keeps the whole delay in InsertDelay.
+        Timestamp InsertSplitDelay( Timestamp now )
+        {
+            if ( !m_splitDelay )
+            {
+                return now;
+            }
+            const Timestamp wake = m_software.BeginDelay( now );
+            m_software.EndDelay( wake );
+            return wake;
+        }
+
+        // APIData_v2 with signalEndOfFrameIdx
+        void MarkEndOfFrame( Timestamp now )
+        {
+            m_software.MarkEndOfFrame( now );
+        }
+
+        // The driver sees the submissions and the GPU queue, the software model does not
+        void OnGpuScheduled( Timestamp submit, Timestamp gpuDone )
+        {
+            const Timestamp cpuTime = submit - m_lastSample;
+            m_cpuTime = m_cpuTime ? m_cpuTime + ( cpuTime - m_cpuTime ) / 8 : cpuTime;
+            m_gpuIdle = gpuDone;
+        }
+
+    private:
+        static const Timestamp              kDriverMargin = kMillisecond / 2;
+
+        Backend                             m_backend;
+        bool                                m_splitDelay;
+        bool                                m_enabled = false;
+        Timestamp                           m_limiterInterval = 0;
+        Timestamp                           m_lastSample = 0;
+        Timestamp                           m_gpuIdle = 0;
+        Timestamp                           m_cpuTime = 0;
+        AMD::AntiLag2::SoftwareLatencyModel m_software;
+    };
+
+    // Virtual time of the front end. Waiting moves it forward instead of blocking.
+    class SimClock
+    {
+    public:
+        Timestamp   Now() const                     { return m_now; }
+        void        WaitUntil( Timestamp deadline ) { m_now = std::max( m_now, deadline ); }
+        void        Set( Timestamp now )            { m_now = now; }
+
+    private:
+        Timestamp   m_now = 0;
+    };
+
+    // Backend of the front end passing its calls to the mock at the time of the virtual clock. The delays move the clock to
+    // the time the mock returns.
+    class SimBackend
+    {
+    public:
+        static const bool kActive = true;
+
+        HRESULT         Initialize( MockAntiLagApi* api, SimClock* clock )  { m_api = api; m_clock = clock; return S_OK; }
+        bool            IsInitialized() const                   { return m_api != nullptr; }
+        unsigned int    DeInitialize()                          { m_api = nullptr; return 0; }
+        HRESULT         SetState( bool enabled, unsigned int maxFPS )   { m_maxFPS = maxFPS; m_api->SetState( enabled, maxFPS ); return S_OK; }
+        HRESULT         InsertDelay()                           { m_clock->Set( m_api->InsertDelay( m_clock->Now() ) ); return S_OK; }
+        HRESULT         BeginDelay( Timestamp* )                { return S_FALSE; }
+        HRESULT         EndDelay()                              { return S_FALSE; }
+        HRESULT         SignalInputSample( std::uint64_t )      { return S_OK; }
+        HRESULT         MarkEndOfFrame( std::uint64_t )         { m_api->MarkEndOfFrame( m_clock->Now() ); return S_OK; }
+        HRESULT         SetFrameType( bool, std::uint64_t )     { return S_OK; }
+        HRESULT         InsertSplitDelay( std::uint64_t )       { m_clock->Set( m_api->InsertSplitDelay( m_clock->Now() ) ); return S_OK; }
+
+        // Limit last passed to SetState
+        unsigned int    GetMaxFPS() const                       { return m_maxFPS; }
+
+    private:
+        MockAntiLagApi* m_api = nullptr;
+        SimClock*       m_clock = nullptr;
+        unsigned int    m_maxFPS = 0;
+    };
+
+    typedef AMD::AntiLag2::Context<SimBackend, SimClock> SimContext;
+
+    // Time between two Present calls made back to back
+    static const Timestamp kBackToBackPresent = kMillisecond / 5;
+
+    inline double ToMs( Timestamp t )
+    {
+        return t / (double)kMillisecond;
+    }
+
+    inline Distribution Summarize( std::vector<double> values )
+    {
+        Distribution d;
+        if ( values.empty() )
+        {
+            return d;
+        }
+        std::sort( values.begin(), values.end() );
+        double sum = 0.0;
+        for ( double v : values )
+        {
+            sum += v;
+        }
+        auto percentile = [&values]( double p ) { return values[ std::min( values.size() - 1, (size_t)( p * values.size() ) ) ]; };
+        d.mean = sum / values.size();
+        double squares = 0.0;
+        for ( double v : values )
+        {
+            squares += ( v - d.mean ) * ( v - d.mean );
+        }
+        d.stddev = std::sqrt( squares / values.size() );
+        d.p50 = percentile( 0.50 );
+        d.p95 = percentile( 0.95 );
+        d.p99 = percentile( 0.99 );
+        d.max = values.back();
+        return d;
+    }
+
+    inline bool IsHitch( const Workload& w, unsigned int frame )
+    {
+        return w.hitch && w.hitchEvery && frame >= w.hitchEvery && frame % w.hitchEvery < w.hitchLength;
+    }
+
+    // How the latency recovers after the hitches: the latency is back to normal once three frames in a row are within 10% of
+    // the median latency of the frames that are not close to a hitch.
+    inline void SummarizeHitches( const Config& config, Result* result )
+    {
+        const Workload& w = config.workload;
+        const std::vector<FrameRecord>& frames = result->frames;
+        if ( !w.hitch || !w.hitchEvery )
+        {
+            return;
+        }
+        std::vector<Timestamp> normal;
+        unsigned int sinceHitch = kHitchWindow;
+        for ( unsigned int i = config.warmupFrames; i < frames.size(); ++i )
+        {
+            sinceHitch = IsHitch( w, i ) ? 0 : sinceHitch + 1;
+            if ( sinceHitch > kHitchWindow )
+            {
+                normal.push_back( frames[ i ].Latency() );
+            }
+        }
+        if ( normal.empty() )
+        {
+            return;
+        }
+        std::sort( normal.begin(), normal.end() );
+        const Timestamp limit = normal[ normal.size() / 2 ] + normal[ normal.size() / 2 ] / 10;
+
+        double latency = 0.0;
+        unsigned int latencyCount = 0;
+        unsigned int recovery = 0;
+        for ( unsigned int i = config.warmupFrames; i + w.hitchLength + kHitchWindow + 2 < frames.size(); ++i )
+        {
+            if ( !IsHitch( w, i ) || IsHitch( w, i - 1 ) )
+            {
+                continue;
+            }
+            const unsigned int after = i + w.hitchLength;
+            for ( unsigned int j = after; j < after + kHitchWindow; ++j )
+            {
+                latency += ToMs( frames[ j ].Latency() );
+                latencyCount++;
+            }
+            unsigned int k = 0;
+            while ( k < kHitchWindow && !( frames[ after + k ].Latency() <= limit && frames[ after + k + 1 ].Latency() <= limit &&
+                                           frames[ after + k + 2 ].Latency() <= limit ) )
+            {
+                k++;
+            }
+            recovery += k;
+            result->hitches++;
+        }
+        if ( result->hitches )
+        {
+            result->hitchLatencyMs = latency / latencyCount;
+            result->recoveryFrames = (double)recovery / result->hitches;
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Runs the simulation. Each frame's stages are resolved in event order:
+    // game thread -> render thread, if there is one -> GPU queue -> flip queue -> scanout.
+    //--------------------------------------------------------------------------------------
+    inline Result Run( const Config& config )
+    {
+        Random          random( config.seed );
+        // The split delay is only inserted on the thread calling Update(), which does not submit the rendering when there is a render thread.
+        MockAntiLagApi  api( config.backend, config.software, config.splitDelay && !config.renderThread );
+        std::unique_ptr<SimContext> context( new SimContext() );
+        SimClock&       clock = context->GetClock();
+        AMD::AntiLag2::FrameLatencyEstimator estimator;
+        context->Initialize( &api, &clock );
+        context->SetSplitDelay( config.splitDelay && !config.renderThread );
+        context->SetRefreshRate( config.vrrHz, config.vrrMinHz );
+
+        const Timestamp refresh = config.refreshHz > 0.0 ? (Timestamp)( kSecond / config.refreshHz ) : 0;
+        const Timestamp vrrInterval = config.vrrHz > 0.0 ? (Timestamp)( kSecond / config.vrrHz ) : 0;
+        const Timestamp lfcInterval = vrrInterval && config.vrrMinHz > 0.0 ? (Timestamp)( kSecond / config.vrrMinHz ) : 0;
+
+        Result result;
+        result.frames.resize( config.frames );
+
+        Timestamp cpuTime = 0;
+        Timestamp renderIdle = 0;
+        Timestamp gpuIdle = 0;
+        Timestamp gpuBusy = 0;
+        Timestamp lastFlip = 0;
+        Timestamp lastPresent = 0;
+        Timestamp presentInterval = 0;
+        double estimateSum = 0.0;
+        unsigned int estimateCount = 0;
+        for ( unsigned int i = 0; i < config.frames; ++i )
+        {
+            FrameRecord& frame = result.frames[ i ];
+            const Workload& w = config.workload;
+            frame.frameStart = cpuTime;
+
+            auto update = [&]( Timestamp now )
+            {
+                clock.Set( now );
+                if ( config.backend != Backend::None )
+                {
+                    context->Update( config.enable, config.maxFPS );
+                }
+                frame.updateEntry = now;
+                frame.updateReturn = clock.Now();
+                frame.maxFPS = AMD::AntiLag2::GetWholeMaxFPS( context->GetBackend().GetMaxFPS() );
+                return frame.updateReturn;
+            };
+
+            // Game thread
+            switch ( config.placement )
+            {
+                case Placement::FrameStart:
+                    cpuTime = update( cpuTime );
+                    cpuTime += random.Jitter( w.preInput, w.jitterPercent );
+                    frame.inputSample = cpuTime;
+                    break;
+                case Placement::BeforeInput:
+                    cpuTime += random.Jitter( w.preInput, w.jitterPercent );
+                    cpuTime = update( cpuTime );
+                    frame.inputSample = cpuTime;
+                    break;
+                case Placement::AfterInput:
+                    cpuTime += random.Jitter( w.preInput, w.jitterPercent );
+                    frame.inputSample = cpuTime;
+                    cpuTime = update( cpuTime );
+                    break;
+            }
+            cpuTime += random.Jitter( w.simulation, w.simulationJitterPercent < 0 ? w.jitterPercent : w.simulationJitterPercent );
+            if ( IsHitch( w, i ) )
+            {
+                cpuTime += w.hitch;
+            }
+            if ( config.renderThread )
+            {
+                // The game thread queues the frame packet and moves on to the next frame. With the queue full it waits for the
+                // render thread to take the packet renderQueue frames back, which it does once it has presented the frame before.
+                Timestamp push = cpuTime;
+                if ( i >= config.renderQueue )
+                {
+                    push = std::max( push, result.frames[ i - config.renderQueue ].renderSubmit );
+                }
+                frame.packetWait = push - cpuTime;
+                cpuTime = push;
+                frame.renderSubmit = std::max( push, renderIdle );
+            }
+            else
+            {
+                clock.Set( cpuTime );
+                if ( config.backend != Backend::None )
+                {
+                    context->SetLatencyMarker( AMD::AntiLag2::LatencyMarker::RenderSubmitStart, context->GetFrameIndex() );
+                }
+                frame.renderSubmit = clock.Now();
+                frame.splitDelay = frame.renderSubmit - cpuTime;
+            }
+            frame.endOfFrame = frame.renderSubmit + random.Jitter( w.render, w.jitterPercent );
+            if ( config.endOfFrameMarkers )
+            {
+                clock.Set( frame.endOfFrame );
+                context->MarkEndOfFrameRendering( context->GetFrameIndex() );
+            }
+
+            // GPU queue
+            frame.gpuStart = std::max( frame.endOfFrame, gpuIdle );
+            frame.gpuDone = frame.gpuStart + random.Jitter( w.gpu + ( i >= w.stepFrame ? w.gpuStep : 0 ), w.jitterPercent );
+            if ( config.frameGeneration )
+            {
+                frame.gpuDone += random.Jitter( w.interpolation, w.jitterPercent );
+            }
+            gpuBusy += frame.gpuDone - frame.gpuStart;
+            gpuIdle = frame.gpuDone;
+            api.OnGpuScheduled( frame.endOfFrame, frame.gpuDone );
+
+            // Flip queue and scanout: with VSync a frame is shown on the first vblank after it is
+            // done that has not been taken by the previous frame. A variable refresh rate display
+            // shows it when it is done, but no sooner than its shortest refresh interval after the
+            // previous one. Below the bottom of its range it shows the previous frame again. Low
+            // framerate compensation spreads the repeats evenly over the interval at which the game
+            // presents, so that a steady framerate lands between them. A frame that is late for
+            // that, or done while a repeat is being scanned out, waits for the repeat to finish.
+            auto scanout = [&]( Timestamp present )
+            {
+                Timestamp flip = present;
+                if ( refresh )
+                {
+                    flip = ( ( present + refresh - 1 ) / refresh ) * refresh;
+                    if ( flip <= lastFlip )
+                    {
+                        flip = lastFlip + refresh;
+                    }
+                }
+                else if ( vrrInterval && lastFlip )
+                {
+                    frame.overCeiling |= flip < lastFlip + vrrInterval;
+                    flip = std::max( flip, lastFlip + vrrInterval );
+                    if ( lfcInterval )
+                    {
+                        // Repeats planned from the present interval, then any the panel needs to stay in its range
+                        const Timestamp copies = ( presentInterval + lfcInterval - 1 ) / lfcInterval;
+                        Timestamp scan = lastFlip;
+                        for ( Timestamp n = 1; n < copies && lastFlip + n * presentInterval / copies < flip; ++n )
+                        {
+                            scan = lastFlip + n * presentInterval / copies;
+                        }
+                        while ( scan + lfcInterval < flip )
+                        {
+                            scan += lfcInterval;
+                        }
+                        if ( scan != lastFlip )
+                        {
+                            flip = std::max( flip, scan + vrrInterval );
+                            frame.compensated = true;
+                        }
+                    }
+                }
+                presentInterval = lastPresent ? present - lastPresent : 0;
+                lastPresent = present;
+                lastFlip = flip;
+                return flip + config.displayLatency;
+            };
+
+            // With frame generation the interpolated frame is presented first, either right away with the
+            // real frame just behind it, or when PaceFrameGenPresent lets it. Both frames are ready once the GPU is done.
+            if ( config.frameGeneration )
+            {
+                Timestamp interpolated = frame.gpuDone;
+                Timestamp real = frame.gpuDone + kBackToBackPresent;
+                if ( config.framePacing )
+                {
+                    clock.Set( frame.gpuDone );
+                    context->PaceFrameGenPresent( true, context->GetFrameIndex() );
+                    interpolated = clock.Now();
+                    clock.Set( frame.gpuDone );
+                    context->PaceFrameGenPresent( false, context->GetFrameIndex() );
+                    real = clock.Now();
+                }
+                frame.interpolatedPhoton = scanout( interpolated );
+                frame.photon = scanout( real );
+            }
+            else
+            {
+                frame.photon = scanout( frame.gpuDone );
+            }
+
+            float estimate = 0.0f;
+            estimator.AddFrame( i + 1, frame.inputSample, frame.photon );
+            if ( i >= config.warmupFrames && estimator.GetEstimate( &estimate ) )
+            {
+                estimateSum += estimate;
+                estimateCount++;
+            }
+
+            // Present blocks until the frame maxFrameLatency frames back has been retired
+            frame.presentReturn = frame.endOfFrame;
+            if ( i >= config.maxFrameLatency )
+            {
+                const FrameRecord& retired = result.frames[ i - config.maxFrameLatency ];
+                Timestamp retireTime = refresh || vrrInterval ? retired.photon - config.displayLatency : retired.gpuDone;
+                frame.presentReturn = std::max( frame.presentReturn, retireTime );
+            }
+            if ( config.renderThread )
+            {
+                renderIdle = frame.presentReturn;
+            }
+            else
+            {
+                cpuTime = frame.presentReturn;
+            }
+        }
+
+        // Statistics, excluding the warm-up frames
+        const unsigned int first = std::min( config.warmupFrames, config.frames ? config.frames - 1 : 0 );
+        std::vector<double> latencies;
+        std::vector<double> lateLatencies;
+        std::vector<double> presentIntervals;
+        double delay = 0.0;
+        double splitDelay = 0.0;
+        double packetWait = 0.0;
+        unsigned int overCeiling = 0;
+        unsigned int compensated = 0;
+        Timestamp lastPhoton = 0;
+        for ( unsigned int i = first; i < config.frames; ++i )
+        {
+            const FrameRecord& frame = result.frames[ i ];
+            overCeiling += frame.overCeiling ? 1 : 0;
+            compensated += frame.compensated ? 1 : 0;
+            if ( i > first && frame.compensated != result.frames[ i - 1 ].compensated )
+            {
+                result.compensationSwitches++;
+            }
+            latencies.push_back( ToMs( frame.Latency() ) );
+            lateLatencies.push_back( ToMs( frame.LateLatency() ) );
+            delay += ToMs( frame.Delay() );
+            splitDelay += ToMs( frame.splitDelay );
+            packetWait += ToMs( frame.packetWait );
+            if ( config.frameGeneration )
+            {
+                if ( lastPhoton )
+                {
+                    presentIntervals.push_back( ToMs( frame.interpolatedPhoton - lastPhoton ) );
+                }
+                lastPhoton = frame.interpolatedPhoton;
+            }
+            if ( lastPhoton )
+            {
+                presentIntervals.push_back( ToMs( frame.photon - lastPhoton ) );
+            }
+            lastPhoton = frame.photon;
+        }
+        result.presentIntervalMs = Summarize( presentIntervals );
+        if ( config.frames - first > 1 )
+        {
+            const FrameRecord& a = result.frames[ first ];
+            const FrameRecord& b = result.frames.back();
+            const double interval = ToMs( b.photon - a.photon ) / ( config.frames - 1 - first );
+            result.fps = 1000.0 / interval;
+            result.gpuIdlePercent = 100.0 * ( 1.0 - (double)gpuBusy / ( b.gpuDone - result.frames[ 0 ].gpuStart ) );
+
+            std::vector<double> frames( latencies );
+            for ( double& f : frames )
+            {
+                f /= interval;
+            }
+            result.latencyFrames = Summarize( frames );
+        }
+        result.latencyMs = Summarize( latencies );
+        result.lateLatencyMs = Summarize( lateLatencies );
+        SummarizeHitches( config, &result );
+        result.latencyEstimate = estimateCount ? estimateSum / estimateCount : 0.0;
+
+        // Convergence of the limit: the first frame it comes within 5% of its median over the last quarter of the run
+        if ( !result.frames.empty() )
+        {
+            std::vector<unsigned int> limits;
+            for ( unsigned int i = config.frames - config.frames / 4 - 1; i < config.frames; ++i )
+            {
+                limits.push_back( result.frames[ i ].maxFPS );
+            }
+            std::nth_element( limits.begin(), limits.begin() + limits.size() / 2, limits.end() );
+            const unsigned int settled = limits[ limits.size() / 2 ];
+            for ( unsigned int i = config.workload.stepFrame; i < config.frames; ++i )
+            {
+                const unsigned int limit = result.frames[ i ].maxFPS;
+                if ( ( limit > settled ? limit - settled : settled - limit ) * 20 <= settled )
+                {
+                    result.settleFrame = i;
+                    break;
+                }
+            }
+        }
+        result.limitChanges = context->GetLimiter().GetChangeCount();
+        result.delayMs = latencies.empty() ? 0.0 : delay / latencies.size();
+        result.splitDelayMs = latencies.empty() ? 0.0 : splitDelay / latencies.size();
+        result.packetWaitMs = latencies.empty() ? 0.0 : packetWait / latencies.size();
+        result.overCeilingPercent = latencies.empty() ? 0.0 : 100.0 * overCeiling / latencies.size();
+        result.compensatedPercent = latencies.empty() ? 0.0 : 100.0 * compensated / latencies.size();
+        return result;
+    }
+}
@@ -0,0 +1,338 @@
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: Replay.cpp
+//
+// Plays back a call log written by AMD::AntiLag2::CallRecorder against a mock driver or
+// the software implementation. With the recorded timing, the game's own work between the
+// calls is reproduced by waiting, so a different delay in the SDK moves the rest of the
+// frame the way it would in the game. Reports the call durations and frame times of the
+// recording next to those of the replay, and the calls whose result differs.
+//--------------------------------------------------------------------------------------
+
+#include "../../ffx_antilag2_record.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace AMD::AntiLag2;
+
+// Stands in for the driver: accepts every call and counts the delays it was asked for.
+class MockBackend
+{
+public:
+    static const bool kActive = true;
+
+    HRESULT         Initialize()                            { m_initialized = true; return S_OK; }
+    bool            IsInitialized() const                   { return m_initialized; }
+    unsigned int    DeInitialize()                          { m_initialized = false; return 0; }
+    HRESULT         SetState( bool, unsigned int )          { return S_OK; }
+    HRESULT         InsertDelay()                           { return S_OK; }
+    HRESULT         BeginDelay( Timestamp* deadline )       { *deadline = GetTimestamp(); return S_OK; }
+    HRESULT         EndDelay()                              { return S_OK; }
+    HRESULT         SignalInputSample( std::uint64_t )      { return S_OK; }
+    HRESULT         MarkEndOfFrame( std::uint64_t )         { return S_OK; }
+    HRESULT         SetFrameType( bool, std::uint64_t )     { return S_OK; }
+    HRESULT         InsertSplitDelay( std::uint64_t )       { return S_FALSE; }
+
+private:
+    bool            m_initialized = false;
+};
+
+enum class Timing
+{
+    Recorded,   // reproduce the time between the calls
+    Fast,       // back to back, to check the results only
+};
+
+static const int kTypeCount = (int)RecordedCallType::SetSplitDelay + 1;
+
+static const char* TypeName( RecordedCallType type )
+{
+    switch ( type )
+    {
+        case RecordedCallType::Initialize:              return "Initialize";
+        case RecordedCallType::DeInitialize:            return "DeInitialize";
+        case RecordedCallType::Update:                  return "Update()";
+        case RecordedCallType::UpdateWithState:         return "Update";
+        case RecordedCallType::SetState:                return "SetState";
+        case RecordedCallType::MarkEndOfFrameRendering: return "MarkEndOfFrameRendering";
+        case RecordedCallType::SetFrameGenFrameType:    return "SetFrameGenFrameType";
+        case RecordedCallType::PaceFrameGenPresent:     return "PaceFrameGenPresent";
+        case RecordedCallType::BeginUpdate:             return "BeginUpdate()";
+        case RecordedCallType::BeginUpdateWithState:    return "BeginUpdate";
+        case RecordedCallType::EndUpdate:               return "EndUpdate";
+        case RecordedCallType::SetLatencyMarker:        return "SetLatencyMarker";
+        case RecordedCallType::SetSplitDelay:           return "SetSplitDelay";
+    }
+    return "?";
+}
+
+static bool IsUpdate( RecordedCallType type )
+{
+    return type == RecordedCallType::Update || type == RecordedCallType::UpdateWithState || type == RecordedCallType::EndUpdate;
+}
+
+struct Replayed
+{
+    Timestamp       entry;
+    Timestamp       duration;
+    HRESULT         result;
+};
+
+template<class ContextType>
+static HRESULT Dispatch( ContextType& context, const RecordedCall& call, std::uint64_t frameIndex )
+{
+    switch ( call.type )
+    {
+        case RecordedCallType::Initialize:              return context.IsInitialized() ? S_OK : context.Initialize();
+        case RecordedCallType::DeInitialize:            return (HRESULT)context.DeInitialize();
+        case RecordedCallType::Update:                  return context.Update();
+        case RecordedCallType::UpdateWithState:         return context.Update( call.flag, call.maxFPS );
+        case RecordedCallType::SetState:                return context.SetState( call.flag, call.maxFPS );
+        case RecordedCallType::MarkEndOfFrameRendering: return context.MarkEndOfFrameRendering( frameIndex );
+        case RecordedCallType::SetFrameGenFrameType:    return context.SetFrameGenFrameType( call.flag, frameIndex );
+        case RecordedCallType::PaceFrameGenPresent:     return context.PaceFrameGenPresent( call.flag, frameIndex );
+        case RecordedCallType::BeginUpdate:             return context.BeginUpdate();
+        case RecordedCallType::BeginUpdateWithState:    return context.BeginUpdate( call.flag, call.maxFPS );
+        case RecordedCallType::EndUpdate:               return context.EndUpdate();
+        case RecordedCallType::SetLatencyMarker:        return context.SetLatencyMarker( (LatencyMarker)call.maxFPS, frameIndex );
+        case RecordedCallType::SetSplitDelay:           return context.SetSplitDelay( call.flag );
+    }
+    return E_INVALIDARG;
+}
+
+// The calls are replayed on one thread, in the order they were made. With the recorded timing each call waits until the time it
+// was made, shifted by how much earlier or later the last Update of the replay returned than the recorded one. The calls of the
+// render and presentation threads follow the frame they belong to that way.
+template<class ContextType>
+static std::vector<Replayed> Replay( ContextType& context, const std::vector<RecordedCall>& calls, Timing timing )
+{
+    std::vector<Replayed> replayed( calls.size() );
+    PreciseWait wait;
+    const Timestamp logStart = calls.front().entry;
+    const Timestamp replayStart = GetTimestamp();
+    Timestamp shift = 0;
+    std::int64_t frameOffset = 0;   // The recording may have started after the first frame.
+
+    if ( calls.front().type != RecordedCallType::Initialize )
+    {
+        context.Initialize();
+    }
+    for ( size_t i = 0; i < calls.size(); ++i )
+    {
+        const RecordedCall& call = calls[ i ];
+        if ( timing == Timing::Recorded )
+        {
+            wait.WaitUntil( replayStart + ( call.entry - logStart ) + shift );
+        }
+        const Timestamp entry = GetTimestamp();
+        const HRESULT result = Dispatch( context, call, call.frameIndex - frameOffset );
+        const Timestamp exit = GetTimestamp();
+        replayed[ i ] = { entry, exit - entry, result };
+
+        if ( IsUpdate( call.type ) )
+        {
+            frameOffset = (std::int64_t)( call.frameIndex - context.GetFrameIndex() );
+            shift = ( exit - replayStart ) - ( call.entry + call.duration - logStart );
+        }
+    }
+    return replayed;
+}
+
+struct Percentiles
+{
+    unsigned int    count = 0;
+    double          p50 = 0.0;
+    double          p99 = 0.0;
+    double          max = 0.0;
+};
+
+static Percentiles GetPercentiles( std::vector<Timestamp> values )
+{
+    Percentiles result;
+    if ( values.empty() )
+    {
+        return result;
+    }
+    std::sort( values.begin(), values.end() );
+    result.count = (unsigned int)values.size();
+    result.p50 = (double)values[ ( values.size() - 1 ) * 50 / 100 ] / kMillisecond;
+    result.p99 = (double)values[ ( values.size() - 1 ) * 99 / 100 ] / kMillisecond;
+    result.max = (double)values.back() / kMillisecond;
+    return result;
+}
+
+static void PrintRow( const char* name, const Percentiles& recorded, const Percentiles& replayed, unsigned int mismatches )
+{
+    printf( "%-24s %7u | %8.3f %8.3f %8.3f | %8.3f %8.3f %8.3f | %10u\n", name, recorded.count, recorded.p50, recorded.p99, recorded.max,
+            replayed.p50, replayed.p99, replayed.max, mismatches );
+}
+
+static void PrintReport( const std::vector<RecordedCall>& calls, const std::vector<Replayed>& replayed )
+{
+    printf( "%-24s %7s | %26s | %26s | %10s\n", "", "", "recorded", "replayed", "" );
+    printf( "%-24s %7s | %8s %8s %8s | %8s %8s %8s | %10s\n", "call", "count", "p50 ms", "p99 ms", "max ms", "p50 ms", "p99 ms", "max ms",
+            "different" );
+    for ( int t = 1; t < kTypeCount; ++t )
+    {
+        std::vector<Timestamp> recordedDurations;
+        std::vector<Timestamp> replayedDurations;
+        unsigned int mismatches = 0;
+        for ( size_t i = 0; i < calls.size(); ++i )
+        {
+            if ( (int)calls[ i ].type == t )
+            {
+                recordedDurations.push_back( calls[ i ].duration );
+                replayedDurations.push_back( replayed[ i ].duration );
+                mismatches += calls[ i ].result != (std::int32_t)replayed[ i ].result ? 1 : 0;
+            }
+        }
+        if ( !recordedDurations.empty() )
+        {
+            PrintRow( TypeName( (RecordedCallType)t ), GetPercentiles( recordedDurations ), GetPercentiles( replayedDurations ), mismatches );
+        }
+    }
+
+    // Frame time: from one Update to the next.
+    std::vector<Timestamp> recordedFrames;
+    std::vector<Timestamp> replayedFrames;
+    size_t previous = calls.size();
+    for ( size_t i = 0; i < calls.size(); ++i )
+    {
+        if ( IsUpdate( calls[ i ].type ) )
+        {
+            if ( previous < calls.size() )
+            {
+                recordedFrames.push_back( calls[ i ].entry - calls[ previous ].entry );
+                replayedFrames.push_back( replayed[ i ].entry - replayed[ previous ].entry );
+            }
+            previous = i;
+        }
+    }
+    PrintRow( "frame time", GetPercentiles( recordedFrames ), GetPercentiles( replayedFrames ), 0 );
+
+    printf( "\nlength: recorded %.3f s, replayed %.3f s\n", (double)( calls.back().entry + calls.back().duration - calls.front().entry ) / kSecond,
+            (double)( replayed.back().entry + replayed.back().duration - replayed.front().entry ) / kSecond );
+}
+
+static void Dump( const std::vector<RecordedCall>& calls )
+{
+    printf( "%14s %10s  %-24s %5s %6s %12s %10s\n", "time ms", "took ms", "call", "flag", "maxFPS", "frame", "result" );
+    for ( const RecordedCall& call : calls )
+    {
+        printf( "%14.3f %10.3f  %-24s %5d %6u %12llu 0x%08x\n", (double)( call.entry - calls.front().entry ) / kMillisecond,
+                (double)call.duration / kMillisecond, TypeName( call.type ), call.flag ? 1 : 0, call.maxFPS,
+                (unsigned long long)call.frameIndex, (unsigned int)call.result );
+    }
+}
+
+static void PrintUsage()
+{
+    printf( "Usage: Replay LOG [options]\n"
+            "  --backend mock|software   what to replay against (default: software)\n"
+            "  --timing recorded|fast    reproduce the time between the calls, or make them back to back (default: recorded)\n"
+            "  --dump                    print the calls instead of replaying them\n" );
+}
+
+int main( int argc, char** argv )
+{
+    if ( argc < 2 || argv[ 1 ][ 0 ] == '-' )
+    {
+        PrintUsage();
+        return 1;
+    }
+    const char* path = argv[ 1 ];
+    bool software = true;
+    bool dump = false;
+    Timing timing = Timing::Recorded;
+    for ( int i = 2; i < argc; ++i )
+    {
+        const char* arg = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : "";
+        if ( !strcmp( arg, "--dump" ) )
+        {
+            dump = true;
+        }
+        else if ( !strcmp( arg, "--backend" ) )
+        {
+            software = strcmp( value, "mock" ) != 0;
+            ++i;
+        }
+        else if ( !strcmp( arg, "--timing" ) )
+        {
+            timing = !strcmp( value, "fast" ) ? Timing::Fast : Timing::Recorded;
+            ++i;
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    CallLogReader reader;
+    if ( !reader.Open( path ) )
+    {
+        printf( "%s is not an Anti-Lag 2.0 call log.\n", path );
+        return 1;
+    }
+    std::vector<RecordedCall> calls;
+    RecordedCall call;
+    while ( reader.Read( &call ) )
+    {
+        calls.push_back( call );
+    }
+    if ( calls.empty() )
+    {
+        printf( "%s contains no calls.\n", path );
+        return 1;
+    }
+
+    // The calls of the different threads are written in the order they returned in.
+    std::stable_sort( calls.begin(), calls.end(), []( const RecordedCall& a, const RecordedCall& b ) { return a.entry < b.entry; } );
+    if ( dump )
+    {
+        Dump( calls );
+        return 0;
+    }
+
+    printf( "%s: %zu calls, replayed against the %s backend\n\n", path, calls.size(), software ? "software" : "mock" );
+    std::vector<Replayed> replayed;
+    if ( software )
+    {
+        std::unique_ptr<SoftwareContext> context( new SoftwareContext() );
+        replayed = Replay( *context, calls, timing );
+    }
+    else
+    {
+        std::unique_ptr<Context<MockBackend>> context( new Context<MockBackend>() );
+        replayed = Replay( *context, calls, timing );
+    }
+    PrintReport( calls, replayed );
+    return 0;
+}
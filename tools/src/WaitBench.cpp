@@ -0,0 +1,257 @@
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: WaitBench.cpp
+//
+// Measures how precisely a frame limiter hits its deadlines on this machine. Each mode
+// paces a busy loop at a range of framerate targets and reports the wake-up lateness
+// as a histogram, together with the drift of the whole run against the ideal schedule.
+//--------------------------------------------------------------------------------------
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#include "../../ffx_antilag2_wait.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace AMD::AntiLag2;
+
+enum class Mode
+{
+    Relative,   // sleep for the remainder of the interval, the way a naive limiter does it
+    Hybrid,     // PreciseWait against absolute deadlines, learning the spin threshold online
+    Calibrated, // PreciseWait, calibrated up front
+    Spin,       // spin for the whole wait
+};
+
+static const char* ModeName( Mode mode )
+{
+    switch ( mode )
+    {
+        case Mode::Relative:   return "relative";
+        case Mode::Hybrid:     return "hybrid";
+        case Mode::Calibrated: return "calibrated";
+        case Mode::Spin:       return "spin";
+    }
+    return "";
+}
+
+static const Timestamp kBuckets[] = { 10, 25, 50, 100, 250, 500, 1000 }; // microseconds
+static const int kBucketCount = sizeof( kBuckets ) / sizeof( kBuckets[ 0 ] ) + 1;
+
+struct Result
+{
+    double      fps = 0.0;
+    double      driftMs = 0.0;
+    double      meanUs = 0.0;
+    double      p99Us = 0.0;
+    double      maxUs = 0.0;
+    double      missPercent = 0.0;
+    unsigned    histogram[ kBucketCount ] = {};
+    Timestamp   spinThreshold = 0;
+};
+
+static void Busy( Timestamp duration )
+{
+    const Timestamp end = GetTimestamp() + duration;
+    while ( GetTimestamp() < end )
+    {
+    }
+}
+
+static Result Run( Mode mode, unsigned int fps, Timestamp duration, unsigned int workPercent, Timestamp tolerance )
+{
+    PreciseWait wait;
+    if ( mode == Mode::Calibrated )
+    {
+        wait.Calibrate();
+    }
+    wait.SetSpinOnly( mode == Mode::Spin );
+
+    const Timestamp interval = kSecond / fps;
+    const Timestamp work = interval * workPercent / 100;
+    const unsigned int frames = (unsigned int)std::max<Timestamp>( duration / interval, 10 );
+    std::vector<Timestamp> lateness;
+    lateness.reserve( frames );
+
+    const Timestamp start = GetTimestamp();
+    Timestamp deadline = start;
+    Timestamp wake = start;
+    for ( unsigned int i = 0; i < frames; ++i )
+    {
+        Busy( work );
+        if ( mode == Mode::Relative )
+        {
+            // The target is relative to the previous wake-up, so every late wake-up moves the whole schedule.
+            deadline = wake + interval;
+            const Timestamp remaining = deadline - GetTimestamp();
+            if ( remaining > 0 )
+            {
+                std::this_thread::sleep_for( std::chrono::nanoseconds( remaining ) );
+            }
+            wake = GetTimestamp();
+        }
+        else
+        {
+            deadline += interval;
+            wake = deadline + wait.WaitUntil( deadline );
+        }
+        lateness.push_back( wake > deadline ? wake - deadline : 0 );
+    }
+    const Timestamp end = wake;
+
+    Result result;
+    result.fps = (double)frames * kSecond / ( end - start );
+    result.driftMs = (double)( end - ( start + frames * interval ) ) / kMillisecond;
+    result.spinThreshold = mode == Mode::Relative ? 0 : wait.GetSpinThreshold();
+
+    unsigned int misses = 0;
+    double sum = 0.0;
+    for ( Timestamp late : lateness )
+    {
+        const Timestamp us = late / kMicrosecond;
+        int bucket = 0;
+        while ( bucket < kBucketCount - 1 && us >= kBuckets[ bucket ] )
+        {
+            ++bucket;
+        }
+        result.histogram[ bucket ]++;
+        misses += late > tolerance ? 1 : 0;
+        sum += (double)late;
+    }
+    std::sort( lateness.begin(), lateness.end() );
+    result.meanUs = sum / lateness.size() / kMicrosecond;
+    result.p99Us = (double)lateness[ lateness.size() * 99 / 100 ] / kMicrosecond;
+    result.maxUs = (double)lateness.back() / kMicrosecond;
+    result.missPercent = 100.0 * misses / lateness.size();
+    return result;
+}
+
+static void PrintHeader( Timestamp tolerance )
+{
+    printf( "%6s %-10s %8s %8s | %7s %7s %8s %6s | %6s |",
+            "target", "mode", "fps", "drift", "mean", "p99", "max", "miss", "spin" );
+    for ( int i = 0; i < kBucketCount - 1; ++i )
+    {
+        printf( " %6s", "" );
+    }
+    printf( " %6s\n", "" );
+    printf( "%6s %-10s %8s %8s | %7s %7s %8s %5lldus | %6s |",
+            "fps", "", "", "ms", "us", "us", "us", (long long)( tolerance / kMicrosecond ), "us" );
+    for ( int i = 0; i < kBucketCount - 1; ++i )
+    {
+        char label[ 16 ];
+        snprintf( label, sizeof( label ), "<%lld", (long long)kBuckets[ i ] );
+        printf( " %6s", label );
+    }
+    printf( " %6s\n", ">=1000" );
+}
+
+static void PrintResult( unsigned int fps, Mode mode, const Result& result )
+{
+    printf( "%6u %-10s %8.1f %8.3f | %7.1f %7.1f %8.1f %5.1f%% | %6lld |",
+            fps, ModeName( mode ), result.fps, result.driftMs, result.meanUs, result.p99Us, result.maxUs, result.missPercent,
+            (long long)( result.spinThreshold / kMicrosecond ) );
+    for ( int i = 0; i < kBucketCount; ++i )
+    {
+        printf( " %6u", result.histogram[ i ] );
+    }
+    printf( "\n" );
+}
+
+static void PrintUsage()
+{
+    printf( "Usage: WaitBench [options]\n"
+            "  --mode relative|hybrid|calibrated|spin   wait implementation (default: all but spin)\n"
+            "  --fps N[,N...]                           framerate targets (default: 30,60,90,120,144,165,240,360)\n"
+            "  --seconds S                              duration of each run\n"
+            "  --work PERCENT                           busy time per frame before the wait\n"
+            "  --tolerance US                           lateness counted as a missed deadline\n" );
+}
+
+int main( int argc, char** argv )
+{
+    std::vector<Mode> modes = { Mode::Relative, Mode::Hybrid, Mode::Calibrated };
+    std::vector<unsigned int> targets = { 30, 60, 90, 120, 144, 165, 240, 360 };
+    Timestamp duration = kSecond;
+    unsigned int workPercent = 50;
+    Timestamp tolerance = 50 * kMicrosecond;
+
+    for ( int i = 1; i < argc; i += 2 )
+    {
+        const char* arg = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+        if ( !value )
+        {
+            PrintUsage();
+            return 1;
+        }
+        if ( !strcmp( arg, "--mode" ) )
+        {
+            Mode mode = !strcmp( value, "relative" ) ? Mode::Relative : !strcmp( value, "hybrid" ) ? Mode::Hybrid :
+                        !strcmp( value, "calibrated" ) ? Mode::Calibrated : Mode::Spin;
+            modes.assign( 1, mode );
+        }
+        else if ( !strcmp( arg, "--fps" ) )
+        {
+            targets.clear();
+            for ( const char* p = value; *p; )
+            {
+                char* next = nullptr;
+                unsigned long fps = strtoul( p, &next, 10 );
+                if ( fps )
+                {
+                    targets.push_back( (unsigned int)fps );
+                }
+                p = *next ? next + 1 : next;
+            }
+        }
+        else if ( !strcmp( arg, "--seconds" ) )   duration = (Timestamp)( atof( value ) * kSecond );
+        else if ( !strcmp( arg, "--work" ) )      workPercent = std::min( (unsigned int)atoi( value ), 95u );
+        else if ( !strcmp( arg, "--tolerance" ) ) tolerance = (Timestamp)( atof( value ) * kMicrosecond );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    PrintHeader( tolerance );
+    for ( unsigned int fps : targets )
+    {
+        for ( Mode mode : modes )
+        {
+            PrintResult( fps, mode, Run( mode, fps, duration, workPercent, tolerance ) );
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,253 @@
+//
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: al2top.cpp
+//
+// Live monitor for a game that publishes its Anti-Lag 2.0 state through a
+// SharedTelemetryWriter. Reads the shared memory ring without ever blocking the game and
+// prints one line per interval: the framerate, whether Anti-Lag 2.0 is enabled, the
+// limit passed to the backend, and percentiles of the delay and the frame time.
+//--------------------------------------------------------------------------------------
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <signal.h>
+#endif
+
+#include "../../ffx_antilag2_shared.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace AMD::AntiLag2;
+
+// Frames the reader stays behind the newest one, so that the frame type of a frame presented after the next Update is in.
+static const std::uint64_t kFrameLag = 2;
+
+// How often the ring is read. It holds about a second of frames at 1000 fps.
+static const Timestamp kPollInterval = 50 * kMillisecond;
+
+// What was read of the frames since the last line.
+struct Interval
+{
+    std::vector<Timestamp>  delays;
+    std::vector<Timestamp>  frameTimes;
+    unsigned int            frames = 0;
+    unsigned int            enabled = 0;
+    unsigned int            interpolated = 0;
+    unsigned int            missed = 0;         // overwritten before they were read
+    unsigned int            maxFPS = 0;         // of the newest frame
+    Timestamp               first = 0;
+    Timestamp               last = 0;
+};
+
+static double Percentile( std::vector<Timestamp>& values, unsigned int percent )
+{
+    if ( values.empty() )
+    {
+        return 0.0;
+    }
+    std::sort( values.begin(), values.end() );
+    return (double)values[ ( values.size() - 1 ) * percent / 100 ] / kMillisecond;
+}
+
+static void PrintHeader( std::uint32_t processId )
+{
+    printf( "process %u\n", processId );
+    printf( "%10s %8s %5s %6s | %7s %7s %7s | %7s %7s %7s | %5s %6s\n",
+            "frame", "fps", "al2", "maxfps", "delay", "delay", "delay", "frame", "frame", "frame", "fg", "missed" );
+    printf( "%10s %8s %5s %6s | %7s %7s %7s | %7s %7s %7s | %5s %6s\n",
+            "", "", "%", "", "p50 ms", "p95 ms", "p99 ms", "p50 ms", "p95 ms", "p99 ms", "%", "" );
+}
+
+static void PrintInterval( std::uint64_t frameIndex, Interval& interval )
+{
+    const double fps = interval.last > interval.first ? (double)interval.frameTimes.size() * kSecond / ( interval.last - interval.first ) : 0.0;
+    printf( "%10llu %8.1f %5.0f %6u | %7.2f %7.2f %7.2f | %7.2f %7.2f %7.2f | %5.0f %6u\n",
+            (unsigned long long)frameIndex, fps, 100.0 * interval.enabled / interval.frames, interval.maxFPS,
+            Percentile( interval.delays, 50 ), Percentile( interval.delays, 95 ), Percentile( interval.delays, 99 ),
+            Percentile( interval.frameTimes, 50 ), Percentile( interval.frameTimes, 95 ), Percentile( interval.frameTimes, 99 ),
+            100.0 * interval.interpolated / interval.frames, interval.missed );
+    fflush( stdout );
+}
+
+// Finds a process that publishes its telemetry. Only possible where the shared memory objects can be listed.
+static std::uint32_t FindProcess()
+{
+#if defined(_WIN32)
+    return 0;
+#else
+    std::uint32_t found = 0;
+    Timestamp latest = 0;
+    if ( DIR* dir = opendir( "/dev/shm" ) )
+    {
+        const char prefix[] = "amd_antilag2_telemetry_";
+        while ( const dirent* entry = readdir( dir ) )
+        {
+            if ( strncmp( entry->d_name, prefix, sizeof( prefix ) - 1 ) )
+            {
+                continue;
+            }
+            // A game that crashed leaves its ring behind. Pick the one that published last.
+            const std::uint32_t processId = (std::uint32_t)strtoul( entry->d_name + sizeof( prefix ) - 1, nullptr, 10 );
+            SharedTelemetryReader reader;
+            SharedFrame frame;
+            if ( processId && kill( (pid_t)processId, 0 ) == 0 && reader.Open( processId ) && reader.IsWriterOpen() &&
+                 reader.GetFrame( reader.GetLatestFrameIndex(), &frame ) && frame.updateEntry > latest )
+            {
+                found = processId;
+                latest = frame.updateEntry;
+            }
+        }
+        closedir( dir );
+    }
+    return found;
+#endif
+}
+
+static void PrintUsage()
+{
+    printf( "Usage: al2top [options]\n"
+            "  --pid N           process to monitor (default: the one that published last, Linux only)\n"
+            "  --interval MS     time between lines (default: 1000)\n"
+            "  --count N         exit after N lines (default: run until the process closes its telemetry)\n" );
+}
+
+int main( int argc, char** argv )
+{
+    std::uint32_t processId = 0;
+    Timestamp lineInterval = kSecond;
+    unsigned int count = 0;
+    for ( int i = 1; i < argc; ++i )
+    {
+        const char* arg = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : "";
+        if ( !strcmp( arg, "--pid" ) )
+        {
+            processId = (std::uint32_t)strtoul( value, nullptr, 10 );
+        }
+        else if ( !strcmp( arg, "--interval" ) )
+        {
+            lineInterval = (Timestamp)( atof( value ) * kMillisecond );
+        }
+        else if ( !strcmp( arg, "--count" ) )
+        {
+            count = (unsigned int)atoi( value );
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+        ++i;
+    }
+    if ( lineInterval < kPollInterval )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if ( processId == 0 )
+    {
+        processId = FindProcess();
+    }
+    SharedTelemetryReader reader;
+    if ( processId == 0 || !reader.Open( processId ) )
+    {
+        fprintf( stderr, processId ? "Process %u does not publish Anti-Lag 2.0 telemetry\n" : "No process publishes Anti-Lag 2.0 telemetry\n", processId );
+        return 1;
+    }
+
+    PrintHeader( processId );
+    Interval interval;
+    SharedFrame previous = {};
+    std::uint64_t next = 0;
+    unsigned int lines = 0;
+    Timestamp lineDeadline = GetTimestamp() + lineInterval;
+    while ( reader.IsWriterOpen() )
+    {
+        const std::uint64_t latest = reader.GetLatestFrameIndex();
+        const std::uint64_t end = latest > kFrameLag ? latest - kFrameLag : 0;
+        if ( next == 0 || next + SharedTelemetry::kCapacity < end )
+        {
+            // Start with the newest frame, or skip what the ring no longer holds after a stall.
+            interval.missed += next ? (unsigned int)( end - next ) : 0;
+            next = end;
+            previous = {};
+        }
+        for ( ; next < end; ++next )
+        {
+            SharedFrame frame;
+            if ( !reader.GetFrame( next, &frame ) )
+            {
+                ++interval.missed;
+                previous = {};
+                continue;
+            }
+            interval.delays.push_back( frame.delay );
+            interval.frames++;
+            interval.enabled += frame.enabled;
+            interval.interpolated += ( frame.frameType & kFrameTypeInterpolated ) != 0;
+            interval.maxFPS = frame.maxFPS;
+            if ( previous.frameIndex + 1 == frame.frameIndex )
+            {
+                interval.frameTimes.push_back( frame.updateEntry - previous.updateEntry );
+                interval.first = interval.first ? interval.first : previous.updateEntry;
+                interval.last = frame.updateEntry;
+            }
+            previous = frame;
+        }
+
+        const Timestamp now = GetTimestamp();
+        if ( now >= lineDeadline )
+        {
+            if ( interval.frames )
+            {
+                PrintInterval( next - 1, interval );
+            }
+            else
+            {
+                printf( "%10llu   no frames\n", (unsigned long long)latest );
+                fflush( stdout );
+            }
+            interval = Interval();
+            lineDeadline += lineInterval;
+            if ( count && ++lines == count )
+            {
+                return 0;
+            }
+        }
+        // A monitor has no use for a precise wake-up, so it does not spin like PreciseWait.
+        std::this_thread::sleep_for( std::chrono::nanoseconds( std::min( kPollInterval, lineDeadline - GetTimestamp() ) ) );
+    }
+    printf( "Process %u closed its telemetry\n", processId );
+    return 0;
+}